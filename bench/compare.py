@@ -0,0 +1,53 @@
+#!/usr/bin/env python3
+"""Compare the farmhash64-bench/1 JSON results of the language ports.
+
+Usage: compare.py <result.json> [<result.json> ...]
+
+Prints one table per metric with a row for each size class and a column for each port,
+and exits with an error if the checksums differ, i.e. if the ports did not hash the same data
+to the same values.
+"""
+
+import json
+import sys
+
+SCHEMA = "farmhash64-bench/1"
+METRICS = ["ns_per_hash", "gb_per_s", "allocs_per_hash", "alloc_bytes_per_hash"]
+
+
+def load(path):
+    with open(path, encoding="utf-8") as f:
+        doc = json.load(f)
+    if doc.get("schema") != SCHEMA:
+        raise SystemExit("%s: unsupported schema %r" % (path, doc.get("schema")))
+    return "%s/%s" % (doc["lang"], doc["impl"]), {r["size"]: r for r in doc["results"]}
+
+
+def fmt(v):
+    return "-" if v is None else ("%.3f" % v)
+
+
+def main(paths):
+    runs = [load(p) for p in paths]
+    sizes = sorted(set().union(*(r.keys() for _, r in runs)))
+    names = [name for name, _ in runs]
+    width = max([12] + [len(n) for n in names])
+    errors = 0
+    for size in sizes:
+        sums = {r[size]["checksum"] for _, r in runs if size in r}
+        if len(sums) > 1:
+            print("checksum mismatch for size %d: %s" % (size, ", ".join(sorted(sums))))
+            errors += 1
+    for metric in METRICS:
+        print("\n%s" % metric)
+        print("%10s" % "size" + "".join(n.rjust(width + 2) for n in names))
+        for size in sizes:
+            cells = [fmt(r[size].get(metric)) if size in r else "" for _, r in runs]
+            print("%10d" % size + "".join(c.rjust(width + 2) for c in cells))
+    return 1 if errors else 0
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        raise SystemExit(__doc__)
+    sys.exit(main(sys.argv[1:]))
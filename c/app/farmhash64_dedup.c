@@ -0,0 +1,218 @@
+// Nicola Asuni
+
+// farmhash64-dedup: remove the duplicate lines of inputs larger than the available memory.
+// See src/farmhash64_dedup.h for the algorithm.
+
+#define _XOPEN_SOURCE 700
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../src/farmhash64_dedup.h"
+
+#ifndef VERSION
+#define VERSION "0.0.0-0"
+#endif
+
+static void usage(FILE *f)
+{
+    fprintf(f,
+            "Usage: farmhash64-dedup [OPTION]... [FILE]...\n"
+            "Write the distinct lines of the FILEs (or standard input) to standard output.\n"
+            "Works with inputs larger than memory: the lines are spilled to hash partitions on disk,\n"
+            "then each partition is deduplicated in memory.\n"
+            "\n"
+            "  -s        stable: keep the first occurrence of each line, in input order\n"
+            "            (default: unspecified order)\n"
+            "  -c        only print the number of distinct lines (64-bit fingerprints)\n"
+            "  -z        lines are terminated by NUL instead of newline\n"
+            "  -o FILE   write the output to FILE instead of standard output\n"
+            "  -t NUM    number of dedup threads (default: number of online CPUs)\n"
+            "  -m MIB    memory budget in MiB, shared by the threads (default: 1024)\n"
+            "  -b BITS   number of partition bits, 0 to %d (default: 8)\n"
+            "  -T DIR    directory of the temporary files (default: $TMPDIR or /tmp)\n"
+            "  -v        print statistics to standard error\n"
+            "  -V        print the version and exit\n"
+            "  -h        print this help and exit\n",
+            FARMHASH64_DEDUP_MAX_BITS);
+}
+
+static const char *status_string(int ret)
+{
+    switch (ret)
+    {
+    case FARMHASH64_DEDUP_ERR_ARGS:
+        return "invalid arguments or record longer than 4 GiB";
+    case FARMHASH64_DEDUP_ERR_MEMORY:
+        return "out of memory";
+    case FARMHASH64_DEDUP_ERR_IO:
+        return strerror(errno);
+    case FARMHASH64_DEDUP_ERR_BUDGET:
+        return "the distinct lines of a single hash do not fit in the memory budget (increase -m)";
+    default:
+        return "unknown error";
+    }
+}
+
+// parses a decimal number in [min, max], returns -1 on error
+static long parse_num(const char *s, long min, long max)
+{
+    char *end;
+    errno = 0;
+    long v = strtol(s, &end, 10);
+    if ((errno != 0) || (end == s) || (*end != 0) || (v < min) || (v > max))
+    {
+        return -1;
+    }
+    return v;
+}
+
+int main(int argc, char *argv[])
+{
+    farmhash64_dedup_opts_t opts;
+    farmhash64_dedup_default_opts(&opts);
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    opts.nthreads = (ncpu < 1) ? 1 : ((ncpu > FARMHASH64_DEDUP_MAX_THREADS) ? FARMHASH64_DEDUP_MAX_THREADS : (unsigned)ncpu);
+    const char *output = NULL;
+    int verbose = 0;
+    long v;
+    int c;
+    while ((c = getopt(argc, argv, "sczo:t:m:b:T:vVh")) != -1)
+    {
+        switch (c)
+        {
+        case 's':
+            opts.stable = 1;
+            break;
+        case 'c':
+            opts.count_only = 1;
+            break;
+        case 'z':
+            opts.delim = 0;
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        case 't':
+            if ((v = parse_num(optarg, 1, FARMHASH64_DEDUP_MAX_THREADS)) < 0)
+            {
+                fprintf(stderr, "farmhash64-dedup: invalid number of threads: %s\n", optarg);
+                return 2;
+            }
+            opts.nthreads = (unsigned)v;
+            break;
+        case 'm':
+            if ((v = parse_num(optarg, 1, (long)(SIZE_MAX >> 21))) < 0)
+            {
+                fprintf(stderr, "farmhash64-dedup: invalid memory budget: %s\n", optarg);
+                return 2;
+            }
+            opts.mem_bytes = (size_t)v << 20;
+            break;
+        case 'b':
+            if ((v = parse_num(optarg, 0, FARMHASH64_DEDUP_MAX_BITS)) < 0)
+            {
+                fprintf(stderr, "farmhash64-dedup: invalid number of partition bits: %s\n", optarg);
+                return 2;
+            }
+            opts.bits = (uint32_t)v;
+            break;
+        case 'T':
+            opts.tmpdir = optarg;
+            break;
+        case 'v':
+            verbose = 1;
+            break;
+        case 'V':
+            fprintf(stdout, "farmhash64-dedup %s\n", VERSION);
+            return 0;
+        case 'h':
+            usage(stdout);
+            return 0;
+        default:
+            usage(stderr);
+            return 2;
+        }
+    }
+    // each thread needs at least the minimum budget
+    if (opts.mem_bytes / opts.nthreads < FARMHASH64_DEDUP_MIN_MEMORY)
+    {
+        opts.nthreads = (unsigned)(opts.mem_bytes / FARMHASH64_DEDUP_MIN_MEMORY);
+    }
+    int nin = (optind < argc) ? (argc - optind) : 1;
+    int *fds = (int *)malloc((size_t)nin * sizeof(int));
+    if (fds == NULL)
+    {
+        fprintf(stderr, "farmhash64-dedup: out of memory\n");
+        return 1;
+    }
+    int i;
+    int ret = 0;
+    for (i = 0; i < nin; i++)
+    {
+        const char *name = (optind < argc) ? argv[optind + i] : "-";
+        fds[i] = (strcmp(name, "-") == 0) ? STDIN_FILENO : open(name, O_RDONLY);
+        if (fds[i] < 0)
+        {
+            fprintf(stderr, "farmhash64-dedup: %s: %s\n", name, strerror(errno));
+            nin = i;
+            ret = 1;
+            break;
+        }
+    }
+    int out = STDOUT_FILENO;
+    if ((ret == 0) && (output != NULL) && !opts.count_only)
+    {
+        out = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out < 0)
+        {
+            fprintf(stderr, "farmhash64-dedup: %s: %s\n", output, strerror(errno));
+            ret = 1;
+        }
+    }
+    if (ret == 0)
+    {
+        farmhash64_dedup_stats_t stats;
+        struct timespec t0;
+        struct timespec t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        int st = farmhash64_dedup_run(fds, (size_t)nin, out, &opts, &stats);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        if (st != FARMHASH64_DEDUP_OK)
+        {
+            fprintf(stderr, "farmhash64-dedup: %s\n", status_string(st));
+            ret = 1;
+        }
+        else
+        {
+            if (opts.count_only)
+            {
+                fprintf(stdout, "%" PRIu64 "\n", stats.distinct);
+            }
+            if (verbose)
+            {
+                double s = (double)(t1.tv_sec - t0.tv_sec) + ((double)(t1.tv_nsec - t0.tv_nsec) / 1e9);
+                fprintf(stderr,
+                        "records: %" PRIu64 "\ndistinct: %" PRIu64 "\ninput bytes: %" PRIu64 "\nspilled bytes: %" PRIu64 "\nsplits: %" PRIu64 "\npartition bits: %u\nthreads: %u\ntime: %.3f s (%.1f MB/s)\n",
+                        stats.records, stats.distinct, stats.bytes_in, stats.bytes_spill, stats.splits, stats.bits, stats.nthreads, s, (s > 0) ? ((double)stats.bytes_in / s / 1e6) : 0.0);
+            }
+        }
+    }
+    if ((out != STDOUT_FILENO) && (out >= 0) && (close(out) != 0))
+    {
+        fprintf(stderr, "farmhash64-dedup: %s: %s\n", output, strerror(errno));
+        ret = 1;
+    }
+    for (i = 0; i < nin; i++)
+    {
+        if (fds[i] != STDIN_FILENO)
+        {
+            close(fds[i]);
+        }
+    }
+    free(fds);
+    return ret;
+}
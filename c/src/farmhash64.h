@@ -26,6 +26,9 @@ extern "C" {
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 
 // PORTABILITY LAYER: endianness and byteswapping functions
@@ -569,6 +572,21 @@ static inline uint64_t farmhash_len_16_mul(uint64_t u, uint64_t v, uint64_t mul)
     return b;
 }
 
+/**
+ * @brief Calculate a 64-bit hash code for a byte array of length 16.
+ *
+ * @param u First 64 bits of the byte array
+ * @param v Last 64 bits of the byte array
+ *
+ * @return 64-bit hash code
+ *
+ * @private
+ */
+static inline uint64_t farmhash_len_16(uint64_t u, uint64_t v)
+{
+    return farmhash_len_16_mul(u, v, 0x9ddfea08eb382d69ULL);
+}
+
 /**
  * @brief Calculate a 64-bit hash code for a byte array of length 0 to 16.
  *
@@ -701,27 +719,114 @@ static inline uint128_t weak_farmhash_na_len_32_with_seeds(const char* s, uint64
             b);
 }
 
-// =================================================================================================
-// PUBLIC FUNCTIONS
-// =================================================================================================
+/**
+ * @brief Internal state of the farmhash64 loop over 64-byte blocks (56 bytes: v, w, x, y, and z).
+ *
+ * @private
+ */
+typedef struct farmhash_na_state_t
+{
+    uint128_t v; /**< State v. */
+    uint128_t w; /**< State w. */
+    uint64_t x;  /**< State x. */
+    uint64_t y;  /**< State y. */
+    uint64_t z;  /**< State z. */
+} farmhash_na_state_t;
 
 /**
- * @brief 64 bit hash.
+ * @brief Initialize the loop state for an input longer than 64 bytes.
  *
- * Returns a 64-bit fingerprint hash for a byte array.
+ * @param st    State to initialize
+ * @param first First 64-bit word of the input
  *
- * This function is not suitable for cryptography.
+ * @private
+ */
+static inline void farmhash_na_init(farmhash_na_state_t *st, uint64_t first)
+{
+    const uint64_t seed = 81;
+    st->v = make_uint128_t(0, 0);
+    st->w = make_uint128_t(0, 0);
+    st->x = (seed * k2) + first;
+    st->y = (seed * k1) + 113;
+    st->z = smix((st->y * k2) + 113) * k2;
+}
+
+/**
+ * @brief Process a 64-byte block of the input (all blocks except the last one).
  *
- * @param s   string to process
- * @param len string length
+ * @param st State
+ * @param s  Pointer to the block
+ *
+ * @private
+ */
+static inline void farmhash_na_block(farmhash_na_state_t *st, const char *s)
+{
+    uint128_t v = st->v;
+    uint128_t w = st->w;
+    uint64_t x = st->x;
+    uint64_t y = st->y;
+    uint64_t z = st->z;
+    x = ror64(x + y + v.lo + fetch64(s + 8), 37) * k1;
+    y = ror64(y + v.hi + fetch64(s + 48), 42) * k1;
+    x ^= w.hi;
+    y += v.lo + fetch64(s + 40);
+    z = ror64(z + w.lo, 33) * k1;
+    v = weak_farmhash_na_len_32_with_seeds(s, v.hi * k1, x + w.lo);
+    w = weak_farmhash_na_len_32_with_seeds(s + 32, z + w.hi, y + fetch64(s + 16));
+    st->v = v;
+    st->w = w;
+    st->x = z;
+    st->y = y;
+    st->z = x;
+}
+
+/**
+ * @brief Process the last 64 bytes of the input and return the hash.
+ *
+ * @param st  State
+ * @param s   Pointer to the last 64 bytes of the input (which may overlap the last processed block)
+ * @param len Length of the whole input
  *
  * @return 64-bit hash code
  *
- * @public
+ * @private
  */
-static inline uint64_t farmhash64(const char *s, size_t len)
+static inline uint64_t farmhash_na_final(const farmhash_na_state_t *st, const char *s, size_t len)
+{
+    uint128_t v = st->v;
+    uint128_t w = st->w;
+    uint64_t x = st->x;
+    uint64_t y = st->y;
+    uint64_t z = st->z;
+    uint64_t mul = k1 + ((z & 0xff) << 1);
+    w.lo += ((len - 1) & 63);
+    v.lo += w.lo;
+    w.lo += v.lo;
+    x = ror64(x + y + v.lo + fetch64(s + 8), 37) * mul;
+    y = ror64(y + v.hi + fetch64(s + 48), 42) * mul;
+    x ^= w.hi * 9;
+    y += v.lo * 9 + fetch64(s + 40);
+    z = ror64(z + w.lo, 33) * mul;
+    v = weak_farmhash_na_len_32_with_seeds(s, v.hi * mul, x + w.lo);
+    w = weak_farmhash_na_len_32_with_seeds(s + 32, z + w.hi, y + fetch64(s + 16));
+    swap64(&z, &x);
+    return farmhash_len_16_mul(farmhash_len_16_mul(v.lo, w.lo, mul) + (smix(y) * k0) + z,
+                               farmhash_len_16_mul(v.hi, w.hi, mul) + x,
+                               mul);
+}
+
+/**
+ * @brief Calculate the 64-bit Fingerprint64 (farmhashna::Hash64) hash code for a byte array.
+ *
+ * @param s   Pointer to the byte array
+ * @param len Length of the byte array
+ *
+ * @return 64-bit hash code
+ *
+ * @private
+ */
+static inline uint64_t farmhash_na_hash64(const char *s, size_t len)
 {
-    const uint64_t seed = 81;
     if (len <= 32)
     {
         if (len <= 16)
@@ -735,67 +840,1047 @@ static inline uint64_t farmhash64(const char *s, size_t len)
         return farmhash_na_len_33_to_64(s, len);
     }
     // For strings over 64 bytes we loop.
-    // Internal state consists of 56 bytes: v, w, x, y, and z.
-    uint128_t v = make_uint128_t(0, 0);
-    uint128_t w = make_uint128_t(0, 0);
-    uint64_t x = (seed * k2) + fetch64(s);
-    uint64_t y = (seed * k1) + 113;
-    uint64_t z = smix((y * k2) + 113) * k2;
+    farmhash_na_state_t st = {{0, 0}, {0, 0}, 0, 0, 0};
+    farmhash_na_init(&st, fetch64(s));
     // Set end so that after the loop we have 1 to 64 bytes left to process.
     const char* end = s + (((len - 1) >> 6) << 6);
     const char* last64 = end + ((len - 1) & 63) - 63;
     assert(s + len - 64 == last64);
     while (s != end)
     {
-        x = ror64(x + y + v.lo + fetch64(s + 8), 37) * k1;
-        y = ror64(y + v.hi + fetch64(s + 48), 42) * k1;
-        x ^= w.hi;
-        y += v.lo + fetch64(s + 40);
-        z = ror64(z + w.lo, 33) * k1;
-        v = weak_farmhash_na_len_32_with_seeds(s, v.hi * k1, x + w.lo);
-        w = weak_farmhash_na_len_32_with_seeds(s + 32, z + w.hi, y + fetch64(s + 16));
-        swap64(&z, &x);
+        farmhash_na_block(&st, s);
         s += 64;
     }
-    uint64_t mul = k1 + ((z & 0xff) << 1);
-    // Make s point to the last 64 bytes of input.
-    s = last64;
-    w.lo += ((len - 1) & 63);
-    v.lo += w.lo;
-    w.lo += v.lo;
-    x = ror64(x + y + v.lo + fetch64(s + 8), 37) * mul;
-    y = ror64(y + v.hi + fetch64(s + 48), 42) * mul;
-    x ^= w.hi * 9;
-    y += v.lo * 9 + fetch64(s + 40);
-    z = ror64(z + w.lo, 33) * mul;
-    v = weak_farmhash_na_len_32_with_seeds(s, v.hi * mul, x + w.lo);
-    w = weak_farmhash_na_len_32_with_seeds(s + 32, z + w.hi, y + fetch64(s + 16));
-    swap64(&z, &x);
-    return farmhash_len_16_mul(farmhash_len_16_mul(v.lo, w.lo, mul) + (smix(y) * k0) + z,
-                               farmhash_len_16_mul(v.hi, w.hi, mul) + x,
-                               mul);
+    // Process the last 64 bytes of input.
+    return farmhash_na_final(&st, last64, len);
 }
 
+// =================================================================================================
+// FARMHASH MK (native 32-bit Fingerprint32)
+// =================================================================================================
+
 /**
- * @brief 32 bit hash.
+ * @brief Fetch a 32-bit little-endian integer from a byte array, as a 32-bit value.
  *
- * Returns a 32-bit fingerprint hash for a byte array.
+ * @param p Pointer to the byte array
  *
- * NOTE: This is NOT equivalent to the original Fingerprint32 function.
- * It is a new function based on farmhash64.
+ * @return The fetched 32-bit integer
  *
- * This function is not suitable for cryptography.
+ * @private
+ */
+static inline uint32_t farmhash_mk_fetch32(const char* p)
+{
+    uint32_t result = 0;
+    memcpy(&result, p, sizeof(result));
+    return uint32_t_in_expected_order(result);
+}
+
+/**
+ * @brief Murmur3 32-bit finalizer.
  *
- * @param s   string to process
- * @param len string length
+ * @param h Hash value
+ *
+ * @return Mixed hash value
+ *
+ * @private
+ */
+static inline uint32_t farmhash_mk_fmix(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+/**
+ * @brief Calculate the farmhashmk 32-bit hash code for a byte array of length 13 to 24.
+ *
+ * @param s    Pointer to the byte array
+ * @param len  Length of the byte array
+ * @param seed Seed value
  *
  * @return 32-bit hash code
  *
- * @public
+ * @private
  */
-static inline uint32_t farmhash32(const char *s, size_t len)
+static inline uint32_t farmhash_mk_len_13_to_24(const char *s, size_t len, uint32_t seed)
 {
-    return mix_64_to_32(farmhash64(s, len));
+    uint32_t a = farmhash_mk_fetch32(s - 4 + (len >> 1));
+    uint32_t b = farmhash_mk_fetch32(s + 4);
+    uint32_t c = farmhash_mk_fetch32(s + len - 8);
+    uint32_t d = farmhash_mk_fetch32(s + (len >> 1));
+    uint32_t e = farmhash_mk_fetch32(s);
+    uint32_t f = farmhash_mk_fetch32(s + len - 4);
+    uint32_t h = (d * c1) + (uint32_t)len + seed;
+    a = ror32(a, 12) + f;
+    h = mur(c, h) + a;
+    a = ror32(a, 3) + c;
+    h = mur(e, h) + a;
+    a = ror32(a + f, 12) + d;
+    h = mur(b ^ seed, h) + a;
+    return farmhash_mk_fmix(h);
+}
+
+/**
+ * @brief Calculate the farmhashmk 32-bit hash code for a byte array of length 0 to 4.
+ *
+ * @param s    Pointer to the byte array
+ * @param len  Length of the byte array
+ * @param seed Seed value
+ *
+ * @return 32-bit hash code
+ *
+ * @private
+ */
+static inline uint32_t farmhash_mk_len_0_to_4(const char *s, size_t len, uint32_t seed)
+{
+    uint32_t b = seed;
+    uint32_t c = 9;
+    size_t i;
+    for (i = 0; i < len; i++)
+    {
+        // the bytes are added as signed values, as in the reference implementation
+        signed char v = (signed char)s[i];
+        b = (b * c1) + (uint32_t)v;
+        c ^= b;
+    }
+    return farmhash_mk_fmix(mur(b, mur((uint32_t)len, c)));
+}
+
+/**
+ * @brief Calculate the farmhashmk 32-bit hash code for a byte array of length 5 to 12.
+ *
+ * @param s    Pointer to the byte array
+ * @param len  Length of the byte array
+ * @param seed Seed value
+ *
+ * @return 32-bit hash code
+ *
+ * @private
+ */
+static inline uint32_t farmhash_mk_len_5_to_12(const char *s, size_t len, uint32_t seed)
+{
+    uint32_t a = (uint32_t)len;
+    uint32_t b = (uint32_t)len * 5;
+    uint32_t c = 9;
+    uint32_t d = b + seed;
+    a += farmhash_mk_fetch32(s);
+    b += farmhash_mk_fetch32(s + len - 4);
+    c += farmhash_mk_fetch32(s + ((len >> 1) & 4));
+    return farmhash_mk_fmix(seed ^ mur(c, mur(b, mur(a, d))));
+}
+
+/**
+ * @brief Calculate the farmhashmk 32-bit hash code for a byte array (upstream farmhashmk::Hash32).
+ *
+ * Inputs longer than 24 bytes are processed in 20-byte blocks with five 32-bit lanes.
+ *
+ * @param s   Pointer to the byte array
+ * @param len Length of the byte array
+ *
+ * @return 32-bit hash code
+ *
+ * @private
+ */
+static inline uint32_t farmhash_mk_hash32(const char *s, size_t len)
+{
+    if (len <= 24)
+    {
+        if (len <= 12)
+        {
+            if (len <= 4)
+            {
+                return farmhash_mk_len_0_to_4(s, len, 0);
+            }
+            return farmhash_mk_len_5_to_12(s, len, 0);
+        }
+        return farmhash_mk_len_13_to_24(s, len, 0);
+    }
+    // len > 24
+    uint32_t h = (uint32_t)len;
+    uint32_t g = c1 * (uint32_t)len;
+    uint32_t f = g;
+    uint32_t a0 = ror32(farmhash_mk_fetch32(s + len - 4) * c1, 17) * c2;
+    uint32_t a1 = ror32(farmhash_mk_fetch32(s + len - 8) * c1, 17) * c2;
+    uint32_t a2 = ror32(farmhash_mk_fetch32(s + len - 16) * c1, 17) * c2;
+    uint32_t a3 = ror32(farmhash_mk_fetch32(s + len - 12) * c1, 17) * c2;
+    uint32_t a4 = ror32(farmhash_mk_fetch32(s + len - 20) * c1, 17) * c2;
+    h ^= a0;
+    h = ror32(h, 19);
+    h = (h * 5) + 0xe6546b64;
+    h ^= a2;
+    h = ror32(h, 19);
+    h = (h * 5) + 0xe6546b64;
+    g ^= a1;
+    g = ror32(g, 19);
+    g = (g * 5) + 0xe6546b64;
+    g ^= a3;
+    g = ror32(g, 19);
+    g = (g * 5) + 0xe6546b64;
+    f += a4;
+    f = ror32(f, 19) + 113;
+    size_t iters = (len - 1) / 20;
+    do
+    {
+        uint32_t a = farmhash_mk_fetch32(s);
+        uint32_t b = farmhash_mk_fetch32(s + 4);
+        uint32_t c = farmhash_mk_fetch32(s + 8);
+        uint32_t d = farmhash_mk_fetch32(s + 12);
+        uint32_t e = farmhash_mk_fetch32(s + 16);
+        h += a;
+        g += b;
+        f += c;
+        h = mur(d, h) + e;
+        g = mur(c, g) + a;
+        f = mur(b + (e * c1), f) + d;
+        f += g;
+        g += f;
+        s += 20;
+    } while (--iters != 0);
+    g = ror32(g, 11) * c1;
+    g = ror32(g, 17) * c1;
+    f = ror32(f, 11) * c1;
+    f = ror32(f, 17) * c1;
+    h = ror32(h + g, 19);
+    h = (h * 5) + 0xe6546b64;
+    h = ror32(h, 17) * c1;
+    h = ror32(h + f, 19);
+    h = (h * 5) + 0xe6546b64;
+    h = ror32(h, 17) * c1;
+    return h;
+}
+
+/**
+ * @brief Calculate the seeded farmhashmk 32-bit hash code for a byte array (upstream farmhashmk::Hash32WithSeed).
+ *
+ * @param s    Pointer to the byte array
+ * @param len  Length of the byte array
+ * @param seed Seed value
+ *
+ * @return 32-bit hash code
+ *
+ * @private
+ */
+static inline uint32_t farmhash_mk_hash32_with_seed(const char *s, size_t len, uint32_t seed)
+{
+    if (len <= 24)
+    {
+        if (len >= 13)
+        {
+            return farmhash_mk_len_13_to_24(s, len, seed * c1);
+        }
+        if (len >= 5)
+        {
+            return farmhash_mk_len_5_to_12(s, len, seed);
+        }
+        return farmhash_mk_len_0_to_4(s, len, seed);
+    }
+    uint32_t h = farmhash_mk_len_13_to_24(s, 24, seed ^ (uint32_t)len);
+    return mur(farmhash_mk_hash32(s + 24, len - 24) + seed, h);
+}
+
+#ifdef FARMHASH64_STATS
+
+// =================================================================================================
+// OPTIONAL INSTRUMENTATION (compile with -DFARMHASH64_STATS)
+// =================================================================================================
+
+#ifndef FARMHASH64_STATS_CYCLES_SHIFT
+/**
+ * @brief Cycle sampling rate: one call every 2^FARMHASH64_STATS_CYCLES_SHIFT is timed.
+ *
+ * Define it as -1 to disable cycle sampling altogether.
+ */
+#define FARMHASH64_STATS_CYCLES_SHIFT 10
+#endif
+
+/**
+ * @brief Thread-local storage class specifier for the current compiler.
+ *
+ * @private
+ */
+#if defined(__cplusplus)
+#define FARMHASH64_THREAD_LOCAL thread_local
+#elif defined(_MSC_VER)
+#define FARMHASH64_THREAD_LOCAL __declspec(thread)
+#else
+#define FARMHASH64_THREAD_LOCAL _Thread_local
+#endif
+
+/**
+ * @brief Number of farmhash64 length branches tracked by the statistics.
+ */
+#define FARMHASH64_STATS_BRANCHES 4
+
+/**
+ * @brief Number of log2 length buckets tracked by the statistics.
+ */
+#define FARMHASH64_STATS_LEN_BUCKETS 65
+
+/**
+ * @brief Per-thread farmhash64 call statistics.
+ *
+ * Branch index: 0 = 0-16 bytes, 1 = 17-32 bytes, 2 = 33-64 bytes, 3 = more than 64 bytes.
+ * Length bucket index: 0 for empty input, otherwise floor(log2(len)) + 1.
+ */
+typedef struct farmhash64_stats_t
+{
+    uint64_t calls[FARMHASH64_STATS_BRANCHES];          /**< Number of calls per length branch. */
+    uint64_t cycles[FARMHASH64_STATS_BRANCHES];         /**< Sum of the sampled cycles per length branch. */
+    uint64_t samples[FARMHASH64_STATS_BRANCHES];        /**< Number of cycle samples per length branch. */
+    uint64_t len_calls[FARMHASH64_STATS_LEN_BUCKETS];   /**< Number of calls per log2 length bucket. */
+    uint64_t len_bytes[FARMHASH64_STATS_LEN_BUCKETS];   /**< Number of bytes hashed per log2 length bucket. */
+} farmhash64_stats_t;
+
+/**
+ * @brief Counters of the calling thread.
+ *
+ * By default each translation unit has its own static copy, so the statistics only cover the calls made
+ * from the translation unit that reads them. To share one set of counters per thread across the whole
+ * program, compile every translation unit with -DFARMHASH64_STATS_SHARED and define
+ * FARMHASH64_STATS_DEFINE before including this header in exactly one of them.
+ *
+ * @private
+ */
+#if defined(FARMHASH64_STATS_SHARED) || defined(FARMHASH64_STATS_DEFINE)
+extern FARMHASH64_THREAD_LOCAL farmhash64_stats_t farmhash64_stats_tls;
+#ifdef FARMHASH64_STATS_DEFINE
+FARMHASH64_THREAD_LOCAL farmhash64_stats_t farmhash64_stats_tls;
+#endif
+#else
+static FARMHASH64_THREAD_LOCAL farmhash64_stats_t farmhash64_stats_tls;
+#endif
+
+/**
+ * @brief Read the CPU timestamp counter, or return 0 when not available.
+ *
+ * @private
+ */
+static inline uint64_t farmhash64_stats_ticks(void)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    return __builtin_ia32_rdtsc();
+#elif defined(__GNUC__) && defined(__aarch64__)
+    uint64_t t = 0;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(t));
+    return t;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Return the log2 length bucket index for the specified length.
+ *
+ * @param len Length of the byte array
+ *
+ * @return Bucket index in the range [0, FARMHASH64_STATS_LEN_BUCKETS)
+ *
+ * @private
+ */
+static inline size_t farmhash64_stats_len_bucket(size_t len)
+{
+    if (len == 0)
+    {
+        return 0;
+    }
+#if defined(__GNUC__)
+    return (size_t)(64 - __builtin_clzll((unsigned long long)len));
+#else
+    size_t b = 0;
+    while (len != 0)
+    {
+        len >>= 1;
+        ++b;
+    }
+    return b;
+#endif
+}
+
+/**
+ * @brief Instrumented version of farmhash_na_hash64.
+ *
+ * @param s   Pointer to the byte array
+ * @param len Length of the byte array
+ *
+ * @return 64-bit hash code
+ *
+ * @private
+ */
+static inline uint64_t farmhash64_stats_hash(const char *s, size_t len)
+{
+    farmhash64_stats_t *st = &farmhash64_stats_tls;
+    size_t br = (len <= 16) ? 0 : ((len <= 32) ? 1 : ((len <= 64) ? 2 : 3));
+    size_t lb = farmhash64_stats_len_bucket(len);
+    uint64_t ncall = st->calls[br]++;
+    st->len_calls[lb]++;
+    st->len_bytes[lb] += len;
+#if FARMHASH64_STATS_CYCLES_SHIFT >= 0
+    if ((ncall & ((1ULL << FARMHASH64_STATS_CYCLES_SHIFT) - 1)) == 0)
+    {
+        uint64_t t0 = farmhash64_stats_ticks();
+        uint64_t h = farmhash_na_hash64(s, len);
+        st->cycles[br] += farmhash64_stats_ticks() - t0;
+        st->samples[br]++;
+        return h;
+    }
+#else
+    (void)ncall;
+#endif
+    return farmhash_na_hash64(s, len);
+}
+
+/**
+ * @brief Copy the farmhash64 statistics collected by the calling thread in this translation unit
+ * (in the whole program with FARMHASH64_STATS_SHARED).
+ *
+ * Counters are per-thread and lock-free: each thread exports its own snapshot,
+ * and snapshots can be combined with farmhash64_stats_merge.
+ *
+ * @param dst Destination snapshot
+ *
+ * @public
+ */
+static inline void farmhash64_stats_snapshot(farmhash64_stats_t *dst)
+{
+    *dst = farmhash64_stats_tls;
+}
+
+/**
+ * @brief Reset the farmhash64 statistics of the calling thread in this translation unit
+ * (in the whole program with FARMHASH64_STATS_SHARED).
+ *
+ * @public
+ */
+static inline void farmhash64_stats_reset(void)
+{
+    memset(&farmhash64_stats_tls, 0, sizeof(farmhash64_stats_tls));
+}
+
+/**
+ * @brief Add the counters of a snapshot to another one.
+ *
+ * @param dst Destination snapshot
+ * @param src Snapshot to add
+ *
+ * @public
+ */
+static inline void farmhash64_stats_merge(farmhash64_stats_t *dst, const farmhash64_stats_t *src)
+{
+    size_t i;
+    for (i = 0; i < FARMHASH64_STATS_BRANCHES; i++)
+    {
+        dst->calls[i] += src->calls[i];
+        dst->cycles[i] += src->cycles[i];
+        dst->samples[i] += src->samples[i];
+    }
+    for (i = 0; i < FARMHASH64_STATS_LEN_BUCKETS; i++)
+    {
+        dst->len_calls[i] += src->len_calls[i];
+        dst->len_bytes[i] += src->len_bytes[i];
+    }
+}
+
+#endif // FARMHASH64_STATS
+
+// =================================================================================================
+// PUBLIC FUNCTIONS
+// =================================================================================================
+
+/**
+ * @brief 64 bit hash.
+ *
+ * Returns a 64-bit fingerprint hash for a byte array.
+ *
+ * This function is not suitable for cryptography.
+ *
+ * When compiled with -DFARMHASH64_STATS, each call also updates the per-thread
+ * statistics (see farmhash64_stats_snapshot).
+ *
+ * @param s   string to process
+ * @param len string length
+ *
+ * @return 64-bit hash code
+ *
+ * @public
+ */
+static inline uint64_t farmhash64(const char *s, size_t len)
+{
+#ifdef FARMHASH64_STATS
+    return farmhash64_stats_hash(s, len);
+#else
+    return farmhash_na_hash64(s, len);
+#endif
+}
+
+/**
+ * @brief 32 bit hash.
+ *
+ * Returns a 32-bit fingerprint hash for a byte array.
+ *
+ * NOTE: This is NOT equivalent to the original Fingerprint32 function.
+ * It is a new function based on farmhash64.
+ *
+ * This function is not suitable for cryptography.
+ *
+ * @param s   string to process
+ * @param len string length
+ *
+ * @return 32-bit hash code
+ *
+ * @public
+ */
+static inline uint32_t farmhash32(const char *s, size_t len)
+{
+    return mix_64_to_32(farmhash64(s, len));
+}
+
+/**
+ * @brief Native 32 bit hash (Fingerprint32).
+ *
+ * Returns a 32-bit fingerprint hash for a byte array, computed with 32-bit
+ * arithmetic only. This is equivalent to farmhashmk::Hash32 (and therefore to
+ * the original Fingerprint32) in Google's FarmHash.
+ *
+ * It is a different function than farmhash32 and returns different values.
+ * Use it to match 32-bit fingerprints produced by other FarmHash libraries, or
+ * on 32-bit targets, where it avoids the 64-bit multiplications of farmhash32.
+ * On 64-bit targets farmhash32 is usually faster.
+ *
+ * This function is not suitable for cryptography.
+ *
+ * @param s   string to process
+ * @param len string length
+ *
+ * @return 32-bit hash code
+ *
+ * @public
+ */
+static inline uint32_t farmhash32_mk(const char *s, size_t len)
+{
+    return farmhash_mk_hash32(s, len);
+}
+
+/**
+ * @brief Native 32 bit hash with a seed.
+ *
+ * Returns a 32-bit hash for a byte array, mixing in a seed value.
+ * This is equivalent to farmhashmk::Hash32WithSeed in Google's FarmHash.
+ *
+ * This function is not suitable for cryptography.
+ *
+ * @param s    string to process
+ * @param len  string length
+ * @param seed seed value
+ *
+ * @return 32-bit hash code
+ *
+ * @public
+ */
+static inline uint32_t farmhash32_mk_with_seed(const char *s, size_t len, uint32_t seed)
+{
+    return farmhash_mk_hash32_with_seed(s, len, seed);
+}
+
+/**
+ * @brief Derive a seeded hash from an unseeded farmhash64 value.
+ *
+ * farmhash64_reseed(farmhash64(s, len), seed0, seed1) == farmhash64_with_seeds(s, len, seed0, seed1)
+ *
+ * @param h     hash code returned by farmhash64
+ * @param seed0 first seed
+ * @param seed1 second seed
+ *
+ * @return 64-bit hash code
+ *
+ * @public
+ */
+static inline uint64_t farmhash64_reseed(uint64_t h, uint64_t seed0, uint64_t seed1)
+{
+    return farmhash_len_16(h - seed0, seed1);
+}
+
+/**
+ * @brief 64 bit hash with two seeds.
+ *
+ * Returns a 64-bit hash for a byte array, mixing in two seed values.
+ * This is equivalent to farmhashna::Hash64WithSeeds in Google's FarmHash.
+ *
+ * The result only depends on the seeds through farmhash64(s, len),
+ * so callers that already have the unseeded hash can derive any number of
+ * seeded hashes with farmhash64_reseed, without hashing the bytes again.
+ *
+ * This function is not suitable for cryptography.
+ *
+ * @param s     string to process
+ * @param len   string length
+ * @param seed0 first seed
+ * @param seed1 second seed
+ *
+ * @return 64-bit hash code
+ *
+ * @public
+ */
+static inline uint64_t farmhash64_with_seeds(const char *s, size_t len, uint64_t seed0, uint64_t seed1)
+{
+    return farmhash64_reseed(farmhash64(s, len), seed0, seed1);
+}
+
+/**
+ * @brief 64 bit hash with a seed.
+ *
+ * Returns a 64-bit hash for a byte array, mixing in a seed value.
+ * This is equivalent to farmhashna::Hash64WithSeed in Google's FarmHash.
+ *
+ * This function is not suitable for cryptography.
+ *
+ * @param s    string to process
+ * @param len  string length
+ * @param seed seed value
+ *
+ * @return 64-bit hash code
+ *
+ * @public
+ */
+static inline uint64_t farmhash64_with_seed(const char *s, size_t len, uint64_t seed)
+{
+    return farmhash64_with_seeds(s, len, k2, seed);
+}
+
+// =================================================================================================
+// CASE-INSENSITIVE HASHING
+// =================================================================================================
+
+/**
+ * @brief Lowercase the ASCII letters of 8 bytes packed in a 64-bit word (SWAR).
+ *
+ * Bytes outside 'A'-'Z' (including non-ASCII bytes) are not modified.
+ *
+ * @param w 8 bytes
+ *
+ * @return 8 folded bytes
+ *
+ * @private
+ */
+static inline uint64_t farmhash_fold_ascii_word(uint64_t w)
+{
+    const uint64_t ones = 0x0101010101010101ULL;
+    uint64_t b7 = w & (0x7f * ones);
+    uint64_t ge_a = b7 + ((0x80 - 'A') * ones);
+    uint64_t gt_z = b7 + ((0x80 - 'Z' - 1) * ones);
+    uint64_t upper = ge_a & ~gt_z & ~w & (0x80 * ones);
+    return w | (upper >> 2);
+}
+
+/**
+ * @brief Copy n bytes lowercasing the ASCII letters.
+ *
+ * Uses SSE2 for 16-byte chunks when available, then 8-byte SWAR words.
+ *
+ * @param dst Destination
+ * @param src Source
+ * @param n   Number of bytes
+ *
+ * @private
+ */
+static inline void farmhash_fold_ascii(char *dst, const char *src, size_t n)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i lo = _mm_set1_epi8('A' - 1);
+    const __m128i hi = _mm_set1_epi8('Z' + 1);
+    const __m128i bit = _mm_set1_epi8(0x20);
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i c = _mm_loadu_si128((const __m128i *)(const void *)(src + i));
+        __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(c, lo), _mm_cmplt_epi8(c, hi));
+        _mm_storeu_si128((__m128i *)(void *)(dst + i), _mm_or_si128(c, _mm_and_si128(upper, bit)));
+    }
+#endif
+    for (; i + 8 <= n; i += 8)
+    {
+        uint64_t w;
+        memcpy(&w, src + i, 8);
+        w = farmhash_fold_ascii_word(w);
+        memcpy(dst + i, &w, 8);
+    }
+    for (; i < n; i++)
+    {
+        char c = src[i];
+        dst[i] = ((c >= 'A') && (c <= 'Z')) ? (char)(c + 32) : c;
+    }
+}
+
+/**
+ * @brief Case-insensitive 64 bit hash for ASCII.
+ *
+ * Returns the same value as farmhash64 on a copy of the input where the ASCII letters 'A'-'Z'
+ * are lowercased, without allocating the copy: each 64-byte block is folded into a local buffer
+ * just before being mixed. All the other bytes are hashed unchanged.
+ *
+ * This function is not suitable for cryptography.
+ *
+ * @param s   string to process
+ * @param len string length
+ *
+ * @return 64-bit hash code
+ *
+ * @public
+ */
+static inline uint64_t farmhash64_ascii_ci(const char *s, size_t len)
+{
+    char blk[64];
+    if (len <= 64)
+    {
+        farmhash_fold_ascii(blk, s, len);
+        return farmhash64(blk, len);
+    }
+    farmhash_na_state_t st = {{0, 0}, {0, 0}, 0, 0, 0};
+    const char* end = s + (((len - 1) >> 6) << 6);
+    farmhash_fold_ascii(blk, s, 64);
+    farmhash_na_init(&st, fetch64(blk));
+    for (;;)
+    {
+        farmhash_na_block(&st, blk);
+        s += 64;
+        if (s == end)
+        {
+            break;
+        }
+        farmhash_fold_ascii(blk, s, 64);
+    }
+    farmhash_fold_ascii(blk, end + ((len - 1) & 63) - 63, 64);
+    return farmhash_na_final(&st, blk, len);
+}
+
+/**
+ * @brief Return the simple case folding of a Unicode code point.
+ *
+ * Covers the ASCII, Latin-1 Supplement, Latin Extended-A, Greek and Cyrillic blocks,
+ * U+1E9E and the Ohm, Kelvin and Angstrom signs (the C and S mappings of CaseFolding.txt).
+ * Any other code point is returned unchanged.
+ *
+ * @param c Code point
+ *
+ * @return Folded code point
+ *
+ * @private
+ */
+static inline uint32_t farmhash_fold_codepoint(uint32_t c)
+{
+    if (c < 0x80)
+    {
+        return ((c >= 'A') && (c <= 'Z')) ? c + 32 : c;
+    }
+    if (c < 0x100)
+    {
+        if (c == 0xb5)
+        {
+            return 0x3bc;
+        }
+        return ((c >= 0xc0) && (c <= 0xde) && (c != 0xd7)) ? c + 32 : c;
+    }
+    if (c < 0x180)
+    {
+        if (c == 0x178)
+        {
+            return 0xff;
+        }
+        if (c == 0x17f)
+        {
+            return 's';
+        }
+        if (((c < 0x130) || ((c >= 0x132) && (c <= 0x137)) || ((c >= 0x14a) && (c <= 0x177))) && ((c & 1) == 0))
+        {
+            return c + 1;
+        }
+        if ((((c >= 0x139) && (c <= 0x148)) || ((c >= 0x179) && (c <= 0x17e))) && ((c & 1) == 1))
+        {
+            return c + 1;
+        }
+        return c;
+    }
+    if ((c >= 0x345) && (c < 0x400))
+    {
+        switch (c)
+        {
+        case 0x345:
+            return 0x3b9;
+        case 0x37f:
+            return 0x3f3;
+        case 0x386:
+            return 0x3ac;
+        case 0x388:
+        case 0x389:
+        case 0x38a:
+            return c + 37;
+        case 0x38c:
+            return 0x3cc;
+        case 0x38e:
+        case 0x38f:
+            return c + 63;
+        case 0x3c2:
+            return 0x3c3;
+        case 0x3cf:
+            return 0x3d7;
+        case 0x3d0:
+            return 0x3b2;
+        case 0x3d1:
+            return 0x3b8;
+        case 0x3d5:
+            return 0x3c6;
+        case 0x3d6:
+            return 0x3c0;
+        case 0x3f0:
+            return 0x3ba;
+        case 0x3f1:
+            return 0x3c1;
+        case 0x3f4:
+            return 0x3b8;
+        case 0x3f5:
+            return 0x3b5;
+        case 0x3f7:
+        case 0x3fa:
+            return c + 1;
+        case 0x3f9:
+            return 0x3f2;
+        case 0x3fd:
+        case 0x3fe:
+        case 0x3ff:
+            return c - 130;
+        default:
+            break;
+        }
+        if (((c >= 0x391) && (c <= 0x3a1)) || ((c >= 0x3a3) && (c <= 0x3ab)))
+        {
+            return c + 32;
+        }
+        if ((c >= 0x3d8) && (c <= 0x3ef) && ((c & 1) == 0))
+        {
+            return c + 1;
+        }
+        return c;
+    }
+    if ((c >= 0x400) && (c < 0x530))
+    {
+        if (c < 0x410)
+        {
+            return c + 80;
+        }
+        if (c < 0x430)
+        {
+            return c + 32;
+        }
+        if (c == 0x4c0)
+        {
+            return 0x4cf;
+        }
+        if ((c >= 0x4c1) && (c <= 0x4ce))
+        {
+            return ((c & 1) == 1) ? c + 1 : c;
+        }
+        if ((((c >= 0x460) && (c <= 0x481)) || ((c >= 0x48a) && (c <= 0x4bf)) || (c >= 0x4d0)) && ((c & 1) == 0))
+        {
+            return c + 1;
+        }
+        return c;
+    }
+    switch (c)
+    {
+    case 0x1e9e:
+        return 0xdf;
+    case 0x2126:
+        return 0x3c9;
+    case 0x212a:
+        return 'k';
+    case 0x212b:
+        return 0xe5;
+    default:
+        return c;
+    }
+}
+
+/**
+ * @brief Decode and fold the UTF-8 sequence at the beginning of a string.
+ *
+ * Invalid, overlong or truncated sequences are returned as a single unchanged byte.
+ *
+ * @param s   Input
+ * @param len Input length (> 0)
+ * @param out Output buffer (at least 4 bytes) receiving the folded UTF-8 bytes
+ * @param nin Number of input bytes consumed
+ *
+ * @return Number of output bytes
+ *
+ * @private
+ */
+static inline size_t farmhash_fold_utf8_char(const char *s, size_t len, char *out, size_t *nin)
+{
+    const uint8_t *u = (const uint8_t *)s;
+    uint32_t c = u[0];
+    size_t n = 1;
+    uint32_t min = 0;
+    if (c >= 0xc0)
+    {
+        if (c < 0xe0)
+        {
+            n = 2;
+            c &= 0x1f;
+            min = 0x80;
+        }
+        else if (c < 0xf0)
+        {
+            n = 3;
+            c &= 0x0f;
+            min = 0x800;
+        }
+        else
+        {
+            n = 4;
+            c &= 0x07;
+            min = 0x10000;
+        }
+        size_t i;
+        for (i = 1; i < n; i++)
+        {
+            if ((i >= len) || ((u[i] & 0xc0) != 0x80))
+            {
+                break;
+            }
+            c = (c << 6) | (u[i] & 0x3f);
+        }
+        if ((i < n) || (c < min) || (c > 0x10ffff))
+        {
+            n = 1;
+            c = u[0];
+        }
+    }
+    *nin = n;
+    uint32_t f = ((n == 1) && (c >= 0x80)) ? c : farmhash_fold_codepoint(c);
+    if (f == c)
+    {
+        memcpy(out, s, n);
+        return n;
+    }
+    if (f < 0x80)
+    {
+        out[0] = (char)f;
+        return 1;
+    }
+    if (f < 0x800)
+    {
+        out[0] = (char)(0xc0 | (f >> 6));
+        out[1] = (char)(0x80 | (f & 0x3f));
+        return 2;
+    }
+    out[0] = (char)(0xe0 | (f >> 12));
+    out[1] = (char)(0x80 | ((f >> 6) & 0x3f));
+    out[2] = (char)(0x80 | (f & 0x3f));
+    return 3;
+}
+
+/**
+ * @brief Return the length of a UTF-8 string after simple case folding.
+ *
+ * @private
+ */
+static inline size_t farmhash_fold_utf8_len(const char *s, size_t len)
+{
+    char tmp[4];
+    size_t total = 0;
+    size_t i = 0;
+    while (i < len)
+    {
+        if ((uint8_t)s[i] < 0x80)
+        {
+            ++total;
+            ++i;
+            continue;
+        }
+        size_t nin = 0;
+        total += farmhash_fold_utf8_char(s + i, len - i, tmp, &nin);
+        i += nin;
+    }
+    return total;
+}
+
+/**
+ * @brief Case-insensitive 64 bit hash for UTF-8 strings.
+ *
+ * Returns the same value as farmhash64 on the simple case folding of the input
+ * (see farmhash_fold_codepoint for the covered characters), without allocating the folded copy.
+ * Pure ASCII inputs take the farmhash64_ascii_ci path; otherwise the folded length is computed first
+ * and the folded bytes are streamed through a local 64-byte block.
+ * Invalid UTF-8 bytes are hashed unchanged.
+ *
+ * This function is not suitable for cryptography.
+ *
+ * @param s   UTF-8 string to process
+ * @param len string length in bytes
+ *
+ * @return 64-bit hash code
+ *
+ * @public
+ */
+static inline uint64_t farmhash64_utf8_ci(const char *s, size_t len)
+{
+    size_t i = 0;
+    while ((i + 8 <= len) && ((fetch64(s + i) & 0x8080808080808080ULL) == 0))
+    {
+        i += 8;
+    }
+    while ((i < len) && ((uint8_t)s[i] < 0x80))
+    {
+        ++i;
+    }
+    if (i == len)
+    {
+        return farmhash64_ascii_ci(s, len);
+    }
+    size_t flen = farmhash_fold_utf8_len(s, len);
+    size_t nloop = (flen - 1) >> 6;
+    char buf[64 + 64 + 4];
+    char *blk = buf + 64;
+    char *prev = buf;
+    size_t fill = 0;
+    size_t done = 0;
+    farmhash_na_state_t st = {{0, 0}, {0, 0}, 0, 0, 0};
+    i = 0;
+    while (i < len)
+    {
+        size_t nin = 1;
+        if ((uint8_t)s[i] < 0x80)
+        {
+            char c = s[i];
+            blk[fill++] = ((c >= 'A') && (c <= 'Z')) ? (char)(c + 32) : c;
+        }
+        else
+        {
+            fill += farmhash_fold_utf8_char(s + i, len - i, blk + fill, &nin);
+        }
+        i += nin;
+        if ((fill >= 64) && (done < nloop))
+        {
+            if (done == 0)
+            {
+                farmhash_na_init(&st, fetch64(blk));
+            }
+            farmhash_na_block(&st, blk);
+            ++done;
+            memcpy(prev, blk, 64);
+            fill -= 64;
+            memcpy(blk, blk + 64, fill);
+        }
+    }
+    if (nloop == 0)
+    {
+        return farmhash64(blk, flen);
+    }
+    // blk follows prev in buf, so the last 64 bytes are contiguous:
+    // the tail of the previous block followed by the pending bytes
+    return farmhash_na_final(&st, buf + fill, flen);
 }
 
 #ifdef __cplusplus
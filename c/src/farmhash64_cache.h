@@ -0,0 +1,609 @@
+/**
+ * @file farmhash64_cache.h
+ * @brief Sharded CLOCK cache of 64-bit keys and values, with TinyLFU admission driven by farmhash64.
+ *
+ * The farmhash64 of a key selects the shard (top bits), the bucket inside the shard (low bits)
+ * and the counters of the key in the frequency sketch of the shard.
+ *
+ * - Each bucket holds up to FARMHASH64_CACHE_WAYS entries and is protected by a sequence lock:
+ *   lookups are lock-free, never block and never write the bucket, except for setting the reference bit
+ *   of a hit entry when it is not already set. There is no list to update on a hit.
+ * - Writers (put/del) take the lock of their shard only.
+ * - Eviction uses CLOCK inside the bucket: the hand skips (and clears) the entries referenced since its last pass.
+ * - Admission uses TinyLFU: every lookup is recorded in a count-min sketch of 4-bit counters (per shard),
+ *   periodically halved so that old accesses fade. When the bucket is full, a new key replaces the CLOCK victim
+ *   only if it was accessed more often. Keys seen only once (e.g. by a scan) cannot evict frequently used entries.
+ *
+ * Values are 64-bit words (e.g. object handles): the cache never dereferences or releases them,
+ * and a lookup can return the value of an entry that is being evicted concurrently.
+ */
+
+#ifndef FARMHASH64_CACHE_H
+#define FARMHASH64_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include "farmhash64.h"
+
+/**
+ * @brief Maximum number of shard bits.
+ */
+#define FARMHASH64_CACHE_MAX_SHARD_BITS 16
+
+/**
+ * @brief Number of entries per bucket.
+ */
+#define FARMHASH64_CACHE_WAYS 8
+
+/**
+ * @brief Number of sketch rows (counters per key).
+ *
+ * @private
+ */
+#define FARMHASH64_CACHE_SKETCH_DEPTH 4
+
+/**
+ * @brief The sketch of a shard is halved after this many lookups per cache entry.
+ *
+ * @private
+ */
+#define FARMHASH64_CACHE_SKETCH_AGE 10
+
+/**
+ * @brief Return codes.
+ */
+enum farmhash64_cache_status_t
+{
+    FARMHASH64_CACHE_OK = 0,           /**< The entry was stored. */
+    FARMHASH64_CACHE_REJECTED = 1,     /**< The entry was not admitted (less frequent than the entry it would evict). */
+    FARMHASH64_CACHE_ERR_ARGS = -1,    /**< Invalid arguments. */
+    FARMHASH64_CACHE_ERR_MEMORY = -2,  /**< Memory allocation failure. */
+};
+
+/**
+ * @brief Cache bucket.
+ *
+ * @private
+ */
+typedef struct farmhash64_cache_bucket_t
+{
+    uint32_t seq;                          /**< Sequence lock (odd while a writer updates the bucket). */
+    uint8_t used;                          /**< Bitmask of the used ways. */
+    uint8_t ref;                           /**< Bitmask of the ways referenced since the last CLOCK pass. */
+    uint8_t hand;                          /**< CLOCK hand. */
+    uint8_t reserved;                      /**< Reserved. */
+    uint64_t key[FARMHASH64_CACHE_WAYS];   /**< Keys. */
+    uint64_t value[FARMHASH64_CACHE_WAYS]; /**< Values. */
+} farmhash64_cache_bucket_t;
+
+/**
+ * @brief Cache statistics.
+ */
+typedef struct farmhash64_cache_stats_t
+{
+    uint64_t hits;      /**< Lookups that found the key. */
+    uint64_t misses;    /**< Lookups that did not find the key. */
+    uint64_t inserts;   /**< New entries stored. */
+    uint64_t rejects;   /**< New entries not admitted. */
+    uint64_t evictions; /**< Entries evicted to make room for new ones. */
+} farmhash64_cache_stats_t;
+
+/**
+ * @brief Cache shard.
+ *
+ * @private
+ */
+typedef struct farmhash64_cache_shard_t
+{
+    pthread_mutex_t lock;                                /**< Writers lock. */
+    farmhash64_cache_bucket_t *buckets;                  /**< Buckets. */
+    uint64_t bucket_mask;                                /**< Number of buckets minus one. */
+    uint64_t *sketch;                                    /**< Frequency sketch (16 4-bit counters per word, 8 words per block). */
+    uint32_t sketch_bits;                                /**< Log2 of the number of sketch blocks. */
+    uint64_t age_at;                                     /**< Number of lookups at which the sketch is halved next. */
+    uint64_t inserts;                                    /**< New entries stored. */
+    uint64_t rejects;                                    /**< New entries not admitted. */
+    uint64_t evictions;                                  /**< Entries evicted. */
+    uint64_t hits __attribute__((aligned(64)));          /**< Lookup hits (written by the readers). */
+    uint64_t misses;                                     /**< Lookup misses (written by the readers). */
+} __attribute__((aligned(64))) farmhash64_cache_shard_t;
+
+/**
+ * @brief Sharded cache.
+ */
+typedef struct farmhash64_cache_t
+{
+    farmhash64_cache_shard_t *shards; /**< Shards. */
+    uint32_t shard_bits;              /**< Number of shard bits. */
+} farmhash64_cache_t;
+
+/**
+ * @brief Hash a key.
+ *
+ * @private
+ */
+static inline uint64_t farmhash64_cache_hash(uint64_t key)
+{
+    return farmhash64((const char *)&key, sizeof(key));
+}
+
+/**
+ * @brief Select the shard of a hash.
+ *
+ * @private
+ */
+static inline farmhash64_cache_shard_t *farmhash64_cache_shard(const farmhash64_cache_t *cache, uint64_t h)
+{
+    return &cache->shards[(cache->shard_bits == 0) ? 0 : (h >> (64 - cache->shard_bits))];
+}
+
+/**
+ * @brief Return the sketch block of a hash: the 4 counters of a key are in the same 64-byte block (8 words),
+ * so recording an access touches a single cache line.
+ *
+ * @private
+ */
+static inline uint64_t *farmhash64_cache_block(const farmhash64_cache_shard_t *sh, uint64_t h)
+{
+    uint64_t b = (sh->sketch_bits == 0) ? 0 : ((h * 0x9e3779b97f4a7c15ULL) >> (64 - sh->sketch_bits));
+    return &sh->sketch[b << 3];
+}
+
+/**
+ * @brief Return the word (in the block) and the bit shift of the counter of a hash in a sketch row.
+ *
+ * Row r uses the words 2r and 2r+1 of the block, selected with 5 middle bits of the hash
+ * (the low bits select the bucket and the top bits the shard).
+ *
+ * @private
+ */
+static inline uint32_t farmhash64_cache_counter(uint64_t h, uint32_t row, uint32_t *shift)
+{
+    uint32_t x = (uint32_t)(h >> (24 + (row * 5))) & 31;
+    *shift = (x & 15) << 2;
+    return (row << 1) + (x >> 4);
+}
+
+/**
+ * @brief Estimate the access frequency of a hash (0 to 15).
+ *
+ * @private
+ */
+static inline uint32_t farmhash64_cache_frequency(const farmhash64_cache_shard_t *sh, uint64_t h)
+{
+    const uint64_t *blk = farmhash64_cache_block(sh, h);
+    uint32_t f = 15;
+    uint32_t r;
+    for (r = 0; r < FARMHASH64_CACHE_SKETCH_DEPTH; r++)
+    {
+        uint32_t shift;
+        uint32_t w = farmhash64_cache_counter(h, r, &shift);
+        uint32_t v = (uint32_t)(__atomic_load_n(&blk[w], __ATOMIC_RELAXED) >> shift) & 15;
+        f = (v < f) ? v : f;
+    }
+    return f;
+}
+
+/**
+ * @brief Record an access in the sketch (conservative update: only the smallest counters are incremented).
+ *
+ * Concurrent updates of the same word can be lost: the sketch is an estimate anyway.
+ *
+ * @private
+ */
+static inline void farmhash64_cache_record(farmhash64_cache_shard_t *sh, uint64_t h)
+{
+    uint64_t *blk = farmhash64_cache_block(sh, h);
+    uint64_t v[FARMHASH64_CACHE_SKETCH_DEPTH];
+    uint32_t w[FARMHASH64_CACHE_SKETCH_DEPTH];
+    uint32_t shift[FARMHASH64_CACHE_SKETCH_DEPTH];
+    uint32_t f = 15;
+    uint32_t r;
+    for (r = 0; r < FARMHASH64_CACHE_SKETCH_DEPTH; r++)
+    {
+        w[r] = farmhash64_cache_counter(h, r, &shift[r]);
+        v[r] = __atomic_load_n(&blk[w[r]], __ATOMIC_RELAXED);
+        uint32_t c = (uint32_t)(v[r] >> shift[r]) & 15;
+        f = (c < f) ? c : f;
+    }
+    if (f == 15)
+    {
+        return;
+    }
+    for (r = 0; r < FARMHASH64_CACHE_SKETCH_DEPTH; r++)
+    {
+        if (((v[r] >> shift[r]) & 15) == f)
+        {
+            __atomic_store_n(&blk[w[r]], v[r] + ((uint64_t)1 << shift[r]), __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/**
+ * @brief Halve all the counters of the sketch of a shard when enough lookups were recorded.
+ *
+ * Must be called with the shard lock held.
+ *
+ * @private
+ */
+static inline void farmhash64_cache_age(farmhash64_cache_shard_t *sh)
+{
+    uint64_t lookups = __atomic_load_n(&sh->hits, __ATOMIC_RELAXED) + __atomic_load_n(&sh->misses, __ATOMIC_RELAXED);
+    if (lookups < sh->age_at)
+    {
+        return;
+    }
+    uint64_t nwords = (uint64_t)8 << sh->sketch_bits;
+    uint64_t i;
+    for (i = 0; i < nwords; i++)
+    {
+        uint64_t v = __atomic_load_n(&sh->sketch[i], __ATOMIC_RELAXED);
+        __atomic_store_n(&sh->sketch[i], (v >> 1) & 0x7777777777777777ULL, __ATOMIC_RELAXED);
+    }
+    sh->age_at = lookups + (FARMHASH64_CACHE_SKETCH_AGE * FARMHASH64_CACHE_WAYS * (sh->bucket_mask + 1));
+}
+
+/**
+ * @brief Start a bucket update (writers only).
+ *
+ * @private
+ */
+static inline uint32_t farmhash64_cache_write_begin(farmhash64_cache_bucket_t *b)
+{
+    uint32_t seq = b->seq;
+    __atomic_store_n(&b->seq, seq + 1, __ATOMIC_RELAXED);
+    return seq;
+}
+
+/**
+ * @brief End a bucket update (writers only).
+ *
+ * @private
+ */
+static inline void farmhash64_cache_write_end(farmhash64_cache_bucket_t *b, uint32_t seq)
+{
+    __atomic_store_n(&b->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Store an entry in a bucket way (writers only).
+ *
+ * @private
+ */
+static inline void farmhash64_cache_set(farmhash64_cache_bucket_t *b, uint32_t way, uint64_t key, uint64_t value)
+{
+    uint32_t seq = farmhash64_cache_write_begin(b);
+    // release stores: a reader that sees any of them also sees the odd sequence number
+    __atomic_store_n(&b->key[way], key, __ATOMIC_RELEASE);
+    __atomic_store_n(&b->value[way], value, __ATOMIC_RELEASE);
+    __atomic_store_n(&b->used, (uint8_t)(b->used | (1u << way)), __ATOMIC_RELEASE);
+    farmhash64_cache_write_end(b, seq);
+}
+
+/**
+ * @brief Find a key in a bucket (writers only).
+ *
+ * @return The way of the key, or -1
+ *
+ * @private
+ */
+static inline int farmhash64_cache_find(const farmhash64_cache_bucket_t *b, uint64_t key)
+{
+    int w;
+    for (w = 0; w < FARMHASH64_CACHE_WAYS; w++)
+    {
+        if (((b->used >> w) & 1) && (b->key[w] == key))
+        {
+            return w;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Create a new cache.
+ *
+ * @param cache      Cache to initialize
+ * @param shard_bits Number of shard bits (up to FARMHASH64_CACHE_MAX_SHARD_BITS), e.g. 6 for 64 shards
+ * @param capacity   Maximum number of entries (rounded up to a power of two buckets per shard)
+ *
+ * @return FARMHASH64_CACHE_OK on success, or a negative farmhash64_cache_status_t error code
+ *
+ * @public
+ */
+static inline int farmhash64_cache_init(farmhash64_cache_t *cache, uint32_t shard_bits, uint64_t capacity)
+{
+    if ((cache == NULL) || (shard_bits > FARMHASH64_CACHE_MAX_SHARD_BITS))
+    {
+        return FARMHASH64_CACHE_ERR_ARGS;
+    }
+    size_t nshards = (size_t)1 << shard_bits;
+    uint64_t nbuckets = 1;
+    while ((nbuckets * FARMHASH64_CACHE_WAYS * nshards) < capacity)
+    {
+        nbuckets <<= 1;
+    }
+    // one 64-byte block (32 counters per row) every 8 entries: 4 counters per row and entry
+    uint32_t sketch_bits = 0;
+    while (((uint64_t)1 << sketch_bits) < nbuckets)
+    {
+        sketch_bits++;
+    }
+    uint64_t nwords = (uint64_t)8 << sketch_bits;
+    memset(cache, 0, sizeof(*cache));
+    cache->shard_bits = shard_bits;
+    cache->shards = (farmhash64_cache_shard_t *)aligned_alloc(64, nshards * sizeof(farmhash64_cache_shard_t));
+    if (cache->shards == NULL)
+    {
+        return FARMHASH64_CACHE_ERR_MEMORY;
+    }
+    memset((void *)cache->shards, 0, nshards * sizeof(farmhash64_cache_shard_t));
+    size_t i;
+    for (i = 0; i < nshards; i++)
+    {
+        farmhash64_cache_shard_t *sh = &cache->shards[i];
+        sh->buckets = (farmhash64_cache_bucket_t *)calloc((size_t)nbuckets, sizeof(farmhash64_cache_bucket_t));
+        sh->sketch = (uint64_t *)aligned_alloc(64, (size_t)nwords * sizeof(uint64_t));
+        if ((sh->buckets == NULL) || (sh->sketch == NULL))
+        {
+            free(sh->buckets);
+            free(sh->sketch);
+            while (i-- > 0)
+            {
+                free(cache->shards[i].buckets);
+                free(cache->shards[i].sketch);
+                pthread_mutex_destroy(&cache->shards[i].lock);
+            }
+            free(cache->shards);
+            cache->shards = NULL;
+            return FARMHASH64_CACHE_ERR_MEMORY;
+        }
+        memset(sh->sketch, 0, (size_t)nwords * sizeof(uint64_t));
+        pthread_mutex_init(&sh->lock, NULL);
+        sh->bucket_mask = nbuckets - 1;
+        sh->sketch_bits = sketch_bits;
+        sh->age_at = FARMHASH64_CACHE_SKETCH_AGE * FARMHASH64_CACHE_WAYS * nbuckets;
+    }
+    return FARMHASH64_CACHE_OK;
+}
+
+/**
+ * @brief Release all the resources of a cache.
+ *
+ * No other thread may use the cache during or after this call.
+ *
+ * @param cache Cache
+ *
+ * @public
+ */
+static inline void farmhash64_cache_destroy(farmhash64_cache_t *cache)
+{
+    if ((cache == NULL) || (cache->shards == NULL))
+    {
+        return;
+    }
+    size_t nshards = (size_t)1 << cache->shard_bits;
+    size_t i;
+    for (i = 0; i < nshards; i++)
+    {
+        free(cache->shards[i].buckets);
+        free(cache->shards[i].sketch);
+        pthread_mutex_destroy(&cache->shards[i].lock);
+    }
+    free(cache->shards);
+    cache->shards = NULL;
+}
+
+/**
+ * @brief Look up a key and record the access in the frequency sketch.
+ *
+ * Lock-free: it can run concurrently with any other operation.
+ *
+ * @param cache Cache
+ * @param key   Key
+ * @param value Output value (can be NULL)
+ *
+ * @return 1 if the key was found, 0 otherwise
+ *
+ * @public
+ */
+static inline int farmhash64_cache_get(farmhash64_cache_t *cache, uint64_t key, uint64_t *value)
+{
+    uint64_t h = farmhash64_cache_hash(key);
+    farmhash64_cache_shard_t *sh = farmhash64_cache_shard(cache, h);
+    farmhash64_cache_bucket_t *b = &sh->buckets[h & sh->bucket_mask];
+    int way;
+    uint64_t v = 0;
+    for (;;)
+    {
+        uint32_t seq = __atomic_load_n(&b->seq, __ATOMIC_ACQUIRE);
+        if ((seq & 1) != 0)
+        {
+            continue; // a writer is updating the bucket
+        }
+        // compare all the ways without branches, the position of a key is random
+        uint32_t match = 0;
+        int w;
+        for (w = 0; w < FARMHASH64_CACHE_WAYS; w++)
+        {
+            match |= (uint32_t)(__atomic_load_n(&b->key[w], __ATOMIC_ACQUIRE) == key) << w;
+        }
+        match &= __atomic_load_n(&b->used, __ATOMIC_ACQUIRE);
+        way = -1;
+        if (match != 0)
+        {
+            way = __builtin_ctz(match);
+            v = __atomic_load_n(&b->value[way], __ATOMIC_ACQUIRE);
+        }
+        // acquire loads: the sequence number is read again after the data
+        if (__atomic_load_n(&b->seq, __ATOMIC_RELAXED) == seq)
+        {
+            break;
+        }
+    }
+    farmhash64_cache_record(sh, h);
+    if (way < 0)
+    {
+        __atomic_fetch_add(&sh->misses, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    if (((__atomic_load_n(&b->ref, __ATOMIC_RELAXED) >> way) & 1) == 0)
+    {
+        __atomic_fetch_or(&b->ref, (uint8_t)(1u << way), __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&sh->hits, 1, __ATOMIC_RELAXED);
+    if (value != NULL)
+    {
+        *value = v;
+    }
+    return 1;
+}
+
+/**
+ * @brief Insert a key or update its value.
+ *
+ * A new key is stored in a free way of its bucket, or replaces the CLOCK victim of the bucket
+ * if the sketch estimates that it is accessed more often than the victim.
+ * The accesses are recorded by farmhash64_cache_get: in a read-through cache,
+ * the lookup that missed the key has already counted it.
+ *
+ * @param cache Cache
+ * @param key   Key
+ * @param value Value
+ *
+ * @return FARMHASH64_CACHE_OK if the entry was stored, FARMHASH64_CACHE_REJECTED if it was not admitted
+ *
+ * @public
+ */
+static inline int farmhash64_cache_put(farmhash64_cache_t *cache, uint64_t key, uint64_t value)
+{
+    uint64_t h = farmhash64_cache_hash(key);
+    farmhash64_cache_shard_t *sh = farmhash64_cache_shard(cache, h);
+    farmhash64_cache_bucket_t *b = &sh->buckets[h & sh->bucket_mask];
+    pthread_mutex_lock(&sh->lock);
+    farmhash64_cache_age(sh);
+    int way = farmhash64_cache_find(b, key);
+    if (way >= 0)
+    {
+        farmhash64_cache_set(b, (uint32_t)way, key, value);
+        pthread_mutex_unlock(&sh->lock);
+        return FARMHASH64_CACHE_OK;
+    }
+    uint32_t free_ways = (uint8_t)~b->used;
+    if (free_ways != 0)
+    {
+        farmhash64_cache_set(b, (uint32_t)__builtin_ctz(free_ways), key, value);
+        sh->inserts++;
+        pthread_mutex_unlock(&sh->lock);
+        return FARMHASH64_CACHE_OK;
+    }
+    // CLOCK: clear the reference bits until an unreferenced entry is found (the start entry after a full turn)
+    uint32_t hand = b->hand;
+    uint32_t step;
+    for (step = 0; step < FARMHASH64_CACHE_WAYS; step++)
+    {
+        uint8_t bit = (uint8_t)(1u << hand);
+        if ((__atomic_load_n(&b->ref, __ATOMIC_RELAXED) & bit) == 0)
+        {
+            break;
+        }
+        __atomic_fetch_and(&b->ref, (uint8_t)~bit, __ATOMIC_RELAXED);
+        hand = (hand + 1) % FARMHASH64_CACHE_WAYS;
+    }
+    b->hand = (uint8_t)((hand + 1) % FARMHASH64_CACHE_WAYS);
+    // TinyLFU: admit the new key only if it is more frequent than the victim
+    if (farmhash64_cache_frequency(sh, h) <= farmhash64_cache_frequency(sh, farmhash64_cache_hash(b->key[hand])))
+    {
+        sh->rejects++;
+        pthread_mutex_unlock(&sh->lock);
+        return FARMHASH64_CACHE_REJECTED;
+    }
+    farmhash64_cache_set(b, hand, key, value);
+    sh->inserts++;
+    sh->evictions++;
+    pthread_mutex_unlock(&sh->lock);
+    return FARMHASH64_CACHE_OK;
+}
+
+/**
+ * @brief Remove a key.
+ *
+ * @param cache Cache
+ * @param key   Key
+ *
+ * @return 1 if the key was removed, 0 if it was not in the cache
+ *
+ * @public
+ */
+static inline int farmhash64_cache_del(farmhash64_cache_t *cache, uint64_t key)
+{
+    uint64_t h = farmhash64_cache_hash(key);
+    farmhash64_cache_shard_t *sh = farmhash64_cache_shard(cache, h);
+    farmhash64_cache_bucket_t *b = &sh->buckets[h & sh->bucket_mask];
+    pthread_mutex_lock(&sh->lock);
+    int way = farmhash64_cache_find(b, key);
+    if (way >= 0)
+    {
+        uint32_t seq = farmhash64_cache_write_begin(b);
+        __atomic_store_n(&b->used, (uint8_t)(b->used & ~(1u << way)), __ATOMIC_RELEASE);
+        farmhash64_cache_write_end(b, seq);
+        __atomic_fetch_and(&b->ref, (uint8_t)~(1u << way), __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&sh->lock);
+    return (way >= 0);
+}
+
+/**
+ * @brief Return the statistics of a shard.
+ *
+ * @param cache Cache
+ * @param shard Shard index, in [0, 2^shard_bits)
+ * @param stats Output statistics
+ *
+ * @public
+ */
+static inline void farmhash64_cache_shard_stats(farmhash64_cache_t *cache, size_t shard, farmhash64_cache_stats_t *stats)
+{
+    farmhash64_cache_shard_t *sh = &cache->shards[shard];
+    stats->hits = __atomic_load_n(&sh->hits, __ATOMIC_RELAXED);
+    stats->misses = __atomic_load_n(&sh->misses, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&sh->lock);
+    stats->inserts = sh->inserts;
+    stats->rejects = sh->rejects;
+    stats->evictions = sh->evictions;
+    pthread_mutex_unlock(&sh->lock);
+}
+
+/**
+ * @brief Return the statistics of the whole cache (sum of all the shards).
+ *
+ * @param cache Cache
+ * @param stats Output statistics
+ *
+ * @public
+ */
+static inline void farmhash64_cache_stats(farmhash64_cache_t *cache, farmhash64_cache_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    size_t nshards = (size_t)1 << cache->shard_bits;
+    size_t i;
+    for (i = 0; i < nshards; i++)
+    {
+        farmhash64_cache_stats_t s;
+        farmhash64_cache_shard_stats(cache, i, &s);
+        stats->hits += s.hits;
+        stats->misses += s.misses;
+        stats->inserts += s.inserts;
+        stats->rejects += s.rejects;
+        stats->evictions += s.evictions;
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FARMHASH64_CACHE_H
@@ -0,0 +1,852 @@
+/**
+ * @file farmhash64_cdc.h
+ * @brief Content-defined chunking and chunk deduplication pipeline with farmhash64 fingerprints.
+ *
+ * A stream is split into variable-size chunks with the FastCDC algorithm: a Gear rolling hash
+ * (one shift and one add per byte) selects the boundaries, skipping the first min_size bytes of each chunk,
+ * with normalized chunking (a stricter mask before avg_size and a looser one after it) to keep the sizes
+ * close to the average. Boundaries depend only on the nearby content, so an insertion or a deletion only
+ * changes the chunks around it.
+ *
+ * Each chunk is fingerprinted with farmhash64 (128 bits with the wide option: farmhash64 plus an
+ * independent farmhash64_with_seed) and looked up in a fingerprint index to detect the duplicates.
+ * A non-cryptographic fingerprint is enough to deduplicate trusted data, at a fraction of the cost of
+ * a cryptographic hash; it must not be used when an attacker can craft colliding chunks.
+ *
+ * farmhash64_cdc_run() runs the three stages on different threads, connected by bounded lock-free
+ * single-producer single-consumer queues:
+ *
+ *   reader + boundary detection --> fingerprinting --> index lookup + sink (calling thread)
+ *
+ * The input is read in large blocks recycled through a third queue, so the chunk data is never copied
+ * (except the tail of each block, less than max_size bytes, moved to the next block).
+ * The throughput is bounded by the slowest stage, usually boundary detection.
+ *
+ * This header uses POSIX I/O and threads: define _XOPEN_SOURCE 700 (or _DEFAULT_SOURCE) before including it.
+ */
+
+#ifndef FARMHASH64_CDC_H
+#define FARMHASH64_CDC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include "farmhash64.h"
+
+/**
+ * @brief Number of input blocks in flight in the pipeline.
+ */
+#define FARMHASH64_CDC_BLOCKS 8
+
+/**
+ * @brief Capacity of the chunk queues between the stages (power of two).
+ */
+#define FARMHASH64_CDC_QUEUE_SIZE 4096
+
+/**
+ * @brief Seed of the second half of the wide (128-bit) fingerprints.
+ */
+#define FARMHASH64_CDC_SEED2 0x9ae16a3b2f90404fULL
+
+/**
+ * @brief Number of busy-wait iterations before a waiting stage yields the CPU.
+ *
+ * @private
+ */
+#define FARMHASH64_CDC_SPINS 64
+
+/**
+ * @brief Return codes.
+ */
+enum farmhash64_cdc_status_t
+{
+    FARMHASH64_CDC_OK = 0,           /**< Success. */
+    FARMHASH64_CDC_ERR_ARGS = -1,    /**< Invalid arguments. */
+    FARMHASH64_CDC_ERR_MEMORY = -2,  /**< Memory allocation failure. */
+    FARMHASH64_CDC_ERR_IO = -3,      /**< Read error (see errno). */
+    FARMHASH64_CDC_ERR_ABORTED = -4, /**< The sink stopped the run. */
+};
+
+/**
+ * @brief Chunking parameters.
+ */
+typedef struct farmhash64_cdc_params_t
+{
+    size_t min_size;   /**< Minimum chunk size (except the last chunk of a stream). */
+    size_t avg_size;   /**< Target average chunk size (power of two). */
+    size_t max_size;   /**< Maximum chunk size. */
+    size_t block_size; /**< Size of the input reads (at least max_size). */
+    unsigned threads;  /**< 3 to run the stages on separate threads, 1 to run them serially. */
+    int wide;          /**< Compute 128-bit fingerprints. */
+} farmhash64_cdc_params_t;
+
+/**
+ * @brief Boundary detector: Gear table and FastCDC masks.
+ */
+typedef struct farmhash64_cdc_chunker_t
+{
+    uint64_t gear[256]; /**< Random value of each byte. */
+    uint64_t mask_s;    /**< Mask used before avg_size (avg bits + 2, harder to match). */
+    uint64_t mask_l;    /**< Mask used after avg_size (avg bits - 2, easier to match). */
+    size_t min_size;    /**< Minimum chunk size. */
+    size_t avg_size;    /**< Average chunk size. */
+    size_t max_size;    /**< Maximum chunk size. */
+} farmhash64_cdc_chunker_t;
+
+/**
+ * @brief A chunk, as passed to the sink.
+ */
+typedef struct farmhash64_cdc_chunk_t
+{
+    uint64_t offset;  /**< Offset of the chunk in the stream. */
+    const char *data; /**< Chunk data, valid only during the sink call. */
+    uint64_t hash;    /**< farmhash64 of the data. */
+    uint64_t hash2;   /**< Second half of the 128-bit fingerprint (wide option), 0 otherwise. */
+    uint32_t len;     /**< Chunk length. */
+    uint32_t refs;    /**< Number of previous occurrences of the fingerprint (0 for a new chunk). */
+} farmhash64_cdc_chunk_t;
+
+/**
+ * @brief Chunk consumer, called in stream order on the calling thread.
+ *
+ * @return 0 to continue, any other value to stop the run with FARMHASH64_CDC_ERR_ABORTED
+ */
+typedef int (*farmhash64_cdc_sink_t)(void *arg, const farmhash64_cdc_chunk_t *chunk);
+
+/**
+ * @brief Slot of the fingerprint index.
+ *
+ * @private
+ */
+typedef struct farmhash64_cdc_slot_t
+{
+    uint64_t hash;  /**< Fingerprint. */
+    uint64_t hash2; /**< Second half of the wide fingerprint. */
+    uint64_t refs;  /**< Number of occurrences (0 for an empty slot). */
+} farmhash64_cdc_slot_t;
+
+/**
+ * @brief Fingerprint index, shared by the runs of a backup to deduplicate across streams.
+ */
+typedef struct farmhash64_cdc_index_t
+{
+    farmhash64_cdc_slot_t *slots; /**< Table (linear probing). */
+    uint64_t mask;                /**< Number of slots minus one. */
+    uint64_t used;                /**< Number of distinct fingerprints. */
+} farmhash64_cdc_index_t;
+
+/**
+ * @brief Statistics of a run.
+ */
+typedef struct farmhash64_cdc_stats_t
+{
+    uint64_t bytes;         /**< Input bytes. */
+    uint64_t chunks;        /**< Number of chunks. */
+    uint64_t unique_chunks; /**< Number of chunks not already in the index. */
+    uint64_t unique_bytes;  /**< Bytes of the unique chunks. */
+} farmhash64_cdc_stats_t;
+
+/**
+ * @brief Queue item kinds.
+ *
+ * @private
+ */
+enum farmhash64_cdc_item_kind_t
+{
+    FARMHASH64_CDC_ITEM_CHUNK = 0,  /**< A chunk. */
+    FARMHASH64_CDC_ITEM_BLOCK = 1,  /**< No more chunks in the block: it can be reused. */
+    FARMHASH64_CDC_ITEM_END = 2,    /**< End of the stream, with the reader status. */
+};
+
+/**
+ * @brief Queue item.
+ *
+ * @private
+ */
+typedef struct farmhash64_cdc_item_t
+{
+    farmhash64_cdc_chunk_t chunk; /**< Chunk. */
+    uint32_t kind;                /**< farmhash64_cdc_item_kind_t. */
+    uint32_t block;               /**< Input block. */
+    int status;                   /**< Reader status (FARMHASH64_CDC_ITEM_END). */
+} farmhash64_cdc_item_t;
+
+/**
+ * @brief Bounded single-producer single-consumer queue.
+ *
+ * The producer and consumer indexes live on separate cache lines, each with a cached copy of the
+ * other index so that the shared line is only read when the queue looks full or empty.
+ *
+ * @private
+ */
+typedef struct farmhash64_cdc_queue_t
+{
+    uint64_t tail __attribute__((aligned(64))); /**< Next slot to write (producer). */
+    uint64_t head_cache;                        /**< Producer copy of head. */
+    uint64_t head __attribute__((aligned(64))); /**< Next slot to read (consumer). */
+    uint64_t tail_cache;                        /**< Consumer copy of tail. */
+    farmhash64_cdc_item_t *items __attribute__((aligned(64))); /**< Ring buffer. */
+    uint64_t mask;                              /**< Capacity minus one. */
+} farmhash64_cdc_queue_t;
+
+/**
+ * @brief State of a run.
+ *
+ * @private
+ */
+typedef struct farmhash64_cdc_ctx_t
+{
+    farmhash64_cdc_queue_t chunks;       /**< Boundary detection to fingerprinting. */
+    farmhash64_cdc_queue_t hashed;       /**< Fingerprinting to index lookup. */
+    farmhash64_cdc_queue_t free_blocks;  /**< Index lookup back to the reader. */
+    farmhash64_cdc_chunker_t chunker;    /**< Boundary detector. */
+    const farmhash64_cdc_params_t *params; /**< Parameters. */
+    char *blocks[FARMHASH64_CDC_BLOCKS]; /**< Input blocks (block_size + max_size bytes each). */
+    farmhash64_cdc_index_t *index;       /**< Fingerprint index. */
+    farmhash64_cdc_sink_t sink;          /**< Chunk consumer (can be NULL). */
+    void *arg;                           /**< Sink argument. */
+    farmhash64_cdc_stats_t stats;        /**< Statistics. */
+    int fd;                              /**< Input. */
+    int stop;                            /**< Set to stop the producer stages. */
+    int status;                          /**< Result of a serial run. */
+} farmhash64_cdc_ctx_t;
+
+/**
+ * @brief Set the default parameters: 2 KiB minimum, 8 KiB average and 64 KiB maximum chunks,
+ * 4 MiB reads, pipelined stages, 64-bit fingerprints.
+ *
+ * @param params Parameters to initialize
+ *
+ * @public
+ */
+static inline void farmhash64_cdc_default_params(farmhash64_cdc_params_t *params)
+{
+    params->min_size = 2048;
+    params->avg_size = 8192;
+    params->max_size = 65536;
+    params->block_size = (size_t)4 << 20;
+    params->threads = 3;
+    params->wide = 0;
+}
+
+/**
+ * @brief Initialize a boundary detector.
+ *
+ * The Gear table is derived from farmhash64, so the boundaries are the same on every platform.
+ *
+ * @param ch     Boundary detector
+ * @param params Parameters: 64 <= min_size < avg_size < max_size, avg_size power of two
+ *
+ * @return FARMHASH64_CDC_OK or FARMHASH64_CDC_ERR_ARGS
+ *
+ * @public
+ */
+static inline int farmhash64_cdc_chunker_init(farmhash64_cdc_chunker_t *ch, const farmhash64_cdc_params_t *params)
+{
+    if ((ch == NULL) || (params == NULL) || (params->min_size < 64) || (params->min_size >= params->avg_size) || (params->avg_size >= params->max_size) || (params->max_size > UINT32_MAX) || ((params->avg_size & (params->avg_size - 1)) != 0))
+    {
+        return FARMHASH64_CDC_ERR_ARGS;
+    }
+    uint32_t bits = 0;
+    while (((size_t)1 << bits) < params->avg_size)
+    {
+        bits++;
+    }
+    if ((bits < 8) || (bits > 30))
+    {
+        return FARMHASH64_CDC_ERR_ARGS;
+    }
+    int i;
+    for (i = 0; i < 256; i++)
+    {
+        char c = (char)i;
+        ch->gear[i] = farmhash64(&c, 1);
+    }
+    // the shifted Gear hash accumulates the most recent bytes in its top bits
+    ch->mask_s = ~(uint64_t)0 << (64 - (bits + 2));
+    ch->mask_l = ~(uint64_t)0 << (64 - (bits - 2));
+    ch->min_size = params->min_size;
+    ch->avg_size = params->avg_size;
+    ch->max_size = params->max_size;
+    return FARMHASH64_CDC_OK;
+}
+
+/**
+ * @brief Find the length of the next chunk.
+ *
+ * When n < max_size the data is treated as the end of the stream.
+ *
+ * @param ch Boundary detector
+ * @param p  Data
+ * @param n  Number of available bytes
+ *
+ * @return Chunk length (n when n <= min_size)
+ *
+ * @public
+ */
+static inline size_t farmhash64_cdc_cut(const farmhash64_cdc_chunker_t *ch, const uint8_t *p, size_t n)
+{
+    if (n <= ch->min_size)
+    {
+        return n;
+    }
+    if (n > ch->max_size)
+    {
+        n = ch->max_size;
+    }
+    size_t normal = (n < ch->avg_size) ? n : ch->avg_size;
+    uint64_t h = 0;
+    size_t i = ch->min_size;
+    for (; i < normal; i++)
+    {
+        h = (h << 1) + ch->gear[p[i]];
+        if ((h & ch->mask_s) == 0)
+        {
+            return i + 1;
+        }
+    }
+    for (; i < n; i++)
+    {
+        h = (h << 1) + ch->gear[p[i]];
+        if ((h & ch->mask_l) == 0)
+        {
+            return i + 1;
+        }
+    }
+    return n;
+}
+
+/**
+ * @brief Initialize an empty fingerprint index.
+ *
+ * @param index  Index
+ * @param nslots Initial number of slots (rounded up to a power of two, grows as needed)
+ *
+ * @return FARMHASH64_CDC_OK or FARMHASH64_CDC_ERR_MEMORY
+ *
+ * @public
+ */
+static inline int farmhash64_cdc_index_init(farmhash64_cdc_index_t *index, uint64_t nslots)
+{
+    uint64_t n = 1024;
+    while (n < nslots)
+    {
+        n <<= 1;
+    }
+    index->slots = (farmhash64_cdc_slot_t *)calloc((size_t)n, sizeof(farmhash64_cdc_slot_t));
+    index->mask = n - 1;
+    index->used = 0;
+    return (index->slots == NULL) ? FARMHASH64_CDC_ERR_MEMORY : FARMHASH64_CDC_OK;
+}
+
+/**
+ * @brief Release the memory of a fingerprint index.
+ *
+ * @param index Index
+ *
+ * @public
+ */
+static inline void farmhash64_cdc_index_free(farmhash64_cdc_index_t *index)
+{
+    free(index->slots);
+    index->slots = NULL;
+    index->mask = 0;
+    index->used = 0;
+}
+
+/**
+ * @brief Add an occurrence of a fingerprint to the index.
+ *
+ * @param index Index
+ * @param hash  Fingerprint
+ * @param hash2 Second half of a wide fingerprint (0 for 64-bit fingerprints)
+ * @param refs  Output number of previous occurrences (0 for a new fingerprint)
+ *
+ * @return FARMHASH64_CDC_OK or FARMHASH64_CDC_ERR_MEMORY
+ *
+ * @public
+ */
+static inline int farmhash64_cdc_index_add(farmhash64_cdc_index_t *index, uint64_t hash, uint64_t hash2, uint64_t *refs)
+{
+    if ((index->used + 1) * 2 > index->mask + 1)
+    {
+        uint64_t nslots = (index->mask + 1) * 2;
+        farmhash64_cdc_slot_t *s = (farmhash64_cdc_slot_t *)calloc((size_t)nslots, sizeof(farmhash64_cdc_slot_t));
+        if (s == NULL)
+        {
+            return FARMHASH64_CDC_ERR_MEMORY;
+        }
+        uint64_t i;
+        for (i = 0; i <= index->mask; i++)
+        {
+            if (index->slots[i].refs == 0)
+            {
+                continue;
+            }
+            uint64_t j = index->slots[i].hash & (nslots - 1);
+            while (s[j].refs != 0)
+            {
+                j = (j + 1) & (nslots - 1);
+            }
+            s[j] = index->slots[i];
+        }
+        free(index->slots);
+        index->slots = s;
+        index->mask = nslots - 1;
+    }
+    uint64_t j = hash & index->mask;
+    while (index->slots[j].refs != 0)
+    {
+        farmhash64_cdc_slot_t *s = &index->slots[j];
+        if ((s->hash == hash) && (s->hash2 == hash2))
+        {
+            *refs = s->refs++;
+            return FARMHASH64_CDC_OK;
+        }
+        j = (j + 1) & index->mask;
+    }
+    index->slots[j].hash = hash;
+    index->slots[j].hash2 = hash2;
+    index->slots[j].refs = 1;
+    index->used++;
+    *refs = 0;
+    return FARMHASH64_CDC_OK;
+}
+
+/**
+ * @brief Allocate a queue.
+ *
+ * @private
+ */
+static inline int farmhash64_cdc_queue_init(farmhash64_cdc_queue_t *q, uint64_t size)
+{
+    q->tail = 0;
+    q->head_cache = 0;
+    q->head = 0;
+    q->tail_cache = 0;
+    q->mask = size - 1;
+    q->items = (farmhash64_cdc_item_t *)malloc((size_t)size * sizeof(farmhash64_cdc_item_t));
+    return (q->items == NULL) ? FARMHASH64_CDC_ERR_MEMORY : FARMHASH64_CDC_OK;
+}
+
+/**
+ * @brief Wait a little: busy-wait first, then yield the CPU to the other stages.
+ *
+ * @private
+ */
+static inline void farmhash64_cdc_wait(unsigned *spins)
+{
+    if (++*spins < FARMHASH64_CDC_SPINS)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+        return;
+    }
+    sched_yield();
+}
+
+/**
+ * @brief Add an item to a queue, waiting while it is full.
+ *
+ * @return 0 on success, -1 if the run was stopped while waiting
+ *
+ * @private
+ */
+static inline int farmhash64_cdc_push(farmhash64_cdc_queue_t *q, const farmhash64_cdc_item_t *item, const int *stop)
+{
+    uint64_t t = q->tail;
+    unsigned spins = 0;
+    while (t - q->head_cache > q->mask)
+    {
+        q->head_cache = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+        if (t - q->head_cache <= q->mask)
+        {
+            break;
+        }
+        if (__atomic_load_n(stop, __ATOMIC_RELAXED))
+        {
+            return -1;
+        }
+        farmhash64_cdc_wait(&spins);
+    }
+    q->items[t & q->mask] = *item;
+    __atomic_store_n(&q->tail, t + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * @brief Remove the oldest item from a queue, waiting while it is empty.
+ *
+ * @return 0 on success, -1 if the run was stopped while waiting
+ *
+ * @private
+ */
+static inline int farmhash64_cdc_pop(farmhash64_cdc_queue_t *q, farmhash64_cdc_item_t *item, const int *stop)
+{
+    uint64_t h = q->head;
+    unsigned spins = 0;
+    while (h == q->tail_cache)
+    {
+        q->tail_cache = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+        if (h != q->tail_cache)
+        {
+            break;
+        }
+        if (__atomic_load_n(stop, __ATOMIC_RELAXED))
+        {
+            return -1;
+        }
+        farmhash64_cdc_wait(&spins);
+    }
+    *item = q->items[h & q->mask];
+    __atomic_store_n(&q->head, h + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * @brief Fill the rest of a block from the input.
+ *
+ * @return Number of bytes read, or -1 on error
+ *
+ * @private
+ */
+static inline ssize_t farmhash64_cdc_fill(int fd, char *buf, size_t n)
+{
+    size_t done = 0;
+    while (done < n)
+    {
+        ssize_t k = read(fd, buf + done, n - done);
+        if (k < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        if (k == 0)
+        {
+            break;
+        }
+        done += (size_t)k;
+    }
+    return (ssize_t)done;
+}
+
+/**
+ * @brief Item handler of the next stage: push to the queue, or run the stages serially.
+ *
+ * @private
+ */
+typedef int (*farmhash64_cdc_emit_t)(farmhash64_cdc_ctx_t *ctx, farmhash64_cdc_item_t *item);
+
+/**
+ * @brief Reader and boundary detection stage.
+ *
+ * Emits the chunks of each block, then a FARMHASH64_CDC_ITEM_BLOCK item once the unfinished tail of the block
+ * has been moved to the next one, and finally a FARMHASH64_CDC_ITEM_END item.
+ *
+ * @private
+ */
+static inline void farmhash64_cdc_read_stage(farmhash64_cdc_ctx_t *ctx, farmhash64_cdc_emit_t emit)
+{
+    const farmhash64_cdc_params_t *params = ctx->params;
+    const size_t cap = params->block_size + params->max_size;
+    farmhash64_cdc_item_t item;
+    memset(&item, 0, sizeof(item));
+    const char *tail = NULL; // unfinished chunk at the end of the previous block
+    size_t carry = 0;
+    uint32_t prev = 0;
+    uint64_t offset = 0;
+    int eof = 0;
+    int status = FARMHASH64_CDC_OK;
+    while (!eof)
+    {
+        farmhash64_cdc_item_t fb;
+        if (farmhash64_cdc_pop(&ctx->free_blocks, &fb, &ctx->stop) != 0)
+        {
+            return;
+        }
+        char *b = ctx->blocks[fb.block];
+        if (tail != NULL)
+        {
+            memcpy(b, tail, carry);
+            item.kind = FARMHASH64_CDC_ITEM_BLOCK;
+            item.block = prev;
+            if (emit(ctx, &item) != 0)
+            {
+                return;
+            }
+        }
+        ssize_t k = farmhash64_cdc_fill(ctx->fd, b + carry, cap - carry);
+        if (k < 0)
+        {
+            status = FARMHASH64_CDC_ERR_IO;
+            k = 0;
+        }
+        ctx->stats.bytes += (uint64_t)k;
+        size_t n = carry + (size_t)k;
+        eof = (n < cap);
+        size_t pos = 0;
+        item.kind = FARMHASH64_CDC_ITEM_CHUNK;
+        item.block = fb.block;
+        // a boundary is final only when max_size bytes are available, as in the unbounded stream
+        while ((n - pos >= params->max_size) || (eof && (pos < n)))
+        {
+            size_t len = farmhash64_cdc_cut(&ctx->chunker, (const uint8_t *)b + pos, n - pos);
+            item.chunk.offset = offset;
+            item.chunk.data = b + pos;
+            item.chunk.len = (uint32_t)len;
+            if (emit(ctx, &item) != 0)
+            {
+                return;
+            }
+            offset += len;
+            pos += len;
+        }
+        tail = b + pos;
+        carry = n - pos;
+        prev = fb.block;
+    }
+    item.kind = FARMHASH64_CDC_ITEM_BLOCK;
+    item.block = prev;
+    if (emit(ctx, &item) != 0)
+    {
+        return;
+    }
+    item.kind = FARMHASH64_CDC_ITEM_END;
+    item.status = status;
+    emit(ctx, &item);
+}
+
+/**
+ * @brief Fingerprint a chunk item.
+ *
+ * @private
+ */
+static inline void farmhash64_cdc_fingerprint(const farmhash64_cdc_ctx_t *ctx, farmhash64_cdc_item_t *item)
+{
+    if (item->kind != FARMHASH64_CDC_ITEM_CHUNK)
+    {
+        return;
+    }
+    item->chunk.hash = farmhash64(item->chunk.data, item->chunk.len);
+    item->chunk.hash2 = ctx->params->wide ? farmhash64_with_seed(item->chunk.data, item->chunk.len, FARMHASH64_CDC_SEED2) : 0;
+}
+
+/**
+ * @brief Index lookup stage for one item: update the index and the statistics, call the sink, recycle the blocks.
+ *
+ * @return 0 to continue, 1 at the end of the stream, or a negative farmhash64_cdc_status_t error code
+ *
+ * @private
+ */
+static inline int farmhash64_cdc_consume(farmhash64_cdc_ctx_t *ctx, farmhash64_cdc_item_t *item)
+{
+    if (item->kind == FARMHASH64_CDC_ITEM_END)
+    {
+        return (item->status == FARMHASH64_CDC_OK) ? 1 : item->status;
+    }
+    if (item->kind == FARMHASH64_CDC_ITEM_BLOCK)
+    {
+        // the queue holds all the blocks, so it is never full
+        farmhash64_cdc_push(&ctx->free_blocks, item, &ctx->stop);
+        return 0;
+    }
+    uint64_t refs;
+    if (farmhash64_cdc_index_add(ctx->index, item->chunk.hash, item->chunk.hash2, &refs) != FARMHASH64_CDC_OK)
+    {
+        return FARMHASH64_CDC_ERR_MEMORY;
+    }
+    item->chunk.refs = (refs > UINT32_MAX) ? UINT32_MAX : (uint32_t)refs;
+    ctx->stats.chunks++;
+    if (refs == 0)
+    {
+        ctx->stats.unique_chunks++;
+        ctx->stats.unique_bytes += item->chunk.len;
+    }
+    if ((ctx->sink != NULL) && (ctx->sink(ctx->arg, &item->chunk) != 0))
+    {
+        return FARMHASH64_CDC_ERR_ABORTED;
+    }
+    return 0;
+}
+
+/**
+ * @brief Serial mode: run the fingerprinting and index stages directly on each item of the reader.
+ *
+ * @private
+ */
+static inline int farmhash64_cdc_emit_serial(farmhash64_cdc_ctx_t *ctx, farmhash64_cdc_item_t *item)
+{
+    farmhash64_cdc_fingerprint(ctx, item);
+    int ret = farmhash64_cdc_consume(ctx, item);
+    if (ret != 0)
+    {
+        ctx->status = (ret == 1) ? FARMHASH64_CDC_OK : ret;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Pipelined mode: pass the items of the reader to the fingerprinting thread.
+ *
+ * @private
+ */
+static inline int farmhash64_cdc_emit_queue(farmhash64_cdc_ctx_t *ctx, farmhash64_cdc_item_t *item)
+{
+    return farmhash64_cdc_push(&ctx->chunks, item, &ctx->stop);
+}
+
+/**
+ * @brief Reader and boundary detection thread.
+ *
+ * @private
+ */
+static inline void *farmhash64_cdc_read_thread(void *arg)
+{
+    farmhash64_cdc_ctx_t *ctx = (farmhash64_cdc_ctx_t *)arg;
+    farmhash64_cdc_read_stage(ctx, farmhash64_cdc_emit_queue);
+    return NULL;
+}
+
+/**
+ * @brief Fingerprinting thread.
+ *
+ * @private
+ */
+static inline void *farmhash64_cdc_hash_thread(void *arg)
+{
+    farmhash64_cdc_ctx_t *ctx = (farmhash64_cdc_ctx_t *)arg;
+    farmhash64_cdc_item_t item;
+    while (farmhash64_cdc_pop(&ctx->chunks, &item, &ctx->stop) == 0)
+    {
+        farmhash64_cdc_fingerprint(ctx, &item);
+        if ((farmhash64_cdc_push(&ctx->hashed, &item, &ctx->stop) != 0) || (item.kind == FARMHASH64_CDC_ITEM_END))
+        {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Split a stream in content-defined chunks, fingerprint them and look them up in an index.
+ *
+ * The sink is called on the calling thread for every chunk, in stream order,
+ * after the chunk has been added to the index (chunk->refs is 0 for the first occurrence).
+ * The index can be reused across runs to deduplicate several streams.
+ *
+ * @param fd     Input file descriptor, read until the end
+ * @param params Parameters (see farmhash64_cdc_default_params)
+ * @param index  Fingerprint index (see farmhash64_cdc_index_init)
+ * @param sink   Chunk consumer (can be NULL)
+ * @param arg    Sink argument
+ * @param stats  Output statistics (can be NULL)
+ *
+ * @return FARMHASH64_CDC_OK on success, or a negative farmhash64_cdc_status_t error code
+ *
+ * @public
+ */
+static inline int farmhash64_cdc_run(int fd, const farmhash64_cdc_params_t *params, farmhash64_cdc_index_t *index, farmhash64_cdc_sink_t sink, void *arg, farmhash64_cdc_stats_t *stats)
+{
+    if ((params == NULL) || (index == NULL) || (index->slots == NULL) || ((params->threads != 1) && (params->threads != 3)) || (params->block_size < params->max_size))
+    {
+        return FARMHASH64_CDC_ERR_ARGS;
+    }
+    farmhash64_cdc_ctx_t *ctx = (farmhash64_cdc_ctx_t *)aligned_alloc(64, (sizeof(farmhash64_cdc_ctx_t) + 63) & ~(size_t)63);
+    if (ctx == NULL)
+    {
+        return FARMHASH64_CDC_ERR_MEMORY;
+    }
+    memset(ctx, 0, sizeof(farmhash64_cdc_ctx_t));
+    int ret = farmhash64_cdc_chunker_init(&ctx->chunker, params);
+    ctx->params = params;
+    ctx->index = index;
+    ctx->sink = sink;
+    ctx->arg = arg;
+    ctx->fd = fd;
+    uint32_t i;
+    if ((ret == FARMHASH64_CDC_OK) && ((farmhash64_cdc_queue_init(&ctx->chunks, FARMHASH64_CDC_QUEUE_SIZE) != FARMHASH64_CDC_OK) || (farmhash64_cdc_queue_init(&ctx->hashed, FARMHASH64_CDC_QUEUE_SIZE) != FARMHASH64_CDC_OK) || (farmhash64_cdc_queue_init(&ctx->free_blocks, FARMHASH64_CDC_BLOCKS) != FARMHASH64_CDC_OK)))
+    {
+        ret = FARMHASH64_CDC_ERR_MEMORY;
+    }
+    for (i = 0; (i < FARMHASH64_CDC_BLOCKS) && (ret == FARMHASH64_CDC_OK); i++)
+    {
+        ctx->blocks[i] = (char *)malloc(params->block_size + params->max_size);
+        if (ctx->blocks[i] == NULL)
+        {
+            ret = FARMHASH64_CDC_ERR_MEMORY;
+            break;
+        }
+        farmhash64_cdc_item_t fb;
+        memset(&fb, 0, sizeof(fb));
+        fb.kind = FARMHASH64_CDC_ITEM_BLOCK;
+        fb.block = i;
+        farmhash64_cdc_push(&ctx->free_blocks, &fb, &ctx->stop);
+    }
+    int serial = (params->threads == 1);
+    if ((ret == FARMHASH64_CDC_OK) && !serial)
+    {
+        pthread_t tid[2];
+        if (pthread_create(&tid[1], NULL, farmhash64_cdc_hash_thread, ctx) != 0)
+        {
+            serial = 1;
+        }
+        else if (pthread_create(&tid[0], NULL, farmhash64_cdc_read_thread, ctx) != 0)
+        {
+            __atomic_store_n(&ctx->stop, 1, __ATOMIC_RELAXED);
+            pthread_join(tid[1], NULL);
+            ctx->stop = 0;
+            serial = 1;
+        }
+        else
+        {
+            farmhash64_cdc_item_t item;
+            while ((ret = farmhash64_cdc_pop(&ctx->hashed, &item, &ctx->stop)) == 0)
+            {
+                ret = farmhash64_cdc_consume(ctx, &item);
+                if (ret != 0)
+                {
+                    break;
+                }
+            }
+            ret = (ret == 1) ? FARMHASH64_CDC_OK : ret;
+            // release the producers if the run stopped early
+            __atomic_store_n(&ctx->stop, 1, __ATOMIC_RELAXED);
+            pthread_join(tid[0], NULL);
+            pthread_join(tid[1], NULL);
+        }
+    }
+    if ((ret == FARMHASH64_CDC_OK) && serial)
+    {
+        farmhash64_cdc_read_stage(ctx, farmhash64_cdc_emit_serial);
+        ret = ctx->status;
+    }
+    for (i = 0; i < FARMHASH64_CDC_BLOCKS; i++)
+    {
+        free(ctx->blocks[i]);
+    }
+    free(ctx->chunks.items);
+    free(ctx->hashed.items);
+    free(ctx->free_blocks.items);
+    if (stats != NULL)
+    {
+        *stats = ctx->stats;
+    }
+    free(ctx);
+    return ret;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // FARMHASH64_CDC_H
@@ -0,0 +1,516 @@
+/**
+ * @file farmhash64_cmap.h
+ * @brief Concurrent hash map of 64-bit keys and values, sharded by farmhash64.
+ *
+ * The map is split in 2^shard_bits shards: the top bits of farmhash64(key) select the shard
+ * and the low bits select the first slot of a linear probing sequence inside the shard table.
+ *
+ * Concurrency model:
+ * - Reads (farmhash64_cmap_get) are lock-free and never block, not even during a resize.
+ * - Writes (put/del) take the lock of their shard only, so writers on different shards never contend.
+ * - A shard grows by building a new table and publishing it atomically;
+ *   only the writers of that shard wait, all the other shards keep working.
+ * - Retired tables are released with epoch-based reclamation:
+ *   each reader thread announces the epoch it is reading in, using its own reader slot.
+ *
+ * Within a table the key of a slot never changes once assigned
+ * (deleted slots become tombstones that can only be revived by the same key),
+ * so a reader can never see a key paired with the value of another key.
+ */
+
+#ifndef FARMHASH64_CMAP_H
+#define FARMHASH64_CMAP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include "farmhash64.h"
+
+/**
+ * @brief Maximum number of concurrent reader threads (reader slot IDs are in [0, FARMHASH64_CMAP_MAX_READERS)).
+ */
+#define FARMHASH64_CMAP_MAX_READERS 256
+
+/**
+ * @brief Maximum number of shard bits.
+ */
+#define FARMHASH64_CMAP_MAX_SHARD_BITS 16
+
+/**
+ * @brief Tag of an empty slot.
+ *
+ * @private
+ */
+#define FARMHASH64_CMAP_EMPTY 0
+
+/**
+ * @brief Tag of a deleted slot.
+ *
+ * @private
+ */
+#define FARMHASH64_CMAP_TOMBSTONE 1
+
+/**
+ * @brief Return codes.
+ */
+enum farmhash64_cmap_status_t
+{
+    FARMHASH64_CMAP_OK = 0,           /**< Success. */
+    FARMHASH64_CMAP_ERR_ARGS = -1,    /**< Invalid arguments. */
+    FARMHASH64_CMAP_ERR_MEMORY = -2,  /**< Memory allocation failure. */
+};
+
+/**
+ * @brief Map slot.
+ *
+ * @private
+ */
+typedef struct farmhash64_cmap_slot_t
+{
+    uint64_t tag;   /**< Key hash (>= 2), or FARMHASH64_CMAP_EMPTY / FARMHASH64_CMAP_TOMBSTONE. */
+    uint64_t key;   /**< Key. */
+    uint64_t value; /**< Value. */
+} farmhash64_cmap_slot_t;
+
+/**
+ * @brief Shard table.
+ *
+ * @private
+ */
+typedef struct farmhash64_cmap_table_t
+{
+    uint64_t mask;                        /**< Number of slots minus one. */
+    uint64_t retire_epoch;                /**< Epoch in which the table was replaced. */
+    struct farmhash64_cmap_table_t *next; /**< Next retired table. */
+    farmhash64_cmap_slot_t *slots;        /**< Slots (allocated after the table header). */
+} farmhash64_cmap_table_t;
+
+/**
+ * @brief Map shard.
+ *
+ * @private
+ */
+typedef struct farmhash64_cmap_shard_t
+{
+    pthread_mutex_t lock;            /**< Writers lock. */
+    farmhash64_cmap_table_t *table;  /**< Current table. */
+    uint64_t live;                   /**< Number of keys. */
+    uint64_t used;                   /**< Number of non-empty slots (keys and tombstones). */
+} __attribute__((aligned(64))) farmhash64_cmap_shard_t;
+
+/**
+ * @brief Epoch announced by a reader thread (0 when not reading).
+ *
+ * @private
+ */
+typedef struct farmhash64_cmap_reader_t
+{
+    uint64_t epoch; /**< Announced epoch. */
+} __attribute__((aligned(64))) farmhash64_cmap_reader_t;
+
+/**
+ * @brief Concurrent hash map.
+ */
+typedef struct farmhash64_cmap_t
+{
+    farmhash64_cmap_shard_t *shards;                                  /**< Shards. */
+    uint32_t shard_bits;                                              /**< Number of shard bits. */
+    uint64_t epoch;                                                   /**< Global epoch. */
+    pthread_mutex_t retire_lock;                                      /**< Lock of the retired tables list. */
+    farmhash64_cmap_table_t *retired;                                 /**< Retired tables waiting to be released. */
+    farmhash64_cmap_reader_t readers[FARMHASH64_CMAP_MAX_READERS];    /**< Reader epochs. */
+} farmhash64_cmap_t;
+
+/**
+ * @brief Hash a key.
+ *
+ * @param key Key
+ *
+ * @return farmhash64 of the key bytes, never equal to a reserved slot tag
+ *
+ * @private
+ */
+static inline uint64_t farmhash64_cmap_hash(uint64_t key)
+{
+    uint64_t h = farmhash64((const char *)&key, sizeof(key));
+    return (h < 2) ? h + 2 : h;
+}
+
+/**
+ * @brief Allocate an empty shard table.
+ *
+ * @param nslots Number of slots (power of two)
+ *
+ * @return New table or NULL
+ *
+ * @private
+ */
+static inline farmhash64_cmap_table_t *farmhash64_cmap_table_new(uint64_t nslots)
+{
+    farmhash64_cmap_table_t *t = (farmhash64_cmap_table_t *)calloc(1, sizeof(farmhash64_cmap_table_t) + ((size_t)nslots * sizeof(farmhash64_cmap_slot_t)));
+    if (t == NULL)
+    {
+        return NULL;
+    }
+    t->mask = nslots - 1;
+    t->slots = (farmhash64_cmap_slot_t *)(void *)(t + 1);
+    return t;
+}
+
+/**
+ * @brief Select the shard of a hash.
+ *
+ * @private
+ */
+static inline farmhash64_cmap_shard_t *farmhash64_cmap_shard(const farmhash64_cmap_t *map, uint64_t h)
+{
+    return &map->shards[(map->shard_bits == 0) ? 0 : (h >> (64 - map->shard_bits))];
+}
+
+/**
+ * @brief Create a new map.
+ *
+ * @param map          Map to initialize
+ * @param shard_bits   Number of shard bits (up to FARMHASH64_CMAP_MAX_SHARD_BITS), e.g. 6 for 64 shards
+ * @param shard_slots  Initial number of slots per shard (rounded up to a power of two)
+ *
+ * @return FARMHASH64_CMAP_OK on success, or a negative farmhash64_cmap_status_t error code
+ *
+ * @public
+ */
+static inline int farmhash64_cmap_init(farmhash64_cmap_t *map, uint32_t shard_bits, uint64_t shard_slots)
+{
+    if ((map == NULL) || (shard_bits > FARMHASH64_CMAP_MAX_SHARD_BITS))
+    {
+        return FARMHASH64_CMAP_ERR_ARGS;
+    }
+    uint64_t nslots = 8;
+    while (nslots < shard_slots)
+    {
+        nslots <<= 1;
+    }
+    size_t nshards = (size_t)1 << shard_bits;
+    memset(map, 0, sizeof(*map));
+    map->shard_bits = shard_bits;
+    map->epoch = 1;
+    map->shards = (farmhash64_cmap_shard_t *)aligned_alloc(64, nshards * sizeof(farmhash64_cmap_shard_t));
+    if (map->shards == NULL)
+    {
+        return FARMHASH64_CMAP_ERR_MEMORY;
+    }
+    memset((void *)map->shards, 0, nshards * sizeof(farmhash64_cmap_shard_t));
+    pthread_mutex_init(&map->retire_lock, NULL);
+    size_t i;
+    for (i = 0; i < nshards; i++)
+    {
+        pthread_mutex_init(&map->shards[i].lock, NULL);
+        map->shards[i].table = farmhash64_cmap_table_new(nslots);
+        if (map->shards[i].table == NULL)
+        {
+            pthread_mutex_destroy(&map->shards[i].lock);
+            while (i-- > 0)
+            {
+                free(map->shards[i].table);
+                pthread_mutex_destroy(&map->shards[i].lock);
+            }
+            pthread_mutex_destroy(&map->retire_lock);
+            free(map->shards);
+            map->shards = NULL;
+            return FARMHASH64_CMAP_ERR_MEMORY;
+        }
+    }
+    return FARMHASH64_CMAP_OK;
+}
+
+/**
+ * @brief Release all the resources of a map.
+ *
+ * No other thread may use the map during or after this call.
+ *
+ * @param map Map
+ *
+ * @public
+ */
+static inline void farmhash64_cmap_destroy(farmhash64_cmap_t *map)
+{
+    if ((map == NULL) || (map->shards == NULL))
+    {
+        return;
+    }
+    size_t nshards = (size_t)1 << map->shard_bits;
+    size_t i;
+    for (i = 0; i < nshards; i++)
+    {
+        free(map->shards[i].table);
+        pthread_mutex_destroy(&map->shards[i].lock);
+    }
+    while (map->retired != NULL)
+    {
+        farmhash64_cmap_table_t *t = map->retired;
+        map->retired = t->next;
+        free(t);
+    }
+    pthread_mutex_destroy(&map->retire_lock);
+    free(map->shards);
+    map->shards = NULL;
+}
+
+/**
+ * @brief Retire a replaced table and release the retired tables that no reader can still see.
+ *
+ * @private
+ */
+static inline void farmhash64_cmap_retire(farmhash64_cmap_t *map, farmhash64_cmap_table_t *old)
+{
+    old->retire_epoch = __atomic_fetch_add(&map->epoch, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_lock(&map->retire_lock);
+    old->next = map->retired;
+    map->retired = old;
+    // readers that are not announced now can only see tables published after every retired one
+    uint64_t min_epoch = UINT64_MAX;
+    size_t i;
+    for (i = 0; i < FARMHASH64_CMAP_MAX_READERS; i++)
+    {
+        uint64_t e = __atomic_load_n(&map->readers[i].epoch, __ATOMIC_SEQ_CST);
+        if ((e != 0) && (e < min_epoch))
+        {
+            min_epoch = e;
+        }
+    }
+    farmhash64_cmap_table_t **pt = &map->retired;
+    while (*pt != NULL)
+    {
+        farmhash64_cmap_table_t *t = *pt;
+        if (t->retire_epoch < min_epoch)
+        {
+            *pt = t->next;
+            free(t);
+        }
+        else
+        {
+            pt = &t->next;
+        }
+    }
+    pthread_mutex_unlock(&map->retire_lock);
+}
+
+/**
+ * @brief Rebuild the table of a shard, dropping the tombstones and growing it if needed.
+ *
+ * Must be called with the shard lock held.
+ *
+ * @private
+ */
+static inline int farmhash64_cmap_resize(farmhash64_cmap_t *map, farmhash64_cmap_shard_t *sh)
+{
+    farmhash64_cmap_table_t *old = sh->table;
+    uint64_t nslots = old->mask + 1;
+    while ((sh->live + 1) * 2 > nslots)
+    {
+        nslots <<= 1;
+    }
+    farmhash64_cmap_table_t *t = farmhash64_cmap_table_new(nslots);
+    if (t == NULL)
+    {
+        return FARMHASH64_CMAP_ERR_MEMORY;
+    }
+    uint64_t i;
+    for (i = 0; i <= old->mask; i++)
+    {
+        const farmhash64_cmap_slot_t *s = &old->slots[i];
+        if (s->tag < 2)
+        {
+            continue;
+        }
+        uint64_t j = s->tag & t->mask;
+        while (t->slots[j].tag != FARMHASH64_CMAP_EMPTY)
+        {
+            j = (j + 1) & t->mask;
+        }
+        t->slots[j].key = s->key;
+        t->slots[j].value = __atomic_load_n(&s->value, __ATOMIC_RELAXED);
+        t->slots[j].tag = s->tag;
+    }
+    sh->used = __atomic_load_n(&sh->live, __ATOMIC_RELAXED);
+    __atomic_store_n(&sh->table, t, __ATOMIC_SEQ_CST);
+    farmhash64_cmap_retire(map, old);
+    return FARMHASH64_CMAP_OK;
+}
+
+/**
+ * @brief Look up a key.
+ *
+ * Lock-free: it can run concurrently with any other operation.
+ * Each concurrent reader thread must use a distinct reader ID.
+ *
+ * @param map    Map
+ * @param reader Reader ID of the calling thread, in [0, FARMHASH64_CMAP_MAX_READERS)
+ * @param key    Key
+ * @param value  Output value (can be NULL)
+ *
+ * @return 1 if the key was found, 0 otherwise
+ *
+ * @public
+ */
+static inline int farmhash64_cmap_get(farmhash64_cmap_t *map, unsigned reader, uint64_t key, uint64_t *value)
+{
+    uint64_t h = farmhash64_cmap_hash(key);
+    farmhash64_cmap_shard_t *sh = farmhash64_cmap_shard(map, h);
+    uint64_t *ep = &map->readers[reader].epoch;
+    int found = 0;
+    __atomic_store_n(ep, __atomic_load_n(&map->epoch, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+    const farmhash64_cmap_table_t *t = __atomic_load_n(&sh->table, __ATOMIC_SEQ_CST);
+    uint64_t i = h & t->mask;
+    for (;;)
+    {
+        const farmhash64_cmap_slot_t *s = &t->slots[i];
+        uint64_t tag = __atomic_load_n(&s->tag, __ATOMIC_ACQUIRE);
+        if (tag == FARMHASH64_CMAP_EMPTY)
+        {
+            break;
+        }
+        if ((tag == h) && (s->key == key))
+        {
+            if (value != NULL)
+            {
+                *value = __atomic_load_n(&s->value, __ATOMIC_RELAXED);
+            }
+            found = 1;
+            break;
+        }
+        i = (i + 1) & t->mask;
+    }
+    __atomic_store_n(ep, 0, __ATOMIC_RELEASE);
+    return found;
+}
+
+/**
+ * @brief Insert a key or update its value.
+ *
+ * @param map   Map
+ * @param key   Key
+ * @param value Value
+ *
+ * @return 1 if the key was inserted, 0 if it was updated, or a negative farmhash64_cmap_status_t error code
+ *
+ * @public
+ */
+static inline int farmhash64_cmap_put(farmhash64_cmap_t *map, uint64_t key, uint64_t value)
+{
+    uint64_t h = farmhash64_cmap_hash(key);
+    farmhash64_cmap_shard_t *sh = farmhash64_cmap_shard(map, h);
+    int ret = 1;
+    pthread_mutex_lock(&sh->lock);
+    if ((sh->used + 1) * 4 > (sh->table->mask + 1) * 3)
+    {
+        ret = farmhash64_cmap_resize(map, sh);
+        if (ret != FARMHASH64_CMAP_OK)
+        {
+            pthread_mutex_unlock(&sh->lock);
+            return ret;
+        }
+        ret = 1;
+    }
+    farmhash64_cmap_table_t *t = sh->table;
+    uint64_t i = h & t->mask;
+    for (;;)
+    {
+        farmhash64_cmap_slot_t *s = &t->slots[i];
+        if (s->tag == FARMHASH64_CMAP_EMPTY)
+        {
+            s->key = key;
+            __atomic_store_n(&s->value, value, __ATOMIC_RELAXED);
+            __atomic_store_n(&s->tag, h, __ATOMIC_RELEASE);
+            sh->used++;
+            __atomic_store_n(&sh->live, sh->live + 1, __ATOMIC_RELAXED);
+            break;
+        }
+        if ((s->key == key) && ((s->tag == h) || (s->tag == FARMHASH64_CMAP_TOMBSTONE)))
+        {
+            __atomic_store_n(&s->value, value, __ATOMIC_RELAXED);
+            if (s->tag == h)
+            {
+                ret = 0;
+            }
+            else
+            {
+                // revive a deleted slot of the same key
+                __atomic_store_n(&s->tag, h, __ATOMIC_RELEASE);
+                __atomic_store_n(&sh->live, sh->live + 1, __ATOMIC_RELAXED);
+            }
+            break;
+        }
+        i = (i + 1) & t->mask;
+    }
+    pthread_mutex_unlock(&sh->lock);
+    return ret;
+}
+
+/**
+ * @brief Delete a key.
+ *
+ * @param map Map
+ * @param key Key
+ *
+ * @return 1 if the key was deleted, 0 if it was not found
+ *
+ * @public
+ */
+static inline int farmhash64_cmap_del(farmhash64_cmap_t *map, uint64_t key)
+{
+    uint64_t h = farmhash64_cmap_hash(key);
+    farmhash64_cmap_shard_t *sh = farmhash64_cmap_shard(map, h);
+    int ret = 0;
+    pthread_mutex_lock(&sh->lock);
+    farmhash64_cmap_table_t *t = sh->table;
+    uint64_t i = h & t->mask;
+    for (;;)
+    {
+        farmhash64_cmap_slot_t *s = &t->slots[i];
+        if (s->tag == FARMHASH64_CMAP_EMPTY)
+        {
+            break;
+        }
+        if ((s->tag == h) && (s->key == key))
+        {
+            __atomic_store_n(&s->tag, FARMHASH64_CMAP_TOMBSTONE, __ATOMIC_RELEASE);
+            __atomic_store_n(&sh->live, sh->live - 1, __ATOMIC_RELAXED);
+            ret = 1;
+            break;
+        }
+        i = (i + 1) & t->mask;
+    }
+    pthread_mutex_unlock(&sh->lock);
+    return ret;
+}
+
+/**
+ * @brief Return the number of keys in the map.
+ *
+ * The value is exact only when no writer is running.
+ *
+ * @param map Map
+ *
+ * @return Number of keys
+ *
+ * @public
+ */
+static inline uint64_t farmhash64_cmap_size(const farmhash64_cmap_t *map)
+{
+    size_t nshards = (size_t)1 << map->shard_bits;
+    uint64_t n = 0;
+    size_t i;
+    for (i = 0; i < nshards; i++)
+    {
+        n += __atomic_load_n(&map->shards[i].live, __ATOMIC_RELAXED);
+    }
+    return n;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // FARMHASH64_CMAP_H
@@ -0,0 +1,1488 @@
+/**
+ * @file farmhash64_dedup.h
+ * @brief External-memory deduplication and distinct counting of delimited records, driven by farmhash64.
+ *
+ * Removes the duplicate records (lines by default) of inputs larger than the available memory,
+ * with a cost proportional to the input size instead of the n log n comparisons of a sort:
+ *
+ * - Spill: the input is streamed once; each record is hashed with farmhash64 and appended,
+ *   with its hash and sequence number, to one of 2^bits partition files selected by the top bits of the hash.
+ *   All the copies of a record land in the same partition.
+ * - Dedup: the partitions are processed in parallel, each one in memory by a single thread
+ *   that keeps the first occurrence of every record. Records with equal hashes are compared byte by byte,
+ *   so hash collisions never merge different records.
+ *   Only the distinct records of a partition are kept in memory: a partition whose distinct records
+ *   do not fit in the per-thread share of the memory budget is split again by the next hash bits.
+ * - Merge (stable mode only): the distinct records of each partition are already in input order,
+ *   so a k-way merge by sequence number writes the first occurrences in the original input order.
+ *   Without stable mode the partitions are written as soon as they are done, in an unspecified order.
+ *
+ * In count mode only the 64-bit hashes are spilled and the result is the number of distinct hashes:
+ * two different records with the same hash are counted once (probability about n^2 / 2^65 for n records).
+ *
+ * This header uses POSIX I/O: define _XOPEN_SOURCE 700 (or _DEFAULT_SOURCE) before including it.
+ * The command line tool is in app/farmhash64_dedup.c.
+ */
+
+#ifndef FARMHASH64_DEDUP_H
+#define FARMHASH64_DEDUP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include "farmhash64.h"
+
+/**
+ * @brief Maximum number of partition bits (one open file per partition while spilling).
+ */
+#define FARMHASH64_DEDUP_MAX_BITS 10
+
+/**
+ * @brief Number of runs merged at once in stable mode; more runs are merged in several passes.
+ */
+#define FARMHASH64_DEDUP_MERGE_WAYS 256
+
+/**
+ * @brief Number of hash bits used each time an oversized partition is split.
+ */
+#define FARMHASH64_DEDUP_SPLIT_BITS 4
+
+/**
+ * @brief Maximum number of threads.
+ */
+#define FARMHASH64_DEDUP_MAX_THREADS 256
+
+/**
+ * @brief Minimum memory budget per thread.
+ */
+#define FARMHASH64_DEDUP_MIN_MEMORY (1 << 20)
+
+/**
+ * @brief Size of the input block and of the output buffers.
+ *
+ * @private
+ */
+#define FARMHASH64_DEDUP_IO_SIZE (1 << 20)
+
+/**
+ * @brief Size of the buffer of each partition file and of each merged run.
+ *
+ * @private
+ */
+#define FARMHASH64_DEDUP_FILE_SIZE (1 << 16)
+
+/**
+ * @brief Size of a spilled record header: hash (8 bytes), sequence number (8 bytes) and length (4 bytes).
+ *
+ * @private
+ */
+#define FARMHASH64_DEDUP_SPILL_HDR 20
+
+/**
+ * @brief Size of a distinct record header in memory and in the runs: sequence number (8 bytes) and length (4 bytes).
+ *
+ * @private
+ */
+#define FARMHASH64_DEDUP_RUN_HDR 12
+
+/**
+ * @brief Maximum length of a temporary file path.
+ *
+ * @private
+ */
+#define FARMHASH64_DEDUP_PATH_MAX 4096
+
+/**
+ * @brief Maximum length of the temporary directory path, leaving room for the file names.
+ *
+ * @private
+ */
+#define FARMHASH64_DEDUP_DIR_MAX (FARMHASH64_DEDUP_PATH_MAX - 512)
+
+/**
+ * @brief Number of file descriptors left to the rest of the process (standard streams, output, caller files),
+ * in addition to the inputs.
+ *
+ * @private
+ */
+#define FARMHASH64_DEDUP_RESERVED_FILES 32
+
+/**
+ * @brief Maximum number of files open at once by a dedup thread: a partition and its split files.
+ *
+ * @private
+ */
+#define FARMHASH64_DEDUP_THREAD_FILES (1 + (1 << FARMHASH64_DEDUP_SPLIT_BITS))
+
+/**
+ * @brief Return codes.
+ */
+enum farmhash64_dedup_status_t
+{
+    FARMHASH64_DEDUP_OK = 0,            /**< Success. */
+    FARMHASH64_DEDUP_ERR_ARGS = -1,     /**< Invalid arguments, or a record longer than 4 GiB. */
+    FARMHASH64_DEDUP_ERR_MEMORY = -2,   /**< Memory allocation failure. */
+    FARMHASH64_DEDUP_ERR_IO = -3,       /**< Read, write or temporary file error (see errno). */
+    FARMHASH64_DEDUP_ERR_BUDGET = -4,   /**< The distinct records of a single hash do not fit in the memory budget. */
+};
+
+/**
+ * @brief Options.
+ */
+typedef struct farmhash64_dedup_opts_t
+{
+    const char *tmpdir; /**< Directory of the temporary files (NULL for $TMPDIR or /tmp). */
+    size_t mem_bytes;   /**< Memory budget of the dedup phase, shared by all the threads. */
+    uint32_t bits;      /**< Number of partition bits (up to FARMHASH64_DEDUP_MAX_BITS), lowered to fit the open file limit. */
+    unsigned nthreads;  /**< Number of dedup threads (1 to FARMHASH64_DEDUP_MAX_THREADS), lowered to the number of partitions and to fit the open file limit. */
+    char delim;         /**< Record delimiter. */
+    int stable;         /**< Write the first occurrences in input order. */
+    int count_only;     /**< Only count the distinct records (hashes), without writing them. */
+} farmhash64_dedup_opts_t;
+
+/**
+ * @brief Statistics of a run.
+ */
+typedef struct farmhash64_dedup_stats_t
+{
+    uint64_t records;     /**< Number of input records. */
+    uint64_t distinct;    /**< Number of distinct records. */
+    uint64_t bytes_in;    /**< Number of input bytes. */
+    uint64_t bytes_spill; /**< Number of bytes written to the partition files. */
+    uint64_t splits;      /**< Number of partitions split because they did not fit in memory. */
+    uint32_t bits;        /**< Number of partition bits used. */
+    unsigned nthreads;    /**< Number of dedup threads used. */
+} farmhash64_dedup_stats_t;
+
+/**
+ * @brief Buffered writer.
+ *
+ * @private
+ */
+typedef struct farmhash64_dedup_writer_t
+{
+    int fd;                /**< Output file descriptor. */
+    char *buf;             /**< Buffer. */
+    size_t len;            /**< Buffered bytes. */
+    size_t cap;            /**< Buffer size. */
+    uint64_t written;      /**< Bytes written so far (buffered included). */
+    pthread_mutex_t *lock; /**< Lock held while writing to fd (can be NULL). */
+    int err;               /**< Set on write error. */
+} farmhash64_dedup_writer_t;
+
+/**
+ * @brief Buffered reader.
+ *
+ * @private
+ */
+typedef struct farmhash64_dedup_reader_t
+{
+    int fd;     /**< Input file descriptor. */
+    char *buf;  /**< Buffer. */
+    size_t pos; /**< First unread byte. */
+    size_t end; /**< End of the buffered bytes. */
+    size_t cap; /**< Buffer size. */
+} farmhash64_dedup_reader_t;
+
+/**
+ * @brief Slot of a dedup table.
+ *
+ * @private
+ */
+typedef struct farmhash64_dedup_slot_t
+{
+    uint64_t hash; /**< Record hash. */
+    uint64_t ref;  /**< Offset of the record in the arena plus one (0 for an empty slot). */
+} farmhash64_dedup_slot_t;
+
+/**
+ * @brief Per-thread dedup memory, reused for all the partitions of the thread.
+ *
+ * @private
+ */
+typedef struct farmhash64_dedup_mem_t
+{
+    farmhash64_dedup_slot_t *slots; /**< Table. */
+    uint64_t mask;                  /**< Number of table slots minus one. */
+    uint64_t used;                  /**< Number of distinct records in the table. */
+    char *arena;                    /**< Distinct records: header and bytes. */
+    size_t arena_len;               /**< Used arena bytes. */
+    size_t arena_cap;               /**< Arena size. */
+    size_t budget;                  /**< Memory budget of the thread. */
+} farmhash64_dedup_mem_t;
+
+/**
+ * @brief Shared state of a run.
+ *
+ * @private
+ */
+typedef struct farmhash64_dedup_ctx_t
+{
+    const farmhash64_dedup_opts_t *opts; /**< Options. */
+    char dir[FARMHASH64_DEDUP_DIR_MAX];  /**< Private temporary directory. */
+    int out_fd;                          /**< Output file descriptor. */
+    pthread_mutex_t lock;                /**< Protects the output and the runs list. */
+    uint64_t *runs;                      /**< IDs of the run files (stable mode). */
+    size_t nruns;                        /**< Number of runs. */
+    size_t runs_cap;                     /**< Capacity of the runs list. */
+    uint64_t next_part;                  /**< Next partition to process. */
+    uint64_t next_id;                    /**< Next temporary file ID. */
+    uint64_t distinct;                   /**< Number of distinct records. */
+    uint64_t splits;                     /**< Number of split partitions. */
+    uint32_t bits;                       /**< Number of partition bits used. */
+    unsigned nthreads;                   /**< Number of dedup threads used. */
+    int ret;                             /**< First error. */
+} farmhash64_dedup_ctx_t;
+
+/**
+ * @brief Set the default options: 1 GiB of memory, 256 partitions, 1 thread, newline-delimited records.
+ *
+ * @param opts Options to initialize
+ *
+ * @public
+ */
+static inline void farmhash64_dedup_default_opts(farmhash64_dedup_opts_t *opts)
+{
+    opts->tmpdir = NULL;
+    opts->mem_bytes = (size_t)1 << 30;
+    opts->bits = 8;
+    opts->nthreads = 1;
+    opts->delim = '\n';
+    opts->stable = 0;
+    opts->count_only = 0;
+}
+
+/**
+ * @brief Write all the bytes to a file descriptor, retrying on partial writes and interrupts.
+ *
+ * @return 0 on success, -1 on error
+ *
+ * @private
+ */
+static inline int farmhash64_dedup_write_all(int fd, const char *p, size_t n)
+{
+    while (n > 0)
+    {
+        ssize_t w = write(fd, p, n);
+        if (w < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        p += w;
+        n -= (size_t)w;
+    }
+    return 0;
+}
+
+/**
+ * @brief Initialize a buffered writer.
+ *
+ * @private
+ */
+static inline int farmhash64_dedup_writer_init(farmhash64_dedup_writer_t *w, int fd, size_t cap, pthread_mutex_t *lock)
+{
+    w->fd = fd;
+    w->len = 0;
+    w->cap = cap;
+    w->written = 0;
+    w->lock = lock;
+    w->err = 0;
+    w->buf = (char *)malloc(cap);
+    return (w->buf == NULL) ? FARMHASH64_DEDUP_ERR_MEMORY : FARMHASH64_DEDUP_OK;
+}
+
+/**
+ * @brief Write the buffered bytes, followed by n more bytes from p.
+ *
+ * @private
+ */
+static inline void farmhash64_dedup_writer_flush(farmhash64_dedup_writer_t *w, const char *p, size_t n)
+{
+    if ((w->len == 0) && (n == 0))
+    {
+        return;
+    }
+    if (w->lock != NULL)
+    {
+        pthread_mutex_lock(w->lock);
+    }
+    if ((farmhash64_dedup_write_all(w->fd, w->buf, w->len) != 0) || (farmhash64_dedup_write_all(w->fd, p, n) != 0))
+    {
+        w->err = 1;
+    }
+    if (w->lock != NULL)
+    {
+        pthread_mutex_unlock(w->lock);
+    }
+    w->len = 0;
+}
+
+/**
+ * @brief Append bytes to a writer.
+ *
+ * With a lock, the bytes of a single call are never interleaved with the ones of other writers.
+ *
+ * @private
+ */
+static inline void farmhash64_dedup_writer_put(farmhash64_dedup_writer_t *w, const void *p, size_t n)
+{
+    w->written += n;
+    if (n > w->cap - w->len)
+    {
+        if (n > w->cap)
+        {
+            farmhash64_dedup_writer_flush(w, (const char *)p, n);
+            return;
+        }
+        farmhash64_dedup_writer_flush(w, NULL, 0);
+    }
+    memcpy(w->buf + w->len, p, n);
+    w->len += n;
+}
+
+/**
+ * @brief Append a record followed by the delimiter, as a single write.
+ *
+ * @private
+ */
+static inline void farmhash64_dedup_writer_record(farmhash64_dedup_writer_t *w, const char *rec, size_t n, char delim)
+{
+    w->written += n + 1;
+    if (n + 1 > w->cap - w->len)
+    {
+        farmhash64_dedup_writer_flush(w, NULL, 0);
+        if (n + 1 > w->cap)
+        {
+            // too long for the buffer: write it directly, keeping it contiguous with the delimiter
+            if (w->lock != NULL)
+            {
+                pthread_mutex_lock(w->lock);
+            }
+            if ((farmhash64_dedup_write_all(w->fd, rec, n) != 0) || (farmhash64_dedup_write_all(w->fd, &delim, 1) != 0))
+            {
+                w->err = 1;
+            }
+            if (w->lock != NULL)
+            {
+                pthread_mutex_unlock(w->lock);
+            }
+            return;
+        }
+    }
+    memcpy(w->buf + w->len, rec, n);
+    w->buf[w->len + n] = delim;
+    w->len += n + 1;
+}
+
+/**
+ * @brief Flush and release a writer.
+ *
+ * @return FARMHASH64_DEDUP_OK or FARMHASH64_DEDUP_ERR_IO
+ *
+ * @private
+ */
+static inline int farmhash64_dedup_writer_close(farmhash64_dedup_writer_t *w)
+{
+    if (w->buf != NULL)
+    {
+        farmhash64_dedup_writer_flush(w, NULL, 0);
+        free(w->buf);
+        w->buf = NULL;
+    }
+    return w->err ? FARMHASH64_DEDUP_ERR_IO : FARMHASH64_DEDUP_OK;
+}
+
+/**
+ * @brief Initialize a buffered reader.
+ *
+ * @private
+ */
+static inline int farmhash64_dedup_reader_init(farmhash64_dedup_reader_t *r, int fd, size_t cap)
+{
+    r->fd = fd;
+    r->pos = 0;
+    r->end = 0;
+    r->cap = cap;
+    r->buf = (char *)malloc(cap);
+    return (r->buf == NULL) ? FARMHASH64_DEDUP_ERR_MEMORY : FARMHASH64_DEDUP_OK;
+}
+
+/**
+ * @brief Read exactly n bytes.
+ *
+ * @return 1 on success, 0 at the end of the file (no bytes read), -1 on error or truncated data
+ *
+ * @private
+ */
+static inline int farmhash64_dedup_reader_read(farmhash64_dedup_reader_t *r, void *dst, size_t n)
+{
+    char *d = (char *)dst;
+    size_t done = 0;
+    while (done < n)
+    {
+        if (r->pos == r->end)
+        {
+            ssize_t k = read(r->fd, r->buf, r->cap);
+            if (k < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return -1;
+            }
+            if (k == 0)
+            {
+                return (done == 0) ? 0 : -1;
+            }
+            r->pos = 0;
+            r->end = (size_t)k;
+        }
+        size_t m = r->end - r->pos;
+        if (m > n - done)
+        {
+            m = n - done;
+        }
+        memcpy(d + done, r->buf + r->pos, m);
+        r->pos += m;
+        done += m;
+    }
+    return 1;
+}
+
+/**
+ * @brief Release a reader and close its file.
+ *
+ * @private
+ */
+static inline void farmhash64_dedup_reader_close(farmhash64_dedup_reader_t *r)
+{
+    free(r->buf);
+    r->buf = NULL;
+    if (r->fd >= 0)
+    {
+        close(r->fd);
+        r->fd = -1;
+    }
+}
+
+/**
+ * @brief Build the path of a temporary file: kind is 'p' (partition), 's' (split partition) or 'r' (run).
+ *
+ * @private
+ */
+static inline void farmhash64_dedup_path(const farmhash64_dedup_ctx_t *ctx, char *path, char kind, uint64_t id)
+{
+    snprintf(path, FARMHASH64_DEDUP_PATH_MAX, "%s/%c%llu", ctx->dir, kind, (unsigned long long)id);
+}
+
+/**
+ * @brief Create a temporary file for writing.
+ *
+ * @private
+ */
+static inline int farmhash64_dedup_create(const farmhash64_dedup_ctx_t *ctx, char kind, uint64_t id)
+{
+    char path[FARMHASH64_DEDUP_PATH_MAX];
+    farmhash64_dedup_path(ctx, path, kind, id);
+    return open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+}
+
+/**
+ * @brief Record the first error of a run.
+ *
+ * @private
+ */
+static inline void farmhash64_dedup_fail(farmhash64_dedup_ctx_t *ctx, int ret)
+{
+    int ok = FARMHASH64_DEDUP_OK;
+    __atomic_compare_exchange_n(&ctx->ret, &ok, ret, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Partition of a hash, skipping the bits already used by the parent partitions.
+ *
+ * @private
+ */
+static inline size_t farmhash64_dedup_part(uint64_t h, uint32_t skip, uint32_t bits)
+{
+    return (bits == 0) ? 0 : (size_t)((h << skip) >> (64 - bits));
+}
+
+/**
+ * @brief State of the spill phase.
+ *
+ * @private
+ */
+typedef struct farmhash64_dedup_spill_t
+{
+    farmhash64_dedup_writer_t *parts; /**< Partition writers. */
+    size_t nparts;                    /**< Number of partitions. */
+    uint32_t bits;                    /**< Number of partition bits. */
+    uint64_t seq;                     /**< Sequence number of the next record. */
+    int ret;                          /**< Status. */
+} farmhash64_dedup_spill_t;
+
+/**
+ * @brief Append a record to its partition.
+ *
+ * @private
+ */
+static inline void farmhash64_dedup_spill_record(farmhash64_dedup_spill_t *sp, const farmhash64_dedup_opts_t *opts, const char *rec, size_t len)
+{
+    uint64_t h = farmhash64(rec, len);
+    farmhash64_dedup_writer_t *w = &sp->parts[farmhash64_dedup_part(h, 0, sp->bits)];
+    if (opts->count_only)
+    {
+        farmhash64_dedup_writer_put(w, &h, sizeof(h));
+    }
+    else if (len > UINT32_MAX)
+    {
+        sp->ret = FARMHASH64_DEDUP_ERR_ARGS;
+    }
+    else
+    {
+        char hdr[FARMHASH64_DEDUP_SPILL_HDR];
+        uint32_t n = (uint32_t)len;
+        memcpy(hdr, &h, 8);
+        memcpy(hdr + 8, &sp->seq, 8);
+        memcpy(hdr + 16, &n, 4);
+        farmhash64_dedup_writer_put(w, hdr, sizeof(hdr));
+        farmhash64_dedup_writer_put(w, rec, len);
+    }
+    sp->seq++;
+}
+
+/**
+ * @brief Split the records of an input in the spill partitions.
+ *
+ * Records are delimited by opts->delim; the last record of each input may have no delimiter.
+ *
+ * @private
+ */
+static inline int farmhash64_dedup_spill_input(farmhash64_dedup_spill_t *sp, const farmhash64_dedup_opts_t *opts, int fd, char **buf, size_t *cap, farmhash64_dedup_stats_t *stats)
+{
+    size_t len = 0;  // buffered bytes
+    size_t scan = 0; // the first scan bytes contain no delimiter
+    for (;;)
+    {
+        if (len == *cap)
+        {
+            // a record longer than the buffer
+            char *nbuf = (char *)realloc(*buf, *cap * 2);
+            if (nbuf == NULL)
+            {
+                return FARMHASH64_DEDUP_ERR_MEMORY;
+            }
+            *buf = nbuf;
+            *cap *= 2;
+        }
+        ssize_t n = read(fd, *buf + len, *cap - len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return FARMHASH64_DEDUP_ERR_IO;
+        }
+        if (n == 0)
+        {
+            break;
+        }
+        stats->bytes_in += (uint64_t)n;
+        len += (size_t)n;
+        const char *b = *buf;
+        size_t start = 0;
+        const char *e;
+        while ((e = (const char *)memchr(b + scan, opts->delim, len - scan)) != NULL)
+        {
+            size_t end = (size_t)(e - b);
+            farmhash64_dedup_spill_record(sp, opts, b + start, end - start);
+            start = end + 1;
+            scan = start;
+        }
+        if (sp->ret != FARMHASH64_DEDUP_OK)
+        {
+            return sp->ret;
+        }
+        memmove(*buf, b + start, len - start);
+        len -= start;
+        scan = len;
+    }
+    if (len > 0)
+    {
+        farmhash64_dedup_spill_record(sp, opts, *buf, len);
+    }
+    return sp->ret;
+}
+
+/**
+ * @brief Spill phase: write the records of all the inputs to the partition files.
+ *
+ * @private
+ */
+static inline int farmhash64_dedup_spill(farmhash64_dedup_ctx_t *ctx, const int *in_fds, size_t nin, farmhash64_dedup_stats_t *stats)
+{
+    const farmhash64_dedup_opts_t *opts = ctx->opts;
+    farmhash64_dedup_spill_t sp;
+    sp.bits = ctx->bits;
+    sp.nparts = (size_t)1 << ctx->bits;
+    sp.seq = 0;
+    sp.ret = FARMHASH64_DEDUP_OK;
+    sp.parts = (farmhash64_dedup_writer_t *)calloc(sp.nparts, sizeof(farmhash64_dedup_writer_t));
+    size_t cap = FARMHASH64_DEDUP_IO_SIZE;
+    char *buf = (char *)malloc(cap);
+    size_t i;
+    if ((sp.parts == NULL) || (buf == NULL))
+    {
+        free(sp.parts);
+        free(buf);
+        return FARMHASH64_DEDUP_ERR_MEMORY;
+    }
+    for (i = 0; i < sp.nparts; i++)
+    {
+        sp.parts[i].fd = -1;
+    }
+    int ret = FARMHASH64_DEDUP_OK;
+    for (i = 0; (i < sp.nparts) && (ret == FARMHASH64_DEDUP_OK); i++)
+    {
+        int fd = farmhash64_dedup_create(ctx, 'p', i);
+        if (fd < 0)
+        {
+            ret = FARMHASH64_DEDUP_ERR_IO;
+            break;
+        }
+        ret = farmhash64_dedup_writer_init(&sp.parts[i], fd, FARMHASH64_DEDUP_FILE_SIZE, NULL);
+        if (ret != FARMHASH64_DEDUP_OK)
+        {
+            close(fd);
+            sp.parts[i].fd = -1;
+        }
+    }
+    for (i = 0; (i < nin) && (ret == FARMHASH64_DEDUP_OK); i++)
+    {
+        ret = farmhash64_dedup_spill_input(&sp, opts, in_fds[i], &buf, &cap, stats);
+    }
+    stats->records = sp.seq;
+    for (i = 0; i < sp.nparts; i++)
+    {
+        if (sp.parts[i].fd < 0)
+        {
+            continue;
+        }
+        int r = farmhash64_dedup_writer_close(&sp.parts[i]);
+        if (close(sp.parts[i].fd) != 0)
+        {
+            r = FARMHASH64_DEDUP_ERR_IO;
+        }
+        if (ret == FARMHASH64_DEDUP_OK)
+        {
+            ret = r;
+        }
+        stats->bytes_spill += sp.parts[i].written;
+    }
+    free(sp.parts);
+    free(buf);
+    return ret;
+}
+
+/**
+ * @brief Grow the dedup table, reinserting the records with their stored hashes.
+ *
+ * @return FARMHASH64_DEDUP_OK, FARMHASH64_DEDUP_ERR_MEMORY, or FARMHASH64_DEDUP_ERR_BUDGET when over budget
+ *
+ * @private
+ */
+static inline int farmhash64_dedup_grow(farmhash64_dedup_mem_t *m)
+{
+    uint64_t nslots = (m->slots == NULL) ? 1024 : (m->mask + 1) * 2;
+    if (((size_t)nslots * sizeof(farmhash64_dedup_slot_t)) + m->arena_len > m->budget)
+    {
+        return FARMHASH64_DEDUP_ERR_BUDGET;
+    }
+    farmhash64_dedup_slot_t *s = (farmhash64_dedup_slot_t *)calloc((size_t)nslots, sizeof(farmhash64_dedup_slot_t));
+    if (s == NULL)
+    {
+        return FARMHASH64_DEDUP_ERR_MEMORY;
+    }
+    uint64_t mask = nslots - 1;
+    uint64_t i;
+    if (m->slots != NULL)
+    {
+        for (i = 0; i <= m->mask; i++)
+        {
+            if (m->slots[i].ref == 0)
+            {
+                continue;
+            }
+            uint64_t j = m->slots[i].hash & mask;
+            while (s[j].ref != 0)
+            {
+                j = (j + 1) & mask;
+            }
+            s[j] = m->slots[i];
+        }
+    }
+    free(m->slots);
+    m->slots = s;
+    m->mask = mask;
+    return FARMHASH64_DEDUP_OK;
+}
+
+/**
+ * @brief Make room for n more bytes in the arena.
+ *
+ * @private
+ */
+static inline int farmhash64_dedup_reserve(farmhash64_dedup_mem_t *m, size_t n)
+{
+    size_t need = m->arena_len + n;
+    if (need + ((size_t)(m->mask + 1) * sizeof(farmhash64_dedup_slot_t)) > m->budget)
+    {
+        return FARMHASH64_DEDUP_ERR_BUDGET;
+    }
+    if (need <= m->arena_cap)
+    {
+        return FARMHASH64_DEDUP_OK;
+    }
+    size_t cap = (m->arena_cap == 0) ? FARMHASH64_DEDUP_IO_SIZE : m->arena_cap;
+    while (cap < need)
+    {
+        cap *= 2;
+    }
+    char *a = (char *)realloc(m->arena, cap);
+    if (a == NULL)
+    {
+        return FARMHASH64_DEDUP_ERR_MEMORY;
+    }
+    m->arena = a;
+    m->arena_cap = cap;
+    return FARMHASH64_DEDUP_OK;
+}
+
+/**
+ * @brief Insert a hash, or a record staged at the end of the arena, unless already present.
+ *
+ * @param m   Dedup memory
+ * @param h   Hash
+ * @param len Length of the staged record (count mode: ignored)
+ * @param rec 1 if a record is staged in the arena, 0 in count mode
+ *
+ * @return 1 if inserted, 0 if already present, or a negative farmhash64_dedup_status_t error code
+ *
+ * @private
+ */
+static inline int farmhash64_dedup_insert(farmhash64_dedup_mem_t *m, uint64_t h, uint32_t len, int rec)
+{
+    if ((m->slots == NULL) || ((m->used + 1) * 2 > m->mask + 1))
+    {
+        int ret = farmhash64_dedup_grow(m);
+        if (ret != FARMHASH64_DEDUP_OK)
+        {
+            return ret;
+        }
+    }
+    const char *staged = m->arena + m->arena_len + FARMHASH64_DEDUP_RUN_HDR;
+    uint64_t j = h & m->mask;
+    while (m->slots[j].ref != 0)
+    {
+        if (m->slots[j].hash == h)
+        {
+            if (!rec)
+            {
+                return 0;
+            }
+            const char *e = m->arena + (m->slots[j].ref - 1);
+            uint32_t elen;
+            memcpy(&elen, e + 8, 4);
+            if ((elen == len) && (memcmp(e + FARMHASH64_DEDUP_RUN_HDR, staged, len) == 0))
+            {
+                return 0;
+            }
+        }
+        j = (j + 1) & m->mask;
+    }
+    m->slots[j].hash = h;
+    m->slots[j].ref = (rec ? (uint64_t)m->arena_len : 0) + 1;
+    m->used++;
+    if (rec)
+    {
+        m->arena_len += FARMHASH64_DEDUP_RUN_HDR + len;
+    }
+    return 1;
+}
+
+/**
+ * @brief Read a partition file in the dedup memory.
+ *
+ * @return FARMHASH64_DEDUP_OK, FARMHASH64_DEDUP_ERR_BUDGET if the distinct records do not fit, or another error
+ *
+ * @private
+ */
+static inline int farmhash64_dedup_load(farmhash64_dedup_mem_t *m, farmhash64_dedup_reader_t *r, int count_only)
+{
+    if (m->slots != NULL)
+    {
+        memset(m->slots, 0, (size_t)(m->mask + 1) * sizeof(farmhash64_dedup_slot_t));
+    }
+    m->used = 0;
+    m->arena_len = 0;
+    for (;;)
+    {
+        int ret;
+        uint64_t h;
+        if (count_only)
+        {
+            ret = farmhash64_dedup_reader_read(r, &h, sizeof(h));
+            if (ret <= 0)
+            {
+                return (ret == 0) ? FARMHASH64_DEDUP_OK : FARMHASH64_DEDUP_ERR_IO;
+            }
+            ret = farmhash64_dedup_insert(m, h, 0, 0);
+        }
+        else
+        {
+            char hdr[FARMHASH64_DEDUP_SPILL_HDR];
+            uint32_t len;
+            ret = farmhash64_dedup_reader_read(r, hdr, sizeof(hdr));
+            if (ret <= 0)
+            {
+                return (ret == 0) ? FARMHASH64_DEDUP_OK : FARMHASH64_DEDUP_ERR_IO;
+            }
+            memcpy(&h, hdr, 8);
+            memcpy(&len, hdr + 16, 4);
+            ret = farmhash64_dedup_reserve(m, FARMHASH64_DEDUP_RUN_HDR + (size_t)len);
+            if (ret != FARMHASH64_DEDUP_OK)
+            {
+                return ret;
+            }
+            // stage the record (sequence number, length and bytes) at the end of the arena
+            char *e = m->arena + m->arena_len;
+            memcpy(e, hdr + 8, FARMHASH64_DEDUP_RUN_HDR);
+            if (farmhash64_dedup_reader_read(r, e + FARMHASH64_DEDUP_RUN_HDR, len) < 0)
+            {
+                return FARMHASH64_DEDUP_ERR_IO;
+            }
+            ret = farmhash64_dedup_insert(m, h, len, 1);
+        }
+        if (ret < 0)
+        {
+            return ret;
+        }
+    }
+}
+
+/**
+ * @brief Append a run file to the list of the runs to merge.
+ *
+ * @private
+ */
+static inline int farmhash64_dedup_add_run(farmhash64_dedup_ctx_t *ctx, uint64_t id)
+{
+    int ret = FARMHASH64_DEDUP_OK;
+    pthread_mutex_lock(&ctx->lock);
+    if (ctx->nruns == ctx->runs_cap)
+    {
+        size_t cap = (ctx->runs_cap == 0) ? 256 : ctx->runs_cap * 2;
+        uint64_t *runs = (uint64_t *)realloc(ctx->runs, cap * sizeof(uint64_t));
+        if (runs == NULL)
+        {
+            ret = FARMHASH64_DEDUP_ERR_MEMORY;
+        }
+        else
+        {
+            ctx->runs = runs;
+            ctx->runs_cap = cap;
+        }
+    }
+    if (ret == FARMHASH64_DEDUP_OK)
+    {
+        ctx->runs[ctx->nruns++] = id;
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    return ret;
+}
+
+/**
+ * @brief Write the distinct records of a loaded partition.
+ *
+ * Stable mode: to a new run file, in input order, to be merged later.
+ * Otherwise: to the output, as records followed by the delimiter.
+ *
+ * @private
+ */
+static inline int farmhash64_dedup_emit(farmhash64_dedup_ctx_t *ctx, const farmhash64_dedup_mem_t *m)
+{
+    __atomic_fetch_add(&ctx->distinct, m->used, __ATOMIC_RELAXED);
+    if (ctx->opts->count_only || (m->used == 0))
+    {
+        return FARMHASH64_DEDUP_OK;
+    }
+    if (ctx->opts->stable)
+    {
+        uint64_t id = __atomic_fetch_add(&ctx->next_id, 1, __ATOMIC_RELAXED);
+        int fd = farmhash64_dedup_create(ctx, 'r', id);
+        if (fd < 0)
+        {
+            return FARMHASH64_DEDUP_ERR_IO;
+        }
+        int ret = (farmhash64_dedup_write_all(fd, m->arena, m->arena_len) == 0) ? FARMHASH64_DEDUP_OK : FARMHASH64_DEDUP_ERR_IO;
+        if (close(fd) != 0)
+        {
+            ret = FARMHASH64_DEDUP_ERR_IO;
+        }
+        return (ret == FARMHASH64_DEDUP_OK) ? farmhash64_dedup_add_run(ctx, id) : ret;
+    }
+    farmhash64_dedup_writer_t w;
+    if (farmhash64_dedup_writer_init(&w, ctx->out_fd, FARMHASH64_DEDUP_IO_SIZE, &ctx->lock) != FARMHASH64_DEDUP_OK)
+    {
+        return FARMHASH64_DEDUP_ERR_MEMORY;
+    }
+    size_t pos = 0;
+    while (pos < m->arena_len)
+    {
+        uint32_t len;
+        memcpy(&len, m->arena + pos + 8, 4);
+        farmhash64_dedup_writer_record(&w, m->arena + pos + FARMHASH64_DEDUP_RUN_HDR, len, ctx->opts->delim);
+        pos += FARMHASH64_DEDUP_RUN_HDR + len;
+    }
+    return farmhash64_dedup_writer_close(&w);
+}
+
+/**
+ * @brief Split an oversized partition file by the next FARMHASH64_DEDUP_SPLIT_BITS hash bits.
+ *
+ * @param ids Output IDs of the 2^FARMHASH64_DEDUP_SPLIT_BITS split files
+ *
+ * @private
+ */
+static inline int farmhash64_dedup_split(farmhash64_dedup_ctx_t *ctx, farmhash64_dedup_reader_t *r, uint32_t skip, uint64_t *ids)
+{
+    const size_t nparts = (size_t)1 << FARMHASH64_DEDUP_SPLIT_BITS;
+    farmhash64_dedup_writer_t w[(size_t)1 << FARMHASH64_DEDUP_SPLIT_BITS];
+    char chunk[4096];
+    int ret = FARMHASH64_DEDUP_OK;
+    size_t i;
+    size_t nopen = 0;
+    for (i = 0; i < nparts; i++)
+    {
+        ids[i] = __atomic_fetch_add(&ctx->next_id, 1, __ATOMIC_RELAXED);
+        int fd = farmhash64_dedup_create(ctx, 's', ids[i]);
+        if ((fd < 0) || (farmhash64_dedup_writer_init(&w[i], fd, FARMHASH64_DEDUP_FILE_SIZE, NULL) != FARMHASH64_DEDUP_OK))
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+            ret = FARMHASH64_DEDUP_ERR_IO;
+            break;
+        }
+        nopen++;
+    }
+    while (ret == FARMHASH64_DEDUP_OK)
+    {
+        uint64_t h;
+        char hdr[FARMHASH64_DEDUP_SPILL_HDR];
+        size_t hlen = ctx->opts->count_only ? sizeof(h) : sizeof(hdr);
+        int k = farmhash64_dedup_reader_read(r, hdr, hlen);
+        if (k <= 0)
+        {
+            ret = (k == 0) ? FARMHASH64_DEDUP_OK : FARMHASH64_DEDUP_ERR_IO;
+            break;
+        }
+        memcpy(&h, hdr, 8);
+        farmhash64_dedup_writer_t *pw = &w[farmhash64_dedup_part(h, skip, FARMHASH64_DEDUP_SPLIT_BITS)];
+        farmhash64_dedup_writer_put(pw, hdr, hlen);
+        if (!ctx->opts->count_only)
+        {
+            uint32_t len;
+            memcpy(&len, hdr + 16, 4);
+            while ((len > 0) && (ret == FARMHASH64_DEDUP_OK))
+            {
+                size_t n = (len < sizeof(chunk)) ? len : sizeof(chunk);
+                if (farmhash64_dedup_reader_read(r, chunk, n) <= 0)
+                {
+                    ret = FARMHASH64_DEDUP_ERR_IO;
+                }
+                farmhash64_dedup_writer_put(pw, chunk, n);
+                len -= (uint32_t)n;
+            }
+        }
+    }
+    for (i = 0; i < nopen; i++)
+    {
+        int r2 = farmhash64_dedup_writer_close(&w[i]);
+        if (close(w[i].fd) != 0)
+        {
+            r2 = FARMHASH64_DEDUP_ERR_IO;
+        }
+        if (ret == FARMHASH64_DEDUP_OK)
+        {
+            ret = r2;
+        }
+    }
+    return ret;
+}
+
+/**
+ * @brief Deduplicate a partition file, splitting it when its distinct records do not fit in memory.
+ *
+ * The file is removed once processed.
+ *
+ * @param skip Number of hash bits shared by all the records of the file
+ *
+ * @private
+ */
+static inline int farmhash64_dedup_file(farmhash64_dedup_ctx_t *ctx, farmhash64_dedup_mem_t *m, char kind, uint64_t id, uint32_t skip)
+{
+    char path[FARMHASH64_DEDUP_PATH_MAX];
+    farmhash64_dedup_reader_t r;
+    farmhash64_dedup_path(ctx, path, kind, id);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return FARMHASH64_DEDUP_ERR_IO;
+    }
+    if (farmhash64_dedup_reader_init(&r, fd, FARMHASH64_DEDUP_FILE_SIZE) != FARMHASH64_DEDUP_OK)
+    {
+        close(fd);
+        return FARMHASH64_DEDUP_ERR_MEMORY;
+    }
+    int ret = farmhash64_dedup_load(m, &r, ctx->opts->count_only);
+    if (ret != FARMHASH64_DEDUP_ERR_BUDGET)
+    {
+        farmhash64_dedup_reader_close(&r);
+        unlink(path);
+        return (ret == FARMHASH64_DEDUP_OK) ? farmhash64_dedup_emit(ctx, m) : ret;
+    }
+    // a single distinct record over budget, or no hash bits left: splitting cannot help
+    if ((m->used < 2) || (skip + FARMHASH64_DEDUP_SPLIT_BITS > 64))
+    {
+        farmhash64_dedup_reader_close(&r);
+        return FARMHASH64_DEDUP_ERR_BUDGET;
+    }
+    __atomic_fetch_add(&ctx->splits, 1, __ATOMIC_RELAXED);
+    uint64_t ids[(size_t)1 << FARMHASH64_DEDUP_SPLIT_BITS];
+    lseek(r.fd, 0, SEEK_SET);
+    r.pos = 0;
+    r.end = 0;
+    ret = farmhash64_dedup_split(ctx, &r, skip, ids);
+    farmhash64_dedup_reader_close(&r);
+    unlink(path);
+    size_t i;
+    for (i = 0; (i < ((size_t)1 << FARMHASH64_DEDUP_SPLIT_BITS)) && (ret == FARMHASH64_DEDUP_OK); i++)
+    {
+        ret = farmhash64_dedup_file(ctx, m, 's', ids[i], skip + FARMHASH64_DEDUP_SPLIT_BITS);
+    }
+    return ret;
+}
+
+/**
+ * @brief Dedup thread: process the partitions handed out by the shared counter.
+ *
+ * @private
+ */
+static inline void *farmhash64_dedup_worker(void *arg)
+{
+    farmhash64_dedup_ctx_t *ctx = (farmhash64_dedup_ctx_t *)arg;
+    uint64_t nparts = (uint64_t)1 << ctx->bits;
+    farmhash64_dedup_mem_t m;
+    memset(&m, 0, sizeof(m));
+    m.budget = ctx->opts->mem_bytes / ctx->nthreads;
+    while (__atomic_load_n(&ctx->ret, __ATOMIC_RELAXED) == FARMHASH64_DEDUP_OK)
+    {
+        uint64_t p = __atomic_fetch_add(&ctx->next_part, 1, __ATOMIC_RELAXED);
+        if (p >= nparts)
+        {
+            break;
+        }
+        int ret = farmhash64_dedup_file(ctx, &m, 'p', p, ctx->bits);
+        if (ret != FARMHASH64_DEDUP_OK)
+        {
+            farmhash64_dedup_fail(ctx, ret);
+        }
+    }
+    free(m.slots);
+    free(m.arena);
+    return NULL;
+}
+
+/**
+ * @brief Merge runs by sequence number.
+ *
+ * The final pass writes the records followed by the delimiter, the other passes write a new run.
+ *
+ * @private
+ */
+static inline int farmhash64_dedup_merge_runs(farmhash64_dedup_ctx_t *ctx, const uint64_t *ids, size_t n, farmhash64_dedup_writer_t *w, int final)
+{
+    farmhash64_dedup_reader_t *rd = (farmhash64_dedup_reader_t *)calloc(n + 1, sizeof(farmhash64_dedup_reader_t));
+    uint64_t *seq = (uint64_t *)calloc(n + 1, sizeof(uint64_t));
+    size_t *heap = (size_t *)calloc(n + 1, sizeof(size_t));
+    char *rec = NULL;
+    size_t rec_cap = 0;
+    size_t nheap = 0;
+    size_t i;
+    int ret = FARMHASH64_DEDUP_OK;
+    if ((rd == NULL) || (seq == NULL) || (heap == NULL))
+    {
+        ret = FARMHASH64_DEDUP_ERR_MEMORY;
+    }
+    for (i = 0; (i < n) && (ret == FARMHASH64_DEDUP_OK); i++)
+    {
+        char path[FARMHASH64_DEDUP_PATH_MAX];
+        farmhash64_dedup_path(ctx, path, 'r', ids[i]);
+        int fd = open(path, O_RDONLY);
+        rd[i].fd = -1;
+        if (fd < 0)
+        {
+            ret = FARMHASH64_DEDUP_ERR_IO;
+            break;
+        }
+        unlink(path);
+        if (farmhash64_dedup_reader_init(&rd[i], fd, FARMHASH64_DEDUP_FILE_SIZE) != FARMHASH64_DEDUP_OK)
+        {
+            close(fd);
+            ret = FARMHASH64_DEDUP_ERR_MEMORY;
+            break;
+        }
+        // runs are never empty
+        if (farmhash64_dedup_reader_read(&rd[i], &seq[i], 8) <= 0)
+        {
+            ret = FARMHASH64_DEDUP_ERR_IO;
+            break;
+        }
+        // sift up
+        size_t c = nheap++;
+        while ((c > 0) && (seq[heap[(c - 1) / 2]] > seq[i]))
+        {
+            heap[c] = heap[(c - 1) / 2];
+            c = (c - 1) / 2;
+        }
+        heap[c] = i;
+    }
+    while ((ret == FARMHASH64_DEDUP_OK) && (nheap > 0))
+    {
+        size_t top = heap[0];
+        uint32_t len;
+        if (farmhash64_dedup_reader_read(&rd[top], &len, 4) <= 0)
+        {
+            ret = FARMHASH64_DEDUP_ERR_IO;
+            break;
+        }
+        if (len > rec_cap)
+        {
+            char *nrec = (char *)realloc(rec, len);
+            if (nrec == NULL)
+            {
+                ret = FARMHASH64_DEDUP_ERR_MEMORY;
+                break;
+            }
+            rec = nrec;
+            rec_cap = len;
+        }
+        if ((len > 0) && (farmhash64_dedup_reader_read(&rd[top], rec, len) <= 0))
+        {
+            ret = FARMHASH64_DEDUP_ERR_IO;
+            break;
+        }
+        if (final)
+        {
+            farmhash64_dedup_writer_record(w, rec, len, ctx->opts->delim);
+        }
+        else
+        {
+            char hdr[FARMHASH64_DEDUP_RUN_HDR];
+            memcpy(hdr, &seq[top], 8);
+            memcpy(hdr + 8, &len, 4);
+            farmhash64_dedup_writer_put(w, hdr, sizeof(hdr));
+            farmhash64_dedup_writer_put(w, rec, len);
+        }
+        int k = farmhash64_dedup_reader_read(&rd[top], &seq[top], 8);
+        if (k < 0)
+        {
+            ret = FARMHASH64_DEDUP_ERR_IO;
+            break;
+        }
+        if (k == 0)
+        {
+            heap[0] = heap[--nheap];
+        }
+        // sift down
+        size_t c = 0;
+        size_t x = heap[0];
+        for (;;)
+        {
+            size_t l = (2 * c) + 1;
+            if (l >= nheap)
+            {
+                break;
+            }
+            if ((l + 1 < nheap) && (seq[heap[l + 1]] < seq[heap[l]]))
+            {
+                l++;
+            }
+            if (seq[heap[l]] >= seq[x])
+            {
+                break;
+            }
+            heap[c] = heap[l];
+            c = l;
+        }
+        heap[c] = x;
+    }
+    if (rd != NULL)
+    {
+        for (i = 0; i < n; i++)
+        {
+            if (rd[i].buf != NULL)
+            {
+                farmhash64_dedup_reader_close(&rd[i]);
+            }
+        }
+    }
+    free(rd);
+    free(seq);
+    free(heap);
+    free(rec);
+    return ret;
+}
+
+/**
+ * @brief Stable mode: merge the runs by sequence number and write the records to the output.
+ *
+ * At most ways runs are open at once: while there are more, the oldest ways runs are merged into a new run.
+ *
+ * @private
+ */
+static inline int farmhash64_dedup_merge(farmhash64_dedup_ctx_t *ctx, size_t ways)
+{
+    farmhash64_dedup_writer_t w;
+    size_t first = 0;
+    int ret = FARMHASH64_DEDUP_OK;
+    memset(&w, 0, sizeof(w));
+    while ((ret == FARMHASH64_DEDUP_OK) && (ctx->nruns - first > ways))
+    {
+        uint64_t id = ctx->next_id++;
+        int fd = farmhash64_dedup_create(ctx, 'r', id);
+        if (fd < 0)
+        {
+            return FARMHASH64_DEDUP_ERR_IO;
+        }
+        if (farmhash64_dedup_writer_init(&w, fd, FARMHASH64_DEDUP_IO_SIZE, NULL) != FARMHASH64_DEDUP_OK)
+        {
+            close(fd);
+            return FARMHASH64_DEDUP_ERR_MEMORY;
+        }
+        ret = farmhash64_dedup_merge_runs(ctx, ctx->runs + first, ways, &w, 0);
+        int r = farmhash64_dedup_writer_close(&w);
+        if (close(fd) != 0)
+        {
+            r = FARMHASH64_DEDUP_ERR_IO;
+        }
+        if (ret == FARMHASH64_DEDUP_OK)
+        {
+            ret = r;
+        }
+        first += ways;
+        if (ret == FARMHASH64_DEDUP_OK)
+        {
+            ret = farmhash64_dedup_add_run(ctx, id);
+        }
+    }
+    if (ret != FARMHASH64_DEDUP_OK)
+    {
+        return ret;
+    }
+    if (farmhash64_dedup_writer_init(&w, ctx->out_fd, FARMHASH64_DEDUP_IO_SIZE, NULL) != FARMHASH64_DEDUP_OK)
+    {
+        return FARMHASH64_DEDUP_ERR_MEMORY;
+    }
+    ret = farmhash64_dedup_merge_runs(ctx, ctx->runs + first, ctx->nruns - first, &w, 1);
+    int r = farmhash64_dedup_writer_close(&w);
+    return (ret == FARMHASH64_DEDUP_OK) ? r : ret;
+}
+
+/**
+ * @brief Number of files that a run can open, from the soft limit on open files (SIZE_MAX when unlimited).
+ *
+ * @private
+ */
+static inline size_t farmhash64_dedup_max_files(size_t nin)
+{
+    struct rlimit rl;
+    if ((getrlimit(RLIMIT_NOFILE, &rl) != 0) || (rl.rlim_cur == RLIM_INFINITY))
+    {
+        return SIZE_MAX;
+    }
+    uint64_t reserved = FARMHASH64_DEDUP_RESERVED_FILES + (uint64_t)nin;
+    return ((uint64_t)rl.rlim_cur > reserved) ? (size_t)((uint64_t)rl.rlim_cur - reserved) : 0;
+}
+
+/**
+ * @brief Remove the temporary directory and any file left in it.
+ *
+ * @private
+ */
+static inline void farmhash64_dedup_cleanup(farmhash64_dedup_ctx_t *ctx)
+{
+    DIR *d = opendir(ctx->dir);
+    if (d != NULL)
+    {
+        struct dirent *e;
+        while ((e = readdir(d)) != NULL)
+        {
+            if (e->d_name[0] == '.')
+            {
+                continue;
+            }
+            char path[FARMHASH64_DEDUP_PATH_MAX];
+            snprintf(path, sizeof(path), "%s/%s", ctx->dir, e->d_name);
+            unlink(path);
+        }
+        closedir(d);
+    }
+    rmdir(ctx->dir);
+}
+
+/**
+ * @brief Remove the duplicate records of the inputs, or count the distinct ones.
+ *
+ * The inputs are read in order as a single stream of records separated by opts->delim;
+ * the last record of each input does not need a final delimiter.
+ * Each distinct record is written once to out_fd, followed by the delimiter:
+ * in input order of first occurrence with opts->stable, in an unspecified order otherwise.
+ * Nothing is written in count mode: the result is in stats->distinct.
+ *
+ * The temporary files are created in a private directory under opts->tmpdir, removed before returning.
+ * They take about the input size plus 20 bytes per record (8 bytes per record in count mode).
+ * The number of partitions and of threads is lowered when needed to keep the open temporary files within
+ * the soft limit on open files (RLIMIT_NOFILE), minus the inputs and FARMHASH64_DEDUP_RESERVED_FILES;
+ * the values used are in stats. In stable mode the runs are merged in several passes when there are more
+ * than FARMHASH64_DEDUP_MERGE_WAYS of them, or more than the limit allows.
+ *
+ * @param in_fds Input file descriptors
+ * @param nin    Number of inputs
+ * @param out_fd Output file descriptor (unused in count mode)
+ * @param opts   Options (see farmhash64_dedup_default_opts)
+ * @param stats  Output statistics (can be NULL)
+ *
+ * @return FARMHASH64_DEDUP_OK on success, or a negative farmhash64_dedup_status_t error code
+ *
+ * @public
+ */
+static inline int farmhash64_dedup_run(const int *in_fds, size_t nin, int out_fd, const farmhash64_dedup_opts_t *opts, farmhash64_dedup_stats_t *stats)
+{
+    farmhash64_dedup_stats_t st;
+    memset(&st, 0, sizeof(st));
+    if ((opts == NULL) || ((in_fds == NULL) && (nin > 0)) || (opts->bits > FARMHASH64_DEDUP_MAX_BITS) || (opts->nthreads < 1) || (opts->nthreads > FARMHASH64_DEDUP_MAX_THREADS) || (opts->mem_bytes / opts->nthreads < FARMHASH64_DEDUP_MIN_MEMORY))
+    {
+        return FARMHASH64_DEDUP_ERR_ARGS;
+    }
+    farmhash64_dedup_ctx_t *ctx = (farmhash64_dedup_ctx_t *)calloc(1, sizeof(farmhash64_dedup_ctx_t));
+    if (ctx == NULL)
+    {
+        return FARMHASH64_DEDUP_ERR_MEMORY;
+    }
+    ctx->opts = opts;
+    ctx->out_fd = out_fd;
+    const char *tmpdir = opts->tmpdir;
+    if (tmpdir == NULL)
+    {
+        tmpdir = getenv("TMPDIR");
+    }
+    if ((tmpdir == NULL) || (tmpdir[0] == 0))
+    {
+        tmpdir = "/tmp";
+    }
+    int n = snprintf(ctx->dir, sizeof(ctx->dir), "%s/farmhash64-dedup-XXXXXX", tmpdir);
+    if ((n < 0) || ((size_t)n >= sizeof(ctx->dir)) || (mkdtemp(ctx->dir) == NULL))
+    {
+        free(ctx);
+        return FARMHASH64_DEDUP_ERR_IO;
+    }
+    // one file per partition while spilling, FARMHASH64_DEDUP_THREAD_FILES per thread while deduplicating
+    size_t max_files = farmhash64_dedup_max_files(nin);
+    if (max_files < FARMHASH64_DEDUP_THREAD_FILES)
+    {
+        rmdir(ctx->dir);
+        free(ctx);
+        errno = EMFILE;
+        return FARMHASH64_DEDUP_ERR_IO;
+    }
+    ctx->bits = opts->bits;
+    while (((size_t)1 << ctx->bits) > max_files)
+    {
+        ctx->bits--;
+    }
+    ctx->nthreads = opts->nthreads;
+    if ((uint64_t)ctx->nthreads > ((uint64_t)1 << ctx->bits))
+    {
+        ctx->nthreads = 1U << ctx->bits;
+    }
+    if (ctx->nthreads > max_files / FARMHASH64_DEDUP_THREAD_FILES)
+    {
+        ctx->nthreads = (unsigned)(max_files / FARMHASH64_DEDUP_THREAD_FILES);
+    }
+    pthread_mutex_init(&ctx->lock, NULL);
+    int ret = farmhash64_dedup_spill(ctx, in_fds, nin, &st);
+    if (ret == FARMHASH64_DEDUP_OK)
+    {
+        pthread_t tid[FARMHASH64_DEDUP_MAX_THREADS];
+        unsigned i;
+        unsigned started = 0;
+        for (i = 1; i < ctx->nthreads; i++)
+        {
+            if (pthread_create(&tid[i], NULL, farmhash64_dedup_worker, ctx) != 0)
+            {
+                break;
+            }
+            started = i;
+        }
+        farmhash64_dedup_worker(ctx);
+        for (i = 1; i <= started; i++)
+        {
+            pthread_join(tid[i], NULL);
+        }
+        ret = ctx->ret;
+    }
+    if ((ret == FARMHASH64_DEDUP_OK) && opts->stable && !opts->count_only)
+    {
+        // the output is open too while merging
+        size_t ways = max_files - 1;
+        ret = farmhash64_dedup_merge(ctx, (ways < FARMHASH64_DEDUP_MERGE_WAYS) ? ways : FARMHASH64_DEDUP_MERGE_WAYS);
+    }
+    st.distinct = ctx->distinct;
+    st.splits = ctx->splits;
+    st.bits = ctx->bits;
+    st.nthreads = ctx->nthreads;
+    farmhash64_dedup_cleanup(ctx);
+    pthread_mutex_destroy(&ctx->lock);
+    free(ctx->runs);
+    free(ctx);
+    if (stats != NULL)
+    {
+        *stats = st;
+    }
+    return ret;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // FARMHASH64_DEDUP_H
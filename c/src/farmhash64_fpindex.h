@@ -0,0 +1,825 @@
+/**
+ * @file farmhash64_fpindex.h
+ * @brief Persistent, memory-mapped fingerprint index (hash -> offset) for log-structured stores.
+ *
+ * Maps the farmhash64 of a key to the offsets of its records in an append-only log.
+ * The index is a single file of 4 KiB pages, accessed with mmap:
+ *
+ * - Page 0 is the header. Pages 1 .. 2^bucket_bits are the buckets, allocated (sparse) when the file is created,
+ *   so opening an index only maps the file: nothing is read or scanned at startup.
+ * - The low bits of the hash select the bucket. A bucket page is a small open addressing table:
+ *   the high hash bits select the first slot and collisions are resolved by linear probing.
+ *   Each slot has a 16-bit tag (the top hash bits), stored in a separate array of the page
+ *   and compared 8 at a time (SSE2 when available), so the 64-bit hashes are only read for matching tags.
+ * - A page that reaches FARMHASH64_FPINDEX_MAX_FILL entries links an overflow page,
+ *   allocated at the end of the file.
+ * - The file is mapped in a reserved address range that is doubled (and the mapping moved)
+ *   when the overflow pages fill it, so the index grows until the 32-bit page links run out:
+ *   FARMHASH64_FPINDEX_MAX_PAGES pages (16 TiB), about 8 * 10^11 entries.
+ *
+ * A lookup reads a single page (one page fault, at most one I/O) while the index holds up to the capacity
+ * given at creation, and typically two pages up to twice that capacity.
+ * The mapping is advised as random access, so a page fault does not read ahead the neighbouring buckets.
+ *
+ * The index only stores hashes: different keys may share a hash, so a lookup returns all the offsets
+ * stored for a hash and the caller must compare the keys of the records in its log.
+ *
+ * Crash safety:
+ * - Every update writes the slot entry before publishing its tag, and initializes a page before linking it,
+ *   so the mapped file is consistent at every instant: the index survives a crash of the process
+ *   (the kernel keeps the mapped pages) without any recovery step.
+ * - farmhash64_fpindex_sync flushes the pages and then records a caller-defined checkpoint
+ *   (e.g. the log offset covered by the index). After a system crash or a power failure the updates
+ *   made after the last checkpoint may be lost: the store re-inserts the log records written after
+ *   farmhash64_fpindex_checkpoint(). Inserting the same (hash, offset) pair twice has no effect.
+ *
+ * Writers (put/replace/del) must be serialized by the caller, and must not run concurrently with lookups.
+ *
+ * This header uses POSIX mmap: define _DEFAULT_SOURCE (or _GNU_SOURCE) before including it.
+ */
+
+#ifndef FARMHASH64_FPINDEX_H
+#define FARMHASH64_FPINDEX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "farmhash64.h"
+
+/**
+ * @brief Page size of the index file.
+ */
+#define FARMHASH64_FPINDEX_PAGE_SIZE 4096
+
+/**
+ * @brief Number of slots of a page (a multiple of 8, the tags are compared in groups of 8).
+ */
+#define FARMHASH64_FPINDEX_SLOTS 224
+
+/**
+ * @brief Maximum number of entries of a page before an overflow page is linked (7/8 of the slots).
+ */
+#define FARMHASH64_FPINDEX_MAX_FILL 196
+
+/**
+ * @brief Number of entries per bucket targeted when sizing a new index from its capacity.
+ */
+#define FARMHASH64_FPINDEX_BUCKET_FILL 168
+
+/**
+ * @brief Maximum number of bucket bits.
+ */
+#define FARMHASH64_FPINDEX_MAX_BUCKET_BITS 29
+
+/**
+ * @brief Initial address space reserved for a new file, as a multiple of the number of buckets (overflow pages included).
+ *
+ * An existing file reserves at least twice its size; the reservation doubles when it is full.
+ */
+#define FARMHASH64_FPINDEX_RESERVE_FACTOR 4
+
+#ifndef FARMHASH64_FPINDEX_MIN_RESERVE
+/**
+ * @brief Minimum address space reserved for the file, in pages.
+ */
+#define FARMHASH64_FPINDEX_MIN_RESERVE (1 << 16)
+#endif
+
+/**
+ * @brief Maximum number of pages of the file (page links are 32-bit).
+ */
+#define FARMHASH64_FPINDEX_MAX_PAGES ((uint64_t)1 << 32)
+
+/**
+ * @brief Number of pages added to the file each time it grows.
+ *
+ * @private
+ */
+#define FARMHASH64_FPINDEX_GROW_PAGES 256
+
+/**
+ * @brief Offset value of a deleted entry.
+ */
+#define FARMHASH64_FPINDEX_DELETED UINT64_MAX
+
+/**
+ * @brief File signature ("FH64FPIX").
+ *
+ * @private
+ */
+#define FARMHASH64_FPINDEX_MAGIC 0x5849504634364846ULL
+
+/**
+ * @brief File format version.
+ *
+ * @private
+ */
+#define FARMHASH64_FPINDEX_VERSION 1
+
+/**
+ * @brief Return codes.
+ */
+enum farmhash64_fpindex_status_t
+{
+    FARMHASH64_FPINDEX_OK = 0,             /**< Success. */
+    FARMHASH64_FPINDEX_ERR_ARGS = -1,      /**< Invalid arguments. */
+    FARMHASH64_FPINDEX_ERR_MEMORY = -2,    /**< The file could not be mapped. */
+    FARMHASH64_FPINDEX_ERR_IO = -3,        /**< File I/O error. */
+    FARMHASH64_FPINDEX_ERR_FORMAT = -4,    /**< The file is not a valid index. */
+    FARMHASH64_FPINDEX_ERR_FULL = -5,      /**< The file reached FARMHASH64_FPINDEX_MAX_PAGES pages. */
+    FARMHASH64_FPINDEX_ERR_NOTFOUND = -6,  /**< The (hash, offset) entry does not exist. */
+};
+
+/**
+ * @brief Slot entry.
+ *
+ * @private
+ */
+typedef struct farmhash64_fpindex_entry_t
+{
+    uint64_t hash;   /**< Key hash. */
+    uint64_t offset; /**< Record offset, or FARMHASH64_FPINDEX_DELETED. */
+} farmhash64_fpindex_entry_t;
+
+/**
+ * @brief Bucket or overflow page (FARMHASH64_FPINDEX_PAGE_SIZE bytes).
+ *
+ * @private
+ */
+typedef struct farmhash64_fpindex_page_t
+{
+    uint32_t next;                                              /**< Overflow page number, or 0. */
+    uint32_t count;                                             /**< Number of used slots. */
+    uint64_t reserved;                                          /**< Reserved (0). */
+    farmhash64_fpindex_entry_t entry[FARMHASH64_FPINDEX_SLOTS]; /**< Slot entries. */
+    uint16_t tag[FARMHASH64_FPINDEX_SLOTS];                     /**< Slot tags (0 = empty slot), 16-byte aligned. */
+    uint8_t pad[FARMHASH64_FPINDEX_PAGE_SIZE - 16 - (FARMHASH64_FPINDEX_SLOTS * 18)]; /**< Padding to the page size. */
+} farmhash64_fpindex_page_t;
+
+/**
+ * @brief File header (page 0).
+ *
+ * @private
+ */
+typedef struct farmhash64_fpindex_header_t
+{
+    uint64_t magic;       /**< FARMHASH64_FPINDEX_MAGIC. */
+    uint32_t version;     /**< FARMHASH64_FPINDEX_VERSION. */
+    uint32_t page_size;   /**< FARMHASH64_FPINDEX_PAGE_SIZE. */
+    uint32_t bucket_bits; /**< Number of bucket bits. */
+    uint32_t reserved;    /**< Reserved (0). */
+    uint64_t next_page;   /**< First unallocated page. */
+    uint64_t entries;     /**< Number of live entries. */
+    uint64_t checkpoint;  /**< Caller checkpoint recorded by the last sync. */
+} farmhash64_fpindex_header_t;
+
+/**
+ * @brief Index statistics.
+ */
+typedef struct farmhash64_fpindex_stats_t
+{
+    uint64_t entries;        /**< Number of live entries. */
+    uint64_t buckets;        /**< Number of bucket pages. */
+    uint64_t overflow_pages; /**< Number of overflow pages. */
+    uint64_t file_bytes;     /**< File size. */
+} farmhash64_fpindex_stats_t;
+
+/**
+ * @brief Open index.
+ */
+typedef struct farmhash64_fpindex_t
+{
+    int fd;                              /**< Index file. */
+    char *base;                          /**< Start of the reserved address space (page 0), moved when the reservation grows. */
+    uint64_t reserved_pages;             /**< Reserved address space, in pages. */
+    uint64_t mapped_pages;               /**< Mapped file size, in pages. */
+    uint64_t next_page;                  /**< First unallocated page (copy of the header field). */
+    uint64_t bucket_mask;                /**< Number of buckets minus one. */
+    farmhash64_fpindex_header_t *header; /**< Mapped header. */
+} farmhash64_fpindex_t;
+
+/**
+ * @brief Return a page of the index.
+ *
+ * @private
+ */
+static inline farmhash64_fpindex_page_t *farmhash64_fpindex_page(const farmhash64_fpindex_t *idx, uint64_t pno)
+{
+    return (farmhash64_fpindex_page_t *)(void *)(idx->base + (pno * FARMHASH64_FPINDEX_PAGE_SIZE));
+}
+
+/**
+ * @brief Normalize a hash: 0 is stored as 1, so that a slot whose entry was never written never matches.
+ *
+ * @private
+ */
+static inline uint64_t farmhash64_fpindex_norm(uint64_t h)
+{
+    return h | (uint64_t)(h == 0);
+}
+
+/**
+ * @brief Slot tag of a hash (the top 16 bits, never 0).
+ *
+ * @private
+ */
+static inline uint16_t farmhash64_fpindex_tag(uint64_t h)
+{
+    uint16_t t = (uint16_t)(h >> 48);
+    return (uint16_t)(t + (t == 0));
+}
+
+/**
+ * @brief First probed slot of a hash (bits 32-47, reduced to the number of slots).
+ *
+ * @private
+ */
+static inline uint32_t farmhash64_fpindex_start(uint64_t h)
+{
+    return (uint32_t)((((h >> 32) & 0xFFFF) * FARMHASH64_FPINDEX_SLOTS) >> 16);
+}
+
+/**
+ * @brief Compare a group of 8 tags.
+ *
+ * @param tags  First tag of the group (16-byte aligned)
+ * @param t     Tag to search
+ * @param empty Set to the bitmask of the empty slots of the group
+ *
+ * @return Bitmask of the slots of the group with tag t
+ *
+ * @private
+ */
+static inline uint32_t farmhash64_fpindex_group(const uint16_t *tags, uint16_t t, uint32_t *empty)
+{
+#if defined(__SSE2__)
+    __m128i v = _mm_load_si128((const __m128i *)(const void *)tags);
+    __m128i m = _mm_cmpeq_epi16(v, _mm_set1_epi16((short)t));
+    __m128i e = _mm_cmpeq_epi16(v, _mm_setzero_si128());
+    *empty = (uint32_t)_mm_movemask_epi8(_mm_packs_epi16(e, e)) & 0xFF;
+    return (uint32_t)_mm_movemask_epi8(_mm_packs_epi16(m, m)) & 0xFF;
+#else
+    uint32_t match = 0;
+    uint32_t i;
+    *empty = 0;
+    for (i = 0; i < 8; i++)
+    {
+        match |= (uint32_t)(tags[i] == t) << i;
+        *empty |= (uint32_t)(tags[i] == 0) << i;
+    }
+    return match;
+#endif
+}
+
+/**
+ * @brief Scan the probe sequence of a hash in a page, up to the first empty slot.
+ *
+ * Every page has at least FARMHASH64_FPINDEX_SLOTS - FARMHASH64_FPINDEX_MAX_FILL empty slots,
+ * so the scan always ends on an empty slot.
+ *
+ * @param p     Page
+ * @param h     Normalized hash
+ * @param found Set to the slots holding h, in probe order
+ * @param n     Set to the number of slots in found
+ *
+ * @return First empty slot of the probe sequence
+ *
+ * @private
+ */
+static inline uint32_t farmhash64_fpindex_scan(const farmhash64_fpindex_page_t *p, uint64_t h, uint8_t *found, uint32_t *n)
+{
+    const uint32_t ngroups = FARMHASH64_FPINDEX_SLOTS / 8;
+    uint16_t t = farmhash64_fpindex_tag(h);
+    uint32_t start = farmhash64_fpindex_start(h);
+    uint32_t g = start >> 3;
+    uint32_t lanes = (0xFFu << (start & 7)) & 0xFF;
+    uint32_t k;
+    *n = 0;
+    for (k = 0; k <= ngroups; k++)
+    {
+        uint32_t empty;
+        uint32_t match = farmhash64_fpindex_group(&p->tag[g * 8], t, &empty) & lanes;
+        empty &= lanes;
+        if (empty != 0)
+        {
+            match &= (empty & (0u - empty)) - 1; // matches before the first empty slot
+        }
+        while (match != 0)
+        {
+            uint32_t slot = (g * 8) + (uint32_t)__builtin_ctz(match);
+            if (p->entry[slot].hash == h)
+            {
+                found[(*n)++] = (uint8_t)slot;
+            }
+            match &= match - 1;
+        }
+        if (empty != 0)
+        {
+            return (g * 8) + (uint32_t)__builtin_ctz(empty);
+        }
+        g = (g + 1 == ngroups) ? 0 : g + 1;
+        lanes = (k + 1 == ngroups) ? ((1u << (start & 7)) - 1) : 0xFF;
+    }
+    return FARMHASH64_FPINDEX_SLOTS; // unreachable for valid pages
+}
+
+/**
+ * @brief Return the overflow page linked by a page, or 0.
+ *
+ * Links to pages beyond the allocated ones (possible after a system crash) are ignored.
+ *
+ * @private
+ */
+static inline uint64_t farmhash64_fpindex_next(const farmhash64_fpindex_t *idx, const farmhash64_fpindex_page_t *p)
+{
+    uint64_t next = __atomic_load_n(&p->next, __ATOMIC_ACQUIRE);
+    return (next < idx->next_page) ? next : 0;
+}
+
+/**
+ * @brief Map the file pages in [idx->mapped_pages, npages), extending the file.
+ *
+ * @private
+ */
+static inline int farmhash64_fpindex_grow(farmhash64_fpindex_t *idx, uint64_t npages)
+{
+    if (npages <= idx->mapped_pages)
+    {
+        return FARMHASH64_FPINDEX_OK;
+    }
+    struct stat st;
+    if (fstat(idx->fd, &st) != 0)
+    {
+        return FARMHASH64_FPINDEX_ERR_IO;
+    }
+    if (((uint64_t)st.st_size < npages * FARMHASH64_FPINDEX_PAGE_SIZE) && (ftruncate(idx->fd, (off_t)(npages * FARMHASH64_FPINDEX_PAGE_SIZE)) != 0))
+    {
+        return FARMHASH64_FPINDEX_ERR_IO;
+    }
+    size_t off = (size_t)(idx->mapped_pages * FARMHASH64_FPINDEX_PAGE_SIZE);
+    size_t len = (size_t)((npages - idx->mapped_pages) * FARMHASH64_FPINDEX_PAGE_SIZE);
+    if (mmap(idx->base + off, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, idx->fd, (off_t)off) == MAP_FAILED)
+    {
+        return FARMHASH64_FPINDEX_ERR_MEMORY;
+    }
+    madvise(idx->base + off, len, MADV_RANDOM);
+    idx->mapped_pages = npages;
+    return FARMHASH64_FPINDEX_OK;
+}
+
+/**
+ * @brief Move the mapped pages to a new reserved address range of npages pages.
+ *
+ * The pointers into the old range are no longer valid.
+ *
+ * @private
+ */
+static inline int farmhash64_fpindex_reserve(farmhash64_fpindex_t *idx, uint64_t npages)
+{
+    void *base = mmap(NULL, (size_t)(npages * FARMHASH64_FPINDEX_PAGE_SIZE), PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED)
+    {
+        return FARMHASH64_FPINDEX_ERR_MEMORY;
+    }
+    size_t len = (size_t)(idx->mapped_pages * FARMHASH64_FPINDEX_PAGE_SIZE);
+    if (len > 0)
+    {
+        if (mmap(base, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, idx->fd, 0) == MAP_FAILED)
+        {
+            munmap(base, (size_t)(npages * FARMHASH64_FPINDEX_PAGE_SIZE));
+            return FARMHASH64_FPINDEX_ERR_MEMORY;
+        }
+        madvise(base, len, MADV_RANDOM);
+    }
+    if (idx->base != NULL)
+    {
+        munmap(idx->base, (size_t)(idx->reserved_pages * FARMHASH64_FPINDEX_PAGE_SIZE));
+    }
+    idx->base = (char *)base;
+    idx->reserved_pages = npages;
+    idx->header = (farmhash64_fpindex_header_t *)base;
+    return FARMHASH64_FPINDEX_OK;
+}
+
+/**
+ * @brief Allocate an overflow page and link it to the full page number full.
+ *
+ * The reserved address space is doubled when needed, which moves the mapping.
+ *
+ * @private
+ */
+static inline int farmhash64_fpindex_link(farmhash64_fpindex_t *idx, uint64_t full, uint64_t *pno)
+{
+    uint64_t np = idx->next_page;
+    if (np >= FARMHASH64_FPINDEX_MAX_PAGES)
+    {
+        return FARMHASH64_FPINDEX_ERR_FULL;
+    }
+    if (np >= idx->reserved_pages)
+    {
+        uint64_t npages = 2 * idx->reserved_pages;
+        int ret = farmhash64_fpindex_reserve(idx, (npages < FARMHASH64_FPINDEX_MAX_PAGES) ? npages : FARMHASH64_FPINDEX_MAX_PAGES);
+        if (ret != FARMHASH64_FPINDEX_OK)
+        {
+            return ret;
+        }
+    }
+    if (np >= idx->mapped_pages)
+    {
+        uint64_t npages = idx->mapped_pages + FARMHASH64_FPINDEX_GROW_PAGES;
+        int ret = farmhash64_fpindex_grow(idx, (npages < idx->reserved_pages) ? npages : idx->reserved_pages);
+        if (ret != FARMHASH64_FPINDEX_OK)
+        {
+            return ret;
+        }
+    }
+    // the page may have been allocated before a system crash: clear it before it becomes reachable
+    memset((void *)farmhash64_fpindex_page(idx, np), 0, FARMHASH64_FPINDEX_PAGE_SIZE);
+    idx->next_page = np + 1;
+    idx->header->next_page = np + 1;
+    __atomic_store_n(&farmhash64_fpindex_page(idx, full)->next, (uint32_t)np, __ATOMIC_RELEASE);
+    *pno = np;
+    return FARMHASH64_FPINDEX_OK;
+}
+
+/**
+ * @brief Close an index, unmapping the file.
+ *
+ * Closing does not flush the pages to the storage: call farmhash64_fpindex_sync first for durability.
+ *
+ * @param idx Index
+ *
+ * @public
+ */
+static inline void farmhash64_fpindex_close(farmhash64_fpindex_t *idx)
+{
+    if ((idx == NULL) || (idx->base == NULL))
+    {
+        return;
+    }
+    munmap(idx->base, (size_t)(idx->reserved_pages * FARMHASH64_FPINDEX_PAGE_SIZE));
+    close(idx->fd);
+    idx->base = NULL;
+    idx->fd = -1;
+}
+
+/**
+ * @brief Open an index file, creating it if it does not exist or is empty.
+ *
+ * Opening an existing index only maps the file: the time does not depend on the number of entries.
+ *
+ * @param idx      Index to initialize
+ * @param path     File path
+ * @param capacity Expected number of entries, used only to choose the number of buckets of a new index
+ *                 (lookups read one page up to this capacity, and about two pages up to twice this capacity).
+ *                 It is not a limit: the index grows with overflow pages up to FARMHASH64_FPINDEX_MAX_PAGES pages,
+ *                 with longer page chains past the capacity.
+ *
+ * @return FARMHASH64_FPINDEX_OK on success, or a negative farmhash64_fpindex_status_t error code
+ *
+ * @public
+ */
+static inline int farmhash64_fpindex_open(farmhash64_fpindex_t *idx, const char *path, uint64_t capacity)
+{
+    if ((idx == NULL) || (path == NULL))
+    {
+        return FARMHASH64_FPINDEX_ERR_ARGS;
+    }
+    memset(idx, 0, sizeof(*idx));
+    idx->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (idx->fd < 0)
+    {
+        return FARMHASH64_FPINDEX_ERR_IO;
+    }
+    struct stat st;
+    if (fstat(idx->fd, &st) != 0)
+    {
+        close(idx->fd);
+        return FARMHASH64_FPINDEX_ERR_IO;
+    }
+    uint64_t file_pages = (uint64_t)st.st_size / FARMHASH64_FPINDEX_PAGE_SIZE;
+    farmhash64_fpindex_header_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    if ((st.st_size != 0) && (pread(idx->fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr)))
+    {
+        close(idx->fd);
+        return FARMHASH64_FPINDEX_ERR_FORMAT;
+    }
+    // an empty file, or a file whose creation did not complete (the signature is written last)
+    int create = (hdr.magic == 0);
+    if (create)
+    {
+        memset(&hdr, 0, sizeof(hdr));
+        while ((hdr.bucket_bits < FARMHASH64_FPINDEX_MAX_BUCKET_BITS) && (((uint64_t)FARMHASH64_FPINDEX_BUCKET_FILL << hdr.bucket_bits) < capacity))
+        {
+            hdr.bucket_bits++;
+        }
+        file_pages = 1 + ((uint64_t)1 << hdr.bucket_bits);
+        if ((ftruncate(idx->fd, 0) != 0) || (ftruncate(idx->fd, (off_t)(file_pages * FARMHASH64_FPINDEX_PAGE_SIZE)) != 0))
+        {
+            close(idx->fd);
+            return FARMHASH64_FPINDEX_ERR_IO;
+        }
+    }
+    else if ((hdr.magic != FARMHASH64_FPINDEX_MAGIC)
+             || (hdr.version != FARMHASH64_FPINDEX_VERSION)
+             || (hdr.page_size != FARMHASH64_FPINDEX_PAGE_SIZE)
+             || (hdr.bucket_bits > FARMHASH64_FPINDEX_MAX_BUCKET_BITS)
+             || (file_pages < 1 + ((uint64_t)1 << hdr.bucket_bits)))
+    {
+        close(idx->fd);
+        return FARMHASH64_FPINDEX_ERR_FORMAT;
+    }
+    uint64_t nbuckets = (uint64_t)1 << hdr.bucket_bits;
+    idx->bucket_mask = nbuckets - 1;
+    // reserve headroom for the overflow pages, so the mapping rarely moves when the file grows
+    uint64_t reserve = 1 + (nbuckets * FARMHASH64_FPINDEX_RESERVE_FACTOR);
+    reserve = (reserve < FARMHASH64_FPINDEX_MIN_RESERVE) ? FARMHASH64_FPINDEX_MIN_RESERVE : reserve;
+    reserve = (reserve < 2 * file_pages) ? 2 * file_pages : reserve;
+    reserve = (reserve < FARMHASH64_FPINDEX_MAX_PAGES) ? reserve : FARMHASH64_FPINDEX_MAX_PAGES;
+    int ret = farmhash64_fpindex_reserve(idx, (file_pages > reserve) ? file_pages : reserve);
+    if (ret != FARMHASH64_FPINDEX_OK)
+    {
+        close(idx->fd);
+        return ret;
+    }
+    ret = farmhash64_fpindex_grow(idx, file_pages);
+    if (ret != FARMHASH64_FPINDEX_OK)
+    {
+        farmhash64_fpindex_close(idx);
+        return ret;
+    }
+    if (create)
+    {
+        idx->header->version = FARMHASH64_FPINDEX_VERSION;
+        idx->header->page_size = FARMHASH64_FPINDEX_PAGE_SIZE;
+        idx->header->bucket_bits = hdr.bucket_bits;
+        idx->header->next_page = file_pages;
+        __atomic_store_n(&idx->header->magic, FARMHASH64_FPINDEX_MAGIC, __ATOMIC_RELEASE);
+    }
+    idx->next_page = idx->header->next_page;
+    if ((idx->next_page > file_pages) || (idx->next_page < 1 + nbuckets))
+    {
+        // the file size or the header were not persisted before a system crash
+        idx->next_page = (idx->next_page > file_pages) ? file_pages : 1 + nbuckets;
+        idx->header->next_page = idx->next_page;
+    }
+    return FARMHASH64_FPINDEX_OK;
+}
+
+/**
+ * @brief Add an entry to the index.
+ *
+ * Adding an existing (hash, offset) pair has no effect, so the log records after the last checkpoint
+ * can be inserted again after a crash.
+ *
+ * @param idx    Index
+ * @param hash   Key hash (e.g. farmhash64 of the key; 0 and 1 are the same hash)
+ * @param offset Record offset (not FARMHASH64_FPINDEX_DELETED)
+ *
+ * @return FARMHASH64_FPINDEX_OK on success, or a negative farmhash64_fpindex_status_t error code
+ *
+ * @public
+ */
+static inline int farmhash64_fpindex_put(farmhash64_fpindex_t *idx, uint64_t hash, uint64_t offset)
+{
+    if ((idx == NULL) || (idx->base == NULL) || (offset == FARMHASH64_FPINDEX_DELETED))
+    {
+        return FARMHASH64_FPINDEX_ERR_ARGS;
+    }
+    uint64_t h = farmhash64_fpindex_norm(hash);
+    uint64_t pno = 1 + (h & idx->bucket_mask);
+    uint8_t found[FARMHASH64_FPINDEX_SLOTS];
+    farmhash64_fpindex_entry_t *deleted = NULL;
+    for (;;)
+    {
+        farmhash64_fpindex_page_t *p = farmhash64_fpindex_page(idx, pno);
+        uint32_t n;
+        uint32_t empty = farmhash64_fpindex_scan(p, h, found, &n);
+        uint32_t i;
+        for (i = 0; i < n; i++)
+        {
+            farmhash64_fpindex_entry_t *e = &p->entry[found[i]];
+            if (e->offset == offset)
+            {
+                return FARMHASH64_FPINDEX_OK;
+            }
+            if ((e->offset == FARMHASH64_FPINDEX_DELETED) && (deleted == NULL))
+            {
+                deleted = e;
+            }
+        }
+        if (p->count < FARMHASH64_FPINDEX_MAX_FILL)
+        {
+            // a page that is not full has no overflow pages: the pair is not in the index
+            if (deleted != NULL)
+            {
+                __atomic_store_n(&deleted->offset, offset, __ATOMIC_RELEASE);
+            }
+            else
+            {
+                p->entry[empty].hash = h;
+                p->entry[empty].offset = offset;
+                __atomic_store_n(&p->tag[empty], farmhash64_fpindex_tag(h), __ATOMIC_RELEASE);
+                p->count++;
+            }
+            idx->header->entries++;
+            return FARMHASH64_FPINDEX_OK;
+        }
+        uint64_t next = farmhash64_fpindex_next(idx, p);
+        if (next == 0)
+        {
+            if (deleted != NULL)
+            {
+                __atomic_store_n(&deleted->offset, offset, __ATOMIC_RELEASE);
+                idx->header->entries++;
+                return FARMHASH64_FPINDEX_OK;
+            }
+            int ret = farmhash64_fpindex_link(idx, pno, &next);
+            if (ret != FARMHASH64_FPINDEX_OK)
+            {
+                return ret;
+            }
+        }
+        pno = next;
+    }
+}
+
+/**
+ * @brief Return the offsets stored for a hash, in insertion order.
+ *
+ * Only the first max offsets are written, but all of them are counted.
+ *
+ * @param idx     Index
+ * @param hash    Key hash
+ * @param offsets Output offsets (can be NULL if max is 0)
+ * @param max     Capacity of offsets
+ *
+ * @return Number of offsets stored for the hash (0 if none)
+ *
+ * @public
+ */
+static inline size_t farmhash64_fpindex_get(const farmhash64_fpindex_t *idx, uint64_t hash, uint64_t *offsets, size_t max)
+{
+    uint64_t h = farmhash64_fpindex_norm(hash);
+    uint64_t pno = 1 + (h & idx->bucket_mask);
+    uint8_t found[FARMHASH64_FPINDEX_SLOTS];
+    size_t count = 0;
+    while (pno != 0)
+    {
+        const farmhash64_fpindex_page_t *p = farmhash64_fpindex_page(idx, pno);
+        uint32_t n;
+        farmhash64_fpindex_scan(p, h, found, &n);
+        uint32_t i;
+        for (i = 0; i < n; i++)
+        {
+            uint64_t off = p->entry[found[i]].offset;
+            if (off != FARMHASH64_FPINDEX_DELETED)
+            {
+                if (count < max)
+                {
+                    offsets[count] = off;
+                }
+                count++;
+            }
+        }
+        pno = (p->count < FARMHASH64_FPINDEX_MAX_FILL) ? 0 : farmhash64_fpindex_next(idx, p);
+    }
+    return count;
+}
+
+/**
+ * @brief Replace the offset of an entry (e.g. when a store compacts its log).
+ *
+ * The offset is updated with a single aligned store: after a crash the entry holds either offset.
+ *
+ * @param idx        Index
+ * @param hash       Key hash
+ * @param old_offset Current offset of the entry
+ * @param new_offset New offset (FARMHASH64_FPINDEX_DELETED deletes the entry)
+ *
+ * @return FARMHASH64_FPINDEX_OK on success, FARMHASH64_FPINDEX_ERR_NOTFOUND if the entry does not exist,
+ *         or another negative farmhash64_fpindex_status_t error code
+ *
+ * @public
+ */
+static inline int farmhash64_fpindex_replace(farmhash64_fpindex_t *idx, uint64_t hash, uint64_t old_offset, uint64_t new_offset)
+{
+    if ((idx == NULL) || (idx->base == NULL) || (old_offset == FARMHASH64_FPINDEX_DELETED))
+    {
+        return FARMHASH64_FPINDEX_ERR_ARGS;
+    }
+    uint64_t h = farmhash64_fpindex_norm(hash);
+    uint64_t pno = 1 + (h & idx->bucket_mask);
+    uint8_t found[FARMHASH64_FPINDEX_SLOTS];
+    while (pno != 0)
+    {
+        farmhash64_fpindex_page_t *p = farmhash64_fpindex_page(idx, pno);
+        uint32_t n;
+        farmhash64_fpindex_scan(p, h, found, &n);
+        uint32_t i;
+        for (i = 0; i < n; i++)
+        {
+            farmhash64_fpindex_entry_t *e = &p->entry[found[i]];
+            if (e->offset == old_offset)
+            {
+                __atomic_store_n(&e->offset, new_offset, __ATOMIC_RELEASE);
+                idx->header->entries -= (new_offset == FARMHASH64_FPINDEX_DELETED);
+                return FARMHASH64_FPINDEX_OK;
+            }
+        }
+        pno = (p->count < FARMHASH64_FPINDEX_MAX_FILL) ? 0 : farmhash64_fpindex_next(idx, p);
+    }
+    return FARMHASH64_FPINDEX_ERR_NOTFOUND;
+}
+
+/**
+ * @brief Delete an entry.
+ *
+ * The slot stays allocated, and is reused if the same hash is added again.
+ *
+ * @param idx    Index
+ * @param hash   Key hash
+ * @param offset Offset of the entry
+ *
+ * @return FARMHASH64_FPINDEX_OK on success, FARMHASH64_FPINDEX_ERR_NOTFOUND if the entry does not exist,
+ *         or another negative farmhash64_fpindex_status_t error code
+ *
+ * @public
+ */
+static inline int farmhash64_fpindex_del(farmhash64_fpindex_t *idx, uint64_t hash, uint64_t offset)
+{
+    return farmhash64_fpindex_replace(idx, hash, offset, FARMHASH64_FPINDEX_DELETED);
+}
+
+/**
+ * @brief Flush the index to the storage and record a checkpoint.
+ *
+ * The pages are flushed before the checkpoint is written, so after a system crash
+ * the index contains at least all the entries added before the checkpoint.
+ *
+ * @param idx        Index
+ * @param checkpoint Caller-defined value (e.g. the log offset covered by the index)
+ *
+ * @return FARMHASH64_FPINDEX_OK on success, or a negative farmhash64_fpindex_status_t error code
+ *
+ * @public
+ */
+static inline int farmhash64_fpindex_sync(farmhash64_fpindex_t *idx, uint64_t checkpoint)
+{
+    if ((idx == NULL) || (idx->base == NULL))
+    {
+        return FARMHASH64_FPINDEX_ERR_ARGS;
+    }
+    if ((msync(idx->base, (size_t)(idx->mapped_pages * FARMHASH64_FPINDEX_PAGE_SIZE), MS_SYNC) != 0) || (fdatasync(idx->fd) != 0))
+    {
+        return FARMHASH64_FPINDEX_ERR_IO;
+    }
+    idx->header->checkpoint = checkpoint;
+    if (msync(idx->base, FARMHASH64_FPINDEX_PAGE_SIZE, MS_SYNC) != 0)
+    {
+        return FARMHASH64_FPINDEX_ERR_IO;
+    }
+    return FARMHASH64_FPINDEX_OK;
+}
+
+/**
+ * @brief Return the checkpoint recorded by the last successful farmhash64_fpindex_sync (0 for a new index).
+ *
+ * @param idx Index
+ *
+ * @return Checkpoint value
+ *
+ * @public
+ */
+static inline uint64_t farmhash64_fpindex_checkpoint(const farmhash64_fpindex_t *idx)
+{
+    return idx->header->checkpoint;
+}
+
+/**
+ * @brief Return the index statistics.
+ *
+ * @param idx   Index
+ * @param stats Output statistics
+ *
+ * @public
+ */
+static inline void farmhash64_fpindex_stats(const farmhash64_fpindex_t *idx, farmhash64_fpindex_stats_t *stats)
+{
+    stats->entries = idx->header->entries;
+    stats->buckets = idx->bucket_mask + 1;
+    stats->overflow_pages = idx->next_page - 1 - stats->buckets;
+    stats->file_bytes = idx->mapped_pages * FARMHASH64_FPINDEX_PAGE_SIZE;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FARMHASH64_FPINDEX_H
@@ -0,0 +1,817 @@
+/**
+ * @file farmhash64_fpset.h
+ * @brief Sets of farmhash64 fingerprints stored as sorted arrays: sort, intersection, union and Jaccard similarity.
+ *
+ * A set is a strictly increasing array of uint64_t fingerprints, as produced by farmhash64_fpset_sort.
+ *
+ * - Sort: parallel radix sort with duplicate removal. The values are first scattered in 256 buckets by
+ *   their top byte (each thread handles a slice of the input), then the buckets are handed out to the
+ *   threads and each one is sorted with a least significant digit radix sort on the remaining 7 bytes,
+ *   skipping the digits that are the same for all the values of the bucket.
+ *   The buckets of uniformly distributed fingerprints stay in the L2 cache up to a few million values.
+ * - Intersection: when one set is at least FARMHASH64_FPSET_GALLOP_RATIO times larger than the other,
+ *   each value of the small set is searched in the large one with a galloping (exponential) search from
+ *   the previous match. Otherwise the sets are compared a block at a time: all the pairs of a block of each
+ *   set in a few vector comparisons (8 x 8 values with AVX-512F, 4 x 4 with AVX2), then the block with the
+ *   smaller last value is replaced. Without AVX2 a branchless scalar merge is used.
+ *   The vector paths are selected at compile time: build with -mavx2, -mavx512f or -march=native to enable them.
+ * - Union: two-way merge, or k-way merge of any number of sets with a binary heap.
+ *
+ * The count functions (farmhash64_fpset_intersect_count, farmhash64_fpset_union_count, farmhash64_fpset_jaccard)
+ * do not write the result, and the union size is derived from the size of the intersection.
+ * Passing a NULL output to farmhash64_fpset_intersect, farmhash64_fpset_union or farmhash64_fpset_merge
+ * also returns the size only.
+ */
+
+#ifndef FARMHASH64_FPSET_H
+#define FARMHASH64_FPSET_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include "farmhash64.h"
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief Maximum number of threads.
+ */
+#define FARMHASH64_FPSET_MAX_THREADS 256
+
+/**
+ * @brief Minimum size ratio between the two sets of an intersection for the galloping search.
+ *
+ * Measured crossover on sets of 2^20 fingerprints (larger than the L2 cache): the searches in the large set
+ * miss the cache, while the vector block comparison streams through it.
+ */
+#if defined(__AVX512F__)
+#define FARMHASH64_FPSET_GALLOP_RATIO 512
+#elif defined(__AVX2__)
+#define FARMHASH64_FPSET_GALLOP_RATIO 256
+#else
+#define FARMHASH64_FPSET_GALLOP_RATIO 12
+#endif
+
+/**
+ * @brief Number of buckets of the first sorting pass (one per value of the top byte).
+ *
+ * @private
+ */
+#define FARMHASH64_FPSET_BUCKETS 256
+
+/**
+ * @brief Buckets up to this size are sorted by insertion.
+ *
+ * @private
+ */
+#define FARMHASH64_FPSET_SMALL_SORT 64
+
+/**
+ * @brief Return codes.
+ */
+enum farmhash64_fpset_status_t
+{
+    FARMHASH64_FPSET_OK = 0,          /**< Success. */
+    FARMHASH64_FPSET_ERR_ARGS = -1,   /**< Invalid arguments. */
+    FARMHASH64_FPSET_ERR_MEMORY = -2, /**< Memory allocation failure. */
+};
+
+/**
+ * @brief Per-thread state of a sorting pass.
+ *
+ * @private
+ */
+typedef struct farmhash64_fpset_task_t
+{
+    uint64_t *v;            /**< Values (input, then the sorted buckets). */
+    uint64_t *tmp;          /**< Values scattered by bucket. */
+    size_t start;           /**< First value of the slice. */
+    size_t end;             /**< End of the slice. */
+    size_t *hist;           /**< Values per bucket in the slice, then the next write position. */
+    const size_t *offsets;  /**< FARMHASH64_FPSET_BUCKETS + 1 bucket offsets (bucket pass). */
+    size_t *nunique;        /**< Distinct values per bucket (bucket pass). */
+    uint64_t *next;         /**< Next bucket to sort, shared by all the bucket tasks. */
+} farmhash64_fpset_task_t;
+
+/**
+ * @brief Run a pass on all the tasks.
+ *
+ * @private
+ */
+static inline void farmhash64_fpset_run(void *(*fn)(void *), farmhash64_fpset_task_t *tasks, unsigned nthreads)
+{
+    pthread_t tid[FARMHASH64_FPSET_MAX_THREADS];
+    unsigned i;
+    unsigned started = 0;
+    for (i = 1; i < nthreads; i++)
+    {
+        if (pthread_create(&tid[i], NULL, fn, &tasks[i]) != 0)
+        {
+            break;
+        }
+        started = i;
+    }
+    // run the tasks that did not get a thread in the current one
+    for (; i < nthreads; i++)
+    {
+        fn(&tasks[i]);
+    }
+    fn(&tasks[0]);
+    for (i = 1; i <= started; i++)
+    {
+        pthread_join(tid[i], NULL);
+    }
+}
+
+/**
+ * @brief Sort a few values by insertion.
+ *
+ * @private
+ */
+static inline void farmhash64_fpset_insertion_sort(uint64_t *v, size_t n)
+{
+    size_t i;
+    for (i = 1; i < n; i++)
+    {
+        uint64_t x = v[i];
+        size_t j = i;
+        while ((j > 0) && (v[j - 1] > x))
+        {
+            v[j] = v[j - 1];
+            --j;
+        }
+        v[j] = x;
+    }
+}
+
+/**
+ * @brief Remove the duplicates of a sorted array.
+ *
+ * @return Number of distinct values, moved to the front of the array
+ *
+ * @private
+ */
+static inline size_t farmhash64_fpset_unique(uint64_t *v, size_t n)
+{
+    if (n == 0)
+    {
+        return 0;
+    }
+    size_t k = 0;
+    size_t i;
+    for (i = 1; i < n; i++)
+    {
+        v[k + 1] = v[i];
+        k += (v[i] != v[k]);
+    }
+    return k + 1;
+}
+
+/**
+ * @brief Sort the values of a bucket on their 7 low bytes.
+ *
+ * @param src Values of the bucket (used as scratch space)
+ * @param dst Sorted values
+ * @param n   Number of values
+ *
+ * @private
+ */
+static inline void farmhash64_fpset_sort_bucket(uint64_t *src, uint64_t *dst, size_t n)
+{
+    if (n <= FARMHASH64_FPSET_SMALL_SORT)
+    {
+        farmhash64_fpset_insertion_sort(src, n);
+        memcpy(dst, src, n * sizeof(uint64_t));
+        return;
+    }
+    size_t count[7][256];
+    memset(count, 0, sizeof(count));
+    size_t i;
+    unsigned d;
+    // the histograms of all the digits in one read
+    for (i = 0; i < n; i++)
+    {
+        uint64_t x = src[i];
+        for (d = 0; d < 7; d++)
+        {
+            count[d][(x >> (8 * d)) & 0xFF]++;
+        }
+    }
+    uint64_t *s = src;
+    uint64_t *t = dst;
+    for (d = 0; d < 7; d++)
+    {
+        size_t *c = count[d];
+        unsigned shift = 8 * d;
+        if (c[(s[0] >> shift) & 0xFF] == n)
+        {
+            continue; // same digit for all the values
+        }
+        size_t pos = 0;
+        unsigned k;
+        for (k = 0; k < 256; k++)
+        {
+            size_t m = c[k];
+            c[k] = pos;
+            pos += m;
+        }
+        for (i = 0; i < n; i++)
+        {
+            uint64_t x = s[i];
+            t[c[(x >> shift) & 0xFF]++] = x;
+        }
+        uint64_t *w = s;
+        s = t;
+        t = w;
+    }
+    if (s != dst)
+    {
+        memcpy(dst, s, n * sizeof(uint64_t));
+    }
+}
+
+/**
+ * @brief First sorting pass: count the values of each bucket in the slice.
+ *
+ * @private
+ */
+static inline void *farmhash64_fpset_histogram(void *arg)
+{
+    farmhash64_fpset_task_t *t = (farmhash64_fpset_task_t *)arg;
+    size_t i;
+    for (i = t->start; i < t->end; i++)
+    {
+        t->hist[t->v[i] >> 56]++;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Second sorting pass: scatter the values of the slice in the buckets.
+ *
+ * On entry hist[b] is the position of the first value of the slice in bucket b.
+ *
+ * @private
+ */
+static inline void *farmhash64_fpset_scatter(void *arg)
+{
+    farmhash64_fpset_task_t *t = (farmhash64_fpset_task_t *)arg;
+    size_t i;
+    for (i = t->start; i < t->end; i++)
+    {
+        uint64_t x = t->v[i];
+        t->tmp[t->hist[x >> 56]++] = x;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Bucket pass: sort and deduplicate the buckets handed out by the shared counter.
+ *
+ * Each bucket is sorted from tmp back to the same position in v.
+ *
+ * @private
+ */
+static inline void *farmhash64_fpset_sort_buckets(void *arg)
+{
+    farmhash64_fpset_task_t *t = (farmhash64_fpset_task_t *)arg;
+    for (;;)
+    {
+        uint64_t b = __atomic_fetch_add(t->next, 1, __ATOMIC_RELAXED);
+        if (b >= FARMHASH64_FPSET_BUCKETS)
+        {
+            break;
+        }
+        size_t off = t->offsets[b];
+        size_t n = t->offsets[b + 1] - off;
+        farmhash64_fpset_sort_bucket(t->tmp + off, t->v + off, n);
+        t->nunique[b] = farmhash64_fpset_unique(t->v + off, n);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Sort an array of fingerprints in ascending order and remove the duplicates, in place.
+ *
+ * The sort takes n * 8 bytes of scratch memory. The values are distributed in buckets by their top byte,
+ * so the work is spread over the threads when the top bytes are varied, as with farmhash64 fingerprints.
+ *
+ * @param v        Values
+ * @param n        Number of values
+ * @param nthreads Number of threads (1 to FARMHASH64_FPSET_MAX_THREADS)
+ * @param nunique  Set to the number of distinct values, stored in v[0] to v[nunique - 1]
+ *
+ * @return FARMHASH64_FPSET_OK on success, or a negative farmhash64_fpset_status_t error code
+ *
+ * @public
+ */
+static inline int farmhash64_fpset_sort(uint64_t *v, size_t n, unsigned nthreads, size_t *nunique)
+{
+    if ((nunique == NULL) || ((v == NULL) && (n > 0)) || (nthreads < 1) || (nthreads > FARMHASH64_FPSET_MAX_THREADS))
+    {
+        return FARMHASH64_FPSET_ERR_ARGS;
+    }
+    if (n <= FARMHASH64_FPSET_SMALL_SORT)
+    {
+        farmhash64_fpset_insertion_sort(v, n);
+        *nunique = farmhash64_fpset_unique(v, n);
+        return FARMHASH64_FPSET_OK;
+    }
+    unsigned nt = nthreads;
+    if (n < (size_t)nt * 4096)
+    {
+        nt = 1;
+    }
+    uint64_t *tmp = (uint64_t *)malloc(n * sizeof(uint64_t));
+    size_t *hist = (size_t *)calloc((size_t)nt * FARMHASH64_FPSET_BUCKETS, sizeof(size_t));
+    size_t *offsets = (size_t *)malloc((FARMHASH64_FPSET_BUCKETS + 1) * sizeof(size_t));
+    size_t *counts = (size_t *)malloc(FARMHASH64_FPSET_BUCKETS * sizeof(size_t));
+    farmhash64_fpset_task_t *tasks = (farmhash64_fpset_task_t *)calloc(nt, sizeof(farmhash64_fpset_task_t));
+    if ((tmp == NULL) || (hist == NULL) || (offsets == NULL) || (counts == NULL) || (tasks == NULL))
+    {
+        free(tmp);
+        free(hist);
+        free(offsets);
+        free(counts);
+        free(tasks);
+        return FARMHASH64_FPSET_ERR_MEMORY;
+    }
+    uint64_t next = 0;
+    unsigned t;
+    for (t = 0; t < nt; t++)
+    {
+        tasks[t].v = v;
+        tasks[t].tmp = tmp;
+        tasks[t].start = n * t / nt;
+        tasks[t].end = n * (t + 1) / nt;
+        tasks[t].hist = hist + ((size_t)t * FARMHASH64_FPSET_BUCKETS);
+        tasks[t].offsets = offsets;
+        tasks[t].nunique = counts;
+        tasks[t].next = &next;
+    }
+    farmhash64_fpset_run(farmhash64_fpset_histogram, tasks, nt);
+    // turn the per-thread counts into write positions: bucket-major, then thread order
+    size_t pos = 0;
+    size_t b;
+    for (b = 0; b < FARMHASH64_FPSET_BUCKETS; b++)
+    {
+        offsets[b] = pos;
+        for (t = 0; t < nt; t++)
+        {
+            size_t m = tasks[t].hist[b];
+            tasks[t].hist[b] = pos;
+            pos += m;
+        }
+    }
+    offsets[FARMHASH64_FPSET_BUCKETS] = pos;
+    farmhash64_fpset_run(farmhash64_fpset_scatter, tasks, nt);
+    farmhash64_fpset_run(farmhash64_fpset_sort_buckets, tasks, nt);
+    // close the gaps left by the duplicates
+    pos = 0;
+    for (b = 0; b < FARMHASH64_FPSET_BUCKETS; b++)
+    {
+        if ((offsets[b] != pos) && (counts[b] > 0))
+        {
+            memmove(v + pos, v + offsets[b], counts[b] * sizeof(uint64_t));
+        }
+        pos += counts[b];
+    }
+    *nunique = pos;
+    free(tmp);
+    free(hist);
+    free(offsets);
+    free(counts);
+    free(tasks);
+    return FARMHASH64_FPSET_OK;
+}
+
+/**
+ * @brief Galloping intersection of a small set with a large one.
+ *
+ * @return Size of the intersection
+ *
+ * @private
+ */
+static inline size_t farmhash64_fpset_gallop(const uint64_t *a, size_t na, const uint64_t *b, size_t nb, uint64_t *out)
+{
+    size_t c = 0;
+    size_t j = 0;
+    size_t i;
+    for (i = 0; (i < na) && (j < nb); i++)
+    {
+        uint64_t x = a[i];
+        if (b[j] < x)
+        {
+            // b[lo] < x, and b[hi] >= x or hi == nb
+            size_t lo = j;
+            size_t step = 1;
+            size_t hi = j + 1;
+            while ((hi < nb) && (b[hi] < x))
+            {
+                lo = hi;
+                step <<= 1;
+                hi = lo + step;
+            }
+            if (hi > nb)
+            {
+                hi = nb;
+            }
+            while (lo + 1 < hi)
+            {
+                size_t mid = lo + ((hi - lo) >> 1);
+                if (b[mid] < x)
+                {
+                    lo = mid;
+                }
+                else
+                {
+                    hi = mid;
+                }
+            }
+            j = hi;
+            if (j == nb)
+            {
+                break;
+            }
+        }
+        if (b[j] == x)
+        {
+            if (out != NULL)
+            {
+                out[c] = x;
+            }
+            ++c;
+            ++j;
+        }
+    }
+    return c;
+}
+
+/**
+ * @brief Merge intersection from positions i and j, for the values left after the vector blocks.
+ *
+ * @return Size of the intersection of the remaining values
+ *
+ * @private
+ */
+static inline size_t farmhash64_fpset_merge_tail(const uint64_t *a, size_t na, const uint64_t *b, size_t nb, size_t i, size_t j, uint64_t *out)
+{
+    size_t c = 0;
+    if (out == NULL)
+    {
+        while ((i < na) && (j < nb))
+        {
+            uint64_t x = a[i];
+            uint64_t y = b[j];
+            c += (x == y);
+            i += (x <= y);
+            j += (y <= x);
+        }
+        return c;
+    }
+    while ((i < na) && (j < nb))
+    {
+        uint64_t x = a[i];
+        uint64_t y = b[j];
+        out[c] = x;
+        c += (x == y);
+        i += (x <= y);
+        j += (y <= x);
+    }
+    return c;
+}
+
+/**
+ * @brief Block intersection of two sets of similar sizes.
+ *
+ * @return Size of the intersection
+ *
+ * @private
+ */
+static inline size_t farmhash64_fpset_blocks(const uint64_t *a, size_t na, const uint64_t *b, size_t nb, uint64_t *out)
+{
+    size_t c = 0;
+    size_t i = 0;
+    size_t j = 0;
+#if defined(__AVX512F__)
+    while ((i + 8 <= na) && (j + 8 <= nb))
+    {
+        __m512i va = _mm512_loadu_si512((const void *)(a + i));
+        __m512i vb = _mm512_loadu_si512((const void *)(b + j));
+        // compare each value of va with the 8 rotations of vb
+        __mmask8 m = _mm512_cmpeq_epi64_mask(va, vb);
+        m |= _mm512_cmpeq_epi64_mask(va, _mm512_alignr_epi64(vb, vb, 1));
+        m |= _mm512_cmpeq_epi64_mask(va, _mm512_alignr_epi64(vb, vb, 2));
+        m |= _mm512_cmpeq_epi64_mask(va, _mm512_alignr_epi64(vb, vb, 3));
+        m |= _mm512_cmpeq_epi64_mask(va, _mm512_alignr_epi64(vb, vb, 4));
+        m |= _mm512_cmpeq_epi64_mask(va, _mm512_alignr_epi64(vb, vb, 5));
+        m |= _mm512_cmpeq_epi64_mask(va, _mm512_alignr_epi64(vb, vb, 6));
+        m |= _mm512_cmpeq_epi64_mask(va, _mm512_alignr_epi64(vb, vb, 7));
+        if (out != NULL)
+        {
+            _mm512_mask_compressstoreu_epi64((void *)(out + c), m, va);
+        }
+        c += (size_t)__builtin_popcount((unsigned)m);
+        uint64_t amax = a[i + 7];
+        uint64_t bmax = b[j + 7];
+        i += (amax <= bmax) ? 8 : 0;
+        j += (bmax <= amax) ? 8 : 0;
+    }
+#elif defined(__AVX2__)
+    while ((i + 4 <= na) && (j + 4 <= nb))
+    {
+        __m256i va = _mm256_loadu_si256((const __m256i *)(const void *)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i *)(const void *)(b + j));
+        // compare each value of va with the 4 rotations of vb
+        __m256i m = _mm256_cmpeq_epi64(va, vb);
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, 0x39)));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, 0x4E)));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, 0x93)));
+        unsigned mask = (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(m));
+        if (out != NULL)
+        {
+            unsigned k = mask;
+            size_t o = c;
+            while (k != 0)
+            {
+                out[o++] = a[i + (size_t)__builtin_ctz(k)];
+                k &= k - 1;
+            }
+        }
+        c += (size_t)__builtin_popcount(mask);
+        uint64_t amax = a[i + 3];
+        uint64_t bmax = b[j + 3];
+        i += (amax <= bmax) ? 4 : 0;
+        j += (bmax <= amax) ? 4 : 0;
+    }
+#endif
+    return c + farmhash64_fpset_merge_tail(a, na, b, nb, i, j, (out == NULL) ? NULL : out + c);
+}
+
+/**
+ * @brief Intersection of two sets.
+ *
+ * @param a   First set (strictly increasing values)
+ * @param na  Size of the first set
+ * @param b   Second set (strictly increasing values)
+ * @param nb  Size of the second set
+ * @param out Output array with room for min(na, nb) values (can be NULL to get the size only)
+ *
+ * @return Size of the intersection (the number of values written in out)
+ *
+ * @public
+ */
+static inline size_t farmhash64_fpset_intersect(const uint64_t *a, size_t na, const uint64_t *b, size_t nb, uint64_t *out)
+{
+    if (na > nb)
+    {
+        const uint64_t *s = a;
+        size_t n = na;
+        a = b;
+        na = nb;
+        b = s;
+        nb = n;
+    }
+    if (na == 0)
+    {
+        return 0;
+    }
+    if (nb / na >= FARMHASH64_FPSET_GALLOP_RATIO)
+    {
+        return farmhash64_fpset_gallop(a, na, b, nb, out);
+    }
+    return farmhash64_fpset_blocks(a, na, b, nb, out);
+}
+
+/**
+ * @brief Size of the intersection of two sets.
+ *
+ * @param a  First set (strictly increasing values)
+ * @param na Size of the first set
+ * @param b  Second set (strictly increasing values)
+ * @param nb Size of the second set
+ *
+ * @return Size of the intersection
+ *
+ * @public
+ */
+static inline size_t farmhash64_fpset_intersect_count(const uint64_t *a, size_t na, const uint64_t *b, size_t nb)
+{
+    return farmhash64_fpset_intersect(a, na, b, nb, NULL);
+}
+
+/**
+ * @brief Size of the union of two sets.
+ *
+ * @param a  First set (strictly increasing values)
+ * @param na Size of the first set
+ * @param b  Second set (strictly increasing values)
+ * @param nb Size of the second set
+ *
+ * @return Size of the union
+ *
+ * @public
+ */
+static inline size_t farmhash64_fpset_union_count(const uint64_t *a, size_t na, const uint64_t *b, size_t nb)
+{
+    return na + nb - farmhash64_fpset_intersect(a, na, b, nb, NULL);
+}
+
+/**
+ * @brief Jaccard similarity of two sets: the size of the intersection divided by the size of the union.
+ *
+ * @param a  First set (strictly increasing values)
+ * @param na Size of the first set
+ * @param b  Second set (strictly increasing values)
+ * @param nb Size of the second set
+ *
+ * @return Similarity between 0 and 1 (1 for two empty sets)
+ *
+ * @public
+ */
+static inline double farmhash64_fpset_jaccard(const uint64_t *a, size_t na, const uint64_t *b, size_t nb)
+{
+    size_t c = farmhash64_fpset_intersect(a, na, b, nb, NULL);
+    size_t u = na + nb - c;
+    return (u == 0) ? 1.0 : (double)c / (double)u;
+}
+
+/**
+ * @brief Union of two sets.
+ *
+ * @param a   First set (strictly increasing values)
+ * @param na  Size of the first set
+ * @param b   Second set (strictly increasing values)
+ * @param nb  Size of the second set
+ * @param out Output array with room for na + nb values (can be NULL to get the size only)
+ *
+ * @return Size of the union (the number of values written in out)
+ *
+ * @public
+ */
+static inline size_t farmhash64_fpset_union(const uint64_t *a, size_t na, const uint64_t *b, size_t nb, uint64_t *out)
+{
+    if (out == NULL)
+    {
+        return farmhash64_fpset_union_count(a, na, b, nb);
+    }
+    size_t c = 0;
+    size_t i = 0;
+    size_t j = 0;
+    while ((i < na) && (j < nb))
+    {
+        uint64_t x = a[i];
+        uint64_t y = b[j];
+        out[c++] = (x <= y) ? x : y;
+        i += (x <= y);
+        j += (y <= x);
+    }
+    if (i < na)
+    {
+        memcpy(out + c, a + i, (na - i) * sizeof(uint64_t));
+        c += na - i;
+    }
+    if (j < nb)
+    {
+        memcpy(out + c, b + j, (nb - j) * sizeof(uint64_t));
+        c += nb - j;
+    }
+    return c;
+}
+
+/**
+ * @brief Merge cursor of a set.
+ *
+ * @private
+ */
+typedef struct farmhash64_fpset_cursor_t
+{
+    const uint64_t *pos; /**< Current value. */
+    const uint64_t *end; /**< End of the set. */
+} farmhash64_fpset_cursor_t;
+
+/**
+ * @brief Restore the heap order from node i down, in a min-heap of cursors ordered by current value.
+ *
+ * @private
+ */
+static inline void farmhash64_fpset_sift_down(farmhash64_fpset_cursor_t *heap, size_t n, size_t i)
+{
+    farmhash64_fpset_cursor_t x = heap[i];
+    for (;;)
+    {
+        size_t k = (2 * i) + 1;
+        if (k >= n)
+        {
+            break;
+        }
+        if ((k + 1 < n) && (*heap[k + 1].pos < *heap[k].pos))
+        {
+            ++k;
+        }
+        if (*heap[k].pos >= *x.pos)
+        {
+            break;
+        }
+        heap[i] = heap[k];
+        i = k;
+    }
+    heap[i] = x;
+}
+
+/**
+ * @brief Union of any number of sets (k-way merge).
+ *
+ * @param sets  Sets (strictly increasing values; a set can be NULL when its size is 0)
+ * @param sizes Sizes of the sets
+ * @param k     Number of sets
+ * @param out   Output array with room for the sum of the sizes (can be NULL to get the size only)
+ * @param nout  Set to the size of the union (the number of values written in out)
+ *
+ * @return FARMHASH64_FPSET_OK on success, or a negative farmhash64_fpset_status_t error code
+ *
+ * @public
+ */
+static inline int farmhash64_fpset_merge(const uint64_t *const *sets, const size_t *sizes, size_t k, uint64_t *out, size_t *nout)
+{
+    if ((nout == NULL) || ((k > 0) && ((sets == NULL) || (sizes == NULL))))
+    {
+        return FARMHASH64_FPSET_ERR_ARGS;
+    }
+    farmhash64_fpset_cursor_t *heap = (farmhash64_fpset_cursor_t *)malloc((k + 1) * sizeof(farmhash64_fpset_cursor_t));
+    if (heap == NULL)
+    {
+        return FARMHASH64_FPSET_ERR_MEMORY;
+    }
+    size_t n = 0;
+    size_t i;
+    for (i = 0; i < k; i++)
+    {
+        if (sizes[i] > 0)
+        {
+            if (sets[i] == NULL)
+            {
+                free(heap);
+                return FARMHASH64_FPSET_ERR_ARGS;
+            }
+            heap[n].pos = sets[i];
+            heap[n].end = sets[i] + sizes[i];
+            ++n;
+        }
+    }
+    size_t c = 0;
+    if (n == 1)
+    {
+        c = (size_t)(heap[0].end - heap[0].pos);
+        if (out != NULL)
+        {
+            memcpy(out, heap[0].pos, c * sizeof(uint64_t));
+        }
+    }
+    else if (n == 2)
+    {
+        c = farmhash64_fpset_union(heap[0].pos, (size_t)(heap[0].end - heap[0].pos), heap[1].pos, (size_t)(heap[1].end - heap[1].pos), out);
+    }
+    else if (n > 2)
+    {
+        for (i = n / 2; i > 0; i--)
+        {
+            farmhash64_fpset_sift_down(heap, n, i - 1);
+        }
+        uint64_t last = ~*heap[0].pos; // differs from the first value
+        while (n > 0)
+        {
+            uint64_t x = *heap[0].pos;
+            if (x != last)
+            {
+                if (out != NULL)
+                {
+                    out[c] = x;
+                }
+                ++c;
+                last = x;
+            }
+            if (++heap[0].pos == heap[0].end)
+            {
+                heap[0] = heap[--n];
+            }
+            if (n > 1)
+            {
+                farmhash64_fpset_sift_down(heap, n, 0);
+            }
+        }
+    }
+    *nout = c;
+    free(heap);
+    return FARMHASH64_FPSET_OK;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FARMHASH64_FPSET_H
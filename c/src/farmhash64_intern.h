@@ -0,0 +1,567 @@
+/**
+ * @file farmhash64_intern.h
+ * @brief Thread-safe string interning pool keyed by farmhash64.
+ *
+ * Each distinct byte string is stored once and identified by a stable 32-bit handle,
+ * so that equality checks become integer compares and repeated tokens cost no allocation.
+ *
+ * - The pool is split in FARMHASH64_INTERN_SHARDS shards selected by the top bits of farmhash64(s).
+ *   Each shard has a linear probing index storing the full 64-bit hash (strings are compared only
+ *   when the hashes match), a bump-pointer arena holding the string bytes, and a directory of its strings.
+ * - Inserts and lookups in a shard take the lock of that shard only.
+ * - Resolving a handle (farmhash64_intern_str) is lock-free: strings never move and the directory
+ *   pages are never reallocated (page k holds 2^(k + FARMHASH64_INTERN_PAGE_BITS) entries).
+ * - Each thread can put a farmhash64_intern_cache_t in front of the pool: a small 2-way set associative
+ *   cache of (hash, string, handle) that answers the frequent tokens without touching the shared shards.
+ *
+ * A handle is (id << FARMHASH64_INTERN_SHARD_BITS) | shard, where id is the 1-based insertion index of the
+ * string in its shard; 0 is never a valid handle. Strings are stored NUL-terminated.
+ *
+ * The pool is not a faster allocator: a single-threaded farmhash64_intern (shard lock) costs about
+ * as much as a malloc + copy + free of the token (around 40 ns per token in benchmark_farmhash64_intern,
+ * even with the per-thread cache). The gains are one copy per distinct string, no per-token free,
+ * and integer equality between handles.
+ */
+
+#ifndef FARMHASH64_INTERN_H
+#define FARMHASH64_INTERN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include "farmhash64.h"
+
+/**
+ * @brief Number of shard bits.
+ */
+#define FARMHASH64_INTERN_SHARD_BITS 6
+
+/**
+ * @brief Number of shards.
+ */
+#define FARMHASH64_INTERN_SHARDS (1 << FARMHASH64_INTERN_SHARD_BITS)
+
+/**
+ * @brief Maximum number of strings per shard.
+ */
+#define FARMHASH64_INTERN_MAX_IDS ((1U << (32 - FARMHASH64_INTERN_SHARD_BITS)) - 1)
+
+/**
+ * @brief Number of entries of the first directory page (log2).
+ *
+ * @private
+ */
+#define FARMHASH64_INTERN_PAGE_BITS 6
+
+/**
+ * @brief Number of directory pages per shard.
+ *
+ * @private
+ */
+#define FARMHASH64_INTERN_PAGES (32 - FARMHASH64_INTERN_SHARD_BITS - FARMHASH64_INTERN_PAGE_BITS + 1)
+
+/**
+ * @brief Size of the arena blocks (longer strings get their own block).
+ *
+ * @private
+ */
+#define FARMHASH64_INTERN_BLOCK_SIZE (1 << 16)
+
+/**
+ * @brief Number of sets of a per-thread cache (power of two).
+ */
+#define FARMHASH64_INTERN_CACHE_SIZE 1024
+
+/**
+ * @brief Arena block header, followed by the block data: string records of length (4 bytes), bytes and NUL.
+ *
+ * The blocks of a shard form a list, released with the pool.
+ *
+ * @private
+ */
+typedef struct farmhash64_intern_block_t
+{
+    struct farmhash64_intern_block_t *next; /**< Previous block. */
+    size_t used;                            /**< Used bytes of data. */
+    size_t size;                            /**< Size of data. */
+} farmhash64_intern_block_t;
+
+/**
+ * @brief Slot of a shard index.
+ *
+ * @private
+ */
+typedef struct farmhash64_intern_slot_t
+{
+    uint64_t hash; /**< Full farmhash64 of the string. */
+    uint32_t id;   /**< 1-based string index in the shard (0 for an empty slot). */
+} farmhash64_intern_slot_t;
+
+/**
+ * @brief Shard.
+ *
+ * @private
+ */
+typedef struct farmhash64_intern_shard_t
+{
+    pthread_mutex_t lock;                               /**< Lock of the index, arena and directory updates. */
+    farmhash64_intern_slot_t *slots;                    /**< Index. */
+    uint64_t mask;                                      /**< Number of index slots minus one. */
+    uint32_t count;                                     /**< Number of strings. */
+    farmhash64_intern_block_t *block;                   /**< Current arena block. */
+    const char **pages[FARMHASH64_INTERN_PAGES];        /**< Directory: string record of each id. */
+    uint64_t bytes;                                     /**< Arena bytes in use. */
+} __attribute__((aligned(64))) farmhash64_intern_shard_t;
+
+/**
+ * @brief Interning pool.
+ */
+typedef struct farmhash64_intern_pool_t
+{
+    farmhash64_intern_shard_t *shards; /**< FARMHASH64_INTERN_SHARDS shards. */
+} farmhash64_intern_pool_t;
+
+/**
+ * @brief Entry of a per-thread cache.
+ *
+ * @private
+ */
+typedef struct farmhash64_intern_cache_entry_t
+{
+    uint64_t hash;   /**< Hash of the cached string. */
+    const char *str; /**< Cached string bytes, in the pool arena. */
+    uint32_t handle; /**< Handle of the cached string (0 for an empty entry). */
+    uint32_t len;    /**< Length of the cached string. */
+} farmhash64_intern_cache_entry_t;
+
+/**
+ * @brief Per-thread front cache: 2-way set associative, most recent entry first.
+ *
+ * Must be used by one thread at a time, and only with one pool.
+ */
+typedef struct farmhash64_intern_cache_t
+{
+    farmhash64_intern_cache_entry_t entry[FARMHASH64_INTERN_CACHE_SIZE][2]; /**< Sets of two entries. */
+    uint64_t hits;                                                           /**< Lookups answered by the cache. */
+    uint64_t misses;                                                         /**< Lookups forwarded to the pool. */
+} farmhash64_intern_cache_t;
+
+/**
+ * @brief Initialize an empty pool.
+ *
+ * @param pool Pool
+ *
+ * @return 0 on success, -1 on memory allocation failure
+ *
+ * @public
+ */
+static inline int farmhash64_intern_init(farmhash64_intern_pool_t *pool)
+{
+    pool->shards = (farmhash64_intern_shard_t *)aligned_alloc(64, FARMHASH64_INTERN_SHARDS * sizeof(farmhash64_intern_shard_t));
+    if (pool->shards == NULL)
+    {
+        return -1;
+    }
+    memset(pool->shards, 0, FARMHASH64_INTERN_SHARDS * sizeof(farmhash64_intern_shard_t));
+    int i;
+    for (i = 0; i < FARMHASH64_INTERN_SHARDS; i++)
+    {
+        pthread_mutex_init(&pool->shards[i].lock, NULL);
+    }
+    return 0;
+}
+
+/**
+ * @brief Release all the memory of a pool. The handles and strings become invalid.
+ *
+ * No other thread may use the pool during or after this call.
+ *
+ * @param pool Pool
+ *
+ * @public
+ */
+static inline void farmhash64_intern_free(farmhash64_intern_pool_t *pool)
+{
+    if (pool->shards == NULL)
+    {
+        return;
+    }
+    int i;
+    int k;
+    for (i = 0; i < FARMHASH64_INTERN_SHARDS; i++)
+    {
+        farmhash64_intern_shard_t *sh = &pool->shards[i];
+        pthread_mutex_destroy(&sh->lock);
+        free(sh->slots);
+        for (k = 0; k < FARMHASH64_INTERN_PAGES; k++)
+        {
+            free((void *)sh->pages[k]);
+        }
+        while (sh->block != NULL)
+        {
+            farmhash64_intern_block_t *next = sh->block->next;
+            free(sh->block);
+            sh->block = next;
+        }
+    }
+    free(pool->shards);
+    pool->shards = NULL;
+}
+
+/**
+ * @brief Reset a per-thread cache.
+ *
+ * @param cache Cache
+ *
+ * @public
+ */
+static inline void farmhash64_intern_cache_init(farmhash64_intern_cache_t *cache)
+{
+    memset(cache, 0, sizeof(farmhash64_intern_cache_t));
+}
+
+/**
+ * @brief Directory entry of a 1-based string id (locked: the caller holds the shard lock).
+ *
+ * @private
+ */
+static inline const char **farmhash64_intern_entry(const farmhash64_intern_shard_t *sh, uint32_t id, int locked)
+{
+    uint64_t idx = (uint64_t)id - 1 + ((uint64_t)1 << FARMHASH64_INTERN_PAGE_BITS);
+    int top = 63 - __builtin_clzll(idx);
+    int k = top - FARMHASH64_INTERN_PAGE_BITS;
+    const char **page = locked ? sh->pages[k] : __atomic_load_n(&sh->pages[k], __ATOMIC_ACQUIRE);
+    return (page == NULL) ? NULL : &page[idx - ((uint64_t)1 << top)];
+}
+
+/**
+ * @brief Get the string of a handle. Lock-free.
+ *
+ * @param pool   Pool
+ * @param handle Handle returned by farmhash64_intern or farmhash64_intern_cached
+ * @param len    Output string length (can be NULL)
+ *
+ * @return NUL-terminated string, valid until the pool is released, or NULL for an invalid handle
+ *
+ * @public
+ */
+static inline const char *farmhash64_intern_str(const farmhash64_intern_pool_t *pool, uint32_t handle, size_t *len)
+{
+    const farmhash64_intern_shard_t *sh = &pool->shards[handle & (FARMHASH64_INTERN_SHARDS - 1)];
+    uint32_t id = handle >> FARMHASH64_INTERN_SHARD_BITS;
+    if ((id == 0) || (id > __atomic_load_n(&sh->count, __ATOMIC_ACQUIRE)))
+    {
+        return NULL;
+    }
+    const char **e = farmhash64_intern_entry(sh, id, 0);
+    if (e == NULL)
+    {
+        return NULL;
+    }
+    const char *rec = __atomic_load_n(e, __ATOMIC_ACQUIRE);
+    if (len != NULL)
+    {
+        uint32_t n;
+        memcpy(&n, rec, sizeof(n));
+        *len = n;
+    }
+    return rec + sizeof(uint32_t);
+}
+
+/**
+ * @brief Check whether the string record of an id matches the given bytes.
+ *
+ * @private
+ */
+static inline int farmhash64_intern_equal(const char *rec, const char *s, size_t len)
+{
+    uint32_t n;
+    memcpy(&n, rec, sizeof(n));
+    return (n == len) && (memcmp(rec + sizeof(uint32_t), s, len) == 0);
+}
+
+/**
+ * @brief Find a string in a locked shard.
+ *
+ * @return Slot holding the string, or the empty slot where it would be inserted
+ *
+ * @private
+ */
+static inline farmhash64_intern_slot_t *farmhash64_intern_probe(farmhash64_intern_shard_t *sh, uint64_t h, const char *s, size_t len)
+{
+    uint64_t j = h & sh->mask;
+    for (;;)
+    {
+        farmhash64_intern_slot_t *slot = &sh->slots[j];
+        if ((slot->id == 0) || ((slot->hash == h) && farmhash64_intern_equal(*farmhash64_intern_entry(sh, slot->id, 1), s, len)))
+        {
+            return slot;
+        }
+        j = (j + 1) & sh->mask;
+    }
+}
+
+/**
+ * @brief Grow the index of a locked shard.
+ *
+ * @private
+ */
+static inline int farmhash64_intern_grow(farmhash64_intern_shard_t *sh)
+{
+    uint64_t nslots = (sh->slots == NULL) ? 64 : (sh->mask + 1) * 2;
+    farmhash64_intern_slot_t *s = (farmhash64_intern_slot_t *)calloc((size_t)nslots, sizeof(farmhash64_intern_slot_t));
+    if (s == NULL)
+    {
+        return -1;
+    }
+    uint64_t i;
+    for (i = 0; (sh->slots != NULL) && (i <= sh->mask); i++)
+    {
+        if (sh->slots[i].id == 0)
+        {
+            continue;
+        }
+        uint64_t j = sh->slots[i].hash & (nslots - 1);
+        while (s[j].id != 0)
+        {
+            j = (j + 1) & (nslots - 1);
+        }
+        s[j] = sh->slots[i];
+    }
+    free(sh->slots);
+    sh->slots = s;
+    sh->mask = nslots - 1;
+    return 0;
+}
+
+/**
+ * @brief Copy a string in the arena of a locked shard and add it to the directory.
+ *
+ * @return New 1-based id, or 0 on failure
+ *
+ * @private
+ */
+static inline uint32_t farmhash64_intern_add(farmhash64_intern_shard_t *sh, const char *s, size_t len)
+{
+    uint32_t id = sh->count + 1;
+    if (id > FARMHASH64_INTERN_MAX_IDS)
+    {
+        return 0;
+    }
+    uint64_t idx = (uint64_t)id - 1 + ((uint64_t)1 << FARMHASH64_INTERN_PAGE_BITS);
+    int top = 63 - __builtin_clzll(idx);
+    int k = top - FARMHASH64_INTERN_PAGE_BITS;
+    if (sh->pages[k] == NULL)
+    {
+        const char **page = (const char **)calloc((size_t)1 << top, sizeof(const char *));
+        if (page == NULL)
+        {
+            return 0;
+        }
+        __atomic_store_n(&sh->pages[k], page, __ATOMIC_RELEASE);
+    }
+    // records are 4-byte aligned: length, bytes, NUL
+    size_t need = (sizeof(uint32_t) + len + 1 + 3) & ~(size_t)3;
+    farmhash64_intern_block_t *b = sh->block;
+    if ((b == NULL) || (b->size - b->used < need))
+    {
+        size_t size = (need > FARMHASH64_INTERN_BLOCK_SIZE / 4) ? need : FARMHASH64_INTERN_BLOCK_SIZE;
+        b = (farmhash64_intern_block_t *)malloc(sizeof(farmhash64_intern_block_t) + size);
+        if (b == NULL)
+        {
+            return 0;
+        }
+        b->used = 0;
+        b->size = size;
+        if ((need == size) && (sh->block != NULL))
+        {
+            // dedicated block for a long string: keep filling the current one
+            b->next = sh->block->next;
+            sh->block->next = b;
+        }
+        else
+        {
+            b->next = sh->block;
+            sh->block = b;
+        }
+    }
+    char *rec = (char *)(b + 1) + b->used;
+    uint32_t n = (uint32_t)len;
+    memcpy(rec, &n, sizeof(n));
+    memcpy(rec + sizeof(uint32_t), s, len);
+    rec[sizeof(uint32_t) + len] = 0;
+    b->used += need;
+    sh->bytes += need;
+    __atomic_store_n(farmhash64_intern_entry(sh, id, 1), rec, __ATOMIC_RELEASE);
+    __atomic_store_n(&sh->count, id, __ATOMIC_RELEASE);
+    return id;
+}
+
+/**
+ * @brief Intern a string with a precomputed farmhash64 hash.
+ *
+ * @private
+ */
+static inline uint32_t farmhash64_intern_hashed(farmhash64_intern_pool_t *pool, uint64_t h, const char *s, size_t len, int insert)
+{
+    uint32_t shard = (uint32_t)(h >> (64 - FARMHASH64_INTERN_SHARD_BITS));
+    farmhash64_intern_shard_t *sh = &pool->shards[shard];
+    uint32_t id = 0;
+    pthread_mutex_lock(&sh->lock);
+    if ((sh->slots == NULL) || (((uint64_t)sh->count + 1) * 2 > sh->mask + 1))
+    {
+        if (!insert || (farmhash64_intern_grow(sh) != 0))
+        {
+            insert = 0;
+        }
+    }
+    if (sh->slots != NULL)
+    {
+        farmhash64_intern_slot_t *slot = farmhash64_intern_probe(sh, h, s, len);
+        id = slot->id;
+        if ((id == 0) && insert)
+        {
+            id = farmhash64_intern_add(sh, s, len);
+            if (id != 0)
+            {
+                slot->hash = h;
+                slot->id = id;
+            }
+        }
+    }
+    pthread_mutex_unlock(&sh->lock);
+    return (id == 0) ? 0 : ((id << FARMHASH64_INTERN_SHARD_BITS) | shard);
+}
+
+/**
+ * @brief Intern a string: return the handle of an equal string already in the pool, or copy it in the pool.
+ *
+ * @param pool Pool
+ * @param s    String bytes (any bytes, NUL included)
+ * @param len  String length (less than 4 GiB)
+ *
+ * @return Handle (equal strings always get the same handle), or 0 on memory allocation failure
+ *
+ * @public
+ */
+static inline uint32_t farmhash64_intern(farmhash64_intern_pool_t *pool, const char *s, size_t len)
+{
+    if (len >= UINT32_MAX)
+    {
+        return 0;
+    }
+    return farmhash64_intern_hashed(pool, farmhash64(s, len), s, len, 1);
+}
+
+/**
+ * @brief Find the handle of a string without adding it to the pool.
+ *
+ * @param pool Pool
+ * @param s    String bytes
+ * @param len  String length
+ *
+ * @return Handle, or 0 if the string is not in the pool
+ *
+ * @public
+ */
+static inline uint32_t farmhash64_intern_find(farmhash64_intern_pool_t *pool, const char *s, size_t len)
+{
+    if (len >= UINT32_MAX)
+    {
+        return 0;
+    }
+    return farmhash64_intern_hashed(pool, farmhash64(s, len), s, len, 0);
+}
+
+/**
+ * @brief Intern a string through a per-thread cache.
+ *
+ * Frequent strings are resolved by the cache without locking; the string is hashed only once.
+ *
+ * @param pool  Pool
+ * @param cache Cache of the calling thread
+ * @param s     String bytes
+ * @param len   String length (less than 4 GiB)
+ *
+ * @return Handle, or 0 on memory allocation failure
+ *
+ * @public
+ */
+static inline uint32_t farmhash64_intern_cached(farmhash64_intern_pool_t *pool, farmhash64_intern_cache_t *cache, const char *s, size_t len)
+{
+    if (len >= UINT32_MAX)
+    {
+        return 0;
+    }
+    uint64_t h = farmhash64(s, len);
+    // the low bits select the cache set, the top bits the shard
+    farmhash64_intern_cache_entry_t *set = cache->entry[h & (FARMHASH64_INTERN_CACHE_SIZE - 1)];
+    int w;
+    for (w = 0; w < 2; w++)
+    {
+        farmhash64_intern_cache_entry_t e = set[w];
+        if ((e.hash != h) || (e.len != len) || (e.handle == 0))
+        {
+            continue;
+        }
+        if (memcmp(e.str, s, len) == 0)
+        {
+            if (w == 1)
+            {
+                set[1] = set[0];
+                set[0] = e;
+            }
+            cache->hits++;
+            return e.handle;
+        }
+    }
+    cache->misses++;
+    uint32_t handle = farmhash64_intern_hashed(pool, h, s, len, 1);
+    if (handle != 0)
+    {
+        set[1] = set[0];
+        set[0].hash = h;
+        set[0].str = farmhash64_intern_str(pool, handle, NULL);
+        set[0].handle = handle;
+        set[0].len = (uint32_t)len;
+    }
+    return handle;
+}
+
+/**
+ * @brief Number of strings in the pool.
+ *
+ * @param pool  Pool
+ * @param bytes Output arena bytes in use, headers and padding included (can be NULL)
+ *
+ * @return Number of distinct strings
+ *
+ * @public
+ */
+static inline uint64_t farmhash64_intern_count(farmhash64_intern_pool_t *pool, uint64_t *bytes)
+{
+    uint64_t n = 0;
+    uint64_t b = 0;
+    int i;
+    for (i = 0; i < FARMHASH64_INTERN_SHARDS; i++)
+    {
+        farmhash64_intern_shard_t *sh = &pool->shards[i];
+        pthread_mutex_lock(&sh->lock);
+        n += sh->count;
+        b += sh->bytes;
+        pthread_mutex_unlock(&sh->lock);
+    }
+    if (bytes != NULL)
+    {
+        *bytes = b;
+    }
+    return n;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // FARMHASH64_INTERN_H
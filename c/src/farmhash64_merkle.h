@@ -0,0 +1,583 @@
+/**
+ * @file farmhash64_merkle.h
+ * @brief Merkle trees of farmhash64 block fingerprints for incremental re-fingerprinting of large files.
+ *
+ * A file is split into fixed-size blocks: each leaf is the farmhash64 of a block,
+ * and each interior node combines its two children with farmhash_len_16_mul
+ * (a node without a right sibling is promoted unchanged).
+ * The root fingerprint also mixes in the file size.
+ *
+ * After an in-place write only the dirty leaves and their ancestors are recomputed,
+ * so refreshing the fingerprint costs O(dirty blocks + log n) instead of a full rehash.
+ * The leaves can be persisted in a compact sidecar file (8 bytes per block),
+ * and two trees can be compared top-down to find the byte ranges that differ (e.g. for delta sync).
+ *
+ * This is not a cryptographic Merkle tree: it detects accidental changes, not malicious ones.
+ * The file functions use the POSIX pread() interface.
+ */
+
+#ifndef FARMHASH64_MERKLE_H
+#define FARMHASH64_MERKLE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include "farmhash64.h"
+
+/**
+ * @brief Magic number at the beginning of a sidecar file ("FH64MRKL").
+ */
+#define FARMHASH64_MERKLE_MAGIC 0x4c4b524d34364846ULL
+
+/**
+ * @brief Format version of the sidecar file.
+ */
+#define FARMHASH64_MERKLE_VERSION 1
+
+/**
+ * @brief Maximum number of tree levels.
+ */
+#define FARMHASH64_MERKLE_MAX_LEVELS 64
+
+/**
+ * @brief Return codes.
+ */
+enum farmhash64_merkle_status_t
+{
+    FARMHASH64_MERKLE_OK = 0,            /**< Success. */
+    FARMHASH64_MERKLE_ERR_ARGS = -1,     /**< Invalid arguments. */
+    FARMHASH64_MERKLE_ERR_MEMORY = -2,   /**< Memory allocation failure. */
+    FARMHASH64_MERKLE_ERR_IO = -3,       /**< Read or write error. */
+    FARMHASH64_MERKLE_ERR_FORMAT = -4,   /**< Invalid or corrupted sidecar file. */
+    FARMHASH64_MERKLE_ERR_MISMATCH = -5, /**< Trees with different block sizes. */
+};
+
+/**
+ * @brief Merkle tree of a file.
+ */
+typedef struct farmhash64_merkle_t
+{
+    uint64_t block_size;                                  /**< Block size in bytes. */
+    uint64_t file_size;                                   /**< File size in bytes. */
+    uint64_t nleaves;                                     /**< Number of blocks. */
+    uint32_t nlevels;                                     /**< Number of levels (0 for an empty file). */
+    uint64_t level_offset[FARMHASH64_MERKLE_MAX_LEVELS];  /**< Index of the first node of each level (level 0 = leaves). */
+    uint64_t level_count[FARMHASH64_MERKLE_MAX_LEVELS];   /**< Number of nodes of each level. */
+    uint64_t *nodes;                                      /**< All the nodes, level by level. */
+} farmhash64_merkle_t;
+
+/**
+ * @brief Callback receiving a byte range that differs between two trees.
+ *
+ * @param offset Offset of the range
+ * @param len    Length of the range
+ * @param ctx    User context
+ */
+typedef void (*farmhash64_merkle_diff_cb)(uint64_t offset, uint64_t len, void *ctx);
+
+/**
+ * @brief Combine two child nodes.
+ *
+ * @private
+ */
+static inline uint64_t farmhash64_merkle_combine(uint64_t left, uint64_t right)
+{
+    return farmhash_len_16_mul(left, right, k2);
+}
+
+/**
+ * @brief Set up the level layout for a file size and allocate the nodes.
+ *
+ * The nodes that exist in both the old and the new layout are preserved.
+ *
+ * @private
+ */
+static inline int farmhash64_merkle_layout(farmhash64_merkle_t *tree, uint64_t file_size)
+{
+    uint64_t nleaves = (file_size + tree->block_size - 1) / tree->block_size;
+    uint64_t total = 0;
+    uint64_t count = nleaves;
+    uint32_t nlevels = 0;
+    uint64_t level_offset[FARMHASH64_MERKLE_MAX_LEVELS];
+    uint64_t level_count[FARMHASH64_MERKLE_MAX_LEVELS];
+    while (count > 0)
+    {
+        level_offset[nlevels] = total;
+        level_count[nlevels] = count;
+        total += count;
+        ++nlevels;
+        if (count == 1)
+        {
+            break;
+        }
+        count = (count + 1) / 2;
+    }
+    uint64_t *nodes = (uint64_t *)malloc((size_t)(total + 1) * sizeof(uint64_t));
+    if (nodes == NULL)
+    {
+        return FARMHASH64_MERKLE_ERR_MEMORY;
+    }
+    if (tree->nodes != NULL)
+    {
+        // preserve the nodes of each level that exist in both layouts
+        uint32_t l;
+        for (l = 0; (l < nlevels) && (l < tree->nlevels); l++)
+        {
+            uint64_t n = (tree->level_count[l] < level_count[l]) ? tree->level_count[l] : level_count[l];
+            memcpy(nodes + level_offset[l], tree->nodes + tree->level_offset[l], (size_t)n * sizeof(uint64_t));
+        }
+    }
+    free(tree->nodes);
+    tree->nodes = nodes;
+    tree->file_size = file_size;
+    tree->nleaves = nleaves;
+    tree->nlevels = nlevels;
+    memcpy(tree->level_offset, level_offset, nlevels * sizeof(uint64_t));
+    memcpy(tree->level_count, level_count, nlevels * sizeof(uint64_t));
+    return FARMHASH64_MERKLE_OK;
+}
+
+/**
+ * @brief Recompute the interior nodes above the leaves range [first, last].
+ *
+ * @private
+ */
+static inline void farmhash64_merkle_propagate(farmhash64_merkle_t *tree, uint64_t first, uint64_t last)
+{
+    uint32_t l;
+    for (l = 1; l < tree->nlevels; l++)
+    {
+        const uint64_t *child = tree->nodes + tree->level_offset[l - 1];
+        uint64_t nchild = tree->level_count[l - 1];
+        uint64_t *node = tree->nodes + tree->level_offset[l];
+        first >>= 1;
+        last >>= 1;
+        uint64_t i;
+        for (i = first; i <= last; i++)
+        {
+            uint64_t c = i * 2;
+            node[i] = (c + 1 < nchild) ? farmhash64_merkle_combine(child[c], child[c + 1]) : child[c];
+        }
+    }
+}
+
+/**
+ * @brief Read and hash the leaves range [first, last] from a file.
+ *
+ * @private
+ */
+static inline int farmhash64_merkle_hash_leaves(farmhash64_merkle_t *tree, int fd, uint64_t first, uint64_t last)
+{
+    char *buf = (char *)malloc((size_t)tree->block_size);
+    if (buf == NULL)
+    {
+        return FARMHASH64_MERKLE_ERR_MEMORY;
+    }
+    uint64_t i;
+    for (i = first; i <= last; i++)
+    {
+        uint64_t off = i * tree->block_size;
+        size_t len = (size_t)(((tree->file_size - off) < tree->block_size) ? (tree->file_size - off) : tree->block_size);
+        size_t done = 0;
+        while (done < len)
+        {
+            ssize_t r = pread(fd, buf + done, len - done, (off_t)(off + done));
+            if (r <= 0)
+            {
+                free(buf);
+                return FARMHASH64_MERKLE_ERR_IO;
+            }
+            done += (size_t)r;
+        }
+        tree->nodes[i] = farmhash64(buf, len);
+    }
+    free(buf);
+    return FARMHASH64_MERKLE_OK;
+}
+
+/**
+ * @brief Initialize an empty tree.
+ *
+ * @param tree       Tree
+ * @param block_size Block size in bytes (e.g. 65536)
+ *
+ * @return FARMHASH64_MERKLE_OK on success, or FARMHASH64_MERKLE_ERR_ARGS
+ *
+ * @public
+ */
+static inline int farmhash64_merkle_init(farmhash64_merkle_t *tree, uint64_t block_size)
+{
+    if ((tree == NULL) || (block_size == 0))
+    {
+        return FARMHASH64_MERKLE_ERR_ARGS;
+    }
+    memset(tree, 0, sizeof(*tree));
+    tree->block_size = block_size;
+    return FARMHASH64_MERKLE_OK;
+}
+
+/**
+ * @brief Release the memory of a tree.
+ *
+ * @param tree Tree
+ *
+ * @public
+ */
+static inline void farmhash64_merkle_free(farmhash64_merkle_t *tree)
+{
+    free(tree->nodes);
+    tree->nodes = NULL;
+    tree->nleaves = 0;
+    tree->nlevels = 0;
+    tree->file_size = 0;
+}
+
+/**
+ * @brief Build the tree of a whole file.
+ *
+ * @param tree      Initialized tree
+ * @param fd        File descriptor open for reading
+ * @param file_size File size in bytes
+ *
+ * @return FARMHASH64_MERKLE_OK on success, or a negative farmhash64_merkle_status_t error code
+ *
+ * @public
+ */
+static inline int farmhash64_merkle_build(farmhash64_merkle_t *tree, int fd, uint64_t file_size)
+{
+    int ret = farmhash64_merkle_layout(tree, file_size);
+    if ((ret != FARMHASH64_MERKLE_OK) || (tree->nleaves == 0))
+    {
+        return ret;
+    }
+    ret = farmhash64_merkle_hash_leaves(tree, fd, 0, tree->nleaves - 1);
+    if (ret == FARMHASH64_MERKLE_OK)
+    {
+        farmhash64_merkle_propagate(tree, 0, tree->nleaves - 1);
+    }
+    return ret;
+}
+
+/**
+ * @brief Update the tree after a write of len bytes at offset.
+ *
+ * Only the blocks touched by the write and their ancestors are recomputed.
+ * If the file size changed (e.g. an append or a truncation), the blocks
+ * from the old last block to the new end of the file are also rehashed.
+ *
+ * @param tree      Tree built from the previous file content
+ * @param fd        File descriptor open for reading
+ * @param file_size New file size in bytes
+ * @param offset    Offset of the write
+ * @param len       Length of the write
+ *
+ * @return FARMHASH64_MERKLE_OK on success, or a negative farmhash64_merkle_status_t error code
+ *
+ * @public
+ */
+static inline int farmhash64_merkle_update(farmhash64_merkle_t *tree, int fd, uint64_t file_size, uint64_t offset, uint64_t len)
+{
+    uint64_t old_leaves = tree->nleaves;
+    uint64_t old_size = tree->file_size;
+    int ret;
+    if ((file_size != old_size) || (tree->nodes == NULL))
+    {
+        ret = farmhash64_merkle_layout(tree, file_size);
+        if (ret != FARMHASH64_MERKLE_OK)
+        {
+            return ret;
+        }
+    }
+    if (tree->nleaves == 0)
+    {
+        return FARMHASH64_MERKLE_OK;
+    }
+    uint64_t first = tree->nleaves;
+    uint64_t last = 0;
+    if ((len > 0) && (offset < file_size))
+    {
+        first = offset / tree->block_size;
+        uint64_t end = ((offset + len) < file_size) ? (offset + len) : file_size;
+        last = (end - 1) / tree->block_size;
+    }
+    if (file_size != old_size)
+    {
+        uint64_t from = (old_leaves > 0) ? old_leaves - 1 : 0;
+        if (from > tree->nleaves - 1)
+        {
+            from = tree->nleaves - 1;
+        }
+        if (from < first)
+        {
+            first = from;
+        }
+        last = tree->nleaves - 1;
+    }
+    if (first > last)
+    {
+        return FARMHASH64_MERKLE_OK;
+    }
+    ret = farmhash64_merkle_hash_leaves(tree, fd, first, last);
+    if (ret == FARMHASH64_MERKLE_OK)
+    {
+        farmhash64_merkle_propagate(tree, first, last);
+    }
+    return ret;
+}
+
+/**
+ * @brief Return the root fingerprint of the tree, which also depends on the file size.
+ *
+ * @param tree Tree
+ *
+ * @return 64-bit fingerprint
+ *
+ * @public
+ */
+static inline uint64_t farmhash64_merkle_root(const farmhash64_merkle_t *tree)
+{
+    uint64_t top = (tree->nlevels > 0) ? tree->nodes[tree->level_offset[tree->nlevels - 1]] : 0;
+    return farmhash64_merkle_combine(top, tree->file_size + tree->block_size);
+}
+
+/**
+ * @brief Write the leaves of the tree to a sidecar file.
+ *
+ * Format (little-endian 64-bit words): magic, version, block size, file size,
+ * number of leaves, root fingerprint, then one word per leaf.
+ *
+ * @param tree Tree
+ * @param path Sidecar file path
+ *
+ * @return FARMHASH64_MERKLE_OK on success, or FARMHASH64_MERKLE_ERR_IO
+ *
+ * @public
+ */
+static inline int farmhash64_merkle_save(const farmhash64_merkle_t *tree, const char *path)
+{
+    FILE *f = fopen(path, "wb");
+    if (f == NULL)
+    {
+        return FARMHASH64_MERKLE_ERR_IO;
+    }
+    uint64_t hdr[6] =
+    {
+        FARMHASH64_MERKLE_MAGIC, FARMHASH64_MERKLE_VERSION, tree->block_size, tree->file_size, tree->nleaves, farmhash64_merkle_root(tree)
+    };
+    uint64_t buf[512];
+    size_t i;
+    int ret = FARMHASH64_MERKLE_OK;
+    for (i = 0; i < 6; i++)
+    {
+        hdr[i] = uint64_t_in_expected_order(hdr[i]);
+    }
+    if (fwrite(hdr, sizeof(hdr), 1, f) != 1)
+    {
+        ret = FARMHASH64_MERKLE_ERR_IO;
+    }
+    uint64_t pos = 0;
+    while ((ret == FARMHASH64_MERKLE_OK) && (pos < tree->nleaves))
+    {
+        size_t n = (size_t)(((tree->nleaves - pos) < 512) ? (tree->nleaves - pos) : 512);
+        for (i = 0; i < n; i++)
+        {
+            buf[i] = uint64_t_in_expected_order(tree->nodes[pos + i]);
+        }
+        if (fwrite(buf, sizeof(uint64_t), n, f) != n)
+        {
+            ret = FARMHASH64_MERKLE_ERR_IO;
+        }
+        pos += n;
+    }
+    if (fclose(f) != 0)
+    {
+        ret = FARMHASH64_MERKLE_ERR_IO;
+    }
+    return ret;
+}
+
+/**
+ * @brief Load a tree from a sidecar file and rebuild its interior nodes.
+ *
+ * @param tree Tree (its previous content is released)
+ * @param path Sidecar file path
+ *
+ * @return FARMHASH64_MERKLE_OK on success, or a negative farmhash64_merkle_status_t error code
+ *
+ * @public
+ */
+static inline int farmhash64_merkle_load(farmhash64_merkle_t *tree, const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        return FARMHASH64_MERKLE_ERR_IO;
+    }
+    uint64_t hdr[6];
+    size_t i;
+    int ret = FARMHASH64_MERKLE_OK;
+    if (fread(hdr, sizeof(hdr), 1, f) != 1)
+    {
+        fclose(f);
+        return FARMHASH64_MERKLE_ERR_FORMAT;
+    }
+    for (i = 0; i < 6; i++)
+    {
+        hdr[i] = uint64_t_in_expected_order(hdr[i]);
+    }
+    if ((hdr[0] != FARMHASH64_MERKLE_MAGIC) || (hdr[1] != FARMHASH64_MERKLE_VERSION) || (hdr[2] == 0)
+            || (hdr[4] != (hdr[3] + hdr[2] - 1) / hdr[2]))
+    {
+        fclose(f);
+        return FARMHASH64_MERKLE_ERR_FORMAT;
+    }
+    farmhash64_merkle_free(tree);
+    tree->block_size = hdr[2];
+    ret = farmhash64_merkle_layout(tree, hdr[3]);
+    if (ret == FARMHASH64_MERKLE_OK)
+    {
+        if (fread(tree->nodes, sizeof(uint64_t), (size_t)tree->nleaves, f) != (size_t)tree->nleaves)
+        {
+            ret = FARMHASH64_MERKLE_ERR_FORMAT;
+        }
+        else
+        {
+            uint64_t j;
+            for (j = 0; j < tree->nleaves; j++)
+            {
+                tree->nodes[j] = uint64_t_in_expected_order(tree->nodes[j]);
+            }
+            if (tree->nleaves > 0)
+            {
+                farmhash64_merkle_propagate(tree, 0, tree->nleaves - 1);
+            }
+            if (farmhash64_merkle_root(tree) != hdr[5])
+            {
+                ret = FARMHASH64_MERKLE_ERR_FORMAT;
+            }
+        }
+    }
+    fclose(f);
+    if (ret != FARMHASH64_MERKLE_OK)
+    {
+        farmhash64_merkle_free(tree);
+    }
+    return ret;
+}
+
+/**
+ * @brief State of a tree comparison.
+ *
+ * @private
+ */
+typedef struct farmhash64_merkle_diff_t
+{
+    const farmhash64_merkle_t *a; /**< First tree. */
+    const farmhash64_merkle_t *b; /**< Second tree. */
+    farmhash64_merkle_diff_cb cb; /**< Callback. */
+    void *ctx;                    /**< Callback context. */
+    uint64_t run_first;           /**< First leaf of the pending range of different leaves. */
+    uint64_t run_end;             /**< End of the pending range. */
+    uint64_t ndiff;               /**< Number of different leaves. */
+} farmhash64_merkle_diff_t;
+
+/**
+ * @brief Report a different leaf, merging consecutive leaves into a single range.
+ *
+ * @private
+ */
+static inline void farmhash64_merkle_diff_leaf(farmhash64_merkle_diff_t *d, uint64_t leaf)
+{
+    d->ndiff++;
+    if ((d->run_end == leaf) && (d->run_end > d->run_first))
+    {
+        d->run_end++;
+        return;
+    }
+    if (d->run_end > d->run_first)
+    {
+        d->cb(d->run_first * d->a->block_size, (d->run_end - d->run_first) * d->a->block_size, d->ctx);
+    }
+    d->run_first = leaf;
+    d->run_end = leaf + 1;
+}
+
+/**
+ * @brief Compare the node (level, index) of two trees and descend where they differ.
+ *
+ * @private
+ */
+static inline void farmhash64_merkle_diff_node(farmhash64_merkle_diff_t *d, uint32_t level, uint64_t index)
+{
+    uint64_t first = index << level;
+    uint64_t end_a = ((index + 1) << level);
+    uint64_t end_b = end_a;
+    if (end_a > d->a->nleaves)
+    {
+        end_a = d->a->nleaves;
+    }
+    if (end_b > d->b->nleaves)
+    {
+        end_b = d->b->nleaves;
+    }
+    if ((first >= end_a) && (first >= end_b))
+    {
+        return;
+    }
+    if ((end_a == end_b) && (level < d->a->nlevels) && (level < d->b->nlevels)
+            && (d->a->nodes[d->a->level_offset[level] + index] == d->b->nodes[d->b->level_offset[level] + index]))
+    {
+        return;
+    }
+    if (level == 0)
+    {
+        farmhash64_merkle_diff_leaf(d, index);
+        return;
+    }
+    farmhash64_merkle_diff_node(d, level - 1, index * 2);
+    farmhash64_merkle_diff_node(d, level - 1, (index * 2) + 1);
+}
+
+/**
+ * @brief Find the byte ranges that differ between two trees with the same block size.
+ *
+ * Equal subtrees are skipped, so the cost is O(d log n) for d different blocks.
+ * The reported ranges are block-aligned and may extend past the end of the smaller file.
+ *
+ * @param a   First tree
+ * @param b   Second tree
+ * @param cb  Callback receiving each range of different blocks, in increasing offset order
+ * @param ctx User context passed to the callback
+ *
+ * @return Number of different blocks, or FARMHASH64_MERKLE_ERR_MISMATCH
+ *
+ * @public
+ */
+static inline int64_t farmhash64_merkle_diff(const farmhash64_merkle_t *a, const farmhash64_merkle_t *b, farmhash64_merkle_diff_cb cb, void *ctx)
+{
+    if (a->block_size != b->block_size)
+    {
+        return FARMHASH64_MERKLE_ERR_MISMATCH;
+    }
+    farmhash64_merkle_diff_t d = {a, b, cb, ctx, 0, 0, 0};
+    uint32_t top = (a->nlevels > b->nlevels) ? a->nlevels : b->nlevels;
+    if (top > 0)
+    {
+        farmhash64_merkle_diff_node(&d, top - 1, 0);
+    }
+    if (d.run_end > d.run_first)
+    {
+        cb(d.run_first * a->block_size, (d.run_end - d.run_first) * a->block_size, ctx);
+    }
+    return (int64_t)d.ndiff;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // FARMHASH64_MERKLE_H
@@ -0,0 +1,513 @@
+/**
+ * @file farmhash64_mphf.h
+ * @brief Minimal perfect hash functions for static key sets, driven by seeded farmhash64.
+ *
+ * This is a BBHash-style construction (Limasset et al., "Fast and scalable minimal perfect hashing for massive key sets").
+ * Each level is a bit array of gamma * (remaining keys) bits:
+ * keys that land on a bit alone are placed on that level, colliding keys move to the next level.
+ * The index of a key is the rank of its bit over all the levels.
+ *
+ * Keys are hashed once with farmhash64; the hash used on level i is farmhash64_reseed(h, i, seed),
+ * which is equal to farmhash64_with_seeds(key, len, i, seed).
+ *
+ * The builder produces a single self-contained image (header, bit arrays and rank samples)
+ * that can be written to a file and later used directly from an mmap'ed region, with no parsing.
+ * The image uses the native byte order and a 64-byte aligned layout.
+ * With gamma = 1 the image takes about 3.1 bits per key, rank samples included;
+ * larger gamma values use more space but place more keys on the first levels, reducing the lookup cost.
+ */
+
+#ifndef FARMHASH64_MPHF_H
+#define FARMHASH64_MPHF_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include "farmhash64.h"
+
+/**
+ * @brief Magic number at the beginning of an image ("FH64MPHF").
+ */
+#define FARMHASH64_MPHF_MAGIC 0x4648504d34364846ULL
+
+/**
+ * @brief Format version of the image.
+ */
+#define FARMHASH64_MPHF_VERSION 1
+
+/**
+ * @brief Maximum number of levels.
+ */
+#define FARMHASH64_MPHF_MAX_LEVELS 48
+
+/**
+ * @brief Maximum number of builder threads.
+ */
+#define FARMHASH64_MPHF_MAX_THREADS 256
+
+/**
+ * @brief Value returned by the lookup functions for keys that are not in the set.
+ *
+ * Keys that are not in the set may also return a valid-looking index.
+ */
+#define FARMHASH64_MPHF_NOT_FOUND UINT64_MAX
+
+/**
+ * @brief Return codes.
+ */
+enum farmhash64_mphf_status_t
+{
+    FARMHASH64_MPHF_OK = 0,             /**< Success. */
+    FARMHASH64_MPHF_ERR_ARGS = -1,      /**< Invalid arguments. */
+    FARMHASH64_MPHF_ERR_MEMORY = -2,    /**< Memory allocation failure. */
+    FARMHASH64_MPHF_ERR_DUPLICATE = -3, /**< Keys with the same hash value, or too many levels. */
+    FARMHASH64_MPHF_ERR_THREAD = -4,    /**< Unable to create a thread. */
+    FARMHASH64_MPHF_ERR_IMAGE = -5,     /**< Invalid or truncated image. */
+};
+
+/**
+ * @brief Image header.
+ */
+typedef struct farmhash64_mphf_header_t
+{
+    uint64_t magic;                                     /**< FARMHASH64_MPHF_MAGIC. */
+    uint32_t version;                                   /**< FARMHASH64_MPHF_VERSION. */
+    uint32_t nlevels;                                   /**< Number of levels. */
+    uint64_t nkeys;                                     /**< Number of keys. */
+    uint64_t seed;                                      /**< Hash seed. */
+    uint64_t nwords;                                    /**< Total number of 64-bit words in the bit arrays. */
+    uint64_t image_size;                                /**< Total image size in bytes. */
+    uint64_t level_offset[FARMHASH64_MPHF_MAX_LEVELS];  /**< First word of each level. */
+    uint64_t level_words[FARMHASH64_MPHF_MAX_LEVELS];   /**< Number of words of each level. */
+    uint64_t reserved[2];                               /**< Padding to a multiple of 64 bytes. */
+} farmhash64_mphf_header_t;
+
+/**
+ * @brief Minimal perfect hash function loaded from an image.
+ */
+typedef struct farmhash64_mphf_t
+{
+    const farmhash64_mphf_header_t *hdr; /**< Image header. */
+    const uint64_t *bits;                /**< Level bit arrays. */
+    const uint64_t *ranks;               /**< Number of set bits before each 512-bit block. */
+} farmhash64_mphf_t;
+
+/**
+ * @brief Count the set bits of a 64-bit word.
+ *
+ * @param x Word
+ *
+ * @return Number of set bits
+ *
+ * @private
+ */
+static inline uint64_t farmhash64_mphf_popcount(uint64_t x)
+{
+#if defined(__GNUC__)
+    return (uint64_t)__builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (x * 0x0101010101010101ULL) >> 56;
+#endif
+}
+
+/**
+ * @brief Map a 64-bit hash to the range [0, n) without a division.
+ *
+ * @param h Hash value
+ * @param n Range size
+ *
+ * @return Value in [0, n)
+ *
+ * @private
+ */
+static inline uint64_t farmhash64_mphf_range(uint64_t h, uint64_t n)
+{
+#if defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 farmhash64_mphf_u128;
+    return (uint64_t)(((farmhash64_mphf_u128)h * n) >> 64);
+#else
+    uint64_t hl = h & 0xffffffff;
+    uint64_t hh = h >> 32;
+    uint64_t nl = n & 0xffffffff;
+    uint64_t nh = n >> 32;
+    uint64_t hi_lo = hh * nl;
+    uint64_t cross = ((hl * nl) >> 32) + (hi_lo & 0xffffffff) + (hl * nh);
+    return (hh * nh) + (hi_lo >> 32) + (cross >> 32);
+#endif
+}
+
+/**
+ * @brief Bit position of a key hash on a level.
+ *
+ * @param h     farmhash64 value of the key
+ * @param level Level number
+ * @param seed  Hash seed
+ * @param nbits Number of bits of the level
+ *
+ * @return Bit position in [0, nbits)
+ *
+ * @private
+ */
+static inline uint64_t farmhash64_mphf_pos(uint64_t h, uint32_t level, uint64_t seed, uint64_t nbits)
+{
+    return farmhash64_mphf_range(farmhash64_reseed(h, level, seed), nbits);
+}
+
+/**
+ * @brief Size of the image header rounded to 64 bytes.
+ *
+ * @private
+ */
+#define FARMHASH64_MPHF_HEADER_SIZE ((sizeof(farmhash64_mphf_header_t) + 63) & ~(size_t)63)
+
+/**
+ * @brief Per-thread state of a builder pass.
+ *
+ * @private
+ */
+typedef struct farmhash64_mphf_task_t
+{
+    uint64_t *keys;     /**< Remaining key hashes. */
+    size_t start;       /**< First key of the slice. */
+    size_t end;         /**< End of the slice. */
+    size_t kept;        /**< Number of keys moved to the next level. */
+    uint64_t *bits;     /**< Level bits. */
+    uint64_t *coll;     /**< Level collision bits. */
+    uint64_t nbits;     /**< Number of bits of the level. */
+    uint64_t seed;      /**< Hash seed. */
+    uint32_t level;     /**< Level number. */
+} farmhash64_mphf_task_t;
+
+/**
+ * @brief First pass: mark the positions of the keys and the collisions.
+ *
+ * @private
+ */
+static inline void *farmhash64_mphf_mark(void *arg)
+{
+    farmhash64_mphf_task_t *t = (farmhash64_mphf_task_t *)arg;
+    size_t i;
+    for (i = t->start; i < t->end; i++)
+    {
+        uint64_t p = farmhash64_mphf_pos(t->keys[i], t->level, t->seed, t->nbits);
+        uint64_t bit = 1ULL << (p & 63);
+        uint64_t old = __atomic_fetch_or(&t->bits[p >> 6], bit, __ATOMIC_RELAXED);
+        if ((old & bit) != 0)
+        {
+            __atomic_fetch_or(&t->coll[p >> 6], bit, __ATOMIC_RELAXED);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Second pass: compact the colliding keys at the beginning of the slice.
+ *
+ * @private
+ */
+static inline void *farmhash64_mphf_filter(void *arg)
+{
+    farmhash64_mphf_task_t *t = (farmhash64_mphf_task_t *)arg;
+    size_t i;
+    size_t j = t->start;
+    for (i = t->start; i < t->end; i++)
+    {
+        uint64_t p = farmhash64_mphf_pos(t->keys[i], t->level, t->seed, t->nbits);
+        if ((t->coll[p >> 6] >> (p & 63)) & 1)
+        {
+            t->keys[j++] = t->keys[i];
+        }
+    }
+    t->kept = j - t->start;
+    return NULL;
+}
+
+/**
+ * @brief Run a builder pass on all the slices.
+ *
+ * @private
+ */
+static inline int farmhash64_mphf_run(void *(*fn)(void *), farmhash64_mphf_task_t *tasks, unsigned nthreads)
+{
+    pthread_t tid[FARMHASH64_MPHF_MAX_THREADS];
+    unsigned i;
+    unsigned started = 0;
+    int ret = FARMHASH64_MPHF_OK;
+    for (i = 1; i < nthreads; i++)
+    {
+        if (pthread_create(&tid[i], NULL, fn, &tasks[i]) != 0)
+        {
+            ret = FARMHASH64_MPHF_ERR_THREAD;
+            break;
+        }
+        started = i;
+    }
+    if (ret != FARMHASH64_MPHF_OK)
+    {
+        // run the slices that did not get a thread in the current one
+        for (; i < nthreads; i++)
+        {
+            fn(&tasks[i]);
+        }
+        ret = FARMHASH64_MPHF_OK;
+    }
+    fn(&tasks[0]);
+    for (i = 1; i <= started; i++)
+    {
+        pthread_join(tid[i], NULL);
+    }
+    return ret;
+}
+
+/**
+ * @brief Build a minimal perfect hash function image.
+ *
+ * The keys are passed as their farmhash64 values, which must be distinct.
+ * On success *image points to a 64-byte aligned buffer of *image_size bytes
+ * that must be released with free().
+ *
+ * @param hashes     farmhash64 values of the keys
+ * @param nkeys      Number of keys
+ * @param gamma      Bits per key on each level (>= 1.0; 1.0 gives the smallest image)
+ * @param seed       Hash seed
+ * @param nthreads   Number of builder threads (1 to FARMHASH64_MPHF_MAX_THREADS)
+ * @param image      Output image
+ * @param image_size Output image size in bytes
+ *
+ * @return FARMHASH64_MPHF_OK on success, or a negative farmhash64_mphf_status_t error code
+ *
+ * @public
+ */
+static inline int farmhash64_mphf_build(const uint64_t *hashes, size_t nkeys, double gamma, uint64_t seed, unsigned nthreads, void **image, size_t *image_size)
+{
+    if ((image == NULL) || (image_size == NULL) || ((hashes == NULL) && (nkeys > 0)) || (gamma < 1.0) || (nthreads < 1) || (nthreads > FARMHASH64_MPHF_MAX_THREADS))
+    {
+        return FARMHASH64_MPHF_ERR_ARGS;
+    }
+    farmhash64_mphf_header_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = FARMHASH64_MPHF_MAGIC;
+    hdr.version = FARMHASH64_MPHF_VERSION;
+    hdr.nkeys = nkeys;
+    hdr.seed = seed;
+    uint64_t *keys = (uint64_t *)malloc((nkeys + 1) * sizeof(uint64_t));
+    uint64_t *bits = NULL;
+    size_t cap = 0;
+    farmhash64_mphf_task_t tasks[FARMHASH64_MPHF_MAX_THREADS];
+    int ret = FARMHASH64_MPHF_OK;
+    if (keys == NULL)
+    {
+        return FARMHASH64_MPHF_ERR_MEMORY;
+    }
+    if (nkeys > 0)
+    {
+        memcpy(keys, hashes, nkeys * sizeof(uint64_t));
+    }
+    size_t remaining = nkeys;
+    uint32_t level = 0;
+    while (remaining > 0)
+    {
+        if (level >= FARMHASH64_MPHF_MAX_LEVELS)
+        {
+            ret = FARMHASH64_MPHF_ERR_DUPLICATE;
+            break;
+        }
+        uint64_t nwords = (uint64_t)((gamma * (double)remaining + 63.0) / 64.0);
+        if (nwords == 0)
+        {
+            nwords = 1;
+        }
+        if (hdr.nwords + nwords > cap)
+        {
+            size_t ncap = (cap == 0) ? (size_t)(nwords * 2) : cap * 2;
+            if (ncap < hdr.nwords + nwords)
+            {
+                ncap = hdr.nwords + nwords;
+            }
+            uint64_t *nbits = (uint64_t *)realloc(bits, 2 * ncap * sizeof(uint64_t));
+            if (nbits == NULL)
+            {
+                ret = FARMHASH64_MPHF_ERR_MEMORY;
+                break;
+            }
+            bits = nbits;
+            cap = ncap;
+        }
+        // the collision bits are stored after the level bits as scratch space
+        uint64_t *lbits = bits + hdr.nwords;
+        uint64_t *coll = lbits + nwords;
+        memset(lbits, 0, 2 * nwords * sizeof(uint64_t));
+        unsigned nt = nthreads;
+        if (remaining < (size_t)nt * 1024)
+        {
+            nt = 1;
+        }
+        unsigned t;
+        for (t = 0; t < nt; t++)
+        {
+            tasks[t].keys = keys;
+            tasks[t].start = remaining * t / nt;
+            tasks[t].end = remaining * (t + 1) / nt;
+            tasks[t].kept = 0;
+            tasks[t].bits = lbits;
+            tasks[t].coll = coll;
+            tasks[t].nbits = nwords * 64;
+            tasks[t].seed = seed;
+            tasks[t].level = level;
+        }
+        ret = farmhash64_mphf_run(farmhash64_mphf_mark, tasks, nt);
+        if (ret == FARMHASH64_MPHF_OK)
+        {
+            ret = farmhash64_mphf_run(farmhash64_mphf_filter, tasks, nt);
+        }
+        if (ret != FARMHASH64_MPHF_OK)
+        {
+            break;
+        }
+        uint64_t w;
+        for (w = 0; w < nwords; w++)
+        {
+            lbits[w] &= ~coll[w];
+        }
+        size_t next = 0;
+        for (t = 0; t < nt; t++)
+        {
+            memmove(keys + next, keys + tasks[t].start, tasks[t].kept * sizeof(uint64_t));
+            next += tasks[t].kept;
+        }
+        hdr.level_offset[level] = hdr.nwords;
+        hdr.level_words[level] = nwords;
+        hdr.nwords += nwords;
+        remaining = next;
+        ++level;
+    }
+    free(keys);
+    if (ret != FARMHASH64_MPHF_OK)
+    {
+        free(bits);
+        return ret;
+    }
+    hdr.nlevels = level;
+    size_t nranks = (size_t)((hdr.nwords + 7) / 8) + 1;
+    size_t size = FARMHASH64_MPHF_HEADER_SIZE + (((size_t)hdr.nwords + nranks) * sizeof(uint64_t));
+    size = (size + 63) & ~(size_t)63;
+    hdr.image_size = size;
+    void *img = aligned_alloc(64, size);
+    if (img == NULL)
+    {
+        free(bits);
+        return FARMHASH64_MPHF_ERR_MEMORY;
+    }
+    memset(img, 0, size);
+    memcpy(img, &hdr, sizeof(hdr));
+    uint64_t *obits = (uint64_t *)(void *)((char *)img + FARMHASH64_MPHF_HEADER_SIZE);
+    uint64_t *oranks = obits + hdr.nwords;
+    if (hdr.nwords > 0)
+    {
+        memcpy(obits, bits, (size_t)hdr.nwords * sizeof(uint64_t));
+    }
+    free(bits);
+    uint64_t cnt = 0;
+    size_t w;
+    for (w = 0; w < (size_t)hdr.nwords; w++)
+    {
+        if ((w & 7) == 0)
+        {
+            oranks[w >> 3] = cnt;
+        }
+        cnt += farmhash64_mphf_popcount(obits[w]);
+    }
+    oranks[nranks - 1] = cnt;
+    *image = img;
+    *image_size = size;
+    return FARMHASH64_MPHF_OK;
+}
+
+/**
+ * @brief Use an image created by farmhash64_mphf_build.
+ *
+ * The image is not copied: it must stay valid (e.g. mapped) while the function is in use.
+ *
+ * @param mphf  Function to initialize
+ * @param image Image (64-bit aligned)
+ * @param size  Image size in bytes
+ *
+ * @return FARMHASH64_MPHF_OK on success, or FARMHASH64_MPHF_ERR_IMAGE
+ *
+ * @public
+ */
+static inline int farmhash64_mphf_load(farmhash64_mphf_t *mphf, const void *image, size_t size)
+{
+    const farmhash64_mphf_header_t *hdr = (const farmhash64_mphf_header_t *)image;
+    if ((image == NULL) || (size < FARMHASH64_MPHF_HEADER_SIZE)
+            || (hdr->magic != FARMHASH64_MPHF_MAGIC) || (hdr->version != FARMHASH64_MPHF_VERSION)
+            || (hdr->image_size > size) || (hdr->nlevels > FARMHASH64_MPHF_MAX_LEVELS)
+            || (hdr->image_size < FARMHASH64_MPHF_HEADER_SIZE + ((hdr->nwords + ((hdr->nwords + 7) / 8) + 1) * sizeof(uint64_t))))
+    {
+        return FARMHASH64_MPHF_ERR_IMAGE;
+    }
+    mphf->hdr = hdr;
+    mphf->bits = (const uint64_t *)(const void *)((const char *)image + FARMHASH64_MPHF_HEADER_SIZE);
+    mphf->ranks = mphf->bits + hdr->nwords;
+    return FARMHASH64_MPHF_OK;
+}
+
+/**
+ * @brief Return the index of a key from its farmhash64 value.
+ *
+ * @param mphf Minimal perfect hash function
+ * @param h    farmhash64 value of the key
+ *
+ * @return Index in [0, nkeys) for keys in the set, an arbitrary index or FARMHASH64_MPHF_NOT_FOUND otherwise
+ *
+ * @public
+ */
+static inline uint64_t farmhash64_mphf_lookup_hash(const farmhash64_mphf_t *mphf, uint64_t h)
+{
+    const farmhash64_mphf_header_t *hdr = mphf->hdr;
+    uint32_t level;
+    for (level = 0; level < hdr->nlevels; level++)
+    {
+        uint64_t p = farmhash64_mphf_pos(h, level, hdr->seed, hdr->level_words[level] * 64);
+        uint64_t w = hdr->level_offset[level] + (p >> 6);
+        uint64_t word = mphf->bits[w];
+        if ((word >> (p & 63)) & 1)
+        {
+            uint64_t rank = mphf->ranks[w >> 3];
+            uint64_t i;
+            for (i = w & ~(uint64_t)7; i < w; i++)
+            {
+                rank += farmhash64_mphf_popcount(mphf->bits[i]);
+            }
+            return rank + farmhash64_mphf_popcount(word & ((1ULL << (p & 63)) - 1));
+        }
+    }
+    return FARMHASH64_MPHF_NOT_FOUND;
+}
+
+/**
+ * @brief Return the index of a key.
+ *
+ * @param mphf Minimal perfect hash function
+ * @param s    Key
+ * @param len  Key length
+ *
+ * @return Index in [0, nkeys) for keys in the set, an arbitrary index or FARMHASH64_MPHF_NOT_FOUND otherwise
+ *
+ * @public
+ */
+static inline uint64_t farmhash64_mphf_lookup(const farmhash64_mphf_t *mphf, const char *s, size_t len)
+{
+    return farmhash64_mphf_lookup_hash(mphf, farmhash64(s, len));
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // FARMHASH64_MPHF_H
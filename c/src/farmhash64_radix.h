@@ -0,0 +1,627 @@
+/**
+ * @file farmhash64_radix.h
+ * @brief Radix-partitioned parallel hash aggregation of 64-bit key columns, driven by farmhash64.
+ *
+ * Instead of sharing one large hash table between all the threads, which does not fit in the caches
+ * and makes the cores fight over the same cache lines, the rows are processed in two phases:
+ *
+ * - Partition: each thread hashes a slice of the key column with farmhash64 and scatters the rows
+ *   in 2^bits partitions selected by the top bits of the hash.
+ *   The rows are staged in per-thread software write-combining buffers (one block of
+ *   FARMHASH64_RADIX_SWWC_TUPLES rows per partition, cache line aligned). A row goes to the buffer
+ *   slot of its destination index modulo FARMHASH64_RADIX_SWWC_TUPLES, and the buffer is copied
+ *   to the partition when the destination reaches a block boundary: the output is 64-byte aligned and
+ *   a block is 3 cache lines, so every copy but the first and last one of each partition slice writes
+ *   whole, aligned cache lines, and the number of open write streams does not depend on the number of partitions.
+ *   The hash is stored with each row, so the following phases never hash a key again.
+ * - Build: the partitions are handed out to the threads one at a time and each one is aggregated
+ *   in a private open addressing table, small enough to stay in the L2 cache of its core
+ *   when the number of partition bits is large enough (see farmhash64_radix_bits).
+ *
+ * The partition phase is also available on its own (farmhash64_radix_partition),
+ * for example to partition both sides of a hash join with the same number of bits.
+ */
+
+#ifndef FARMHASH64_RADIX_H
+#define FARMHASH64_RADIX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include "farmhash64.h"
+
+/**
+ * @brief Maximum number of partition bits.
+ *
+ * Each thread uses FARMHASH64_RADIX_SWWC_TUPLES * sizeof(farmhash64_radix_tuple_t) * 2^bits bytes
+ * of write-combining buffers (12 KiB for 6 bits, 192 KiB for 10 bits).
+ */
+#define FARMHASH64_RADIX_MAX_BITS 16
+
+/**
+ * @brief Maximum number of threads.
+ */
+#define FARMHASH64_RADIX_MAX_THREADS 256
+
+/**
+ * @brief Number of rows in a write-combining buffer (8 rows = 3 cache lines).
+ */
+#define FARMHASH64_RADIX_SWWC_TUPLES 8
+
+/**
+ * @brief Maximum initial number of slots of a partition table (256 KiB, grown on demand).
+ *
+ * @private
+ */
+#define FARMHASH64_RADIX_TABLE_SLOTS 8192
+
+/**
+ * @brief Return codes.
+ */
+enum farmhash64_radix_status_t
+{
+    FARMHASH64_RADIX_OK = 0,           /**< Success. */
+    FARMHASH64_RADIX_ERR_ARGS = -1,    /**< Invalid arguments. */
+    FARMHASH64_RADIX_ERR_MEMORY = -2,  /**< Memory allocation failure. */
+};
+
+/**
+ * @brief Partitioned row.
+ */
+typedef struct farmhash64_radix_tuple_t
+{
+    uint64_t hash;  /**< farmhash64 of the key. */
+    uint64_t key;   /**< Key. */
+    uint64_t value; /**< Value (0 when no value column is given). */
+} farmhash64_radix_tuple_t;
+
+/**
+ * @brief Rows grouped by partition.
+ */
+typedef struct farmhash64_radix_partitions_t
+{
+    farmhash64_radix_tuple_t *tuples; /**< Rows of partition p are tuples[offsets[p]] to tuples[offsets[p + 1] - 1]. */
+    uint64_t *offsets;                /**< 2^bits + 1 partition offsets. */
+    uint32_t bits;                    /**< Number of partition bits. */
+    size_t nrows;                     /**< Number of rows. */
+} farmhash64_radix_partitions_t;
+
+/**
+ * @brief Aggregated group.
+ */
+typedef struct farmhash64_radix_group_t
+{
+    uint64_t key;   /**< Key. */
+    uint64_t count; /**< Number of rows with this key. */
+    uint64_t sum;   /**< Wrapping sum of the values of the rows with this key. */
+} farmhash64_radix_group_t;
+
+/**
+ * @brief Result of an aggregation.
+ */
+typedef struct farmhash64_radix_result_t
+{
+    farmhash64_radix_group_t *groups; /**< Groups, ordered by partition (release with farmhash64_radix_result_free). */
+    size_t ngroups;                   /**< Number of groups. */
+} farmhash64_radix_result_t;
+
+/**
+ * @brief Slot of a partition table.
+ *
+ * @private
+ */
+typedef struct farmhash64_radix_slot_t
+{
+    uint64_t hash;  /**< Key hash. */
+    uint64_t key;   /**< Key. */
+    uint64_t count; /**< Number of rows (0 for an empty slot). */
+    uint64_t sum;   /**< Sum of the values. */
+} farmhash64_radix_slot_t;
+
+/**
+ * @brief Per-thread state of a partitioning or build pass.
+ *
+ * @private
+ */
+typedef struct farmhash64_radix_task_t
+{
+    const uint64_t *keys;              /**< Key column. */
+    const uint64_t *values;            /**< Value column (can be NULL). */
+    uint64_t *hashes;                  /**< Hashes of the rows (computed by the histogram pass). */
+    size_t start;                      /**< First row of the slice. */
+    size_t end;                        /**< End of the slice. */
+    uint32_t bits;                     /**< Number of partition bits. */
+    uint64_t *hist;                    /**< Rows per partition in the slice, then the next write position. */
+    farmhash64_radix_tuple_t *tuples;  /**< Partitioned rows. */
+    const uint64_t *offsets;           /**< Partition offsets (build pass). */
+    uint64_t *ngroups;                 /**< Groups per partition (build pass). */
+    uint64_t *next;                    /**< Next partition to build, shared by all the build tasks. */
+    int ret;                           /**< Status of the task. */
+} farmhash64_radix_task_t;
+
+/**
+ * @brief Hash a key.
+ *
+ * @param key Key
+ *
+ * @return farmhash64 of the key bytes
+ *
+ * @private
+ */
+static inline uint64_t farmhash64_radix_hash(uint64_t key)
+{
+    return farmhash64((const char *)&key, sizeof(key));
+}
+
+/**
+ * @brief Partition of a hash: its top bits.
+ *
+ * @private
+ */
+static inline size_t farmhash64_radix_part(uint64_t h, uint32_t bits)
+{
+    return (bits == 0) ? 0 : (size_t)(h >> (64 - bits));
+}
+
+/**
+ * @brief Suggest the number of partition bits.
+ *
+ * Returns the smallest number of bits that keeps the table of each partition within cache_bytes,
+ * assuming ngroups distinct keys, evenly distributed, and a table load of 50%.
+ *
+ * @param ngroups     Expected number of distinct keys (the number of rows is a safe upper bound)
+ * @param cache_bytes Per-core cache budget of a partition table, e.g. the L2 size
+ *
+ * @return Number of partition bits (up to FARMHASH64_RADIX_MAX_BITS)
+ *
+ * @public
+ */
+static inline uint32_t farmhash64_radix_bits(uint64_t ngroups, size_t cache_bytes)
+{
+    uint64_t slots = cache_bytes / (2 * sizeof(farmhash64_radix_slot_t));
+    uint32_t bits = 0;
+    while ((bits < FARMHASH64_RADIX_MAX_BITS) && ((ngroups >> bits) > slots))
+    {
+        ++bits;
+    }
+    return bits;
+}
+
+/**
+ * @brief Run a pass on all the tasks.
+ *
+ * @private
+ */
+static inline void farmhash64_radix_run(void *(*fn)(void *), farmhash64_radix_task_t *tasks, unsigned nthreads)
+{
+    pthread_t tid[FARMHASH64_RADIX_MAX_THREADS];
+    unsigned i;
+    unsigned started = 0;
+    for (i = 1; i < nthreads; i++)
+    {
+        if (pthread_create(&tid[i], NULL, fn, &tasks[i]) != 0)
+        {
+            break;
+        }
+        started = i;
+    }
+    // run the tasks that did not get a thread in the current one
+    for (; i < nthreads; i++)
+    {
+        fn(&tasks[i]);
+    }
+    fn(&tasks[0]);
+    for (i = 1; i <= started; i++)
+    {
+        pthread_join(tid[i], NULL);
+    }
+}
+
+/**
+ * @brief First partitioning pass: hash the keys of the slice and count the rows of each partition.
+ *
+ * @private
+ */
+static inline void *farmhash64_radix_histogram(void *arg)
+{
+    farmhash64_radix_task_t *t = (farmhash64_radix_task_t *)arg;
+    size_t i;
+    for (i = t->start; i < t->end; i++)
+    {
+        uint64_t h = farmhash64_radix_hash(t->keys[i]);
+        t->hashes[i] = h;
+        t->hist[farmhash64_radix_part(h, t->bits)]++;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Second partitioning pass: scatter the rows of the slice through the write-combining buffers.
+ *
+ * On entry hist[p] is the position of the first row of the slice in partition p.
+ * Buffer slot k of partition p holds the row going to a position equal to k modulo
+ * FARMHASH64_RADIX_SWWC_TUPLES, so the full buffers are copied to block-aligned positions.
+ *
+ * @private
+ */
+static inline void *farmhash64_radix_scatter(void *arg)
+{
+    farmhash64_radix_task_t *t = (farmhash64_radix_task_t *)arg;
+    size_t nparts = (size_t)1 << t->bits;
+    farmhash64_radix_tuple_t *buf = (farmhash64_radix_tuple_t *)aligned_alloc(64, nparts * FARMHASH64_RADIX_SWWC_TUPLES * sizeof(farmhash64_radix_tuple_t));
+    uint8_t *fill = (uint8_t *)calloc(nparts, sizeof(uint8_t));
+    if ((buf == NULL) || (fill == NULL))
+    {
+        free(buf);
+        free(fill);
+        t->ret = FARMHASH64_RADIX_ERR_MEMORY;
+        return NULL;
+    }
+    size_t i;
+    for (i = t->start; i < t->end; i++)
+    {
+        uint64_t h = t->hashes[i];
+        size_t p = farmhash64_radix_part(h, t->bits);
+        farmhash64_radix_tuple_t *b = buf + (p * FARMHASH64_RADIX_SWWC_TUPLES);
+        uint64_t pos = t->hist[p]++;
+        size_t k = (size_t)(pos % FARMHASH64_RADIX_SWWC_TUPLES);
+        b[k].hash = h;
+        b[k].key = t->keys[i];
+        b[k].value = (t->values == NULL) ? 0 : t->values[i];
+        size_t f = (size_t)fill[p] + 1;
+        if (k == FARMHASH64_RADIX_SWWC_TUPLES - 1)
+        {
+            // the block is complete (only its tail on the first copy of the slice)
+            memcpy(t->tuples + (pos + 1 - f), b + (FARMHASH64_RADIX_SWWC_TUPLES - f), f * sizeof(farmhash64_radix_tuple_t));
+            f = 0;
+        }
+        fill[p] = (uint8_t)f;
+    }
+    size_t p;
+    for (p = 0; p < nparts; p++)
+    {
+        size_t f = fill[p];
+        if (f > 0)
+        {
+            uint64_t start = t->hist[p] - f;
+            memcpy(t->tuples + start, buf + (p * FARMHASH64_RADIX_SWWC_TUPLES) + (start % FARMHASH64_RADIX_SWWC_TUPLES), f * sizeof(farmhash64_radix_tuple_t));
+        }
+    }
+    free(buf);
+    free(fill);
+    return NULL;
+}
+
+/**
+ * @brief Release the memory of partitioned rows.
+ *
+ * @param parts Partitions
+ *
+ * @public
+ */
+static inline void farmhash64_radix_partitions_free(farmhash64_radix_partitions_t *parts)
+{
+    if (parts == NULL)
+    {
+        return;
+    }
+    free(parts->tuples);
+    free(parts->offsets);
+    parts->tuples = NULL;
+    parts->offsets = NULL;
+}
+
+/**
+ * @brief Run the two partitioning passes.
+ *
+ * @private
+ */
+static inline int farmhash64_radix_partition_passes(farmhash64_radix_task_t *tasks, unsigned nt, farmhash64_radix_partitions_t *parts)
+{
+    size_t nparts = (size_t)1 << parts->bits;
+    farmhash64_radix_run(farmhash64_radix_histogram, tasks, nt);
+    // turn the per-thread counts into write positions: partition-major, then thread order
+    uint64_t pos = 0;
+    size_t p;
+    unsigned t;
+    for (p = 0; p < nparts; p++)
+    {
+        parts->offsets[p] = pos;
+        for (t = 0; t < nt; t++)
+        {
+            uint64_t n = tasks[t].hist[p];
+            tasks[t].hist[p] = pos;
+            pos += n;
+        }
+    }
+    parts->offsets[nparts] = pos;
+    farmhash64_radix_run(farmhash64_radix_scatter, tasks, nt);
+    int ret = FARMHASH64_RADIX_OK;
+    for (t = 0; t < nt; t++)
+    {
+        if (tasks[t].ret != FARMHASH64_RADIX_OK)
+        {
+            ret = tasks[t].ret;
+        }
+    }
+    return ret;
+}
+
+/**
+ * @brief Hash a key column with farmhash64 and group its rows in 2^bits partitions by the top hash bits.
+ *
+ * The rows of each partition keep the order of the input; the tuples array is 64-byte aligned.
+ * On success the partitions must be released with farmhash64_radix_partitions_free.
+ *
+ * @param keys     Key column
+ * @param values   Value column (can be NULL)
+ * @param nrows    Number of rows
+ * @param bits     Number of partition bits (up to FARMHASH64_RADIX_MAX_BITS)
+ * @param nthreads Number of threads (1 to FARMHASH64_RADIX_MAX_THREADS)
+ * @param parts    Output partitions
+ *
+ * @return FARMHASH64_RADIX_OK on success, or a negative farmhash64_radix_status_t error code
+ *
+ * @public
+ */
+static inline int farmhash64_radix_partition(const uint64_t *keys, const uint64_t *values, size_t nrows, uint32_t bits, unsigned nthreads, farmhash64_radix_partitions_t *parts)
+{
+    if ((parts == NULL) || ((keys == NULL) && (nrows > 0)) || (bits > FARMHASH64_RADIX_MAX_BITS) || (nthreads < 1) || (nthreads > FARMHASH64_RADIX_MAX_THREADS))
+    {
+        return FARMHASH64_RADIX_ERR_ARGS;
+    }
+    size_t nparts = (size_t)1 << bits;
+    unsigned nt = nthreads;
+    if (nrows < (size_t)nt * 4096)
+    {
+        nt = 1;
+    }
+    memset(parts, 0, sizeof(*parts));
+    parts->bits = bits;
+    parts->nrows = nrows;
+    parts->offsets = (uint64_t *)calloc(nparts + 1, sizeof(uint64_t));
+    // the size is rounded up to a multiple of 64 bytes as required by aligned_alloc
+    parts->tuples = (farmhash64_radix_tuple_t *)aligned_alloc(64, ((((nrows + 1) * sizeof(farmhash64_radix_tuple_t)) + 63) & ~(size_t)63));
+    uint64_t *hashes = (uint64_t *)malloc((nrows + 1) * sizeof(uint64_t));
+    uint64_t *hist = (uint64_t *)calloc((size_t)nt * nparts, sizeof(uint64_t));
+    farmhash64_radix_task_t *tasks = (farmhash64_radix_task_t *)calloc(nt, sizeof(farmhash64_radix_task_t));
+    int ret = FARMHASH64_RADIX_ERR_MEMORY;
+    if ((parts->offsets != NULL) && (parts->tuples != NULL) && (hashes != NULL) && (hist != NULL) && (tasks != NULL))
+    {
+        unsigned t;
+        for (t = 0; t < nt; t++)
+        {
+            tasks[t].keys = keys;
+            tasks[t].values = values;
+            tasks[t].hashes = hashes;
+            tasks[t].start = nrows * t / nt;
+            tasks[t].end = nrows * (t + 1) / nt;
+            tasks[t].bits = bits;
+            tasks[t].hist = hist + ((size_t)t * nparts);
+            tasks[t].tuples = parts->tuples;
+        }
+        ret = farmhash64_radix_partition_passes(tasks, nt, parts);
+    }
+    free(hashes);
+    free(hist);
+    free(tasks);
+    if (ret != FARMHASH64_RADIX_OK)
+    {
+        farmhash64_radix_partitions_free(parts);
+    }
+    return ret;
+}
+
+/**
+ * @brief Aggregate one partition in the table of the current thread.
+ *
+ * The groups are written over the partition rows, which are no longer needed.
+ *
+ * @return Number of groups, or a negative farmhash64_radix_status_t error code
+ *
+ * @private
+ */
+static inline int64_t farmhash64_radix_build_part(farmhash64_radix_tuple_t *rows, uint64_t nrows, farmhash64_radix_slot_t **table, uint64_t *cap)
+{
+    uint64_t nslots = 8;
+    while ((nslots < 2 * nrows) && (nslots < FARMHASH64_RADIX_TABLE_SLOTS))
+    {
+        nslots <<= 1;
+    }
+    uint64_t used = 0;
+    uint64_t i;
+    uint64_t j;
+    for (;;)
+    {
+        if (nslots > *cap)
+        {
+            free(*table);
+            *table = (farmhash64_radix_slot_t *)aligned_alloc(64, (size_t)nslots * sizeof(farmhash64_radix_slot_t));
+            *cap = (*table == NULL) ? 0 : nslots;
+            if (*table == NULL)
+            {
+                return FARMHASH64_RADIX_ERR_MEMORY;
+            }
+        }
+        farmhash64_radix_slot_t *s = *table;
+        uint64_t mask = nslots - 1;
+        memset(s, 0, (size_t)nslots * sizeof(farmhash64_radix_slot_t));
+        used = 0;
+        for (i = 0; i < nrows; i++)
+        {
+            const farmhash64_radix_tuple_t *r = &rows[i];
+            j = r->hash & mask;
+            while ((s[j].count != 0) && ((s[j].hash != r->hash) || (s[j].key != r->key)))
+            {
+                j = (j + 1) & mask;
+            }
+            if (s[j].count == 0)
+            {
+                if (2 * (used + 1) > nslots)
+                {
+                    break;
+                }
+                s[j].hash = r->hash;
+                s[j].key = r->key;
+                ++used;
+            }
+            s[j].count++;
+            s[j].sum += r->value;
+        }
+        if (i == nrows)
+        {
+            break;
+        }
+        // more groups than expected: restart with a larger table, using the stored hashes
+        nslots <<= 1;
+    }
+    farmhash64_radix_group_t *g = (farmhash64_radix_group_t *)(void *)rows;
+    const farmhash64_radix_slot_t *s = *table;
+    uint64_t n = 0;
+    for (j = 0; j < nslots; j++)
+    {
+        if (s[j].count != 0)
+        {
+            g[n].key = s[j].key;
+            g[n].count = s[j].count;
+            g[n].sum = s[j].sum;
+            ++n;
+        }
+    }
+    return (int64_t)n;
+}
+
+/**
+ * @brief Build pass: aggregate the partitions handed out by the shared counter.
+ *
+ * @private
+ */
+static inline void *farmhash64_radix_build(void *arg)
+{
+    farmhash64_radix_task_t *t = (farmhash64_radix_task_t *)arg;
+    uint64_t nparts = (uint64_t)1 << t->bits;
+    farmhash64_radix_slot_t *table = NULL;
+    uint64_t cap = 0;
+    for (;;)
+    {
+        uint64_t p = __atomic_fetch_add(t->next, 1, __ATOMIC_RELAXED);
+        if (p >= nparts)
+        {
+            break;
+        }
+        int64_t n = farmhash64_radix_build_part(t->tuples + t->offsets[p], t->offsets[p + 1] - t->offsets[p], &table, &cap);
+        if (n < 0)
+        {
+            t->ret = (int)n;
+            break;
+        }
+        t->ngroups[p] = (uint64_t)n;
+    }
+    free(table);
+    return NULL;
+}
+
+/**
+ * @brief Release the memory of an aggregation result.
+ *
+ * @param res Result
+ *
+ * @public
+ */
+static inline void farmhash64_radix_result_free(farmhash64_radix_result_t *res)
+{
+    if (res == NULL)
+    {
+        return;
+    }
+    free(res->groups);
+    res->groups = NULL;
+    res->ngroups = 0;
+}
+
+/**
+ * @brief Group the rows by key, counting them and summing their values (GROUP BY key: COUNT(*), SUM(value)).
+ *
+ * The rows are partitioned with farmhash64_radix_partition and each partition is aggregated
+ * by a single thread in a private table, so no synchronization is needed on the groups.
+ * On success the result must be released with farmhash64_radix_result_free.
+ *
+ * @param keys     Key column
+ * @param values   Value column (can be NULL to only count the rows)
+ * @param nrows    Number of rows
+ * @param bits     Number of partition bits (up to FARMHASH64_RADIX_MAX_BITS, see farmhash64_radix_bits)
+ * @param nthreads Number of threads (1 to FARMHASH64_RADIX_MAX_THREADS)
+ * @param res      Output groups
+ *
+ * @return FARMHASH64_RADIX_OK on success, or a negative farmhash64_radix_status_t error code
+ *
+ * @public
+ */
+static inline int farmhash64_radix_aggregate(const uint64_t *keys, const uint64_t *values, size_t nrows, uint32_t bits, unsigned nthreads, farmhash64_radix_result_t *res)
+{
+    if (res == NULL)
+    {
+        return FARMHASH64_RADIX_ERR_ARGS;
+    }
+    memset(res, 0, sizeof(*res));
+    farmhash64_radix_partitions_t parts;
+    int ret = farmhash64_radix_partition(keys, values, nrows, bits, nthreads, &parts);
+    if (ret != FARMHASH64_RADIX_OK)
+    {
+        return ret;
+    }
+    size_t nparts = (size_t)1 << bits;
+    unsigned nt = ((uint64_t)nthreads > (uint64_t)nparts) ? (unsigned)nparts : nthreads;
+    uint64_t *ngroups = (uint64_t *)calloc(nparts, sizeof(uint64_t));
+    farmhash64_radix_task_t *tasks = (farmhash64_radix_task_t *)calloc(nt, sizeof(farmhash64_radix_task_t));
+    uint64_t next = 0;
+    unsigned t;
+    ret = ((ngroups == NULL) || (tasks == NULL)) ? FARMHASH64_RADIX_ERR_MEMORY : FARMHASH64_RADIX_OK;
+    if (ret == FARMHASH64_RADIX_OK)
+    {
+        for (t = 0; t < nt; t++)
+        {
+            tasks[t].bits = bits;
+            tasks[t].tuples = parts.tuples;
+            tasks[t].offsets = parts.offsets;
+            tasks[t].ngroups = ngroups;
+            tasks[t].next = &next;
+        }
+        farmhash64_radix_run(farmhash64_radix_build, tasks, nt);
+        for (t = 0; t < nt; t++)
+        {
+            if (tasks[t].ret != FARMHASH64_RADIX_OK)
+            {
+                ret = tasks[t].ret;
+            }
+        }
+    }
+    if (ret == FARMHASH64_RADIX_OK)
+    {
+        // move the groups of each partition next to the previous ones, reusing the rows memory
+        // (a group has the same size as a row)
+        farmhash64_radix_group_t *groups = (farmhash64_radix_group_t *)(void *)parts.tuples;
+        size_t n = 0;
+        size_t p;
+        for (p = 0; p < nparts; p++)
+        {
+            memmove(groups + n, parts.tuples + parts.offsets[p], (size_t)ngroups[p] * sizeof(farmhash64_radix_group_t));
+            n += (size_t)ngroups[p];
+        }
+        res->groups = groups;
+        res->ngroups = n;
+        parts.tuples = NULL;
+    }
+    free(ngroups);
+    free(tasks);
+    farmhash64_radix_partitions_free(&parts);
+    return ret;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // FARMHASH64_RADIX_H
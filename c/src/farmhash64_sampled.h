@@ -0,0 +1,126 @@
+/**
+ * @file farmhash64_sampled.h
+ * @brief Sampled hash of long keys for hash table bucketing. NOT a fingerprint.
+ *
+ * farmhash64_sampled hashes a fixed-size sample of a key instead of all its bytes, so its cost depends on
+ * the byte budget and not on the key length. It is meant for hash tables with long keys (multi-KB blobs)
+ * that always confirm a match with a full key comparison, where the hash only selects the bucket.
+ *
+ * The sample of a key longer than the budget is:
+ *
+ * - the key length;
+ * - the first and the last FARMHASH64_SAMPLED_EDGE bytes;
+ * - (budget - 2 * FARMHASH64_SAMPLED_EDGE) / FARMHASH64_SAMPLED_BLOCK interior blocks of FARMHASH64_SAMPLED_BLOCK
+ *   bytes, one in the middle of each of as many equal slices of the interior (a fixed stride for a given length).
+ *
+ * Keys up to the budget are hashed entirely, and the result is then equal to farmhash64.
+ *
+ * WARNING: this is not a fingerprint and must never be used as one (deduplication, content addressing,
+ * checksums, cache keys without key comparison, persisted hashes): two different keys of the same length
+ * that only differ outside the sampled bytes ALWAYS have the same hash.
+ * For the same reason it offers no protection against crafted keys: if the keys come from untrusted input,
+ * an attacker can put any number of distinct keys in the same bucket.
+ * Use farmhash64 for anything that must distinguish keys.
+ */
+
+#ifndef FARMHASH64_SAMPLED_H
+#define FARMHASH64_SAMPLED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "farmhash64.h"
+
+/**
+ * @brief Number of bytes sampled at each end of the key.
+ */
+#define FARMHASH64_SAMPLED_EDGE 64
+
+/**
+ * @brief Size of an interior sample block.
+ */
+#define FARMHASH64_SAMPLED_BLOCK 64
+
+/**
+ * @brief Minimum byte budget (smaller budgets are raised to this value): the two ends of the key.
+ */
+#define FARMHASH64_SAMPLED_MIN_BUDGET (2 * FARMHASH64_SAMPLED_EDGE)
+
+/**
+ * @brief Suggested byte budget.
+ */
+#define FARMHASH64_SAMPLED_DEFAULT_BUDGET 512
+
+/**
+ * @brief Size of the buffer where the sampled bytes are gathered before hashing.
+ *
+ * @private
+ */
+#define FARMHASH64_SAMPLED_CHUNK 1024
+
+/**
+ * @brief Sampled 64-bit hash of a long key, for hash table bucketing only. NOT a fingerprint.
+ *
+ * Hashes the length, the first and last FARMHASH64_SAMPLED_EDGE bytes and evenly spaced interior blocks,
+ * up to about budget bytes in total, so the cost is O(budget) and not O(len).
+ * Keys of up to budget bytes are hashed entirely and the result is the same as farmhash64(s, len).
+ *
+ * Different keys of the same length that only differ outside the sampled bytes have the same hash:
+ * the hash table must compare the full keys, and this function must not be used where farmhash64 is
+ * used as a fingerprint. See the file description.
+ *
+ * @param s      key
+ * @param len    key length
+ * @param budget maximum number of key bytes to hash (at least FARMHASH64_SAMPLED_MIN_BUDGET,
+ *               e.g. FARMHASH64_SAMPLED_DEFAULT_BUDGET)
+ *
+ * @return 64-bit hash code
+ *
+ * @public
+ */
+static inline uint64_t farmhash64_sampled(const char *s, size_t len, size_t budget)
+{
+    if (budget < FARMHASH64_SAMPLED_MIN_BUDGET)
+    {
+        budget = FARMHASH64_SAMPLED_MIN_BUDGET;
+    }
+    if (len <= budget)
+    {
+        return farmhash64(s, len);
+    }
+    char buf[FARMHASH64_SAMPLED_CHUNK];
+    size_t nblocks = (budget - (2 * FARMHASH64_SAMPLED_EDGE)) / FARMHASH64_SAMPLED_BLOCK;
+    size_t interior = len - (2 * FARMHASH64_SAMPLED_EDGE);
+    // interior > nblocks * FARMHASH64_SAMPLED_BLOCK, so the slices are larger than a block
+    size_t stride = (nblocks > 0) ? interior / nblocks : FARMHASH64_SAMPLED_BLOCK;
+    const char *first = s + FARMHASH64_SAMPLED_EDGE + ((stride - FARMHASH64_SAMPLED_BLOCK) / 2);
+    uint64_t h = (uint64_t)len;
+    size_t fill = FARMHASH64_SAMPLED_EDGE;
+    size_t k;
+    memcpy(buf, s, FARMHASH64_SAMPLED_EDGE);
+    for (k = 0; k < nblocks; k++)
+    {
+        if (fill == FARMHASH64_SAMPLED_CHUNK)
+        {
+            h = farmhash64_with_seeds(buf, fill, h, (uint64_t)len);
+            fill = 0;
+        }
+        memcpy(buf + fill, first + (k * stride), FARMHASH64_SAMPLED_BLOCK);
+        fill += FARMHASH64_SAMPLED_BLOCK;
+    }
+    if (fill == FARMHASH64_SAMPLED_CHUNK)
+    {
+        h = farmhash64_with_seeds(buf, fill, h, (uint64_t)len);
+        fill = 0;
+    }
+    memcpy(buf + fill, s + len - FARMHASH64_SAMPLED_EDGE, FARMHASH64_SAMPLED_EDGE);
+    fill += FARMHASH64_SAMPLED_EDGE;
+    return farmhash64_with_seeds(buf, fill, h, (uint64_t)len);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FARMHASH64_SAMPLED_H
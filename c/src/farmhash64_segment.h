@@ -0,0 +1,868 @@
+/**
+ * @file farmhash64_segment.h
+ * @brief Block framing with farmhash checksums for append-only segment files, with lazy verification.
+ *
+ * A segment file is a sequence of fixed-size blocks. Block 0 is the header; each following block holds
+ * up to block_size - trailer bytes of payload and ends with a trailer that stores the payload length and
+ * its checksum: farmhash64 (16-byte trailer) or farmhash32 (8-byte trailer) of the payload, seeded with the
+ * segment id and the block number, so a block written to the wrong place or copied from another segment
+ * does not verify either.
+ *
+ * Writing (farmhash64_segment_writer_t) is streaming: appended data is staged in a buffer of
+ * FARMHASH64_SEGMENT_BATCH block payloads and written with one pwritev per batch, with the trailers gathered
+ * from a separate array. Appends of whole batches are written directly from the caller buffer.
+ * farmhash64_segment_writer_flush writes a partially filled block as it is: a written block is never rewritten,
+ * and the next append starts a new block. Data is addressed by its position in the segment,
+ * block * payload + offset in the block, as returned by farmhash64_segment_append: flushing leaves a gap.
+ *
+ * Reading (farmhash64_segment_reader_t) maps the file and verifies each block the first time it is touched,
+ * recording the verified blocks in a bitmap, so a read pays for the checksum of a block only once.
+ * farmhash64_segment_scrub verifies all the blocks not verified yet with several threads.
+ * The reader functions can be called concurrently from any number of threads.
+ *
+ * After a crash, the blocks written after the last farmhash64_segment_writer_sync may be missing or torn.
+ * Reopening the segment for writing drops the trailing blocks that do not verify (and an incomplete last block).
+ * A torn block followed by a valid one (pwritev does not order the writes of a batch) is not dropped:
+ * it is reported as corrupt when read or scrubbed.
+ *
+ * This header uses POSIX mmap, pwritev and threads: define _DEFAULT_SOURCE (or _GNU_SOURCE) before including it.
+ */
+
+#ifndef FARMHASH64_SEGMENT_H
+#define FARMHASH64_SEGMENT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "farmhash64.h"
+
+/**
+ * @brief Minimum block size.
+ */
+#define FARMHASH64_SEGMENT_MIN_BLOCK 512
+
+/**
+ * @brief Maximum block size.
+ */
+#define FARMHASH64_SEGMENT_MAX_BLOCK (1 << 24)
+
+/**
+ * @brief Number of blocks written by each pwritev (two iovecs per block).
+ */
+#define FARMHASH64_SEGMENT_BATCH 64
+
+/**
+ * @brief Maximum number of scrub threads.
+ */
+#define FARMHASH64_SEGMENT_MAX_THREADS 256
+
+/**
+ * @brief Number of blocks verified by a scrub thread at a time.
+ *
+ * @private
+ */
+#define FARMHASH64_SEGMENT_SCRUB_CHUNK 256
+
+/**
+ * @brief File signature ("FH64SEGM").
+ *
+ * @private
+ */
+#define FARMHASH64_SEGMENT_MAGIC 0x4d47455334364846ULL
+
+/**
+ * @brief File format version.
+ *
+ * @private
+ */
+#define FARMHASH64_SEGMENT_VERSION 1
+
+/**
+ * @brief Return codes.
+ */
+enum farmhash64_segment_status_t
+{
+    FARMHASH64_SEGMENT_OK = 0,            /**< Success. */
+    FARMHASH64_SEGMENT_ERR_ARGS = -1,     /**< Invalid arguments. */
+    FARMHASH64_SEGMENT_ERR_MEMORY = -2,   /**< Memory allocation or mapping failed. */
+    FARMHASH64_SEGMENT_ERR_IO = -3,       /**< File I/O error. */
+    FARMHASH64_SEGMENT_ERR_FORMAT = -4,   /**< The file is not a valid segment. */
+    FARMHASH64_SEGMENT_ERR_CORRUPT = -5,  /**< A block checksum does not match. */
+    FARMHASH64_SEGMENT_ERR_RANGE = -6,    /**< The position is outside the data of the segment. */
+};
+
+/**
+ * @brief File header, at the start of block 0.
+ *
+ * @private
+ */
+typedef struct farmhash64_segment_header_t
+{
+    uint64_t magic;      /**< FARMHASH64_SEGMENT_MAGIC. */
+    uint32_t version;    /**< FARMHASH64_SEGMENT_VERSION. */
+    uint32_t block_size; /**< Block size in bytes. */
+    uint32_t sum_bits;   /**< Checksum size: 32 or 64 bits. */
+    uint32_t reserved;   /**< Zero. */
+    uint64_t segment_id; /**< Caller-defined segment id, also used as checksum seed. */
+    uint64_t sum;        /**< farmhash64 of the previous fields. */
+} farmhash64_segment_header_t;
+
+/**
+ * @brief Segment writer.
+ */
+typedef struct farmhash64_segment_writer_t
+{
+    int fd;              /**< Segment file. */
+    uint32_t block_size; /**< Block size in bytes. */
+    uint32_t payload;    /**< Payload bytes per block. */
+    uint32_t sum_bits;   /**< Checksum size: 32 or 64 bits. */
+    uint64_t segment_id; /**< Segment id. */
+    uint64_t block;      /**< Number of the first staged block. */
+    size_t fill;         /**< Staged payload bytes. */
+    char *buf;           /**< FARMHASH64_SEGMENT_BATCH payloads, back to back. */
+    char *trailers;      /**< FARMHASH64_SEGMENT_BATCH trailers. */
+} farmhash64_segment_writer_t;
+
+/**
+ * @brief Segment reader.
+ */
+typedef struct farmhash64_segment_reader_t
+{
+    const char *map;     /**< Read-only mapping of the file. */
+    size_t map_size;     /**< Size of the mapping. */
+    uint32_t block_size; /**< Block size in bytes. */
+    uint32_t payload;    /**< Payload bytes per block. */
+    uint32_t sum_bits;   /**< Checksum size: 32 or 64 bits. */
+    uint64_t segment_id; /**< Segment id. */
+    uint64_t nblocks;    /**< Number of data blocks. */
+    uint64_t *verified;  /**< Bitmap of the verified blocks (updated atomically). */
+} farmhash64_segment_reader_t;
+
+/**
+ * @brief Scrub results.
+ */
+typedef struct farmhash64_segment_scrub_t
+{
+    uint64_t checked;       /**< Blocks verified by this scrub (not verified before). */
+    uint64_t corrupt;       /**< Blocks that failed verification. */
+    uint64_t first_corrupt; /**< Number of the first corrupt block, or UINT64_MAX. */
+} farmhash64_segment_scrub_t;
+
+/**
+ * @brief Returns the trailer size for a checksum size.
+ *
+ * @param sum_bits Checksum size: 32 or 64 bits.
+ *
+ * @return Trailer size in bytes.
+ *
+ * @private
+ */
+static inline uint32_t farmhash64_segment_trailer_size(uint32_t sum_bits)
+{
+    return (sum_bits == 32) ? 8 : 16;
+}
+
+/**
+ * @brief Block checksum: the farmhash64 of the payload, seeded with the segment id, the block number and the length.
+ *
+ * @param p        Payload.
+ * @param len      Payload length.
+ * @param id       Segment id.
+ * @param block    Block number (the first data block is 0).
+ * @param sum_bits Checksum size: 32 or 64 bits.
+ *
+ * @return Checksum (in the low 32 bits when sum_bits is 32).
+ *
+ * @private
+ */
+static inline uint64_t farmhash64_segment_sum(const char *p, uint32_t len, uint64_t id, uint64_t block, uint32_t sum_bits)
+{
+    uint64_t h = farmhash64_with_seeds(p, len, id, block ^ ((uint64_t)len << 40));
+    return (sum_bits == 32) ? mix_64_to_32(h) : h;
+}
+
+/**
+ * @brief Writes the trailer of a block.
+ *
+ * @param t        Trailer.
+ * @param len      Payload length.
+ * @param sum      Checksum.
+ * @param sum_bits Checksum size: 32 or 64 bits.
+ *
+ * @private
+ */
+static inline void farmhash64_segment_put_trailer(char *t, uint32_t len, uint64_t sum, uint32_t sum_bits)
+{
+    memcpy(t, &len, 4);
+    if (sum_bits == 32)
+    {
+        uint32_t s = (uint32_t)sum;
+        memcpy(t + 4, &s, 4);
+        return;
+    }
+    memset(t + 4, 0, 4);
+    memcpy(t + 8, &sum, 8);
+}
+
+/**
+ * @brief Verifies a block.
+ *
+ * @param blk        Block.
+ * @param block_size Block size.
+ * @param id         Segment id.
+ * @param block      Block number.
+ * @param sum_bits   Checksum size: 32 or 64 bits.
+ * @param len        Set to the payload length.
+ *
+ * @return 1 if the checksum matches, 0 otherwise.
+ *
+ * @private
+ */
+static inline int farmhash64_segment_check(const char *blk, uint32_t block_size, uint64_t id, uint64_t block, uint32_t sum_bits, uint32_t *len)
+{
+    uint32_t tsize = farmhash64_segment_trailer_size(sum_bits);
+    const char *t = blk + block_size - tsize;
+    uint32_t n;
+    memcpy(&n, t, 4);
+    if (n > block_size - tsize)
+    {
+        return 0;
+    }
+    uint64_t sum;
+    if (sum_bits == 32)
+    {
+        uint32_t s;
+        memcpy(&s, t + 4, 4);
+        sum = s;
+    }
+    else
+    {
+        memcpy(&sum, t + 8, 8);
+    }
+    *len = n;
+    return (farmhash64_segment_sum(blk, n, id, block, sum_bits) == sum);
+}
+
+/**
+ * @brief Returns the header checksum.
+ *
+ * @private
+ */
+static inline uint64_t farmhash64_segment_header_sum(const farmhash64_segment_header_t *h)
+{
+    return farmhash64((const char *)h, offsetof(farmhash64_segment_header_t, sum));
+}
+
+/**
+ * @brief Reads and validates the header of a segment file.
+ *
+ * @private
+ */
+static inline int farmhash64_segment_read_header(int fd, farmhash64_segment_header_t *h)
+{
+    if (pread(fd, h, sizeof(*h), 0) != (ssize_t)sizeof(*h))
+    {
+        return FARMHASH64_SEGMENT_ERR_FORMAT;
+    }
+    if ((h->magic != FARMHASH64_SEGMENT_MAGIC) || (h->version != FARMHASH64_SEGMENT_VERSION) || (h->sum != farmhash64_segment_header_sum(h))
+            || (h->block_size < FARMHASH64_SEGMENT_MIN_BLOCK) || (h->block_size > FARMHASH64_SEGMENT_MAX_BLOCK) || ((h->sum_bits != 32) && (h->sum_bits != 64)))
+    {
+        return FARMHASH64_SEGMENT_ERR_FORMAT;
+    }
+    return FARMHASH64_SEGMENT_OK;
+}
+
+/**
+ * @brief Writes all the iovecs at the given file offset, retrying short writes.
+ *
+ * @param fd  File.
+ * @param iov Buffers (modified).
+ * @param cnt Number of buffers.
+ * @param off File offset.
+ *
+ * @return FARMHASH64_SEGMENT_OK or FARMHASH64_SEGMENT_ERR_IO.
+ *
+ * @private
+ */
+static inline int farmhash64_segment_pwritev_all(int fd, struct iovec *iov, int cnt, off_t off)
+{
+    while (cnt > 0)
+    {
+        ssize_t n = pwritev(fd, iov, cnt, off);
+        if (n <= 0)
+        {
+            return FARMHASH64_SEGMENT_ERR_IO;
+        }
+        off += n;
+        while ((cnt > 0) && ((size_t)n >= iov->iov_len))
+        {
+            n -= (ssize_t)iov->iov_len;
+            iov++;
+            cnt--;
+        }
+        if (cnt > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= (size_t)n;
+        }
+    }
+    return FARMHASH64_SEGMENT_OK;
+}
+
+/**
+ * @brief Writes nb blocks of payload taken from data (size bytes: the last block may be partial).
+ *
+ * The padding of a partial last block must be zero: it is written as it is.
+ *
+ * @private
+ */
+static inline int farmhash64_segment_write_blocks(farmhash64_segment_writer_t *w, const char *data, size_t size, uint32_t nb)
+{
+    struct iovec iov[2 * FARMHASH64_SEGMENT_BATCH];
+    uint32_t tsize = farmhash64_segment_trailer_size(w->sum_bits);
+    uint32_t i;
+    for (i = 0; i < nb; i++)
+    {
+        size_t pos = (size_t)i * w->payload;
+        uint32_t len = ((size - pos) < w->payload) ? (uint32_t)(size - pos) : w->payload;
+        char *t = w->trailers + ((size_t)i * tsize);
+        farmhash64_segment_put_trailer(t, len, farmhash64_segment_sum(data + pos, len, w->segment_id, w->block + i, w->sum_bits), w->sum_bits);
+        iov[2 * i].iov_base = (void *)(uintptr_t)(data + pos);
+        iov[2 * i].iov_len = w->payload;
+        iov[(2 * i) + 1].iov_base = t;
+        iov[(2 * i) + 1].iov_len = tsize;
+    }
+    int ret = farmhash64_segment_pwritev_all(w->fd, iov, (int)(2 * nb), (off_t)((w->block + 1) * w->block_size));
+    if (ret == FARMHASH64_SEGMENT_OK)
+    {
+        w->block += nb;
+    }
+    return ret;
+}
+
+/**
+ * @brief Closes a segment writer, without flushing the staged data.
+ *
+ * @param w Writer.
+ *
+ * @public
+ */
+static inline void farmhash64_segment_writer_close(farmhash64_segment_writer_t *w)
+{
+    if (w->fd >= 0)
+    {
+        close(w->fd);
+    }
+    free(w->buf);
+    free(w->trailers);
+    memset(w, 0, sizeof(*w));
+    w->fd = -1;
+}
+
+/**
+ * @brief Opens a segment file for appending, creating it if it does not exist.
+ *
+ * An existing segment keeps its block size, checksum size and id (the arguments are ignored):
+ * its trailing blocks that do not verify are dropped, and the next append starts a new block.
+ *
+ * @param w          Writer to initialize.
+ * @param path       Segment file path.
+ * @param block_size Block size: a power of two from FARMHASH64_SEGMENT_MIN_BLOCK to FARMHASH64_SEGMENT_MAX_BLOCK.
+ * @param sum_bits   Checksum size: 32 (farmhash32) or 64 (farmhash64).
+ * @param segment_id Caller-defined id of the segment (e.g. its sequence number).
+ *
+ * @return FARMHASH64_SEGMENT_OK or an error code.
+ *
+ * @public
+ */
+static inline int farmhash64_segment_writer_open(farmhash64_segment_writer_t *w, const char *path, uint32_t block_size, uint32_t sum_bits, uint64_t segment_id)
+{
+    memset(w, 0, sizeof(*w));
+    w->fd = -1;
+    if ((path == NULL) || (block_size < FARMHASH64_SEGMENT_MIN_BLOCK) || (block_size > FARMHASH64_SEGMENT_MAX_BLOCK) || ((block_size & (block_size - 1)) != 0) || ((sum_bits != 32) && (sum_bits != 64)))
+    {
+        return FARMHASH64_SEGMENT_ERR_ARGS;
+    }
+    w->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (w->fd < 0)
+    {
+        return FARMHASH64_SEGMENT_ERR_IO;
+    }
+    struct stat st;
+    if (fstat(w->fd, &st) != 0)
+    {
+        farmhash64_segment_writer_close(w);
+        return FARMHASH64_SEGMENT_ERR_IO;
+    }
+    farmhash64_segment_header_t h;
+    int ret = FARMHASH64_SEGMENT_OK;
+    if (st.st_size == 0)
+    {
+        memset(&h, 0, sizeof(h));
+        h.magic = FARMHASH64_SEGMENT_MAGIC;
+        h.version = FARMHASH64_SEGMENT_VERSION;
+        h.block_size = block_size;
+        h.sum_bits = sum_bits;
+        h.segment_id = segment_id;
+        h.sum = farmhash64_segment_header_sum(&h);
+        char *blk = (char *)calloc(1, block_size);
+        if (blk == NULL)
+        {
+            farmhash64_segment_writer_close(w);
+            return FARMHASH64_SEGMENT_ERR_MEMORY;
+        }
+        memcpy(blk, &h, sizeof(h));
+        if ((pwrite(w->fd, blk, block_size, 0) != (ssize_t)block_size) || (fdatasync(w->fd) != 0))
+        {
+            ret = FARMHASH64_SEGMENT_ERR_IO;
+        }
+        free(blk);
+    }
+    else
+    {
+        ret = farmhash64_segment_read_header(w->fd, &h);
+    }
+    if (ret != FARMHASH64_SEGMENT_OK)
+    {
+        farmhash64_segment_writer_close(w);
+        return ret;
+    }
+    w->block_size = h.block_size;
+    w->sum_bits = h.sum_bits;
+    w->segment_id = h.segment_id;
+    w->payload = h.block_size - farmhash64_segment_trailer_size(h.sum_bits);
+    w->buf = (char *)malloc((size_t)FARMHASH64_SEGMENT_BATCH * w->payload);
+    w->trailers = (char *)malloc((size_t)FARMHASH64_SEGMENT_BATCH * 16);
+    if ((w->buf == NULL) || (w->trailers == NULL))
+    {
+        farmhash64_segment_writer_close(w);
+        return FARMHASH64_SEGMENT_ERR_MEMORY;
+    }
+    // drop the incomplete last block and the trailing blocks that do not verify
+    uint64_t nblocks = ((uint64_t)st.st_size / h.block_size);
+    nblocks = (nblocks > 0) ? nblocks - 1 : 0;
+    while (nblocks > 0)
+    {
+        uint32_t len;
+        if (pread(w->fd, w->buf, h.block_size, (off_t)(nblocks * h.block_size)) != (ssize_t)h.block_size)
+        {
+            farmhash64_segment_writer_close(w);
+            return FARMHASH64_SEGMENT_ERR_IO;
+        }
+        if (farmhash64_segment_check(w->buf, h.block_size, h.segment_id, nblocks - 1, h.sum_bits, &len))
+        {
+            break;
+        }
+        nblocks--;
+    }
+    if ((uint64_t)st.st_size != ((nblocks + 1) * h.block_size))
+    {
+        if (ftruncate(w->fd, (off_t)((nblocks + 1) * h.block_size)) != 0)
+        {
+            farmhash64_segment_writer_close(w);
+            return FARMHASH64_SEGMENT_ERR_IO;
+        }
+    }
+    w->block = nblocks;
+    return FARMHASH64_SEGMENT_OK;
+}
+
+/**
+ * @brief Returns the position of the next appended byte.
+ *
+ * @param w Writer.
+ *
+ * @return Position in the segment (block * payload + offset in the block).
+ *
+ * @public
+ */
+static inline uint64_t farmhash64_segment_writer_pos(const farmhash64_segment_writer_t *w)
+{
+    return (w->block * w->payload) + w->fill;
+}
+
+/**
+ * @brief Appends data to the segment.
+ *
+ * The data is staged and written when a batch of blocks is full, by farmhash64_segment_writer_flush
+ * or by farmhash64_segment_writer_sync. Whole batches are written directly from data when nothing is staged.
+ *
+ * @param w    Writer.
+ * @param data Data to append.
+ * @param size Number of bytes.
+ * @param pos  If not NULL, set to the position of the first appended byte (see farmhash64_segment_read).
+ *
+ * @return FARMHASH64_SEGMENT_OK or FARMHASH64_SEGMENT_ERR_IO.
+ *
+ * @public
+ */
+static inline int farmhash64_segment_append(farmhash64_segment_writer_t *w, const void *data, size_t size, uint64_t *pos)
+{
+    const char *p = (const char *)data;
+    size_t cap = (size_t)FARMHASH64_SEGMENT_BATCH * w->payload;
+    if (pos != NULL)
+    {
+        *pos = farmhash64_segment_writer_pos(w);
+    }
+    while (size > 0)
+    {
+        if ((w->fill == 0) && (size >= cap))
+        {
+            int ret = farmhash64_segment_write_blocks(w, p, cap, FARMHASH64_SEGMENT_BATCH);
+            if (ret != FARMHASH64_SEGMENT_OK)
+            {
+                return ret;
+            }
+            p += cap;
+            size -= cap;
+            continue;
+        }
+        size_t n = cap - w->fill;
+        n = (size < n) ? size : n;
+        memcpy(w->buf + w->fill, p, n);
+        w->fill += n;
+        p += n;
+        size -= n;
+        if (w->fill == cap)
+        {
+            int ret = farmhash64_segment_write_blocks(w, w->buf, cap, FARMHASH64_SEGMENT_BATCH);
+            if (ret != FARMHASH64_SEGMENT_OK)
+            {
+                return ret;
+            }
+            w->fill = 0;
+        }
+    }
+    return FARMHASH64_SEGMENT_OK;
+}
+
+/**
+ * @brief Writes the staged data, including a partially filled last block (the next append starts a new block).
+ *
+ * @param w Writer.
+ *
+ * @return FARMHASH64_SEGMENT_OK or FARMHASH64_SEGMENT_ERR_IO.
+ *
+ * @public
+ */
+static inline int farmhash64_segment_writer_flush(farmhash64_segment_writer_t *w)
+{
+    if (w->fill == 0)
+    {
+        return FARMHASH64_SEGMENT_OK;
+    }
+    uint32_t nb = (uint32_t)((w->fill + w->payload - 1) / w->payload);
+    memset(w->buf + w->fill, 0, ((size_t)nb * w->payload) - w->fill);
+    int ret = farmhash64_segment_write_blocks(w, w->buf, w->fill, nb);
+    if (ret == FARMHASH64_SEGMENT_OK)
+    {
+        w->fill = 0;
+    }
+    return ret;
+}
+
+/**
+ * @brief Writes the staged data and waits until the segment is on stable storage.
+ *
+ * @param w Writer.
+ *
+ * @return FARMHASH64_SEGMENT_OK or FARMHASH64_SEGMENT_ERR_IO.
+ *
+ * @public
+ */
+static inline int farmhash64_segment_writer_sync(farmhash64_segment_writer_t *w)
+{
+    int ret = farmhash64_segment_writer_flush(w);
+    if ((ret == FARMHASH64_SEGMENT_OK) && (fdatasync(w->fd) != 0))
+    {
+        ret = FARMHASH64_SEGMENT_ERR_IO;
+    }
+    return ret;
+}
+
+/**
+ * @brief Closes a segment reader.
+ *
+ * @param r Reader.
+ *
+ * @public
+ */
+static inline void farmhash64_segment_reader_close(farmhash64_segment_reader_t *r)
+{
+    if (r->map != NULL)
+    {
+        munmap((void *)(uintptr_t)r->map, r->map_size);
+    }
+    free(r->verified);
+    memset(r, 0, sizeof(*r));
+}
+
+/**
+ * @brief Opens a segment file for reading.
+ *
+ * The file is mapped and nothing is verified: the reader sees the blocks present when it is opened.
+ *
+ * @param r    Reader to initialize.
+ * @param path Segment file path.
+ *
+ * @return FARMHASH64_SEGMENT_OK or an error code.
+ *
+ * @public
+ */
+static inline int farmhash64_segment_reader_open(farmhash64_segment_reader_t *r, const char *path)
+{
+    memset(r, 0, sizeof(*r));
+    if (path == NULL)
+    {
+        return FARMHASH64_SEGMENT_ERR_ARGS;
+    }
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return FARMHASH64_SEGMENT_ERR_IO;
+    }
+    farmhash64_segment_header_t h;
+    struct stat st;
+    int ret = farmhash64_segment_read_header(fd, &h);
+    if ((ret == FARMHASH64_SEGMENT_OK) && (fstat(fd, &st) != 0))
+    {
+        ret = FARMHASH64_SEGMENT_ERR_IO;
+    }
+    if ((ret == FARMHASH64_SEGMENT_OK) && ((uint64_t)st.st_size < h.block_size))
+    {
+        ret = FARMHASH64_SEGMENT_ERR_FORMAT;
+    }
+    if (ret != FARMHASH64_SEGMENT_OK)
+    {
+        close(fd);
+        return ret;
+    }
+    r->block_size = h.block_size;
+    r->sum_bits = h.sum_bits;
+    r->segment_id = h.segment_id;
+    r->payload = h.block_size - farmhash64_segment_trailer_size(h.sum_bits);
+    r->nblocks = ((uint64_t)st.st_size / h.block_size) - 1;
+    r->map_size = (size_t)((r->nblocks + 1) * h.block_size);
+    void *map = mmap(NULL, r->map_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        memset(r, 0, sizeof(*r));
+        return FARMHASH64_SEGMENT_ERR_MEMORY;
+    }
+    r->map = (const char *)map;
+    r->verified = (uint64_t *)calloc((size_t)((r->nblocks + 63) / 64) + 1, sizeof(uint64_t));
+    if (r->verified == NULL)
+    {
+        farmhash64_segment_reader_close(r);
+        return FARMHASH64_SEGMENT_ERR_MEMORY;
+    }
+    return FARMHASH64_SEGMENT_OK;
+}
+
+/**
+ * @brief Returns the payload of a data block, verifying it the first time.
+ *
+ * @param r     Reader.
+ * @param block Block number (0 to nblocks - 1).
+ * @param data  Set to the payload (in the mapping, valid until the reader is closed).
+ * @param len   Set to the payload length.
+ *
+ * @return FARMHASH64_SEGMENT_OK, FARMHASH64_SEGMENT_ERR_RANGE or FARMHASH64_SEGMENT_ERR_CORRUPT.
+ *
+ * @public
+ */
+static inline int farmhash64_segment_block(farmhash64_segment_reader_t *r, uint64_t block, const char **data, uint32_t *len)
+{
+    if (block >= r->nblocks)
+    {
+        return FARMHASH64_SEGMENT_ERR_RANGE;
+    }
+    const char *blk = r->map + ((block + 1) * r->block_size);
+    uint64_t bit = (uint64_t)1 << (block & 63);
+    uint64_t *word = &r->verified[block >> 6];
+    uint32_t n;
+    if ((__atomic_load_n(word, __ATOMIC_RELAXED) & bit) != 0)
+    {
+        memcpy(&n, blk + r->payload, 4);
+    }
+    else
+    {
+        if (!farmhash64_segment_check(blk, r->block_size, r->segment_id, block, r->sum_bits, &n))
+        {
+            return FARMHASH64_SEGMENT_ERR_CORRUPT;
+        }
+        __atomic_fetch_or(word, bit, __ATOMIC_RELAXED);
+    }
+    *data = blk;
+    *len = n;
+    return FARMHASH64_SEGMENT_OK;
+}
+
+/**
+ * @brief Copies size bytes of data from a position returned by farmhash64_segment_append.
+ *
+ * The blocks spanned by the data are verified the first time they are read.
+ *
+ * @param r    Reader.
+ * @param pos  Position of the first byte.
+ * @param buf  Output buffer.
+ * @param size Number of bytes.
+ *
+ * @return FARMHASH64_SEGMENT_OK, FARMHASH64_SEGMENT_ERR_RANGE (the data is not in the segment)
+ *         or FARMHASH64_SEGMENT_ERR_CORRUPT.
+ *
+ * @public
+ */
+static inline int farmhash64_segment_read(farmhash64_segment_reader_t *r, uint64_t pos, void *buf, size_t size)
+{
+    char *out = (char *)buf;
+    uint64_t block = pos / r->payload;
+    uint32_t off = (uint32_t)(pos % r->payload);
+    while (size > 0)
+    {
+        const char *data;
+        uint32_t len;
+        int ret = farmhash64_segment_block(r, block, &data, &len);
+        if (ret != FARMHASH64_SEGMENT_OK)
+        {
+            return ret;
+        }
+        if (off >= len)
+        {
+            return FARMHASH64_SEGMENT_ERR_RANGE;
+        }
+        size_t n = len - off;
+        n = (size < n) ? size : n;
+        memcpy(out, data + off, n);
+        out += n;
+        size -= n;
+        if ((size > 0) && (len < r->payload))
+        {
+            // the data continues past the end of a flushed block
+            return FARMHASH64_SEGMENT_ERR_RANGE;
+        }
+        block++;
+        off = 0;
+    }
+    return FARMHASH64_SEGMENT_OK;
+}
+
+/**
+ * @brief Shared state of the scrub threads.
+ *
+ * @private
+ */
+typedef struct farmhash64_segment_scrub_ctx_t
+{
+    farmhash64_segment_reader_t *r; /**< Reader. */
+    uint64_t next;                  /**< Next chunk to verify (atomic). */
+    farmhash64_segment_scrub_t res; /**< Results (atomic). */
+} farmhash64_segment_scrub_ctx_t;
+
+/**
+ * @brief Scrub thread: verifies chunks of blocks until none is left.
+ *
+ * @private
+ */
+static inline void *farmhash64_segment_scrub_worker(void *arg)
+{
+    farmhash64_segment_scrub_ctx_t *ctx = (farmhash64_segment_scrub_ctx_t *)arg;
+    farmhash64_segment_reader_t *r = ctx->r;
+    uint64_t nchunks = (r->nblocks + FARMHASH64_SEGMENT_SCRUB_CHUNK - 1) / FARMHASH64_SEGMENT_SCRUB_CHUNK;
+    uint64_t checked = 0;
+    uint64_t corrupt = 0;
+    uint64_t first = UINT64_MAX;
+    for (;;)
+    {
+        uint64_t c = __atomic_fetch_add(&ctx->next, 1, __ATOMIC_RELAXED);
+        if (c >= nchunks)
+        {
+            break;
+        }
+        uint64_t b = c * FARMHASH64_SEGMENT_SCRUB_CHUNK;
+        uint64_t end = b + FARMHASH64_SEGMENT_SCRUB_CHUNK;
+        end = (end < r->nblocks) ? end : r->nblocks;
+        madvise((void *)(uintptr_t)(r->map + ((b + 1) * r->block_size)), (size_t)((end - b) * r->block_size), MADV_WILLNEED);
+        for (; b < end; b++)
+        {
+            if ((__atomic_load_n(&r->verified[b >> 6], __ATOMIC_RELAXED) & ((uint64_t)1 << (b & 63))) != 0)
+            {
+                continue;
+            }
+            const char *data;
+            uint32_t len;
+            if (farmhash64_segment_block(r, b, &data, &len) == FARMHASH64_SEGMENT_OK)
+            {
+                checked++;
+                continue;
+            }
+            corrupt++;
+            first = (b < first) ? b : first;
+        }
+    }
+    __atomic_fetch_add(&ctx->res.checked, checked, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&ctx->res.corrupt, corrupt, __ATOMIC_RELAXED);
+    uint64_t cur = __atomic_load_n(&ctx->res.first_corrupt, __ATOMIC_RELAXED);
+    while ((first < cur) && !__atomic_compare_exchange_n(&ctx->res.first_corrupt, &cur, first, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+    return NULL;
+}
+
+/**
+ * @brief Verifies all the blocks not verified yet, with nthreads threads (the calling thread included).
+ *
+ * Can run while other threads read the segment, e.g. from a background thread.
+ *
+ * @param r        Reader.
+ * @param nthreads Number of threads (1 to FARMHASH64_SEGMENT_MAX_THREADS).
+ * @param res      Results.
+ *
+ * @return FARMHASH64_SEGMENT_OK (even if corrupt blocks are found) or FARMHASH64_SEGMENT_ERR_ARGS.
+ *
+ * @public
+ */
+static inline int farmhash64_segment_scrub(farmhash64_segment_reader_t *r, unsigned nthreads, farmhash64_segment_scrub_t *res)
+{
+    if ((res == NULL) || (nthreads < 1) || (nthreads > FARMHASH64_SEGMENT_MAX_THREADS))
+    {
+        return FARMHASH64_SEGMENT_ERR_ARGS;
+    }
+    farmhash64_segment_scrub_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.r = r;
+    ctx.res.first_corrupt = UINT64_MAX;
+    pthread_t tid[FARMHASH64_SEGMENT_MAX_THREADS];
+    unsigned i;
+    unsigned started = 0;
+    for (i = 1; i < nthreads; i++)
+    {
+        if (pthread_create(&tid[i], NULL, farmhash64_segment_scrub_worker, &ctx) != 0)
+        {
+            break;
+        }
+        started = i;
+    }
+    farmhash64_segment_scrub_worker(&ctx);
+    for (i = 1; i <= started; i++)
+    {
+        pthread_join(tid[i], NULL);
+    }
+    *res = ctx.res;
+    return FARMHASH64_SEGMENT_OK;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FARMHASH64_SEGMENT_H
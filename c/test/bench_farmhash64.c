@@ -0,0 +1,95 @@
+// Nicola Asuni
+
+// Cross-language benchmark (see the "Benchmarks" section of the main README.md).
+// Hashes the data_setup() corpus over fixed size classes and prints the results
+// in the farmhash64-bench/1 JSON format shared by all the language ports.
+
+#if __STDC_VERSION__ >= 199901L
+#define _XOPEN_SOURCE 600
+#else
+#define _XOPEN_SOURCE 500
+#endif
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../src/farmhash64.h"
+
+#define BENCH_DATA_SIZE 1048576 // 1 << 20
+#define BENCH_NUM_SIZES 10
+
+static const size_t bench_sizes[BENCH_NUM_SIZES] = {8, 16, 32, 64, 128, 256, 1024, 4096, 65536, 1048576};
+static char data[BENCH_DATA_SIZE];
+
+// returns current time in nanoseconds
+static uint64_t get_time()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (((uint64_t)t.tv_sec * 1000000000) + (uint64_t)t.tv_nsec);
+}
+
+// Initialize data to pseudorandom values (same generator as test_farmhash64.c).
+static void data_setup()
+{
+    static const uint64_t kt = 0xc3a5c85c97cb3127ULL;
+    uint64_t a = 9;
+    uint64_t b = 777;
+    uint8_t u = 0;
+    for (int i = 0; i < BENCH_DATA_SIZE; i++)
+    {
+        a += b;
+        b += a;
+        a = (a ^ (a >> 41)) * kt;
+        b = (b ^ (b >> 41)) * kt + i;
+        u = b >> 37;
+        memcpy(data + i, &u, 1);  // uint8_t -> char
+    }
+}
+
+// number of timed hashes for each size class
+static uint64_t bench_iterations(size_t size)
+{
+    uint64_t n = ((uint64_t)1 << 26) / size;
+    return (n < 64) ? 64 : n;
+}
+
+// offset of the i-th hashed slice: 64 different cache lines unless the slice covers most of the corpus
+static size_t bench_offset(uint64_t i, size_t size)
+{
+    return (size <= (BENCH_DATA_SIZE / 2)) ? (size_t)((i & 63) << 6) : 0;
+}
+
+static uint64_t bench_run(size_t size, uint64_t iterations)
+{
+    uint64_t i;
+    uint64_t checksum = 0;
+    for (i = 0; i < iterations; i++)
+    {
+        checksum += farmhash64(data + bench_offset(i, size), size);
+    }
+    return checksum;
+}
+
+int main()
+{
+    int k;
+    data_setup();
+    fprintf(stdout, "{\"schema\":\"farmhash64-bench/1\",\"lang\":\"c\",\"impl\":\"farmhash64.h\",\"results\":[\n");
+    for (k = 0; k < BENCH_NUM_SIZES; k++)
+    {
+        size_t size = bench_sizes[k];
+        uint64_t iterations = bench_iterations(size);
+        volatile uint64_t warmup = bench_run(size, iterations / 8);
+        (void)warmup;
+        uint64_t tstart = get_time();
+        uint64_t checksum = bench_run(size, iterations);
+        uint64_t tend = get_time();
+        double ns = (double)(tend - tstart) / (double)iterations;
+        fprintf(stdout, "{\"size\":%zu,\"iterations\":%" PRIu64 ",\"ns_per_hash\":%.3f,\"gb_per_s\":%.3f,\"allocs_per_hash\":0,\"alloc_bytes_per_hash\":0,\"checksum\":\"%016" PRIx64 "\"}%s\n",
+                size, iterations, ns, (double)size / ns, checksum, (k < BENCH_NUM_SIZES - 1) ? "," : "");
+    }
+    fprintf(stdout, "]}\n");
+    return 0;
+}
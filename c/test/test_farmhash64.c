@@ -276,6 +276,242 @@ int test_farmhash32_strings()
     return errors;
 }
 
+typedef struct test_data_seed_t
+{
+    uint64_t h64seed;
+    uint64_t h64seeds;
+    const char* str;
+} test_data_seed_t;
+
+static test_data_seed_t seed_input[] =
+{
+    {0x46e6a80a993c964f, 0xf846bc39066a4ace, ""},
+    {0xc309d54b0bf8e13e, 0xe77670284f3c4adc, "a"},
+    {0x98dc10e3a1ed2818, 0x63d167e86b2a1d6b, "abcdefghi"},
+    {0xd82e061bd1e7729b, 0x787787db4516d3eb, "0123456789=012345"},
+    {0xec54f36a6e846c5f, 0x9b8a12888dbb798c, "Nepal premier won't resign."},
+    {0xefc2a72481a32106, 0xfc277ddbbdf5138a, "Free! Free!/A trip/to Mars/for 900/empty jars/Burma Shave"},
+};
+
+int test_farmhash64_with_seeds()
+{
+    int errors = 0;
+    uint64_t h;
+    size_t i;
+    for (i = 0 ; i < sizeof(seed_input) / sizeof(seed_input[0]); i++)
+    {
+        size_t len = strlen(seed_input[i].str);
+        h = farmhash64_with_seed(seed_input[i].str, len, 12345);
+        if (h != seed_input[i].h64seed)
+        {
+            fprintf(stderr, "%s (%lu) expected %lx but got %lx for %s\n", __func__, i, seed_input[i].h64seed, h, seed_input[i].str);
+            ++errors;
+        }
+        h = farmhash64_with_seeds(seed_input[i].str, len, 1, 2);
+        if (h != seed_input[i].h64seeds)
+        {
+            fprintf(stderr, "%s (%lu) expected %lx but got %lx for %s\n", __func__, i, seed_input[i].h64seeds, h, seed_input[i].str);
+            ++errors;
+        }
+        if (farmhash64_reseed(farmhash64(seed_input[i].str, len), 1, 2) != h)
+        {
+            fprintf(stderr, "%s (%lu) reseed mismatch for %s\n", __func__, i, seed_input[i].str);
+            ++errors;
+        }
+    }
+    return errors;
+}
+
+typedef struct test_data_mk_t
+{
+    uint32_t h32;
+    uint32_t h32seed;
+    const char* str;
+} test_data_mk_t;
+
+static test_data_mk_t mk_input[] =
+{
+    {0xdc56d17a, 0x7f9c4657, ""},
+    {0x3c973d4d, 0x055eb300, "a"},
+    {0x417330fd, 0x2a84d556, "ab"},
+    {0x2f635ec7, 0xa193629f, "abc"},
+    {0x98b51e95, 0x28f95271, "abcd"},
+    {0x6f98dc86, 0x5ad6eaa7, "abcdefghi"},
+    {0x335f081f, 0xc0deef77, "0123456789=012345"},
+    {0x322984d9, 0x696eddf5, "Nepal premier won't resign."},
+    {0x7613810f, 0xec415a0e, "Free! Free!/A trip/to Mars/for 900/empty jars/Burma Shave"},
+};
+
+int test_farmhash32_mk()
+{
+    int errors = 0;
+    uint32_t h;
+    size_t i;
+    for (i = 0 ; i < sizeof(mk_input) / sizeof(mk_input[0]); i++)
+    {
+        size_t len = strlen(mk_input[i].str);
+        h = farmhash32_mk(mk_input[i].str, len);
+        if (h != mk_input[i].h32)
+        {
+            fprintf(stderr, "%s (%lu) expected %x but got %x for %s\n", __func__, i, mk_input[i].h32, h, mk_input[i].str);
+            ++errors;
+        }
+        h = farmhash32_mk_with_seed(mk_input[i].str, len, 12345);
+        if (h != mk_input[i].h32seed)
+        {
+            fprintf(stderr, "%s (%lu) expected %x but got %x for %s\n", __func__, i, mk_input[i].h32seed, h, mk_input[i].str);
+            ++errors;
+        }
+    }
+    // every length class, at unaligned offsets: the result must not depend on the alignment
+    char buf[128];
+    for (i = 0; i < 100; i++)
+    {
+        memcpy(buf + 1, data + i, i);
+        if ((farmhash32_mk(buf + 1, i) != farmhash32_mk(data + i, i)) || (farmhash32_mk_with_seed(buf + 1, i, 7) != farmhash32_mk_with_seed(data + i, i, 7)))
+        {
+            fprintf(stderr, "%s : alignment mismatch for length %lu\n", __func__, i);
+            ++errors;
+        }
+    }
+    return errors;
+}
+
+int test_farmhash64_ascii_ci()
+{
+    int errors = 0;
+    char upper[1024];
+    char lower[1024];
+    size_t i, j;
+    data_setup();
+    for (i = 0; i < TEST_STRING_DATA_SIZE; i++)
+    {
+        size_t len = strlen(string_input[i].str);
+        for (j = 0; j < len; j++)
+        {
+            char c = string_input[i].str[j];
+            upper[j] = ((c >= 'a') && (c <= 'z')) ? (char)(c - 32) : c;
+        }
+        if (farmhash64_ascii_ci(upper, len) != farmhash64_ascii_ci(string_input[i].str, len))
+        {
+            fprintf(stderr, "%s (%lu) case mismatch for %s\n", __func__, i, string_input[i].str);
+            ++errors;
+        }
+    }
+    // random bytes, including non-ASCII ones, at every length and alignment
+    for (i = 0; i < 1000; i++)
+    {
+        const char *s = data + (i * 7);
+        for (j = 0; j < i; j++)
+        {
+            lower[j] = ((s[j] >= 'A') && (s[j] <= 'Z')) ? (char)(s[j] + 32) : s[j];
+        }
+        if (farmhash64_ascii_ci(s, i) != farmhash64(lower, i))
+        {
+            fprintf(stderr, "%s : mismatch for length %lu\n", __func__, i);
+            ++errors;
+        }
+    }
+    return errors;
+}
+
+int test_farmhash64_utf8_ci()
+{
+    int errors = 0;
+    // pairs of characters (uppercase, folded) with different UTF-8 lengths
+    static const char *pairs[][2] =
+    {
+        {"A", "a"}, {"\xc3\x89", "\xc3\xa9"}, {"\xe2\x84\xaa", "k"}, {"\xce\xa3", "\xcf\x83"},
+        {"\xcf\x82", "\xcf\x83"}, {"\xe1\xba\x9e", "\xc3\x9f"}, {"\xd0\x96", "\xd0\xb6"}, {"\xd0\x81", "\xd1\x91"},
+        {"\xc5\xbf", "s"}, {"\xc4\xb0", "\xc4\xb0"}, {"\xc5\xb8", "\xc3\xbf"}, {"\xe2\x84\xa6", "\xcf\x89"},
+        {"\xff", "\xff"}, {"\xc3", "\xc3"}, {"7", "7"}, {"\xd3\x81", "\xd3\x82"},
+    };
+    const size_t npairs = sizeof(pairs) / sizeof(pairs[0]);
+    char upper[2048];
+    char lower[2048];
+    size_t ulen = 0;
+    size_t llen = 0;
+    size_t i;
+    for (i = 0; i < 400; i++)
+    {
+        if (farmhash64_utf8_ci(upper, ulen) != farmhash64(lower, llen))
+        {
+            fprintf(stderr, "%s : mismatch after %lu characters\n", __func__, i);
+            ++errors;
+        }
+        const char *u = pairs[(i * 5) % npairs][0];
+        const char *l = pairs[(i * 5) % npairs][1];
+        memcpy(upper + ulen, u, strlen(u));
+        ulen += strlen(u);
+        memcpy(lower + llen, l, strlen(l));
+        llen += strlen(l);
+    }
+    const char *gu = "\xce\x91\xce\x92\xce\x93 \xd0\x9a\xd0\x98\xd0\x95\xd0\x92 Stra\xc3\x9f" "e";
+    const char *gl = "\xce\xb1\xce\xb2\xce\xb3 \xd0\xba\xd0\xb8\xd0\xb5\xd0\xb2 stra\xc3\x9f" "e";
+    if (farmhash64_utf8_ci(gu, strlen(gu)) != farmhash64(gl, strlen(gl)))
+    {
+        fprintf(stderr, "%s : mismatch for Greek/Cyrillic string\n", __func__);
+        ++errors;
+    }
+    if (farmhash64_utf8_ci("Hello World", 11) != farmhash64("hello world", 11))
+    {
+        fprintf(stderr, "%s : mismatch for ASCII string\n", __func__);
+        ++errors;
+    }
+    return errors;
+}
+
+void benchmark_farmhash32_mk()
+{
+    static const size_t lens[] = {4, 8, 12, 16, 24, 64};
+    uint64_t tstart, tend;
+    uint32_t sum = 0;
+    size_t j;
+    int i;
+    int size = 1000000;
+    for (j = 0; j < sizeof(lens) / sizeof(lens[0]); j++)
+    {
+        tstart = get_time();
+        for (i = 0; i < size; i++)
+        {
+            sum += farmhash32(data + (i & 1023), lens[j]);
+        }
+        tend = get_time();
+        uint64_t t64 = tend - tstart;
+        tstart = get_time();
+        for (i = 0; i < size; i++)
+        {
+            sum += farmhash32_mk(data + (i & 1023), lens[j]);
+        }
+        tend = get_time();
+        fprintf(stdout, " * %s : %2lu bytes : farmhash32 %.2f ns/op, farmhash32_mk %.2f ns/op\n", __func__, lens[j], (double)t64 / size, (double)(tend - tstart) / size);
+    }
+    if (sum == 0)
+    {
+        fprintf(stdout, " * %s : zero checksum\n", __func__);
+    }
+}
+
+void benchmark_farmhash64_ci()
+{
+    static const size_t lens[] = {12, 31, 70};
+    uint64_t tstart, tend;
+    uint64_t sum = 0;
+    size_t j;
+    int i;
+    int size = 100000;
+    tstart = get_time();
+    for (i = 0; i < size; i++)
+    {
+        for (j = 0; j < sizeof(lens) / sizeof(lens[0]); j++)
+        {
+            sum += farmhash64_ascii_ci(data + (i & 1023), lens[j]);
+        }
+    }
+    tend = get_time();
+    fprintf(stdout, " * %s : %.2f ns/op (checksum %016llx)\n", __func__, (double)(tend - tstart) / (size * 3), (unsigned long long)sum);
+}
+
 int main()
 {
     int errors = 0;
@@ -283,8 +519,14 @@ int main()
     errors += test_farmhash64_strings();
     errors += test_farmhash64();
     errors += test_farmhash32_strings();
+    errors += test_farmhash64_with_seeds();
+    errors += test_farmhash32_mk();
+    errors += test_farmhash64_ascii_ci();
+    errors += test_farmhash64_utf8_ci();
 
     benchmark_farmhash64();
+    benchmark_farmhash64_ci();
+    benchmark_farmhash32_mk();
 
     return errors;
 }
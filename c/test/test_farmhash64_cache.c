@@ -0,0 +1,439 @@
+// Nicola Asuni
+
+#if __STDC_VERSION__ >= 199901L
+#define _XOPEN_SOURCE 600
+#else
+#define _XOPEN_SOURCE 500
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../src/farmhash64_cache.h"
+
+#define TEST_THREADS 4
+
+static const uint64_t k_capacity = 16384;
+static const uint64_t k_universe = 1000000;
+static const uint64_t k_ops = 4000000;
+
+// returns current time in nanoseconds
+uint64_t get_time()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (((uint64_t)t.tv_sec * 1000000000) + (uint64_t)t.tv_nsec);
+}
+
+// value stored for a key, to detect torn reads
+static uint64_t value_of(uint64_t key)
+{
+    return ~key * 0x9e3779b97f4a7c15ULL;
+}
+
+static uint64_t xorshift(uint64_t *x)
+{
+    *x ^= *x << 13;
+    *x ^= *x >> 7;
+    *x ^= *x << 17;
+    return *x;
+}
+
+// skewed access pattern (probability of key k about 1/k), interleaved with scans of keys never seen again
+static uint64_t *make_trace(uint64_t n, uint64_t seed)
+{
+    uint64_t *trace = (uint64_t *)malloc(n * sizeof(uint64_t));
+    uint64_t x = seed;
+    uint64_t scan = k_universe;
+    uint64_t i = 0;
+    while (i < n)
+    {
+        uint64_t j;
+        // 90% skewed lookups, 10% one-off scan
+        for (j = 0; (j < 9000) && (i < n); j++)
+        {
+            // log-uniform: random bit length, then a random key of that length
+            uint64_t r = xorshift(&x);
+            uint32_t bits = (uint32_t)(r % 20);
+            trace[i++] = ((uint64_t)1 << bits) + ((r >> 8) & (((uint64_t)1 << bits) - 1));
+        }
+        for (j = 0; (j < 1000) && (i < n); j++)
+        {
+            trace[i++] = scan++;
+        }
+    }
+    return trace;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Baseline: mutex-protected LRU list with a chained hash index.
+
+typedef struct lru_node_t
+{
+    uint64_t key;
+    uint64_t value;
+    uint32_t prev;
+    uint32_t next;
+    uint32_t chain;
+} lru_node_t;
+
+typedef struct lru_t
+{
+    pthread_mutex_t lock;
+    lru_node_t *nodes; // node 0 is the list head
+    uint32_t *heads;
+    uint64_t mask;
+    uint32_t size;
+    uint32_t capacity;
+} lru_t;
+
+static void lru_init(lru_t *c, uint32_t capacity)
+{
+    pthread_mutex_init(&c->lock, NULL);
+    c->nodes = (lru_node_t *)calloc(capacity + 1, sizeof(lru_node_t));
+    c->mask = 1;
+    while (c->mask < 2 * (uint64_t)capacity)
+    {
+        c->mask <<= 1;
+    }
+    c->heads = (uint32_t *)calloc(c->mask, sizeof(uint32_t));
+    c->mask--;
+    c->size = 0;
+    c->capacity = capacity;
+}
+
+static void lru_destroy(lru_t *c)
+{
+    free(c->nodes);
+    free(c->heads);
+    pthread_mutex_destroy(&c->lock);
+}
+
+static void lru_unlink(lru_t *c, uint32_t n)
+{
+    c->nodes[c->nodes[n].prev].next = c->nodes[n].next;
+    c->nodes[c->nodes[n].next].prev = c->nodes[n].prev;
+}
+
+static void lru_push_front(lru_t *c, uint32_t n)
+{
+    c->nodes[n].prev = 0;
+    c->nodes[n].next = c->nodes[0].next;
+    c->nodes[c->nodes[0].next].prev = n;
+    c->nodes[0].next = n;
+}
+
+static uint32_t lru_find(const lru_t *c, uint64_t key)
+{
+    uint32_t n = c->heads[farmhash64_cache_hash(key) & c->mask];
+    while ((n != 0) && (c->nodes[n].key != key))
+    {
+        n = c->nodes[n].chain;
+    }
+    return n;
+}
+
+static int lru_get(lru_t *c, uint64_t key, uint64_t *value)
+{
+    pthread_mutex_lock(&c->lock);
+    uint32_t n = lru_find(c, key);
+    if (n != 0)
+    {
+        lru_unlink(c, n);
+        lru_push_front(c, n);
+        *value = c->nodes[n].value;
+    }
+    pthread_mutex_unlock(&c->lock);
+    return (n != 0);
+}
+
+static void lru_put(lru_t *c, uint64_t key, uint64_t value)
+{
+    pthread_mutex_lock(&c->lock);
+    uint32_t n = lru_find(c, key);
+    if (n == 0)
+    {
+        if (c->size < c->capacity)
+        {
+            n = ++c->size;
+        }
+        else
+        {
+            n = c->nodes[0].prev; // least recently used
+            lru_unlink(c, n);
+            uint32_t *p = &c->heads[farmhash64_cache_hash(c->nodes[n].key) & c->mask];
+            while (*p != n)
+            {
+                p = &c->nodes[*p].chain;
+            }
+            *p = c->nodes[n].chain;
+        }
+        uint32_t *head = &c->heads[farmhash64_cache_hash(key) & c->mask];
+        c->nodes[n].key = key;
+        c->nodes[n].chain = *head;
+        *head = n;
+    }
+    else
+    {
+        lru_unlink(c, n);
+    }
+    c->nodes[n].value = value;
+    lru_push_front(c, n);
+    pthread_mutex_unlock(&c->lock);
+}
+
+// -------------------------------------------------------------------------------------------------
+
+int test_farmhash64_cache_basic()
+{
+    int errors = 0;
+    farmhash64_cache_t cache;
+    if (farmhash64_cache_init(&cache, 2, 1000) != FARMHASH64_CACHE_OK)
+    {
+        fprintf(stderr, "%s : init error\n", __func__);
+        return 1;
+    }
+    errors += (farmhash64_cache_init(NULL, 2, 1000) != FARMHASH64_CACHE_ERR_ARGS);
+    uint64_t v = 0;
+    errors += (farmhash64_cache_get(&cache, 1, &v) != 0);
+    errors += (farmhash64_cache_put(&cache, 1, 10) != FARMHASH64_CACHE_OK);
+    errors += (farmhash64_cache_get(&cache, 1, &v) != 1) || (v != 10);
+    errors += (farmhash64_cache_put(&cache, 1, 11) != FARMHASH64_CACHE_OK);
+    errors += (farmhash64_cache_get(&cache, 1, &v) != 1) || (v != 11);
+    errors += (farmhash64_cache_del(&cache, 1) != 1);
+    errors += (farmhash64_cache_del(&cache, 1) != 0);
+    errors += (farmhash64_cache_get(&cache, 1, NULL) != 0);
+    // fill well beyond the capacity: the number of entries stays bounded and the values stay consistent
+    uint64_t k;
+    for (k = 0; k < 100000; k++)
+    {
+        if (farmhash64_cache_get(&cache, k, &v) && (v != value_of(k)))
+        {
+            ++errors;
+        }
+        farmhash64_cache_put(&cache, k, value_of(k));
+    }
+    uint64_t present = 0;
+    for (k = 0; k < 100000; k++)
+    {
+        if (farmhash64_cache_get(&cache, k, &v))
+        {
+            present++;
+            errors += (v != value_of(k));
+        }
+    }
+    errors += (present == 0) || (present > 1024);
+    // frequent keys survive a scan of keys seen only once
+    farmhash64_cache_t hot;
+    farmhash64_cache_init(&hot, 0, 64);
+    uint64_t hot_misses = 0;
+    for (k = 0; k < 100000; k++)
+    {
+        uint64_t hk = k % 32;
+        if (!farmhash64_cache_get(&hot, hk, NULL))
+        {
+            hot_misses += (k >= 1000);
+            farmhash64_cache_put(&hot, hk, hk);
+        }
+        if (!farmhash64_cache_get(&hot, 1000000 + k, NULL))
+        {
+            farmhash64_cache_put(&hot, 1000000 + k, k);
+        }
+    }
+    present = 0;
+    for (k = 0; k < 32; k++)
+    {
+        present += (uint64_t)farmhash64_cache_get(&hot, k, NULL);
+    }
+    errors += (present < 30) || (hot_misses > 1000);
+    farmhash64_cache_stats_t st;
+    farmhash64_cache_stats(&hot, &st);
+    errors += (st.rejects == 0) || (st.hits + st.misses != (2 * 100000) + 32);
+    farmhash64_cache_destroy(&hot);
+    farmhash64_cache_destroy(&cache);
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors (%lu hot keys kept, %lu hot misses)\n", __func__, errors, (unsigned long)present, (unsigned long)hot_misses);
+    }
+    return errors;
+}
+
+// capacities that give a single bucket (and a single sketch block) per shard
+int test_farmhash64_cache_small()
+{
+    int errors = 0;
+    static const uint32_t cases[][2] = {{0, 1}, {0, 8}, {1, 8}, {2, 16}, {4, 100}};
+    size_t c;
+    for (c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+    {
+        farmhash64_cache_t cache;
+        if (farmhash64_cache_init(&cache, cases[c][0], cases[c][1]) != FARMHASH64_CACHE_OK)
+        {
+            fprintf(stderr, "%s (shard_bits=%u capacity=%u) : init error\n", __func__, cases[c][0], cases[c][1]);
+            ++errors;
+            continue;
+        }
+        uint64_t v = 0;
+        errors += (farmhash64_cache_put(&cache, 7, value_of(7)) != FARMHASH64_CACHE_OK);
+        errors += (farmhash64_cache_get(&cache, 7, &v) != 1) || (v != value_of(7));
+        uint64_t k;
+        for (k = 0; k < 10000; k++)
+        {
+            if (farmhash64_cache_get(&cache, k % 64, &v) && (v != value_of(k % 64)))
+            {
+                ++errors;
+            }
+            farmhash64_cache_put(&cache, k % 64, value_of(k % 64));
+        }
+        uint64_t present = 0;
+        for (k = 0; k < 64; k++)
+        {
+            present += (uint64_t)farmhash64_cache_get(&cache, k, NULL);
+        }
+        errors += (present == 0);
+        farmhash64_cache_destroy(&cache);
+    }
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors\n", __func__, errors);
+    }
+    return errors;
+}
+
+typedef struct cache_task_t
+{
+    farmhash64_cache_t *cache;
+    lru_t *lru;
+    const uint64_t *trace;
+    uint64_t n;
+    uint64_t hits;
+    uint64_t errors;
+} cache_task_t;
+
+static void *cache_worker(void *arg)
+{
+    cache_task_t *t = (cache_task_t *)arg;
+    uint64_t i;
+    uint64_t v;
+    for (i = 0; i < t->n; i++)
+    {
+        uint64_t key = t->trace[i];
+        if (farmhash64_cache_get(t->cache, key, &v))
+        {
+            t->hits++;
+            t->errors += (v != value_of(key));
+        }
+        else
+        {
+            farmhash64_cache_put(t->cache, key, value_of(key));
+        }
+    }
+    return NULL;
+}
+
+static void *lru_worker(void *arg)
+{
+    cache_task_t *t = (cache_task_t *)arg;
+    uint64_t i;
+    uint64_t v;
+    for (i = 0; i < t->n; i++)
+    {
+        uint64_t key = t->trace[i];
+        if (lru_get(t->lru, key, &v))
+        {
+            t->hits++;
+        }
+        else
+        {
+            lru_put(t->lru, key, value_of(key));
+        }
+    }
+    return NULL;
+}
+
+// runs the trace on nthreads threads (each with its own slice), returns the elapsed time
+static uint64_t run_trace(void *(*worker)(void *), farmhash64_cache_t *cache, lru_t *lru, const uint64_t *trace, uint64_t n, int nthreads, uint64_t *hits, uint64_t *errors)
+{
+    pthread_t tid[TEST_THREADS];
+    cache_task_t task[TEST_THREADS];
+    int i;
+    uint64_t tstart = get_time();
+    for (i = 0; i < nthreads; i++)
+    {
+        task[i].cache = cache;
+        task[i].lru = lru;
+        task[i].trace = trace + ((n / (uint64_t)nthreads) * (uint64_t)i);
+        task[i].n = n / (uint64_t)nthreads;
+        task[i].hits = 0;
+        task[i].errors = 0;
+        pthread_create(&tid[i], NULL, worker, &task[i]);
+    }
+    *hits = 0;
+    *errors = 0;
+    for (i = 0; i < nthreads; i++)
+    {
+        pthread_join(tid[i], NULL);
+        *hits += task[i].hits;
+        *errors += task[i].errors;
+    }
+    return get_time() - tstart;
+}
+
+int test_farmhash64_cache_threads()
+{
+    farmhash64_cache_t cache;
+    farmhash64_cache_init(&cache, 4, 4096);
+    uint64_t n = 400000;
+    uint64_t *trace = make_trace(n, 3);
+    uint64_t hits;
+    uint64_t errors;
+    run_trace(cache_worker, &cache, NULL, trace, n, TEST_THREADS, &hits, &errors);
+    farmhash64_cache_stats_t st;
+    farmhash64_cache_stats(&cache, &st);
+    errors += (st.hits != hits) || (st.hits + st.misses != n);
+    farmhash64_cache_destroy(&cache);
+    free(trace);
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %lu errors\n", __func__, (unsigned long)errors);
+    }
+    return (int)errors;
+}
+
+int benchmark_farmhash64_cache()
+{
+    int errors = 0;
+    uint64_t *trace = make_trace(k_ops, 42);
+    int nthreads;
+    for (nthreads = 1; nthreads <= TEST_THREADS; nthreads *= TEST_THREADS)
+    {
+        uint64_t hits;
+        uint64_t err;
+        lru_t lru;
+        lru_init(&lru, (uint32_t)k_capacity);
+        uint64_t tlru = run_trace(lru_worker, NULL, &lru, trace, k_ops, nthreads, &hits, &err);
+        double lru_ratio = (double)hits / (double)k_ops;
+        lru_destroy(&lru);
+        farmhash64_cache_t cache;
+        farmhash64_cache_init(&cache, 6, k_capacity);
+        uint64_t tcache = run_trace(cache_worker, &cache, NULL, trace, k_ops, nthreads, &hits, &err);
+        errors += (int)err;
+        double cache_ratio = (double)hits / (double)k_ops;
+        farmhash64_cache_destroy(&cache);
+        fprintf(stdout, " * %s : %d thread(s) : mutex LRU hit ratio %.3f %.1f ns/op, CLOCK+TinyLFU hit ratio %.3f %.1f ns/op\n", __func__, nthreads, lru_ratio, (double)tlru / k_ops, cache_ratio, (double)tcache / k_ops);
+    }
+    free(trace);
+    return errors;
+}
+
+int main()
+{
+    int errors = 0;
+
+    errors += test_farmhash64_cache_basic();
+    errors += test_farmhash64_cache_small();
+    errors += test_farmhash64_cache_threads();
+    errors += benchmark_farmhash64_cache();
+
+    return errors;
+}
@@ -0,0 +1,322 @@
+// Nicola Asuni
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../src/farmhash64_cdc.h"
+
+static const size_t k_bench_size = (size_t)64 << 20;
+
+// returns current time in nanoseconds
+uint64_t get_time()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (((uint64_t)t.tv_sec * 1000000000) + (uint64_t)t.tv_nsec);
+}
+
+// fills a buffer with pseudorandom bytes
+static void make_data(char *data, size_t len, uint64_t seed)
+{
+    uint64_t x = seed;
+    size_t i;
+    for (i = 0; i < len; i++)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        data[i] = (char)(x >> 56);
+    }
+}
+
+// creates an unlinked temporary file with the given content
+static int temp_file(const char *data, size_t len)
+{
+    char path[] = "/tmp/test_farmhash64_cdc_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+    {
+        return fd;
+    }
+    unlink(path);
+    size_t done = 0;
+    while (done < len)
+    {
+        ssize_t n = write(fd, data + done, len - done);
+        if (n <= 0)
+        {
+            break;
+        }
+        done += (size_t)n;
+    }
+    lseek(fd, 0, SEEK_SET);
+    return fd;
+}
+
+typedef struct sink_state_t
+{
+    const char *data;  // expected stream content
+    uint64_t next;     // expected offset of the next chunk
+    uint64_t *hashes;  // chunk fingerprints, in order
+    size_t nhashes;
+    size_t cap;
+    size_t limit;      // abort after this many chunks (0 = never)
+    int wide;
+    int errors;
+} sink_state_t;
+
+static int check_sink(void *arg, const farmhash64_cdc_chunk_t *chunk)
+{
+    sink_state_t *st = (sink_state_t *)arg;
+    if ((chunk->offset != st->next) || (memcmp(chunk->data, st->data + chunk->offset, chunk->len) != 0) || (chunk->hash != farmhash64(chunk->data, chunk->len)) || (chunk->hash2 != (st->wide ? farmhash64_with_seed(chunk->data, chunk->len, FARMHASH64_CDC_SEED2) : 0)))
+    {
+        ++st->errors;
+    }
+    st->next += chunk->len;
+    if (st->nhashes < st->cap)
+    {
+        st->hashes[st->nhashes] = chunk->hash;
+    }
+    st->nhashes++;
+    return (st->limit > 0) && (st->nhashes >= st->limit);
+}
+
+int test_farmhash64_cdc_cut()
+{
+    int errors = 0;
+    const size_t len = (size_t)4 << 20;
+    char *data = (char *)malloc(len);
+    make_data(data, len, 0x9e3779b97f4a7c15ULL);
+    farmhash64_cdc_params_t params;
+    farmhash64_cdc_default_params(&params);
+    farmhash64_cdc_chunker_t ch;
+    if (farmhash64_cdc_chunker_init(&ch, &params) != FARMHASH64_CDC_OK)
+    {
+        fprintf(stderr, "%s : chunker_init error\n", __func__);
+        free(data);
+        return 1;
+    }
+    size_t pos = 0;
+    size_t nchunks = 0;
+    while (pos < len)
+    {
+        size_t n = farmhash64_cdc_cut(&ch, (const uint8_t *)data + pos, len - pos);
+        if ((n == 0) || (n > params.max_size) || ((n < params.min_size) && (pos + n != len)))
+        {
+            fprintf(stderr, "%s : invalid chunk length %lu at offset %lu\n", __func__, (unsigned long)n, (unsigned long)pos);
+            ++errors;
+            break;
+        }
+        pos += n;
+        nchunks++;
+    }
+    // normalized chunking keeps the average close to the target
+    double avg = (double)len / (double)nchunks;
+    if ((avg < (double)params.avg_size * 0.7) || (avg > (double)params.avg_size * 1.5))
+    {
+        fprintf(stderr, "%s : average chunk size %.0f too far from %lu\n", __func__, avg, (unsigned long)params.avg_size);
+        ++errors;
+    }
+    errors += (farmhash64_cdc_cut(&ch, (const uint8_t *)data, 100) != 100);
+    // fixed Gear table: the same content always gives the same boundaries
+    static const char zero[4096] = {0};
+    errors += (farmhash64_cdc_cut(&ch, (const uint8_t *)zero, sizeof(zero)) != sizeof(zero));
+    params.avg_size = 3000;
+    errors += (farmhash64_cdc_chunker_init(&ch, &params) != FARMHASH64_CDC_ERR_ARGS);
+    farmhash64_cdc_default_params(&params);
+    params.min_size = params.avg_size;
+    errors += (farmhash64_cdc_chunker_init(&ch, &params) != FARMHASH64_CDC_ERR_ARGS);
+    free(data);
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors\n", __func__, errors);
+    }
+    return errors;
+}
+
+int test_farmhash64_cdc_run()
+{
+    int errors = 0;
+    // stream = A + B + A: the second copy of A must be deduplicated
+    const size_t alen = (size_t)3 << 20;
+    const size_t len = 3 * alen;
+    char *data = (char *)malloc(len);
+    make_data(data, 2 * alen, 0x0123456789abcdefULL);
+    memcpy(data + 2 * alen, data, alen);
+    int fd = temp_file(data, len);
+    const unsigned threads[] = {1, 3, 3};
+    const size_t block[] = {(size_t)1 << 20, (size_t)1 << 20, 65536};
+    const int wide[] = {0, 0, 1};
+    farmhash64_cdc_stats_t ref;
+    memset(&ref, 0, sizeof(ref));
+    size_t k;
+    for (k = 0; k < 3; k++)
+    {
+        farmhash64_cdc_params_t params;
+        farmhash64_cdc_default_params(&params);
+        params.threads = threads[k];
+        params.block_size = block[k];
+        params.wide = wide[k];
+        farmhash64_cdc_index_t index;
+        farmhash64_cdc_index_init(&index, 0);
+        farmhash64_cdc_stats_t stats;
+        sink_state_t st;
+        memset(&st, 0, sizeof(st));
+        st.data = data;
+        st.wide = wide[k];
+        lseek(fd, 0, SEEK_SET);
+        if (farmhash64_cdc_run(fd, &params, &index, check_sink, &st, &stats) != FARMHASH64_CDC_OK)
+        {
+            fprintf(stderr, "%s (case %lu) : run error\n", __func__, (unsigned long)k);
+            ++errors;
+        }
+        if ((st.errors != 0) || (st.next != len) || (stats.bytes != len) || (stats.chunks != st.nhashes))
+        {
+            fprintf(stderr, "%s (case %lu) : wrong chunks (%d errors, %lu of %lu bytes)\n", __func__, (unsigned long)k, st.errors, (unsigned long)st.next, (unsigned long)len);
+            ++errors;
+        }
+        // only the chunks around the A/B and B/A borders can be unique in the second copy of A
+        if ((stats.unique_bytes > 2 * alen + 2 * params.max_size) || (stats.unique_bytes < 2 * alen) || (index.used != stats.unique_chunks))
+        {
+            fprintf(stderr, "%s (case %lu) : %lu unique bytes\n", __func__, (unsigned long)k, (unsigned long)stats.unique_bytes);
+            ++errors;
+        }
+        // the boundaries do not depend on the threads or on the block size
+        if (k == 0)
+        {
+            ref = stats;
+        }
+        else if ((stats.chunks != ref.chunks) || (stats.unique_chunks != ref.unique_chunks) || (stats.unique_bytes != ref.unique_bytes))
+        {
+            fprintf(stderr, "%s (case %lu) : results differ from the serial run\n", __func__, (unsigned long)k);
+            ++errors;
+        }
+        // a second run over the same index finds only duplicates
+        lseek(fd, 0, SEEK_SET);
+        errors += (farmhash64_cdc_run(fd, &params, &index, NULL, NULL, &stats) != FARMHASH64_CDC_OK) || (stats.unique_chunks != 0) || (stats.bytes != len);
+        // the sink can stop the run
+        farmhash64_cdc_index_t index2;
+        farmhash64_cdc_index_init(&index2, 0);
+        memset(&st, 0, sizeof(st));
+        st.data = data;
+        st.wide = wide[k];
+        st.limit = 5;
+        lseek(fd, 0, SEEK_SET);
+        errors += (farmhash64_cdc_run(fd, &params, &index2, check_sink, &st, &stats) != FARMHASH64_CDC_ERR_ABORTED) || (stats.chunks != 5);
+        farmhash64_cdc_index_free(&index2);
+        farmhash64_cdc_index_free(&index);
+    }
+    close(fd);
+    // shift resistance: a few bytes inserted at the start only change the first chunks
+    size_t shift = 100;
+    char *shifted = (char *)malloc(alen + shift);
+    make_data(shifted, shift, 42);
+    memcpy(shifted + shift, data, alen);
+    uint64_t *h1 = (uint64_t *)malloc(alen / 1024 * sizeof(uint64_t));
+    uint64_t *h2 = (uint64_t *)malloc(alen / 1024 * sizeof(uint64_t));
+    sink_state_t s1;
+    sink_state_t s2;
+    memset(&s1, 0, sizeof(s1));
+    memset(&s2, 0, sizeof(s2));
+    s1.data = data;
+    s1.hashes = h1;
+    s1.cap = alen / 1024;
+    s2.data = shifted;
+    s2.hashes = h2;
+    s2.cap = alen / 1024;
+    farmhash64_cdc_params_t params;
+    farmhash64_cdc_default_params(&params);
+    farmhash64_cdc_index_t index;
+    farmhash64_cdc_index_init(&index, 0);
+    int fd1 = temp_file(data, alen);
+    int fd2 = temp_file(shifted, alen + shift);
+    errors += (farmhash64_cdc_run(fd1, &params, &index, check_sink, &s1, NULL) != FARMHASH64_CDC_OK);
+    errors += (farmhash64_cdc_run(fd2, &params, &index, check_sink, &s2, NULL) != FARMHASH64_CDC_OK);
+    size_t i;
+    size_t common = 0;
+    for (i = 0; (i + 2 < s1.nhashes) && (i + 2 < s2.nhashes); i++)
+    {
+        // after the first boundaries the two streams resynchronize
+        common += (h1[s1.nhashes - 1 - i] == h2[s2.nhashes - 1 - i]);
+    }
+    if (common + 3 < s1.nhashes)
+    {
+        fprintf(stderr, "%s : only %lu of %lu chunks survived a %lu byte insertion\n", __func__, (unsigned long)common, (unsigned long)s1.nhashes, (unsigned long)shift);
+        ++errors;
+    }
+    close(fd1);
+    close(fd2);
+    farmhash64_cdc_index_free(&index);
+    free(h1);
+    free(h2);
+    free(shifted);
+    free(data);
+    // invalid arguments
+    farmhash64_cdc_index_init(&index, 0);
+    params.threads = 2;
+    errors += (farmhash64_cdc_run(0, &params, &index, NULL, NULL, NULL) != FARMHASH64_CDC_ERR_ARGS);
+    params.threads = 3;
+    params.block_size = params.max_size - 1;
+    errors += (farmhash64_cdc_run(0, &params, &index, NULL, NULL, NULL) != FARMHASH64_CDC_ERR_ARGS);
+    errors += (farmhash64_cdc_run(0, NULL, &index, NULL, NULL, NULL) != FARMHASH64_CDC_ERR_ARGS);
+    farmhash64_cdc_index_free(&index);
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors\n", __func__, errors);
+    }
+    return errors;
+}
+
+int benchmark_farmhash64_cdc()
+{
+    int errors = 0;
+    char *data = (char *)malloc(k_bench_size);
+    make_data(data, k_bench_size, 0xfedcba9876543210ULL);
+    int fd = temp_file(data, k_bench_size);
+    farmhash64_cdc_params_t params;
+    farmhash64_cdc_default_params(&params);
+    farmhash64_cdc_chunker_t ch;
+    farmhash64_cdc_chunker_init(&ch, &params);
+    // boundary detection alone, from memory
+    uint64_t tstart = get_time();
+    size_t pos = 0;
+    while (pos < k_bench_size)
+    {
+        pos += farmhash64_cdc_cut(&ch, (const uint8_t *)data + pos, k_bench_size - pos);
+    }
+    uint64_t t = get_time() - tstart;
+    fprintf(stdout, " * %s : boundary detection only : %6.2f GB/s\n", __func__, (double)k_bench_size / (double)t);
+    const unsigned threads[] = {1, 3};
+    size_t k;
+    for (k = 0; k < 2; k++)
+    {
+        params.threads = threads[k];
+        farmhash64_cdc_index_t index;
+        farmhash64_cdc_index_init(&index, 0);
+        farmhash64_cdc_stats_t stats;
+        lseek(fd, 0, SEEK_SET);
+        tstart = get_time();
+        errors += (farmhash64_cdc_run(fd, &params, &index, NULL, NULL, &stats) != FARMHASH64_CDC_OK);
+        t = get_time() - tstart;
+        errors += (stats.bytes != k_bench_size);
+        fprintf(stdout, " * %s : %s : %6.2f GB/s : %lu chunks\n", __func__, (threads[k] == 1) ? "serial   " : "pipelined", (double)k_bench_size / (double)t, (unsigned long)stats.chunks);
+        farmhash64_cdc_index_free(&index);
+    }
+    close(fd);
+    free(data);
+    return errors;
+}
+
+int main()
+{
+    int errors = 0;
+
+    errors += test_farmhash64_cdc_cut();
+    errors += test_farmhash64_cdc_run();
+    errors += benchmark_farmhash64_cdc();
+
+    return errors;
+}
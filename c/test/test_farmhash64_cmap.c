@@ -0,0 +1,303 @@
+// Nicola Asuni
+
+#if __STDC_VERSION__ >= 199901L
+#define _XOPEN_SOURCE 600
+#else
+#define _XOPEN_SOURCE 500
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../src/farmhash64_cmap.h"
+
+#define BENCH_MAX_THREADS 64
+
+static const uint64_t k_bench_keys = 1 << 16;
+static const uint64_t k_bench_ops = 1 << 18;
+
+// returns current time in nanoseconds
+uint64_t get_time()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (((uint64_t)t.tv_sec * 1000000000) + (uint64_t)t.tv_nsec);
+}
+
+int test_farmhash64_cmap_basic()
+{
+    int errors = 0;
+    farmhash64_cmap_t map;
+    uint64_t v = 0;
+    uint64_t i;
+    if (farmhash64_cmap_init(&map, 2, 4) != FARMHASH64_CMAP_OK)
+    {
+        fprintf(stderr, "%s : init error\n", __func__);
+        return 1;
+    }
+    // enough keys to force several resizes of every shard
+    for (i = 0; i < 10000; i++)
+    {
+        if (farmhash64_cmap_put(&map, i, i * 3) != 1)
+        {
+            fprintf(stderr, "%s : unable to insert key %lu\n", __func__, i);
+            ++errors;
+        }
+    }
+    if (farmhash64_cmap_put(&map, 5, 55) != 0)
+    {
+        fprintf(stderr, "%s : expected update of key 5\n", __func__);
+        ++errors;
+    }
+    if ((farmhash64_cmap_get(&map, 0, 5, &v) != 1) || (v != 55))
+    {
+        fprintf(stderr, "%s : expected value 55 for key 5, got %lu\n", __func__, v);
+        ++errors;
+    }
+    for (i = 0; i < 10000; i += 2)
+    {
+        errors += (farmhash64_cmap_del(&map, i) != 1);
+    }
+    errors += (farmhash64_cmap_del(&map, 0) != 0);
+    errors += (farmhash64_cmap_size(&map) != 5000);
+    for (i = 0; i < 10000; i++)
+    {
+        int found = farmhash64_cmap_get(&map, 0, i, &v);
+        if ((found != (int)(i & 1)) || (found && (v != ((i == 5) ? 55 : i * 3))))
+        {
+            fprintf(stderr, "%s : unexpected lookup result for key %lu\n", __func__, i);
+            ++errors;
+            break;
+        }
+    }
+    // revive deleted keys
+    errors += (farmhash64_cmap_put(&map, 2, 7) != 1);
+    errors += ((farmhash64_cmap_get(&map, 0, 2, &v) != 1) || (v != 7));
+    errors += (farmhash64_cmap_size(&map) != 5001);
+    errors += (farmhash64_cmap_init(&map, FARMHASH64_CMAP_MAX_SHARD_BITS + 1, 4) != FARMHASH64_CMAP_ERR_ARGS);
+    farmhash64_cmap_destroy(&map);
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors\n", __func__, errors);
+    }
+    return errors;
+}
+
+#define TEST_THREADS 8
+
+static const uint64_t k_test_keys = 20000;
+
+typedef struct test_task_t
+{
+    farmhash64_cmap_t *map;
+    unsigned id;
+    int phase;
+    uint64_t inserted; // number of puts that returned 1
+    uint64_t deleted;  // number of dels that returned 1
+    int errors;
+} test_task_t;
+
+// All the threads walk the same keys, each one from a different starting point.
+// Phase 0: insert [0, k_test_keys) and read them back.
+// Phase 1: delete the multiples of 3, insert [k_test_keys, 2 * k_test_keys), read [0, k_test_keys).
+static void *test_worker(void *arg)
+{
+    test_task_t *t = (test_task_t *)arg;
+    uint64_t start = k_test_keys * t->id / TEST_THREADS;
+    uint64_t i;
+    uint64_t v;
+    int r;
+    for (i = 0; i < k_test_keys; i++)
+    {
+        uint64_t key = (start + i) % k_test_keys;
+        if (t->phase == 0)
+        {
+            r = farmhash64_cmap_put(t->map, key, key * 3);
+            t->inserted += (r == 1);
+            t->errors += (r < 0);
+            if ((farmhash64_cmap_get(t->map, t->id, key, &v) != 1) || (v != key * 3))
+            {
+                t->errors++;
+            }
+            continue;
+        }
+        if ((key % 3) == 0)
+        {
+            t->deleted += (uint64_t)farmhash64_cmap_del(t->map, key);
+        }
+        r = farmhash64_cmap_put(t->map, k_test_keys + key, key * 5);
+        t->inserted += (r == 1);
+        t->errors += (r < 0);
+        // read in the opposite direction, racing with the deletes of the other threads
+        uint64_t rkey = (start + k_test_keys - i) % k_test_keys;
+        r = farmhash64_cmap_get(t->map, t->id, rkey, &v);
+        if (((r == 0) && ((rkey % 3) != 0)) || ((r == 1) && (v != rkey * 3)))
+        {
+            t->errors++;
+        }
+    }
+    return NULL;
+}
+
+static int run_test_phase(farmhash64_cmap_t *map, int phase, uint64_t *inserted, uint64_t *deleted)
+{
+    pthread_t tid[TEST_THREADS];
+    test_task_t task[TEST_THREADS];
+    int errors = 0;
+    unsigned i;
+    *inserted = 0;
+    *deleted = 0;
+    for (i = 0; i < TEST_THREADS; i++)
+    {
+        memset(&task[i], 0, sizeof(task[i]));
+        task[i].map = map;
+        task[i].id = i;
+        task[i].phase = phase;
+        pthread_create(&tid[i], NULL, test_worker, &task[i]);
+    }
+    for (i = 0; i < TEST_THREADS; i++)
+    {
+        pthread_join(tid[i], NULL);
+        errors += task[i].errors;
+        *inserted += task[i].inserted;
+        *deleted += task[i].deleted;
+    }
+    return errors;
+}
+
+int test_farmhash64_cmap_threads()
+{
+    int errors = 0;
+    farmhash64_cmap_t map;
+    uint64_t inserted;
+    uint64_t deleted;
+    uint64_t v = 0;
+    uint64_t i;
+    // small shards, so that the tables are resized while the other threads read them
+    if (farmhash64_cmap_init(&map, 2, 4) != FARMHASH64_CMAP_OK)
+    {
+        fprintf(stderr, "%s : init error\n", __func__);
+        return 1;
+    }
+    errors += run_test_phase(&map, 0, &inserted, &deleted);
+    // each key is inserted by exactly one of the threads
+    if ((inserted != k_test_keys) || (farmhash64_cmap_size(&map) != k_test_keys))
+    {
+        fprintf(stderr, "%s : %lu keys inserted, size %lu, expected %lu\n", __func__, inserted, farmhash64_cmap_size(&map), k_test_keys);
+        ++errors;
+    }
+    errors += run_test_phase(&map, 1, &inserted, &deleted);
+    uint64_t ndel = (k_test_keys + 2) / 3;
+    if ((inserted != k_test_keys) || (deleted != ndel))
+    {
+        fprintf(stderr, "%s : %lu keys inserted and %lu deleted, expected %lu and %lu\n", __func__, inserted, deleted, k_test_keys, ndel);
+        ++errors;
+    }
+    if (farmhash64_cmap_size(&map) != (2 * k_test_keys) - ndel)
+    {
+        fprintf(stderr, "%s : size %lu, expected %lu\n", __func__, farmhash64_cmap_size(&map), (2 * k_test_keys) - ndel);
+        ++errors;
+    }
+    for (i = 0; i < 2 * k_test_keys; i++)
+    {
+        int exp_found = (i >= k_test_keys) || ((i % 3) != 0);
+        uint64_t exp_value = (i >= k_test_keys) ? (i - k_test_keys) * 5 : i * 3;
+        int found = farmhash64_cmap_get(&map, 0, i, &v);
+        if ((found != exp_found) || (found && (v != exp_value)))
+        {
+            fprintf(stderr, "%s : unexpected lookup result for key %lu\n", __func__, i);
+            ++errors;
+            break;
+        }
+    }
+    farmhash64_cmap_destroy(&map);
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors\n", __func__, errors);
+    }
+    return errors;
+}
+
+typedef struct bench_task_t
+{
+    farmhash64_cmap_t *map;
+    unsigned id;
+    unsigned nthreads;
+    int errors;
+} bench_task_t;
+
+// 90% reads, 10% writes on a shared key space; writer keys are partitioned by thread
+static void *bench_worker(void *arg)
+{
+    bench_task_t *t = (bench_task_t *)arg;
+    uint64_t x = 0x9e3779b97f4a7c15ULL * (t->id + 1);
+    uint64_t ops = k_bench_ops / t->nthreads;
+    uint64_t i;
+    uint64_t v = 0;
+    for (i = 0; i < ops; i++)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        uint64_t key = x % k_bench_keys;
+        if ((x >> 60) < 14)
+        {
+            if (farmhash64_cmap_get(t->map, t->id, key, &v) && (v != key))
+            {
+                t->errors++;
+            }
+        }
+        else
+        {
+            key = key - (key % t->nthreads) + t->id;
+            farmhash64_cmap_put(t->map, key, key);
+        }
+    }
+    return NULL;
+}
+
+int benchmark_farmhash64_cmap()
+{
+    int errors = 0;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned maxthreads = (ncpu < 1) ? 1 : ((ncpu > BENCH_MAX_THREADS) ? BENCH_MAX_THREADS : (unsigned)ncpu);
+    pthread_t tid[BENCH_MAX_THREADS];
+    bench_task_t task[BENCH_MAX_THREADS];
+    unsigned nt;
+    unsigned i;
+    for (nt = 1; nt <= maxthreads; nt = ((nt * 2 > maxthreads) && (nt < maxthreads)) ? maxthreads : nt * 2)
+    {
+        farmhash64_cmap_t map;
+        farmhash64_cmap_init(&map, 6, 16);
+        uint64_t tstart = get_time();
+        for (i = 0; i < nt; i++)
+        {
+            task[i].map = &map;
+            task[i].id = i;
+            task[i].nthreads = nt;
+            task[i].errors = 0;
+            pthread_create(&tid[i], NULL, bench_worker, &task[i]);
+        }
+        for (i = 0; i < nt; i++)
+        {
+            pthread_join(tid[i], NULL);
+            errors += task[i].errors;
+        }
+        uint64_t tend = get_time();
+        fprintf(stdout, " * %s : %2u threads : %8.2f Mops/s\n", __func__, nt, (double)k_bench_ops * 1000.0 / (double)(tend - tstart));
+        farmhash64_cmap_destroy(&map);
+    }
+    return errors;
+}
+
+int main()
+{
+    int errors = 0;
+
+    errors += test_farmhash64_cmap_basic();
+    errors += test_farmhash64_cmap_threads();
+    errors += benchmark_farmhash64_cmap();
+
+    return errors;
+}
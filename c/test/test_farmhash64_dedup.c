@@ -0,0 +1,422 @@
+// Nicola Asuni
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+#include "../src/farmhash64_dedup.h"
+
+#define BENCH_MAX_THREADS 64
+
+static const uint32_t k_bench_lines = 1 << 21;
+static const uint32_t k_bench_distinct = 1 << 18;
+
+// returns current time in nanoseconds
+uint64_t get_time()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (((uint64_t)t.tv_sec * 1000000000) + (uint64_t)t.tv_nsec);
+}
+
+// creates an unlinked temporary file
+static int temp_file()
+{
+    char path[] = "/tmp/test_farmhash64_dedup_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd >= 0)
+    {
+        unlink(path);
+    }
+    return fd;
+}
+
+// reads the whole content of a file
+static char *read_file(int fd, size_t *len)
+{
+    off_t size = lseek(fd, 0, SEEK_END);
+    char *buf = (char *)malloc((size_t)size + 1);
+    lseek(fd, 0, SEEK_SET);
+    *len = 0;
+    while (*len < (size_t)size)
+    {
+        ssize_t n = read(fd, buf + *len, (size_t)size - *len);
+        if (n <= 0)
+        {
+            break;
+        }
+        *len += (size_t)n;
+    }
+    return buf;
+}
+
+// writes nlines pseudorandom lines over ndistinct values to fd; returns the line keys
+static uint32_t *make_lines(int fd, uint32_t nlines, uint32_t ndistinct)
+{
+    uint32_t *keys = (uint32_t *)malloc(nlines * sizeof(uint32_t));
+    FILE *f = fdopen(dup(fd), "w");
+    uint64_t x = 0x9e3779b97f4a7c15ULL;
+    uint32_t i;
+    for (i = 0; i < nlines; i++)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        keys[i] = (uint32_t)(x % ndistinct);
+        // key 0 is the empty line
+        if (keys[i] == 0)
+        {
+            fputc('\n', f);
+        }
+        else
+        {
+            fprintf(f, "line-%u-%0*u\n", keys[i], (int)(keys[i] % 40), 7);
+        }
+    }
+    fclose(f);
+    lseek(fd, 0, SEEK_SET);
+    return keys;
+}
+
+// checks the output against the expected first occurrences of the keys
+static int check_output(const char *out, size_t len, const uint32_t *keys, uint32_t nlines, uint32_t ndistinct, int stable)
+{
+    char *seen = (char *)calloc(ndistinct, 1);
+    char *found = (char *)calloc(ndistinct, 1);
+    char line[128];
+    uint32_t i;
+    size_t pos = 0;
+    int errors = 0;
+    for (i = 0; (i < nlines) && (errors == 0); i++)
+    {
+        if (seen[keys[i]] && stable)
+        {
+            continue;
+        }
+        seen[keys[i]] = 1;
+        if (!stable)
+        {
+            continue;
+        }
+        // the next output line must be the first occurrence of this key
+        int n = (keys[i] == 0) ? 0 : snprintf(line, sizeof(line), "line-%u-%0*u", keys[i], (int)(keys[i] % 40), 7);
+        if ((pos + (size_t)n + 1 > len) || (memcmp(out + pos, line, (size_t)n) != 0) || (out[pos + (size_t)n] != '\n'))
+        {
+            fprintf(stderr, "%s : expected key %u at output offset %lu\n", __func__, keys[i], (unsigned long)pos);
+            ++errors;
+        }
+        pos += (size_t)n + 1;
+    }
+    if (!stable)
+    {
+        // every line must be a distinct expected key
+        while ((pos < len) && (errors == 0))
+        {
+            const char *e = (const char *)memchr(out + pos, '\n', len - pos);
+            unsigned k = 0;
+            if ((e == NULL) || ((e != out + pos) && (sscanf(out + pos, "line-%u-", &k) != 1)) || (k >= ndistinct) || !seen[k] || found[k])
+            {
+                fprintf(stderr, "%s : unexpected or duplicate line at output offset %lu\n", __func__, (unsigned long)pos);
+                ++errors;
+                break;
+            }
+            found[k] = 1;
+            pos = (size_t)(e - out) + 1;
+        }
+        for (i = 0; (i < ndistinct) && (errors == 0); i++)
+        {
+            errors += (seen[i] != found[i]);
+        }
+    }
+    errors += (pos != len);
+    free(seen);
+    free(found);
+    return errors;
+}
+
+int test_farmhash64_dedup_lines()
+{
+    int errors = 0;
+    const uint32_t nlines = 200000;
+    const uint32_t ndistinct = 60000;
+    int in = temp_file();
+    uint32_t *keys = make_lines(in, nlines, ndistinct);
+    uint32_t nref = 0;
+    char *seen = (char *)calloc(ndistinct, 1);
+    uint32_t i;
+    for (i = 0; i < nlines; i++)
+    {
+        nref += (seen[keys[i]] == 0);
+        seen[keys[i]] = 1;
+    }
+    free(seen);
+    // bits = 0 with the minimum budget forces the single partition to be split
+    const uint32_t bits[] = {0, 4, 8, 0};
+    const unsigned threads[] = {1, 3, 2, 1};
+    const int stable[] = {1, 0, 1, 0};
+    const int count_only[] = {0, 0, 0, 1};
+    size_t k;
+    for (k = 0; k < 4; k++)
+    {
+        farmhash64_dedup_opts_t opts;
+        farmhash64_dedup_stats_t stats;
+        farmhash64_dedup_default_opts(&opts);
+        opts.bits = bits[k];
+        opts.nthreads = threads[k];
+        opts.mem_bytes = (size_t)threads[k] * FARMHASH64_DEDUP_MIN_MEMORY;
+        opts.stable = stable[k];
+        opts.count_only = count_only[k];
+        int out = temp_file();
+        lseek(in, 0, SEEK_SET);
+        if (farmhash64_dedup_run(&in, 1, out, &opts, &stats) != FARMHASH64_DEDUP_OK)
+        {
+            fprintf(stderr, "%s (case %lu) : dedup error\n", __func__, (unsigned long)k);
+            ++errors;
+            close(out);
+            continue;
+        }
+        if ((stats.records != nlines) || (stats.distinct != nref))
+        {
+            fprintf(stderr, "%s (case %lu) : expected %u records and %u distinct, got %lu and %lu\n", __func__, (unsigned long)k, nlines, nref, (unsigned long)stats.records, (unsigned long)stats.distinct);
+            ++errors;
+        }
+        if ((bits[k] == 0) && (stats.splits == 0))
+        {
+            fprintf(stderr, "%s (case %lu) : expected partition splits\n", __func__, (unsigned long)k);
+            ++errors;
+        }
+        size_t len;
+        char *res = read_file(out, &len);
+        if (count_only[k])
+        {
+            errors += (len != 0);
+        }
+        else
+        {
+            errors += check_output(res, len, keys, nlines, ndistinct, stable[k]);
+        }
+        free(res);
+        close(out);
+    }
+    free(keys);
+    close(in);
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors\n", __func__, errors);
+    }
+    return errors;
+}
+
+int test_farmhash64_dedup_records()
+{
+    int errors = 0;
+    // NUL-delimited binary records over two inputs; the last record of each input has no delimiter
+    static const char in1[] = "b\nx\0a\0\0b\nx\0\xff\xfe";
+    static const char in2[] = "a\0c";
+    static const char expected[] = "b\nx\0a\0\0\xff\xfe\0c\0";
+    int fds[2];
+    fds[0] = temp_file();
+    fds[1] = temp_file();
+    errors += (write(fds[0], in1, sizeof(in1) - 1) != (ssize_t)(sizeof(in1) - 1));
+    errors += (write(fds[1], in2, sizeof(in2) - 1) != (ssize_t)(sizeof(in2) - 1));
+    lseek(fds[0], 0, SEEK_SET);
+    lseek(fds[1], 0, SEEK_SET);
+    farmhash64_dedup_opts_t opts;
+    farmhash64_dedup_stats_t stats;
+    farmhash64_dedup_default_opts(&opts);
+    opts.delim = 0;
+    opts.stable = 1;
+    opts.bits = 2;
+    opts.mem_bytes = 2 * FARMHASH64_DEDUP_MIN_MEMORY;
+    opts.nthreads = 2;
+    int out = temp_file();
+    if (farmhash64_dedup_run(fds, 2, out, &opts, &stats) != FARMHASH64_DEDUP_OK)
+    {
+        fprintf(stderr, "%s : dedup error\n", __func__);
+        ++errors;
+    }
+    else
+    {
+        size_t len;
+        char *res = read_file(out, &len);
+        if ((len != sizeof(expected) - 1) || (memcmp(res, expected, len) != 0) || (stats.records != 7) || (stats.distinct != 5))
+        {
+            fprintf(stderr, "%s : unexpected output (%lu bytes, %lu records, %lu distinct)\n", __func__, (unsigned long)len, (unsigned long)stats.records, (unsigned long)stats.distinct);
+            ++errors;
+        }
+        free(res);
+    }
+    close(out);
+    close(fds[0]);
+    close(fds[1]);
+    // empty input
+    out = temp_file();
+    errors += (farmhash64_dedup_run(NULL, 0, out, &opts, &stats) != FARMHASH64_DEDUP_OK) || (stats.records != 0) || (stats.distinct != 0);
+    close(out);
+    // invalid arguments
+    errors += (farmhash64_dedup_run(NULL, 0, 1, NULL, &stats) != FARMHASH64_DEDUP_ERR_ARGS);
+    opts.bits = FARMHASH64_DEDUP_MAX_BITS + 1;
+    errors += (farmhash64_dedup_run(NULL, 0, 1, &opts, &stats) != FARMHASH64_DEDUP_ERR_ARGS);
+    opts.bits = 2;
+    opts.nthreads = 0;
+    errors += (farmhash64_dedup_run(NULL, 0, 1, &opts, &stats) != FARMHASH64_DEDUP_ERR_ARGS);
+    opts.nthreads = 4;
+    errors += (farmhash64_dedup_run(NULL, 0, 1, &opts, &stats) != FARMHASH64_DEDUP_ERR_ARGS);
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors\n", __func__, errors);
+    }
+    return errors;
+}
+
+// a low limit on open files lowers the partitions and the threads, and merges the runs in several passes
+int test_farmhash64_dedup_files()
+{
+    int errors = 0;
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) != 0)
+    {
+        return 0;
+    }
+    const uint32_t nlines = 600000;
+    const uint32_t ndistinct = 600000;
+    int in = temp_file();
+    uint32_t *keys = make_lines(in, nlines, ndistinct);
+    farmhash64_dedup_opts_t opts;
+    farmhash64_dedup_stats_t stats;
+    farmhash64_dedup_default_opts(&opts);
+    opts.bits = FARMHASH64_DEDUP_MAX_BITS;
+    opts.mem_bytes = FARMHASH64_DEDUP_MIN_MEMORY;
+    opts.stable = 1;
+    int out = temp_file();
+    struct rlimit low = rl;
+    // room for the input and 17 temporary files: 16 partitions, 1 thread, 16 runs merged at once
+    low.rlim_cur = FARMHASH64_DEDUP_RESERVED_FILES + 1 + FARMHASH64_DEDUP_THREAD_FILES;
+    if ((rl.rlim_cur != RLIM_INFINITY) && (low.rlim_cur > rl.rlim_cur))
+    {
+        low.rlim_cur = rl.rlim_cur;
+    }
+    setrlimit(RLIMIT_NOFILE, &low);
+    int ret = farmhash64_dedup_run(&in, 1, out, &opts, &stats);
+    // the budget of the single thread that fits is the whole memory budget
+    farmhash64_dedup_stats_t count;
+    opts.nthreads = 4;
+    opts.mem_bytes = (size_t)4 * FARMHASH64_DEDUP_MIN_MEMORY;
+    opts.stable = 0;
+    opts.count_only = 1;
+    lseek(in, 0, SEEK_SET);
+    errors += (farmhash64_dedup_run(&in, 1, out, &opts, &count) != FARMHASH64_DEDUP_OK) || (count.nthreads != 1) || (count.splits >= stats.splits);
+    // not even one thread fits
+    low.rlim_cur--;
+    setrlimit(RLIMIT_NOFILE, &low);
+    lseek(in, 0, SEEK_SET);
+    errors += (farmhash64_dedup_run(&in, 1, out, &opts, NULL) != FARMHASH64_DEDUP_ERR_IO);
+    setrlimit(RLIMIT_NOFILE, &rl);
+    if (ret != FARMHASH64_DEDUP_OK)
+    {
+        fprintf(stderr, "%s : dedup error\n", __func__);
+        ++errors;
+    }
+    else
+    {
+        if ((stats.bits != 4) || (stats.nthreads != 1) || (stats.splits == 0) || (stats.records != nlines) || (count.distinct != stats.distinct))
+        {
+            fprintf(stderr, "%s : %u bits, %u threads, %lu splits, %lu records\n", __func__, stats.bits, stats.nthreads, (unsigned long)stats.splits, (unsigned long)stats.records);
+            ++errors;
+        }
+        size_t len;
+        char *res = read_file(out, &len);
+        errors += check_output(res, len, keys, nlines, ndistinct, 1);
+        free(res);
+    }
+    close(out);
+    close(in);
+    free(keys);
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors\n", __func__, errors);
+    }
+    return errors;
+}
+
+static int cmp_line(const void *a, const void *b)
+{
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+// Baseline: load all the lines in memory, sort them and skip the adjacent duplicates.
+static uint64_t bench_sort(int in, uint32_t *ndistinct)
+{
+    size_t len;
+    uint64_t tstart = get_time();
+    char *buf = read_file(in, &len);
+    char **lines = (char **)malloc(k_bench_lines * sizeof(char *));
+    uint32_t n = 0;
+    size_t pos = 0;
+    while ((pos < len) && (n < k_bench_lines))
+    {
+        char *e = (char *)memchr(buf + pos, '\n', len - pos);
+        *e = 0;
+        lines[n++] = buf + pos;
+        pos = (size_t)(e - buf) + 1;
+    }
+    qsort(lines, n, sizeof(char *), cmp_line);
+    uint32_t i;
+    *ndistinct = (n > 0);
+    for (i = 1; i < n; i++)
+    {
+        *ndistinct += (strcmp(lines[i], lines[i - 1]) != 0);
+    }
+    uint64_t t = get_time() - tstart;
+    free(lines);
+    free(buf);
+    return t;
+}
+
+int benchmark_farmhash64_dedup()
+{
+    int errors = 0;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned maxthreads = (ncpu < 1) ? 1 : ((ncpu > BENCH_MAX_THREADS) ? BENCH_MAX_THREADS : (unsigned)ncpu);
+    int in = temp_file();
+    uint32_t *keys = make_lines(in, k_bench_lines, k_bench_distinct);
+    double mb = (double)lseek(in, 0, SEEK_END) / 1e6;
+    uint32_t nsort;
+    uint64_t tsort = bench_sort(in, &nsort);
+    fprintf(stdout, " * %s : in-memory sort baseline : %8.2f MB/s\n", __func__, mb * 1e9 / (double)tsort);
+    int out = open("/dev/null", O_WRONLY);
+    unsigned nt;
+    for (nt = 1; nt <= maxthreads; nt = ((nt * 2 > maxthreads) && (nt < maxthreads)) ? maxthreads : nt * 2)
+    {
+        farmhash64_dedup_opts_t opts;
+        farmhash64_dedup_stats_t stats;
+        farmhash64_dedup_default_opts(&opts);
+        opts.nthreads = nt;
+        opts.mem_bytes = (size_t)256 << 20;
+        lseek(in, 0, SEEK_SET);
+        uint64_t tstart = get_time();
+        errors += (farmhash64_dedup_run(&in, 1, out, &opts, &stats) != FARMHASH64_DEDUP_OK);
+        uint64_t t = get_time() - tstart;
+        errors += (stats.distinct != nsort);
+        fprintf(stdout, " * %s : %2u threads : external dedup %8.2f MB/s : speedup %5.2f\n", __func__, nt, mb * 1e9 / (double)t, (double)tsort / (double)t);
+    }
+    close(out);
+    close(in);
+    free(keys);
+    return errors;
+}
+
+int main()
+{
+    int errors = 0;
+
+    errors += test_farmhash64_dedup_lines();
+    errors += test_farmhash64_dedup_records();
+    errors += test_farmhash64_dedup_files();
+    errors += benchmark_farmhash64_dedup();
+
+    return errors;
+}
@@ -0,0 +1,300 @@
+// Nicola Asuni
+
+#define _DEFAULT_SOURCE
+
+// small address space reservations, so that the tests move the mapping when the file grows
+#define FARMHASH64_FPINDEX_MIN_RESERVE 64
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "../src/farmhash64_fpindex.h"
+
+static const uint64_t k_test_keys = 200000;
+static const uint64_t k_bench_keys = 2000000;
+static const uint64_t k_bench_lookups = 1000000;
+
+// returns current time in nanoseconds
+uint64_t get_time()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (((uint64_t)t.tv_sec * 1000000000) + (uint64_t)t.tv_nsec);
+}
+
+// hash of the key number i, as a store would compute it
+static uint64_t key_hash(uint64_t i)
+{
+    char key[32];
+    size_t len = (size_t)snprintf(key, sizeof(key), "user:%lu", (unsigned long)i);
+    return farmhash64(key, (len < sizeof(key)) ? len : sizeof(key) - 1);
+}
+
+// number of page faults of the process
+static uint64_t page_faults()
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (uint64_t)(ru.ru_minflt + ru.ru_majflt);
+}
+
+// checks that every key i < n maps to offset i * 100 (plus delta for the keys multiple of 3)
+static int check_keys(const farmhash64_fpindex_t *idx, uint64_t n, uint64_t delta)
+{
+    uint64_t i;
+    uint64_t off[4];
+    for (i = 0; i < n; i++)
+    {
+        uint64_t want = (i * 100) + (((i % 3) == 0) ? delta : 0);
+        size_t c = farmhash64_fpindex_get(idx, key_hash(i), off, 4);
+        if ((c != 1) || (off[0] != want))
+        {
+            fprintf(stderr, "%s : key %lu: %lu offsets, first %lu, expected %lu\n", __func__, (unsigned long)i, (unsigned long)c, (unsigned long)off[0], (unsigned long)want);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int test_farmhash64_fpindex_basic(const char *dir)
+{
+    int errors = 0;
+    char path[256];
+    snprintf(path, sizeof(path), "%s/basic.idx", dir);
+    farmhash64_fpindex_t idx;
+    // undersized on purpose: most buckets need overflow pages
+    if (farmhash64_fpindex_open(&idx, path, k_test_keys / 4) != FARMHASH64_FPINDEX_OK)
+    {
+        fprintf(stderr, "%s : open error\n", __func__);
+        return 1;
+    }
+    uint64_t i;
+    for (i = 0; i < k_test_keys; i++)
+    {
+        errors += (farmhash64_fpindex_put(&idx, key_hash(i), i * 100) != FARMHASH64_FPINDEX_OK);
+    }
+    // inserting the same pairs again has no effect
+    for (i = 0; i < k_test_keys; i += 7)
+    {
+        errors += (farmhash64_fpindex_put(&idx, key_hash(i), i * 100) != FARMHASH64_FPINDEX_OK);
+    }
+    errors += check_keys(&idx, k_test_keys, 0);
+    errors += (farmhash64_fpindex_get(&idx, key_hash(k_test_keys + 1), NULL, 0) != 0);
+    farmhash64_fpindex_stats_t st;
+    farmhash64_fpindex_stats(&idx, &st);
+    errors += (st.entries != k_test_keys) || (st.overflow_pages == 0);
+    // update, delete, reinsert
+    for (i = 0; i < k_test_keys; i += 3)
+    {
+        errors += (farmhash64_fpindex_replace(&idx, key_hash(i), i * 100, (i * 100) + 1) != FARMHASH64_FPINDEX_OK);
+    }
+    errors += (farmhash64_fpindex_replace(&idx, key_hash(1), 12345, 1) != FARMHASH64_FPINDEX_ERR_NOTFOUND);
+    errors += check_keys(&idx, k_test_keys, 1);
+    errors += (farmhash64_fpindex_del(&idx, key_hash(5), 500) != FARMHASH64_FPINDEX_OK);
+    errors += (farmhash64_fpindex_get(&idx, key_hash(5), NULL, 0) != 0);
+    errors += (farmhash64_fpindex_put(&idx, key_hash(5), 500) != FARMHASH64_FPINDEX_OK);
+    // several offsets for one hash (colliding keys)
+    errors += (farmhash64_fpindex_put(&idx, 0, 7) != FARMHASH64_FPINDEX_OK);
+    errors += (farmhash64_fpindex_put(&idx, 0, 8) != FARMHASH64_FPINDEX_OK);
+    errors += (farmhash64_fpindex_put(&idx, 0, FARMHASH64_FPINDEX_DELETED) != FARMHASH64_FPINDEX_ERR_ARGS);
+    uint64_t off[4];
+    errors += (farmhash64_fpindex_get(&idx, 0, off, 4) != 2) || (off[0] != 7) || (off[1] != 8);
+    errors += (farmhash64_fpindex_sync(&idx, 4242) != FARMHASH64_FPINDEX_OK);
+    farmhash64_fpindex_close(&idx);
+    // reopen: the capacity is ignored and nothing is scanned
+    if (farmhash64_fpindex_open(&idx, path, 1) != FARMHASH64_FPINDEX_OK)
+    {
+        fprintf(stderr, "%s : reopen error\n", __func__);
+        return errors + 1;
+    }
+    errors += (farmhash64_fpindex_checkpoint(&idx) != 4242);
+    errors += check_keys(&idx, k_test_keys, 1);
+    farmhash64_fpindex_stats_t st2;
+    farmhash64_fpindex_stats(&idx, &st2);
+    errors += (st2.entries != k_test_keys + 2) || (st2.overflow_pages != st.overflow_pages);
+    farmhash64_fpindex_close(&idx);
+    // not an index
+    FILE *f = fopen(path, "r+");
+    fputs("garbage!", f);
+    fclose(f);
+    errors += (farmhash64_fpindex_open(&idx, path, 1) != FARMHASH64_FPINDEX_ERR_FORMAT);
+    unlink(path);
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors\n", __func__, errors);
+    }
+    return errors;
+}
+
+int test_farmhash64_fpindex_grow(const char *dir)
+{
+    int errors = 0;
+    char path[256];
+    snprintf(path, sizeof(path), "%s/grow.idx", dir);
+    farmhash64_fpindex_t idx;
+    // 4 buckets and 64 reserved pages: the overflow pages outgrow the reservation several times
+    if (farmhash64_fpindex_open(&idx, path, FARMHASH64_FPINDEX_BUCKET_FILL * 4) != FARMHASH64_FPINDEX_OK)
+    {
+        fprintf(stderr, "%s : open error\n", __func__);
+        return 1;
+    }
+    errors += (idx.reserved_pages != FARMHASH64_FPINDEX_MIN_RESERVE);
+    const uint64_t n1 = 30000;
+    const uint64_t n2 = 150000;
+    uint64_t i;
+    for (i = 0; i < n1; i++)
+    {
+        errors += (farmhash64_fpindex_put(&idx, key_hash(i), i * 100) != FARMHASH64_FPINDEX_OK);
+    }
+    errors += (idx.reserved_pages <= FARMHASH64_FPINDEX_MIN_RESERVE);
+    errors += check_keys(&idx, n1, 0);
+    farmhash64_fpindex_close(&idx);
+    // reopen: the reservation leaves room for the file to double
+    if (farmhash64_fpindex_open(&idx, path, 1) != FARMHASH64_FPINDEX_OK)
+    {
+        fprintf(stderr, "%s : reopen error\n", __func__);
+        return errors + 1;
+    }
+    uint64_t reserved = idx.reserved_pages;
+    errors += (reserved < 2 * idx.mapped_pages);
+    errors += check_keys(&idx, n1, 0);
+    for (i = n1; i < n2; i++)
+    {
+        errors += (farmhash64_fpindex_put(&idx, key_hash(i), i * 100) != FARMHASH64_FPINDEX_OK);
+    }
+    if ((idx.reserved_pages <= reserved) || (check_keys(&idx, n2, 0) != 0))
+    {
+        fprintf(stderr, "%s : the index did not grow after reopening\n", __func__);
+        ++errors;
+    }
+    farmhash64_fpindex_stats_t st;
+    farmhash64_fpindex_stats(&idx, &st);
+    errors += (st.entries != n2);
+    farmhash64_fpindex_close(&idx);
+    unlink(path);
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors\n", __func__, errors);
+    }
+    return errors;
+}
+
+int test_farmhash64_fpindex_crash(const char *dir)
+{
+    int errors = 0;
+    char path[256];
+    snprintf(path, sizeof(path), "%s/crash.idx", dir);
+    // the child process dies without syncing or closing the index
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        farmhash64_fpindex_t idx;
+        if (farmhash64_fpindex_open(&idx, path, k_test_keys / 2) != FARMHASH64_FPINDEX_OK)
+        {
+            _exit(1);
+        }
+        uint64_t i;
+        for (i = 0; i < k_test_keys; i++)
+        {
+            farmhash64_fpindex_put(&idx, key_hash(i), i * 100);
+        }
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    errors += (!WIFEXITED(status) || (WEXITSTATUS(status) != 0));
+    farmhash64_fpindex_t idx;
+    if (farmhash64_fpindex_open(&idx, path, 1) != FARMHASH64_FPINDEX_OK)
+    {
+        fprintf(stderr, "%s : reopen error\n", __func__);
+        return errors + 1;
+    }
+    errors += check_keys(&idx, k_test_keys, 0);
+    errors += (farmhash64_fpindex_checkpoint(&idx) != 0);
+    farmhash64_fpindex_close(&idx);
+    unlink(path);
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors\n", __func__, errors);
+    }
+    return errors;
+}
+
+int benchmark_farmhash64_fpindex(const char *dir)
+{
+    int errors = 0;
+    char path[256];
+    snprintf(path, sizeof(path), "%s/bench.idx", dir);
+    uint64_t *hashes = (uint64_t *)malloc(k_bench_keys * sizeof(uint64_t));
+    uint64_t i;
+    for (i = 0; i < k_bench_keys; i++)
+    {
+        hashes[i] = key_hash(i);
+    }
+    farmhash64_fpindex_t idx;
+    errors += (farmhash64_fpindex_open(&idx, path, k_bench_keys) != FARMHASH64_FPINDEX_OK);
+    uint64_t tstart = get_time();
+    for (i = 0; i < k_bench_keys; i++)
+    {
+        errors += (farmhash64_fpindex_put(&idx, hashes[i], i) != FARMHASH64_FPINDEX_OK);
+    }
+    uint64_t tput = get_time() - tstart;
+    farmhash64_fpindex_stats_t st;
+    farmhash64_fpindex_stats(&idx, &st);
+    farmhash64_fpindex_close(&idx);
+    // reopen and measure the first lookups (cold mapping) and the following ones
+    tstart = get_time();
+    errors += (farmhash64_fpindex_open(&idx, path, 0) != FARMHASH64_FPINDEX_OK);
+    uint64_t topen = get_time() - tstart;
+    uint64_t x = 88172645463325252ULL;
+    uint64_t cold = st.buckets / 4;
+    uint64_t sum = 0;
+    uint64_t off;
+    uint64_t faults = page_faults();
+    for (i = 0; i < cold; i++)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        sum += farmhash64_fpindex_get(&idx, hashes[x % k_bench_keys], &off, 1);
+    }
+    faults = page_faults() - faults;
+    tstart = get_time();
+    for (i = 0; i < k_bench_lookups; i++)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        sum += farmhash64_fpindex_get(&idx, hashes[x % k_bench_keys], &off, 1);
+    }
+    uint64_t tget = get_time() - tstart;
+    errors += (sum != cold + k_bench_lookups);
+    fprintf(stdout, " * %s : %lu entries, %lu buckets, %lu overflow pages, %.1f MiB\n", __func__, (unsigned long)st.entries, (unsigned long)st.buckets, (unsigned long)st.overflow_pages, (double)st.file_bytes / (1 << 20));
+    fprintf(stdout, " * %s : put %.1f ns/op, open %.1f us, get %.1f ns/op, %.2f page faults per cold lookup\n", __func__, (double)tput / k_bench_keys, (double)topen / 1000, (double)tget / k_bench_lookups, (double)faults / cold);
+    farmhash64_fpindex_close(&idx);
+    unlink(path);
+    free(hashes);
+    return errors;
+}
+
+int main()
+{
+    int errors = 0;
+    char dir[] = "/tmp/test_farmhash64_fpindex_XXXXXX";
+    if (mkdtemp(dir) == NULL)
+    {
+        fprintf(stderr, "unable to create a temporary directory\n");
+        return 1;
+    }
+
+    errors += test_farmhash64_fpindex_basic(dir);
+    errors += test_farmhash64_fpindex_grow(dir);
+    errors += test_farmhash64_fpindex_crash(dir);
+    errors += benchmark_farmhash64_fpindex(dir);
+
+    rmdir(dir);
+    return errors;
+}
@@ -0,0 +1,482 @@
+// Nicola Asuni
+
+#if __STDC_VERSION__ >= 199901L
+#define _XOPEN_SOURCE 600
+#else
+#define _XOPEN_SOURCE 500
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../src/farmhash64_fpset.h"
+
+#define BENCH_MAX_THREADS 64
+
+static const size_t k_bench_sort = 1 << 22;
+static const size_t k_bench_set = 1 << 20;
+static const size_t k_bench_small = 256;
+static const size_t k_bench_pairs = 1 << 16;
+
+// returns current time in nanoseconds
+uint64_t get_time()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (((uint64_t)t.tv_sec * 1000000000) + (uint64_t)t.tv_nsec);
+}
+
+static uint64_t xorshift(uint64_t *x)
+{
+    *x ^= *x << 13;
+    *x ^= *x >> 7;
+    *x ^= *x << 17;
+    return *x;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// reference sort with duplicate removal
+static size_t ref_sort(uint64_t *v, size_t n)
+{
+    qsort(v, n, sizeof(uint64_t), cmp_u64);
+    size_t k = 0;
+    size_t i;
+    for (i = 0; i < n; i++)
+    {
+        if ((k == 0) || (v[i] != v[k - 1]))
+        {
+            v[k++] = v[i];
+        }
+    }
+    return k;
+}
+
+// reference merge intersection (and union size)
+static size_t ref_intersect(const uint64_t *a, size_t na, const uint64_t *b, size_t nb, uint64_t *out)
+{
+    size_t i = 0;
+    size_t j = 0;
+    size_t c = 0;
+    while ((i < na) && (j < nb))
+    {
+        if (a[i] < b[j])
+        {
+            i++;
+        }
+        else if (a[i] > b[j])
+        {
+            j++;
+        }
+        else
+        {
+            if (out != NULL)
+            {
+                out[c] = a[i];
+            }
+            c++;
+            i++;
+            j++;
+        }
+    }
+    return c;
+}
+
+// builds a set of n distinct values: the values of a shared pool selected with probability share, and random ones
+static size_t make_set(uint64_t *v, size_t n, const uint64_t *pool, size_t npool, unsigned share, uint64_t *seed)
+{
+    size_t i;
+    for (i = 0; i < n; i++)
+    {
+        uint64_t r = xorshift(seed);
+        v[i] = ((r % 100) < share) ? pool[(r >> 8) % npool] : xorshift(seed);
+    }
+    return ref_sort(v, n);
+}
+
+// values with duplicates, and either random or with few distinct top bytes
+static void make_values(uint64_t *v, size_t n, int mode, uint64_t *seed)
+{
+    size_t i;
+    for (i = 0; i < n; i++)
+    {
+        uint64_t r = xorshift(seed);
+        switch (mode)
+        {
+        case 0:
+            v[i] = r;
+            break;
+        case 1:
+            v[i] = r % (n / 2 + 1); // top bytes all zero, many duplicates
+            break;
+        default:
+            v[i] = (i & 1) ? v[i / 2] : (r | 0xFF00000000000000ULL);
+            break;
+        }
+    }
+}
+
+int test_farmhash64_fpset_sort()
+{
+    int errors = 0;
+    static const size_t sizes[] = {0, 1, 2, 63, 64, 65, 1000, 100000, 300001};
+    static const unsigned threads[] = {1, 3, 8};
+    uint64_t seed = 0x9e3779b97f4a7c15ULL;
+    size_t maxn = 300001;
+    uint64_t *v = (uint64_t *)malloc(maxn * sizeof(uint64_t));
+    uint64_t *ref = (uint64_t *)malloc(maxn * sizeof(uint64_t));
+    size_t s;
+    int mode;
+    unsigned t;
+    for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        for (mode = 0; mode < 3; mode++)
+        {
+            for (t = 0; t < sizeof(threads) / sizeof(threads[0]); t++)
+            {
+                size_t n = sizes[s];
+                make_values(v, n, mode, &seed);
+                memcpy(ref, v, n * sizeof(uint64_t));
+                size_t nref = ref_sort(ref, n);
+                size_t nunique = 0;
+                if (farmhash64_fpset_sort(v, n, threads[t], &nunique) != FARMHASH64_FPSET_OK)
+                {
+                    fprintf(stderr, "%s (n=%lu mode=%d threads=%u) : sort error\n", __func__, n, mode, threads[t]);
+                    ++errors;
+                    continue;
+                }
+                if ((nunique != nref) || ((n > 0) && (memcmp(v, ref, nref * sizeof(uint64_t)) != 0)))
+                {
+                    fprintf(stderr, "%s (n=%lu mode=%d threads=%u) : wrong result\n", __func__, n, mode, threads[t]);
+                    ++errors;
+                }
+            }
+        }
+    }
+    size_t nunique;
+    errors += (farmhash64_fpset_sort(v, 10, 0, &nunique) != FARMHASH64_FPSET_ERR_ARGS);
+    errors += (farmhash64_fpset_sort(NULL, 10, 1, &nunique) != FARMHASH64_FPSET_ERR_ARGS);
+    errors += (farmhash64_fpset_sort(v, 10, 1, NULL) != FARMHASH64_FPSET_ERR_ARGS);
+    free(v);
+    free(ref);
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors\n", __func__, errors);
+    }
+    return errors;
+}
+
+int test_farmhash64_fpset_intersect()
+{
+    int errors = 0;
+    static const size_t sizes[][2] = {{0, 0}, {0, 10}, {1, 1}, {3, 5}, {7, 9}, {100, 100}, {1000, 1237}, {4000, 300}, {50, 5000}, {3, 100000}, {20000, 20011}};
+    static const unsigned shares[] = {0, 30, 90, 100};
+    uint64_t seed = 0x2545f4914f6cdd1dULL;
+    size_t npool = 2000;
+    uint64_t *pool = (uint64_t *)malloc(npool * sizeof(uint64_t));
+    uint64_t *a = (uint64_t *)malloc(100000 * sizeof(uint64_t));
+    uint64_t *b = (uint64_t *)malloc(100000 * sizeof(uint64_t));
+    uint64_t *out = (uint64_t *)malloc(200000 * sizeof(uint64_t));
+    uint64_t *ref = (uint64_t *)malloc(200000 * sizeof(uint64_t));
+    size_t i;
+    for (i = 0; i < npool; i++)
+    {
+        pool[i] = xorshift(&seed);
+    }
+    // extreme values
+    pool[0] = 0;
+    pool[1] = UINT64_MAX;
+    size_t s;
+    unsigned h;
+    for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        for (h = 0; h < sizeof(shares) / sizeof(shares[0]); h++)
+        {
+            size_t na = make_set(a, sizes[s][0], pool, (shares[h] == 100) ? 64 : npool, shares[h], &seed);
+            size_t nb = make_set(b, sizes[s][1], pool, (shares[h] == 100) ? 64 : npool, shares[h], &seed);
+            size_t nref = ref_intersect(a, na, b, nb, ref);
+            size_t c = farmhash64_fpset_intersect(a, na, b, nb, out);
+            if ((c != nref) || (memcmp(out, ref, nref * sizeof(uint64_t)) != 0))
+            {
+                fprintf(stderr, "%s (%lu x %lu, %u%%) : wrong intersection\n", __func__, na, nb, shares[h]);
+                ++errors;
+            }
+            if ((farmhash64_fpset_intersect_count(a, na, b, nb) != nref) || (farmhash64_fpset_intersect_count(b, nb, a, na) != nref))
+            {
+                fprintf(stderr, "%s (%lu x %lu, %u%%) : wrong intersection size\n", __func__, na, nb, shares[h]);
+                ++errors;
+            }
+            // union: merge the two sets and sort them as reference
+            memcpy(ref, a, na * sizeof(uint64_t));
+            memcpy(ref + na, b, nb * sizeof(uint64_t));
+            size_t nu = ref_sort(ref, na + nb);
+            c = farmhash64_fpset_union(a, na, b, nb, out);
+            if ((c != nu) || (memcmp(out, ref, nu * sizeof(uint64_t)) != 0))
+            {
+                fprintf(stderr, "%s (%lu x %lu, %u%%) : wrong union\n", __func__, na, nb, shares[h]);
+                ++errors;
+            }
+            if ((farmhash64_fpset_union(a, na, b, nb, NULL) != nu) || (farmhash64_fpset_union_count(b, nb, a, na) != nu))
+            {
+                fprintf(stderr, "%s (%lu x %lu, %u%%) : wrong union size\n", __func__, na, nb, shares[h]);
+                ++errors;
+            }
+            double jref = (nu == 0) ? 1.0 : (double)nref / (double)nu;
+            if (farmhash64_fpset_jaccard(a, na, b, nb) != jref)
+            {
+                fprintf(stderr, "%s (%lu x %lu, %u%%) : wrong Jaccard similarity\n", __func__, na, nb, shares[h]);
+                ++errors;
+            }
+        }
+    }
+    free(pool);
+    free(a);
+    free(b);
+    free(out);
+    free(ref);
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors\n", __func__, errors);
+    }
+    return errors;
+}
+
+int test_farmhash64_fpset_merge()
+{
+    int errors = 0;
+    static const size_t counts[] = {0, 1, 2, 3, 5, 33};
+    uint64_t seed = 0x853c49e6748fea9bULL;
+    size_t npool = 500;
+    uint64_t pool[500];
+    uint64_t *sets[33];
+    size_t sizes[33];
+    uint64_t *out = (uint64_t *)malloc(33 * 1000 * sizeof(uint64_t));
+    uint64_t *ref = (uint64_t *)malloc(33 * 1000 * sizeof(uint64_t));
+    size_t i;
+    for (i = 0; i < npool; i++)
+    {
+        pool[i] = xorshift(&seed);
+    }
+    for (i = 0; i < 33; i++)
+    {
+        sets[i] = (uint64_t *)malloc(1000 * sizeof(uint64_t));
+    }
+    size_t c;
+    for (c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+    {
+        size_t k = counts[c];
+        size_t total = 0;
+        for (i = 0; i < k; i++)
+        {
+            // some empty sets
+            sizes[i] = make_set(sets[i], (i % 4 == 3) ? 0 : (xorshift(&seed) % 1000), pool, npool, 50, &seed);
+            memcpy(ref + total, sets[i], sizes[i] * sizeof(uint64_t));
+            total += sizes[i];
+        }
+        size_t nref = ref_sort(ref, total);
+        size_t nout = 0;
+        size_t ncount = 0;
+        if ((farmhash64_fpset_merge((const uint64_t *const *)sets, sizes, k, out, &nout) != FARMHASH64_FPSET_OK) ||
+            (farmhash64_fpset_merge((const uint64_t *const *)sets, sizes, k, NULL, &ncount) != FARMHASH64_FPSET_OK))
+        {
+            fprintf(stderr, "%s (k=%lu) : merge error\n", __func__, k);
+            ++errors;
+            continue;
+        }
+        if ((nout != nref) || (ncount != nref) || (memcmp(out, ref, nref * sizeof(uint64_t)) != 0))
+        {
+            fprintf(stderr, "%s (k=%lu) : wrong union\n", __func__, k);
+            ++errors;
+        }
+    }
+    errors += (farmhash64_fpset_merge(NULL, sizes, 2, out, NULL) != FARMHASH64_FPSET_ERR_ARGS);
+    errors += (farmhash64_fpset_merge(NULL, sizes, 2, out, &c) != FARMHASH64_FPSET_ERR_ARGS);
+    for (i = 0; i < 33; i++)
+    {
+        free(sets[i]);
+    }
+    free(out);
+    free(ref);
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors\n", __func__, errors);
+    }
+    return errors;
+}
+
+// branchy scalar merge, as in the jobs the module replaces
+static size_t bench_merge_count(const uint64_t *a, size_t na, const uint64_t *b, size_t nb)
+{
+    return ref_intersect(a, na, b, nb, NULL);
+}
+
+int benchmark_farmhash64_fpset_sort()
+{
+    int errors = 0;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned maxthreads = (ncpu < 1) ? 1 : ((ncpu > BENCH_MAX_THREADS) ? BENCH_MAX_THREADS : (unsigned)ncpu);
+    uint64_t *v = (uint64_t *)malloc(k_bench_sort * sizeof(uint64_t));
+    uint64_t *ref = (uint64_t *)malloc(k_bench_sort * sizeof(uint64_t));
+    uint64_t seed = 0x9e3779b97f4a7c15ULL;
+    size_t i;
+    for (i = 0; i < k_bench_sort; i++)
+    {
+        // about 10% duplicates
+        v[i] = farmhash64_with_seed("", 0, xorshift(&seed) % (k_bench_sort * 5));
+    }
+    memcpy(ref, v, k_bench_sort * sizeof(uint64_t));
+    uint64_t tstart = get_time();
+    size_t nref = ref_sort(ref, k_bench_sort);
+    uint64_t tqsort = get_time() - tstart;
+    unsigned nt;
+    for (nt = 1; nt <= maxthreads; nt = ((nt * 2 > maxthreads) && (nt < maxthreads)) ? maxthreads : nt * 2)
+    {
+        uint64_t *w = (uint64_t *)malloc(k_bench_sort * sizeof(uint64_t));
+        memcpy(w, v, k_bench_sort * sizeof(uint64_t));
+        size_t nunique = 0;
+        tstart = get_time();
+        errors += (farmhash64_fpset_sort(w, k_bench_sort, nt, &nunique) != FARMHASH64_FPSET_OK);
+        uint64_t tsort = get_time() - tstart;
+        errors += ((nunique != nref) || (memcmp(w, ref, nref * sizeof(uint64_t)) != 0));
+        free(w);
+        fprintf(stdout, " * %s : %lu values : %2u threads : qsort %8.2f Mvalues/s : radix %8.2f Mvalues/s : speedup %5.2f\n",
+                __func__, k_bench_sort, nt, (double)k_bench_sort * 1000.0 / (double)tqsort, (double)k_bench_sort * 1000.0 / (double)tsort, (double)tqsort / (double)tsort);
+    }
+    free(v);
+    free(ref);
+    return errors;
+}
+
+int benchmark_farmhash64_fpset_intersect()
+{
+    int errors = 0;
+    uint64_t seed = 0x2545f4914f6cdd1dULL;
+    size_t npool = k_bench_set;
+    uint64_t *pool = (uint64_t *)malloc(npool * sizeof(uint64_t));
+    uint64_t *a = (uint64_t *)malloc(k_bench_set * sizeof(uint64_t));
+    uint64_t *b = (uint64_t *)malloc(k_bench_set * sizeof(uint64_t));
+    size_t i;
+    for (i = 0; i < npool; i++)
+    {
+        pool[i] = xorshift(&seed);
+    }
+    // balanced and skewed sizes, about half of the values shared
+    static const size_t sizes[][2] = {{1 << 20, 1 << 20}, {1 << 16, 1 << 20}, {1 << 10, 1 << 20}};
+    size_t s;
+    for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        size_t na = make_set(a, sizes[s][0], pool, npool, 50, &seed);
+        size_t nb = make_set(b, sizes[s][1], pool, npool, 50, &seed);
+        int rounds = (int)((1 << 24) / (na + nb)) + 1;
+        size_t cref = 0;
+        size_t c = 0;
+        int r;
+        uint64_t tstart = get_time();
+        for (r = 0; r < rounds; r++)
+        {
+            cref += bench_merge_count(a, na, b, nb);
+        }
+        uint64_t tmerge = get_time() - tstart;
+        tstart = get_time();
+        for (r = 0; r < rounds; r++)
+        {
+            c += farmhash64_fpset_intersect_count(a, na, b, nb);
+        }
+        uint64_t tset = get_time() - tstart;
+        errors += (c != cref);
+        fprintf(stdout, " * %s : %7lu x %7lu : merge %10.1f us : fpset %10.1f us : speedup %6.2f\n",
+                __func__, na, nb, (double)tmerge / (1000.0 * rounds), (double)tset / (1000.0 * rounds), (double)tmerge / (double)tset);
+    }
+    // Jaccard similarity of many pairs of small sets
+    uint64_t *small = (uint64_t *)malloc(2 * k_bench_pairs * k_bench_small * sizeof(uint64_t));
+    size_t *nsmall = (size_t *)malloc(2 * k_bench_pairs * sizeof(size_t));
+    for (i = 0; i < 2 * k_bench_pairs; i++)
+    {
+        nsmall[i] = make_set(small + (i * k_bench_small), k_bench_small, pool, 4096, 60, &seed);
+    }
+    double jref = 0;
+    double jset = 0;
+    uint64_t tstart = get_time();
+    for (i = 0; i < k_bench_pairs; i++)
+    {
+        const uint64_t *x = small + (2 * i * k_bench_small);
+        const uint64_t *y = x + k_bench_small;
+        size_t c = bench_merge_count(x, nsmall[2 * i], y, nsmall[(2 * i) + 1]);
+        jref += (double)c / (double)(nsmall[2 * i] + nsmall[(2 * i) + 1] - c);
+    }
+    uint64_t tmerge = get_time() - tstart;
+    tstart = get_time();
+    for (i = 0; i < k_bench_pairs; i++)
+    {
+        const uint64_t *x = small + (2 * i * k_bench_small);
+        jset += farmhash64_fpset_jaccard(x, nsmall[2 * i], x + k_bench_small, nsmall[(2 * i) + 1]);
+    }
+    uint64_t tset = get_time() - tstart;
+    errors += (jset != jref);
+    fprintf(stdout, " * %s : Jaccard of %lu pairs of %lu values : merge %8.1f ns/pair : fpset %8.1f ns/pair : speedup %6.2f\n",
+            __func__, k_bench_pairs, k_bench_small, (double)tmerge / k_bench_pairs, (double)tset / k_bench_pairs, (double)tmerge / (double)tset);
+    free(small);
+    free(nsmall);
+    free(pool);
+    free(a);
+    free(b);
+    return errors;
+}
+
+int benchmark_farmhash64_fpset_merge()
+{
+    int errors = 0;
+    uint64_t seed = 0x853c49e6748fea9bULL;
+    const size_t k = 16;
+    const size_t n = 1 << 16;
+    uint64_t *data = (uint64_t *)malloc(k * n * sizeof(uint64_t));
+    uint64_t *out = (uint64_t *)malloc(k * n * sizeof(uint64_t));
+    uint64_t *pool = (uint64_t *)malloc(n * sizeof(uint64_t));
+    const uint64_t *sets[16];
+    size_t sizes[16];
+    size_t i;
+    for (i = 0; i < n; i++)
+    {
+        pool[i] = xorshift(&seed);
+    }
+    for (i = 0; i < k; i++)
+    {
+        sizes[i] = make_set(data + (i * n), n, pool, n, 20, &seed);
+        sets[i] = data + (i * n);
+    }
+    size_t nout = 0;
+    size_t ncount = 0;
+    uint64_t tstart = get_time();
+    errors += (farmhash64_fpset_merge(sets, sizes, k, out, &nout) != FARMHASH64_FPSET_OK);
+    uint64_t tmerge = get_time() - tstart;
+    tstart = get_time();
+    errors += (farmhash64_fpset_merge(sets, sizes, k, NULL, &ncount) != FARMHASH64_FPSET_OK);
+    uint64_t tcount = get_time() - tstart;
+    errors += (nout != ncount);
+    fprintf(stdout, " * %s : union of %lu sets of %lu values : %8.2f Mvalues/s : count only %8.2f Mvalues/s\n",
+            __func__, k, n, (double)(k * n) * 1000.0 / (double)tmerge, (double)(k * n) * 1000.0 / (double)tcount);
+    free(pool);
+    free(data);
+    free(out);
+    return errors;
+}
+
+int main()
+{
+    int errors = 0;
+
+    errors += test_farmhash64_fpset_sort();
+    errors += test_farmhash64_fpset_intersect();
+    errors += test_farmhash64_fpset_merge();
+    errors += benchmark_farmhash64_fpset_sort();
+    errors += benchmark_farmhash64_fpset_intersect();
+    errors += benchmark_farmhash64_fpset_merge();
+
+    return errors;
+}
@@ -0,0 +1,293 @@
+// Nicola Asuni
+
+#if __STDC_VERSION__ >= 199901L
+#define _XOPEN_SOURCE 600
+#else
+#define _XOPEN_SOURCE 500
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../src/farmhash64_intern.h"
+
+#define TEST_THREADS 4
+
+static const uint32_t k_vocabulary = 20000;
+static const uint32_t k_bench_tokens = 1 << 22;
+static const uint32_t k_bench_record = 64;
+
+// returns current time in nanoseconds
+uint64_t get_time()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (((uint64_t)t.tv_sec * 1000000000) + (uint64_t)t.tv_nsec);
+}
+
+// writes the token of word w, returns its length
+static size_t make_token(char *buf, uint32_t w)
+{
+    return (size_t)snprintf(buf, 64, "field_%u.%s", w, (w & 1) ? "tag" : "label_value");
+}
+
+// skewed pseudorandom word sequence (most tokens come from a few hundred words)
+static uint32_t *make_words(uint32_t n, uint64_t seed)
+{
+    uint32_t *words = (uint32_t *)malloc(n * sizeof(uint32_t));
+    uint64_t x = seed;
+    uint32_t i;
+    for (i = 0; i < n; i++)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        uint32_t r = (uint32_t)(x >> 32);
+        words[i] = ((r & 7) != 0) ? ((r >> 3) % 256) : ((r >> 3) % k_vocabulary);
+    }
+    return words;
+}
+
+int test_farmhash64_intern_basic()
+{
+    int errors = 0;
+    farmhash64_intern_pool_t pool;
+    if (farmhash64_intern_init(&pool) != 0)
+    {
+        fprintf(stderr, "%s : init error\n", __func__);
+        return 1;
+    }
+    uint32_t *handles = (uint32_t *)calloc(k_vocabulary, sizeof(uint32_t));
+    char buf[64];
+    uint32_t w;
+    for (w = 0; w < k_vocabulary; w++)
+    {
+        size_t len = make_token(buf, w);
+        handles[w] = farmhash64_intern(&pool, buf, len);
+        errors += (handles[w] == 0);
+    }
+    uint64_t bytes;
+    errors += (farmhash64_intern_count(&pool, &bytes) != k_vocabulary) || (bytes == 0);
+    for (w = 0; w < k_vocabulary; w++)
+    {
+        size_t len = make_token(buf, w);
+        size_t slen = 0;
+        const char *s = farmhash64_intern_str(&pool, handles[w], &slen);
+        if ((farmhash64_intern(&pool, buf, len) != handles[w]) || (farmhash64_intern_find(&pool, buf, len) != handles[w]) || (s == NULL) || (slen != len) || (memcmp(s, buf, len) != 0) || (s[len] != 0))
+        {
+            fprintf(stderr, "%s : wrong handle or string for %s\n", __func__, buf);
+            ++errors;
+            break;
+        }
+    }
+    errors += (farmhash64_intern_count(&pool, NULL) != k_vocabulary);
+    // binary strings, empty string, long strings
+    errors += (farmhash64_intern_find(&pool, "absent", 6) != 0);
+    uint32_t h0 = farmhash64_intern(&pool, "", 0);
+    uint32_t h1 = farmhash64_intern(&pool, "a\0b", 3);
+    uint32_t h2 = farmhash64_intern(&pool, "a\0c", 3);
+    errors += (h0 == 0) || (h1 == 0) || (h1 == h2) || (farmhash64_intern(&pool, "", 0) != h0) || (farmhash64_intern(&pool, "a\0b", 3) != h1);
+    size_t big = 100000;
+    char *long_str = (char *)malloc(big);
+    memset(long_str, 'x', big);
+    uint32_t hl = farmhash64_intern(&pool, long_str, big);
+    size_t slen = 0;
+    const char *s = farmhash64_intern_str(&pool, hl, &slen);
+    errors += (s == NULL) || (slen != big) || (memcmp(s, long_str, big) != 0);
+    // strings stay valid after more inserts
+    errors += (farmhash64_intern_str(&pool, h1, &slen) == NULL) || (slen != 3) || (memcmp(farmhash64_intern_str(&pool, h1, NULL), "a\0b", 3) != 0);
+    free(long_str);
+    // invalid handles
+    errors += (farmhash64_intern_str(&pool, 0, NULL) != NULL);
+    errors += (farmhash64_intern_str(&pool, 0xFFFFFFFF, NULL) != NULL);
+    // cached lookups return the pool handles
+    farmhash64_intern_cache_t *cache = (farmhash64_intern_cache_t *)malloc(sizeof(farmhash64_intern_cache_t));
+    farmhash64_intern_cache_init(cache);
+    uint32_t *words = make_words(100000, 1);
+    uint32_t i;
+    for (i = 0; i < 100000; i++)
+    {
+        size_t len = make_token(buf, words[i]);
+        if (farmhash64_intern_cached(&pool, cache, buf, len) != handles[words[i]])
+        {
+            fprintf(stderr, "%s : cached handle mismatch for %s\n", __func__, buf);
+            ++errors;
+            break;
+        }
+    }
+    errors += (cache->hits == 0) || (cache->hits + cache->misses != 100000);
+    free(words);
+    free(cache);
+    free(handles);
+    farmhash64_intern_free(&pool);
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors\n", __func__, errors);
+    }
+    return errors;
+}
+
+typedef struct intern_task_t
+{
+    farmhash64_intern_pool_t *pool;
+    uint32_t *words;
+    uint32_t nwords;
+    uint32_t *handles; // handle of each word, as seen by this thread
+    uint64_t checksum;
+} intern_task_t;
+
+static void *intern_worker(void *arg)
+{
+    intern_task_t *t = (intern_task_t *)arg;
+    farmhash64_intern_cache_t *cache = (farmhash64_intern_cache_t *)malloc(sizeof(farmhash64_intern_cache_t));
+    farmhash64_intern_cache_init(cache);
+    char buf[64];
+    uint32_t i;
+    for (i = 0; i < t->nwords; i++)
+    {
+        size_t len = make_token(buf, t->words[i]);
+        uint32_t h = farmhash64_intern_cached(t->pool, cache, buf, len);
+        if (t->handles != NULL)
+        {
+            t->handles[t->words[i]] = h;
+        }
+        t->checksum += h;
+    }
+    free(cache);
+    return NULL;
+}
+
+int test_farmhash64_intern_threads()
+{
+    int errors = 0;
+    farmhash64_intern_pool_t pool;
+    farmhash64_intern_init(&pool);
+    pthread_t tid[TEST_THREADS];
+    intern_task_t task[TEST_THREADS];
+    const uint32_t nwords = 200000;
+    int i;
+    for (i = 0; i < TEST_THREADS; i++)
+    {
+        task[i].pool = &pool;
+        task[i].words = make_words(nwords, (uint64_t)i + 7);
+        task[i].nwords = nwords;
+        task[i].handles = (uint32_t *)calloc(k_vocabulary, sizeof(uint32_t));
+        task[i].checksum = 0;
+        pthread_create(&tid[i], NULL, intern_worker, &task[i]);
+    }
+    for (i = 0; i < TEST_THREADS; i++)
+    {
+        pthread_join(tid[i], NULL);
+    }
+    // all the threads must agree on the handle of every word, and the handles must be distinct
+    char buf[64];
+    uint32_t w;
+    uint64_t n = 0;
+    for (w = 0; w < k_vocabulary; w++)
+    {
+        uint32_t h = 0;
+        for (i = 0; i < TEST_THREADS; i++)
+        {
+            uint32_t hi = task[i].handles[w];
+            if ((hi != 0) && (h != 0) && (hi != h))
+            {
+                fprintf(stderr, "%s : threads disagree on word %u\n", __func__, w);
+                ++errors;
+            }
+            h = (hi != 0) ? hi : h;
+        }
+        if (h != 0)
+        {
+            size_t len = make_token(buf, w);
+            errors += (farmhash64_intern_find(&pool, buf, len) != h);
+            n++;
+        }
+    }
+    errors += (farmhash64_intern_count(&pool, NULL) != n);
+    for (i = 0; i < TEST_THREADS; i++)
+    {
+        free(task[i].words);
+        free(task[i].handles);
+    }
+    farmhash64_intern_free(&pool);
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors\n", __func__, errors);
+    }
+    return errors;
+}
+
+int benchmark_farmhash64_intern()
+{
+    int errors = 0;
+    uint32_t *words = make_words(k_bench_tokens, 99);
+    // pregenerate the token stream, as a parser would see it
+    char *text = (char *)malloc((size_t)k_bench_tokens * 32);
+    uint32_t *offset = (uint32_t *)malloc((k_bench_tokens + 1) * sizeof(uint32_t));
+    char **record = (char **)malloc(k_bench_record * sizeof(char *));
+    uint32_t i;
+    uint32_t j;
+    offset[0] = 0;
+    for (i = 0; i < k_bench_tokens; i++)
+    {
+        offset[i + 1] = offset[i] + (uint32_t)make_token(text + offset[i], words[i]);
+    }
+    // baseline: a fresh heap copy per token, released with its record
+    uint64_t sum = 0;
+    uint64_t tstart = get_time();
+    for (i = 0; i < k_bench_tokens; i += k_bench_record)
+    {
+        for (j = 0; j < k_bench_record; j++)
+        {
+            size_t len = offset[i + j + 1] - offset[i + j];
+            record[j] = (char *)malloc(len + 1);
+            memcpy(record[j], text + offset[i + j], len);
+            record[j][len] = 0;
+        }
+        for (j = 0; j < k_bench_record; j++)
+        {
+            sum += (uint8_t)record[j][0];
+            free(record[j]);
+        }
+    }
+    uint64_t tmalloc = get_time() - tstart;
+    farmhash64_intern_pool_t pool;
+    farmhash64_intern_init(&pool);
+    tstart = get_time();
+    for (i = 0; i < k_bench_tokens; i++)
+    {
+        sum += farmhash64_intern(&pool, text + offset[i], offset[i + 1] - offset[i]);
+    }
+    uint64_t tpool = get_time() - tstart;
+    farmhash64_intern_cache_t *cache = (farmhash64_intern_cache_t *)malloc(sizeof(farmhash64_intern_cache_t));
+    farmhash64_intern_cache_init(cache);
+    tstart = get_time();
+    for (i = 0; i < k_bench_tokens; i++)
+    {
+        sum += farmhash64_intern_cached(&pool, cache, text + offset[i], offset[i + 1] - offset[i]);
+    }
+    uint64_t tcache = get_time() - tstart;
+    fprintf(stdout, " * %s : malloc+copy+free per token : %6.1f ns/token\n", __func__, (double)tmalloc / k_bench_tokens);
+    fprintf(stdout, " * %s : intern (shard lock)        : %6.1f ns/token\n", __func__, (double)tpool / k_bench_tokens);
+    fprintf(stdout, " * %s : intern (per-thread cache)  : %6.1f ns/token (hit rate %.1f%%)\n", __func__, (double)tcache / k_bench_tokens, 100.0 * (double)cache->hits / k_bench_tokens);
+    errors += (sum == 0);
+    farmhash64_intern_free(&pool);
+    free(cache);
+    free(record);
+    free(offset);
+    free(text);
+    free(words);
+    return errors;
+}
+
+int main()
+{
+    int errors = 0;
+
+    errors += test_farmhash64_intern_basic();
+    errors += test_farmhash64_intern_threads();
+    errors += benchmark_farmhash64_intern();
+
+    return errors;
+}
@@ -0,0 +1,174 @@
+// Nicola Asuni
+
+#if __STDC_VERSION__ >= 199901L
+#define _XOPEN_SOURCE 600
+#else
+#define _XOPEN_SOURCE 500
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../src/farmhash64_merkle.h"
+
+#define TEST_BLOCK_SIZE 64
+#define TEST_FILE_SIZE 10000
+
+static char data[TEST_FILE_SIZE * 2];
+
+typedef struct diff_ranges_t
+{
+    int n;
+    uint64_t offset[16];
+    uint64_t len[16];
+} diff_ranges_t;
+
+static void diff_cb(uint64_t offset, uint64_t len, void *ctx)
+{
+    diff_ranges_t *r = (diff_ranges_t *)ctx;
+    if (r->n < 16)
+    {
+        r->offset[r->n] = offset;
+        r->len[r->n] = len;
+    }
+    r->n++;
+}
+
+int write_file(const char *path, size_t size)
+{
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if ((fd >= 0) && (pwrite(fd, data, size, 0) != (ssize_t)size))
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// build a tree from scratch for comparison
+uint64_t full_root(int fd, uint64_t size)
+{
+    farmhash64_merkle_t t;
+    farmhash64_merkle_init(&t, TEST_BLOCK_SIZE);
+    farmhash64_merkle_build(&t, fd, size);
+    uint64_t root = farmhash64_merkle_root(&t);
+    farmhash64_merkle_free(&t);
+    return root;
+}
+
+int test_farmhash64_merkle()
+{
+    int errors = 0;
+    size_t i;
+    char path[] = "/tmp/test_farmhash64_merkle_XXXXXX";
+    char sidecar[64];
+    for (i = 0; i < sizeof(data); i++)
+    {
+        data[i] = (char)(i * 31 + (i >> 8));
+    }
+    int tmp = mkstemp(path);
+    if (tmp < 0)
+    {
+        fprintf(stderr, "%s : unable to create a temporary file\n", __func__);
+        return 1;
+    }
+    close(tmp);
+    snprintf(sidecar, sizeof(sidecar), "%s.fhm", path);
+    int fd = write_file(path, TEST_FILE_SIZE);
+    farmhash64_merkle_t a;
+    farmhash64_merkle_t b;
+    farmhash64_merkle_init(&a, TEST_BLOCK_SIZE);
+    farmhash64_merkle_init(&b, TEST_BLOCK_SIZE);
+    errors += (farmhash64_merkle_build(&a, fd, TEST_FILE_SIZE) != FARMHASH64_MERKLE_OK);
+    errors += (a.nleaves != (TEST_FILE_SIZE + TEST_BLOCK_SIZE - 1) / TEST_BLOCK_SIZE);
+    errors += (farmhash64_merkle_save(&a, sidecar) != FARMHASH64_MERKLE_OK);
+    errors += (farmhash64_merkle_load(&b, sidecar) != FARMHASH64_MERKLE_OK);
+    errors += (farmhash64_merkle_root(&a) != farmhash64_merkle_root(&b));
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : build/save/load error\n", __func__);
+    }
+
+    // in-place writes on two separate regions
+    uint64_t old_root = farmhash64_merkle_root(&a);
+    errors += (pwrite(fd, "XYZ", 3, 100) != 3);
+    errors += (farmhash64_merkle_update(&a, fd, TEST_FILE_SIZE, 100, 3) != FARMHASH64_MERKLE_OK);
+    errors += (pwrite(fd, "0123456789", 10, 5000) != 10);
+    errors += (farmhash64_merkle_update(&a, fd, TEST_FILE_SIZE, 5000, 10) != FARMHASH64_MERKLE_OK);
+    if ((farmhash64_merkle_root(&a) == old_root) || (farmhash64_merkle_root(&a) != full_root(fd, TEST_FILE_SIZE)))
+    {
+        fprintf(stderr, "%s : incremental update mismatch\n", __func__);
+        ++errors;
+    }
+    diff_ranges_t r;
+    memset(&r, 0, sizeof(r));
+    int64_t nd = farmhash64_merkle_diff(&a, &b, diff_cb, &r);
+    if ((nd != 2) || (r.n != 2) || (r.offset[0] != 64) || (r.len[0] != 64) || (r.offset[1] != 4992) || (r.len[1] != 64))
+    {
+        fprintf(stderr, "%s : unexpected diff: %ld blocks, %d ranges\n", __func__, nd, r.n);
+        ++errors;
+    }
+
+    // append across several blocks
+    errors += (pwrite(fd, data, 1000, TEST_FILE_SIZE) != 1000);
+    errors += (farmhash64_merkle_update(&a, fd, TEST_FILE_SIZE + 1000, TEST_FILE_SIZE, 1000) != FARMHASH64_MERKLE_OK);
+    if (farmhash64_merkle_root(&a) != full_root(fd, TEST_FILE_SIZE + 1000))
+    {
+        fprintf(stderr, "%s : append update mismatch\n", __func__);
+        ++errors;
+    }
+    memset(&r, 0, sizeof(r));
+    nd = farmhash64_merkle_diff(&a, &b, diff_cb, &r);
+    // blocks 1 and 78 differ, and the tail from the old last block (156) onward
+    if ((r.n != 3) || (r.offset[2] != 156 * TEST_BLOCK_SIZE) || (nd != 2 + 16))
+    {
+        fprintf(stderr, "%s : unexpected append diff: %ld blocks, %d ranges\n", __func__, nd, r.n);
+        ++errors;
+    }
+
+    // truncate
+    errors += (ftruncate(fd, 3000) != 0);
+    errors += (farmhash64_merkle_update(&a, fd, 3000, 0, 0) != FARMHASH64_MERKLE_OK);
+    if (farmhash64_merkle_root(&a) != full_root(fd, 3000))
+    {
+        fprintf(stderr, "%s : truncate update mismatch\n", __func__);
+        ++errors;
+    }
+
+    // identical trees
+    memset(&r, 0, sizeof(r));
+    errors += (farmhash64_merkle_diff(&b, &b, diff_cb, &r) != 0);
+    errors += (r.n != 0);
+
+    farmhash64_merkle_t c;
+    farmhash64_merkle_init(&c, 128);
+    errors += (farmhash64_merkle_diff(&a, &c, diff_cb, &r) != FARMHASH64_MERKLE_ERR_MISMATCH);
+
+    // corrupted sidecar
+    FILE *f = fopen(sidecar, "r+b");
+    fseek(f, 48, SEEK_SET);
+    fputc('!', f);
+    fclose(f);
+    errors += (farmhash64_merkle_load(&c, sidecar) != FARMHASH64_MERKLE_ERR_FORMAT);
+
+    farmhash64_merkle_free(&a);
+    farmhash64_merkle_free(&b);
+    close(fd);
+    unlink(path);
+    unlink(sidecar);
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors\n", __func__, errors);
+    }
+    return errors;
+}
+
+int main()
+{
+    int errors = 0;
+
+    errors += test_farmhash64_merkle();
+
+    return errors;
+}
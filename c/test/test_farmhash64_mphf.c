@@ -0,0 +1,213 @@
+// Nicola Asuni
+
+#if __STDC_VERSION__ >= 199901L
+#define _XOPEN_SOURCE 600
+#else
+#define _XOPEN_SOURCE 500
+#endif
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../src/farmhash64_mphf.h"
+
+static const size_t k_num_keys = 200000;
+
+// returns current time in nanoseconds
+uint64_t get_time()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (((uint64_t)t.tv_sec * 1000000000) + (uint64_t)t.tv_nsec);
+}
+
+uint64_t *make_hashes(size_t n)
+{
+    uint64_t *hashes = (uint64_t *)malloc(n * sizeof(uint64_t));
+    char key[32];
+    size_t i;
+    for (i = 0; i < n; i++)
+    {
+        snprintf(key, sizeof(key), "key:%zu", i);
+        hashes[i] = farmhash64(key, strlen(key));
+    }
+    return hashes;
+}
+
+int check_mphf(const void *image, size_t size, const uint64_t *hashes, size_t n)
+{
+    int errors = 0;
+    farmhash64_mphf_t mphf;
+    size_t i;
+    if (farmhash64_mphf_load(&mphf, image, size) != FARMHASH64_MPHF_OK)
+    {
+        fprintf(stderr, "%s : unable to load the image\n", __func__);
+        return 1;
+    }
+    uint8_t *seen = (uint8_t *)calloc(n + 1, 1);
+    for (i = 0; i < n; i++)
+    {
+        uint64_t idx = farmhash64_mphf_lookup_hash(&mphf, hashes[i]);
+        if (idx >= n)
+        {
+            fprintf(stderr, "%s : key %zu has index %" PRIu64 " out of range\n", __func__, i, idx);
+            ++errors;
+            break;
+        }
+        if (seen[idx])
+        {
+            fprintf(stderr, "%s : key %zu has duplicate index %" PRIu64 "\n", __func__, i, idx);
+            ++errors;
+            break;
+        }
+        seen[idx] = 1;
+    }
+    free(seen);
+    return errors;
+}
+
+int test_farmhash64_mphf_build()
+{
+    int errors = 0;
+    void *image = NULL;
+    size_t size = 0;
+    uint64_t *hashes = make_hashes(k_num_keys);
+    int ret = farmhash64_mphf_build(hashes, k_num_keys, 1.0, 42, 4, &image, &size);
+    if (ret != FARMHASH64_MPHF_OK)
+    {
+        fprintf(stderr, "%s : build error %d\n", __func__, ret);
+        free(hashes);
+        return 1;
+    }
+    double bpk = (double)(size * 8) / (double)k_num_keys;
+    if (bpk > 4.0)
+    {
+        fprintf(stderr, "%s : expected less than 4 bits per key, got %f\n", __func__, bpk);
+        ++errors;
+    }
+    errors += check_mphf(image, size, hashes, k_num_keys);
+
+    // a single thread must produce the same image
+    void *image1 = NULL;
+    size_t size1 = 0;
+    ret = farmhash64_mphf_build(hashes, k_num_keys, 1.0, 42, 1, &image1, &size1);
+    if ((ret != FARMHASH64_MPHF_OK) || (size1 != size) || (memcmp(image, image1, size) != 0))
+    {
+        fprintf(stderr, "%s : single thread image mismatch\n", __func__);
+        ++errors;
+    }
+    free(image1);
+
+    // lookup by key
+    farmhash64_mphf_t mphf;
+    if (farmhash64_mphf_load(&mphf, image, size) != FARMHASH64_MPHF_OK)
+    {
+        fprintf(stderr, "%s : unable to load the image\n", __func__);
+        ++errors;
+    }
+    else if (farmhash64_mphf_lookup(&mphf, "key:7", 5) != farmhash64_mphf_lookup_hash(&mphf, hashes[7]))
+    {
+        fprintf(stderr, "%s : lookup by key mismatch\n", __func__);
+        ++errors;
+    }
+    free(image);
+    free(hashes);
+    return errors;
+}
+
+int test_farmhash64_mphf_gamma()
+{
+    int errors = 0;
+    void *image = NULL;
+    size_t size = 0;
+    uint64_t *hashes = make_hashes(1000);
+    if (farmhash64_mphf_build(hashes, 1000, 2.0, 7, 2, &image, &size) != FARMHASH64_MPHF_OK)
+    {
+        fprintf(stderr, "%s : build error\n", __func__);
+        ++errors;
+    }
+    else
+    {
+        errors += check_mphf(image, size, hashes, 1000);
+    }
+    free(image);
+    free(hashes);
+    return errors;
+}
+
+int test_farmhash64_mphf_errors()
+{
+    int errors = 0;
+    void *image = NULL;
+    size_t size = 0;
+    uint64_t hashes[4] = {1, 2, 3, 2};
+    farmhash64_mphf_t mphf;
+    if (farmhash64_mphf_build(hashes, 4, 1.0, 0, 1, &image, &size) != FARMHASH64_MPHF_ERR_DUPLICATE)
+    {
+        fprintf(stderr, "%s : expected duplicate error\n", __func__);
+        ++errors;
+    }
+    if (farmhash64_mphf_build(hashes, 4, 0.5, 0, 1, &image, &size) != FARMHASH64_MPHF_ERR_ARGS)
+    {
+        fprintf(stderr, "%s : expected argument error\n", __func__);
+        ++errors;
+    }
+    if (farmhash64_mphf_build(hashes, 3, 1.0, 0, 1, &image, &size) != FARMHASH64_MPHF_OK)
+    {
+        fprintf(stderr, "%s : build error\n", __func__);
+        return ++errors;
+    }
+    if (farmhash64_mphf_load(&mphf, image, size - 8) != FARMHASH64_MPHF_ERR_IMAGE)
+    {
+        fprintf(stderr, "%s : expected image error\n", __func__);
+        ++errors;
+    }
+    errors += check_mphf(image, size, hashes, 3);
+    free(image);
+    return errors;
+}
+
+void benchmark_farmhash64_mphf()
+{
+    uint64_t tstart, tend;
+    void *image = NULL;
+    size_t size = 0;
+    uint64_t *hashes = make_hashes(k_num_keys);
+    uint64_t sum = 0;
+    size_t i;
+    farmhash64_mphf_t mphf;
+    tstart = get_time();
+    int ret = farmhash64_mphf_build(hashes, k_num_keys, 1.0, 42, 4, &image, &size);
+    tend = get_time();
+    if ((ret != FARMHASH64_MPHF_OK) || (farmhash64_mphf_load(&mphf, image, size) != FARMHASH64_MPHF_OK))
+    {
+        fprintf(stderr, "%s : build error\n", __func__);
+        free(image);
+        free(hashes);
+        return;
+    }
+    fprintf(stdout, " * %s build : %" PRIu64 " ns/key, %.2f bits/key\n", __func__, (tend - tstart) / k_num_keys, (double)(size * 8) / (double)k_num_keys);
+    tstart = get_time();
+    for (i = 0; i < k_num_keys; i++)
+    {
+        sum += farmhash64_mphf_lookup_hash(&mphf, hashes[i]);
+    }
+    tend = get_time();
+    fprintf(stdout, " * %s lookup : %" PRIu64 " ns/op (%" PRIu64 ")\n", __func__, (tend - tstart) / k_num_keys, sum);
+    free(image);
+    free(hashes);
+}
+
+int main()
+{
+    int errors = 0;
+
+    errors += test_farmhash64_mphf_build();
+    errors += test_farmhash64_mphf_gamma();
+    errors += test_farmhash64_mphf_errors();
+
+    benchmark_farmhash64_mphf();
+
+    return errors;
+}
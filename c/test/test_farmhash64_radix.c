@@ -0,0 +1,330 @@
+// Nicola Asuni
+
+#if __STDC_VERSION__ >= 199901L
+#define _XOPEN_SOURCE 600
+#else
+#define _XOPEN_SOURCE 500
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../src/farmhash64_radix.h"
+
+#define BENCH_MAX_THREADS 64
+
+static const size_t k_bench_rows = 1 << 21;
+static const uint64_t k_bench_groups = 1 << 18;
+
+// returns current time in nanoseconds
+uint64_t get_time()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (((uint64_t)t.tv_sec * 1000000000) + (uint64_t)t.tv_nsec);
+}
+
+// fills the key and value columns with pseudorandom rows over ngroups distinct keys
+static void make_rows(uint64_t *keys, uint64_t *values, size_t nrows, uint64_t ngroups)
+{
+    uint64_t x = 0x9e3779b97f4a7c15ULL;
+    size_t i;
+    for (i = 0; i < nrows; i++)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        keys[i] = (x % ngroups) * 0x100000001b3ULL;
+        values[i] = x >> 40;
+    }
+}
+
+int test_farmhash64_radix_partition()
+{
+    int errors = 0;
+    const size_t nrows = 100000;
+    uint64_t *keys = (uint64_t *)malloc(nrows * sizeof(uint64_t));
+    uint64_t *values = (uint64_t *)malloc(nrows * sizeof(uint64_t));
+    make_rows(keys, values, nrows, 5000);
+    uint64_t ksum = 0;
+    uint64_t vsum = 0;
+    size_t i;
+    for (i = 0; i < nrows; i++)
+    {
+        ksum += keys[i];
+        vsum += values[i];
+    }
+    uint32_t bits;
+    for (bits = 0; bits <= 10; bits += 5)
+    {
+        farmhash64_radix_partitions_t parts;
+        if (farmhash64_radix_partition(keys, values, nrows, bits, 4, &parts) != FARMHASH64_RADIX_OK)
+        {
+            fprintf(stderr, "%s (bits=%u) : partition error\n", __func__, bits);
+            ++errors;
+            continue;
+        }
+        size_t nparts = (size_t)1 << bits;
+        errors += (parts.offsets[0] != 0) || (parts.offsets[nparts] != nrows);
+        errors += (((uintptr_t)parts.tuples & 63) != 0);
+        uint64_t ks = 0;
+        uint64_t vs = 0;
+        size_t p;
+        for (p = 0; p < nparts; p++)
+        {
+            uint64_t j;
+            for (j = parts.offsets[p]; j < parts.offsets[p + 1]; j++)
+            {
+                const farmhash64_radix_tuple_t *r = &parts.tuples[j];
+                if ((r->hash != farmhash64((const char *)&r->key, sizeof(r->key))) || (farmhash64_radix_part(r->hash, bits) != p))
+                {
+                    fprintf(stderr, "%s (bits=%u) : row %lu is in the wrong partition or has a wrong hash\n", __func__, bits, j);
+                    ++errors;
+                    break;
+                }
+                ks += r->key;
+                vs += r->value;
+            }
+        }
+        if ((ks != ksum) || (vs != vsum))
+        {
+            fprintf(stderr, "%s (bits=%u) : rows lost or duplicated\n", __func__, bits);
+            ++errors;
+        }
+        farmhash64_radix_partitions_free(&parts);
+    }
+    // the rows of a partition keep the input order, also across the thread slices
+    farmhash64_radix_partitions_t parts;
+    for (i = 0; i < nrows; i++)
+    {
+        values[i] = i;
+    }
+    if (farmhash64_radix_partition(keys, values, nrows, 7, 4, &parts) == FARMHASH64_RADIX_OK)
+    {
+        size_t p;
+        for (p = 0; p < ((size_t)1 << 7); p++)
+        {
+            uint64_t j;
+            for (j = parts.offsets[p] + 1; j < parts.offsets[p + 1]; j++)
+            {
+                if (parts.tuples[j].value <= parts.tuples[j - 1].value)
+                {
+                    fprintf(stderr, "%s : row %lu of partition %lu is out of order\n", __func__, j, p);
+                    ++errors;
+                    break;
+                }
+            }
+        }
+        farmhash64_radix_partitions_free(&parts);
+    }
+    else
+    {
+        ++errors;
+    }
+    errors += (farmhash64_radix_partition(keys, values, nrows, FARMHASH64_RADIX_MAX_BITS + 1, 1, &parts) != FARMHASH64_RADIX_ERR_ARGS);
+    errors += (farmhash64_radix_partition(keys, values, nrows, 4, 0, &parts) != FARMHASH64_RADIX_ERR_ARGS);
+    errors += (farmhash64_radix_partition(NULL, NULL, 1, 4, 1, &parts) != FARMHASH64_RADIX_ERR_ARGS);
+    free(keys);
+    free(values);
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors\n", __func__, errors);
+    }
+    return errors;
+}
+
+static int cmp_group(const void *a, const void *b)
+{
+    uint64_t ka = ((const farmhash64_radix_group_t *)a)->key;
+    uint64_t kb = ((const farmhash64_radix_group_t *)b)->key;
+    return (ka > kb) - (ka < kb);
+}
+
+int test_farmhash64_radix_aggregate()
+{
+    int errors = 0;
+    const size_t nrows = 200000;
+    const uint64_t ngroups = 20000;
+    uint64_t *keys = (uint64_t *)malloc(nrows * sizeof(uint64_t));
+    uint64_t *values = (uint64_t *)malloc(nrows * sizeof(uint64_t));
+    // reference aggregation indexed by key / 0x100000001b3
+    uint64_t *count = (uint64_t *)calloc(ngroups, sizeof(uint64_t));
+    uint64_t *sum = (uint64_t *)calloc(ngroups, sizeof(uint64_t));
+    make_rows(keys, values, nrows, ngroups);
+    size_t i;
+    uint64_t nref = 0;
+    for (i = 0; i < nrows; i++)
+    {
+        uint64_t g = keys[i] / 0x100000001b3ULL;
+        nref += (count[g] == 0);
+        count[g]++;
+        sum[g] += values[i];
+    }
+    // bits = 0 puts all the groups in one partition and forces the table to grow
+    const uint32_t bits[] = {0, 3, 8};
+    const unsigned threads[] = {1, 3, 8};
+    size_t k;
+    for (k = 0; k < 3; k++)
+    {
+        farmhash64_radix_result_t res;
+        if (farmhash64_radix_aggregate(keys, (k == 1) ? NULL : values, nrows, bits[k], threads[k], &res) != FARMHASH64_RADIX_OK)
+        {
+            fprintf(stderr, "%s (bits=%u) : aggregate error\n", __func__, bits[k]);
+            ++errors;
+            continue;
+        }
+        if (res.ngroups != nref)
+        {
+            fprintf(stderr, "%s (bits=%u) : expected %lu groups, got %lu\n", __func__, bits[k], nref, res.ngroups);
+            ++errors;
+        }
+        qsort(res.groups, res.ngroups, sizeof(farmhash64_radix_group_t), cmp_group);
+        for (i = 0; i < res.ngroups; i++)
+        {
+            const farmhash64_radix_group_t *g = &res.groups[i];
+            uint64_t r = g->key / 0x100000001b3ULL;
+            if ((i > 0) && (g->key == res.groups[i - 1].key))
+            {
+                fprintf(stderr, "%s (bits=%u) : duplicate group %lu\n", __func__, bits[k], g->key);
+                ++errors;
+                break;
+            }
+            if ((r >= ngroups) || (g->count != count[r]) || (g->sum != ((k == 1) ? 0 : sum[r])))
+            {
+                fprintf(stderr, "%s (bits=%u) : wrong aggregate for key %lu\n", __func__, bits[k], g->key);
+                ++errors;
+                break;
+            }
+        }
+        farmhash64_radix_result_free(&res);
+    }
+    farmhash64_radix_result_t res;
+    errors += (farmhash64_radix_aggregate(NULL, NULL, 0, 4, 2, &res) != FARMHASH64_RADIX_OK) || (res.ngroups != 0);
+    farmhash64_radix_result_free(&res);
+    errors += (farmhash64_radix_aggregate(keys, values, nrows, 4, 1, NULL) != FARMHASH64_RADIX_ERR_ARGS);
+    errors += (farmhash64_radix_bits(1 << 20, 1 << 20) != 6);
+    errors += (farmhash64_radix_bits(1000, 1 << 20) != 0);
+    free(keys);
+    free(values);
+    free(count);
+    free(sum);
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors\n", __func__, errors);
+    }
+    return errors;
+}
+
+// Baseline: a single table shared by all the threads, updated with atomic operations.
+typedef struct shared_slot_t
+{
+    uint64_t key; // 0 = empty (the benchmark keys are never 0 after adding 1)
+    uint64_t count;
+    uint64_t sum;
+    uint64_t pad;
+} shared_slot_t;
+
+typedef struct bench_task_t
+{
+    const uint64_t *keys;
+    const uint64_t *values;
+    size_t start;
+    size_t end;
+    shared_slot_t *slots;
+    uint64_t mask;
+} bench_task_t;
+
+static void *bench_shared_worker(void *arg)
+{
+    bench_task_t *t = (bench_task_t *)arg;
+    size_t i;
+    for (i = t->start; i < t->end; i++)
+    {
+        uint64_t key = t->keys[i] + 1;
+        uint64_t j = farmhash64_radix_hash(key) & t->mask;
+        for (;;)
+        {
+            shared_slot_t *s = &t->slots[j];
+            uint64_t cur = __atomic_load_n(&s->key, __ATOMIC_ACQUIRE);
+            if ((cur == 0) && __atomic_compare_exchange_n(&s->key, &cur, key, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            {
+                cur = key;
+            }
+            if (cur == key)
+            {
+                __atomic_fetch_add(&s->count, 1, __ATOMIC_RELAXED);
+                __atomic_fetch_add(&s->sum, t->values[i], __ATOMIC_RELAXED);
+                break;
+            }
+            j = (j + 1) & t->mask;
+        }
+    }
+    return NULL;
+}
+
+static uint64_t bench_shared(const uint64_t *keys, const uint64_t *values, size_t nrows, unsigned nt)
+{
+    pthread_t tid[BENCH_MAX_THREADS];
+    bench_task_t task[BENCH_MAX_THREADS];
+    uint64_t nslots = 2 * k_bench_groups;
+    shared_slot_t *slots = (shared_slot_t *)calloc(nslots, sizeof(shared_slot_t));
+    unsigned i;
+    uint64_t tstart = get_time();
+    for (i = 0; i < nt; i++)
+    {
+        task[i].keys = keys;
+        task[i].values = values;
+        task[i].start = nrows * i / nt;
+        task[i].end = nrows * (i + 1) / nt;
+        task[i].slots = slots;
+        task[i].mask = nslots - 1;
+        pthread_create(&tid[i], NULL, bench_shared_worker, &task[i]);
+    }
+    for (i = 0; i < nt; i++)
+    {
+        pthread_join(tid[i], NULL);
+    }
+    uint64_t tend = get_time();
+    free(slots);
+    return tend - tstart;
+}
+
+int benchmark_farmhash64_radix()
+{
+    int errors = 0;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned maxthreads = (ncpu < 1) ? 1 : ((ncpu > BENCH_MAX_THREADS) ? BENCH_MAX_THREADS : (unsigned)ncpu);
+    uint64_t *keys = (uint64_t *)malloc(k_bench_rows * sizeof(uint64_t));
+    uint64_t *values = (uint64_t *)malloc(k_bench_rows * sizeof(uint64_t));
+    make_rows(keys, values, k_bench_rows, k_bench_groups);
+    // tables of 256 KiB per partition
+    uint32_t bits = farmhash64_radix_bits(k_bench_groups, 1 << 18);
+    unsigned nt;
+    for (nt = 1; nt <= maxthreads; nt = ((nt * 2 > maxthreads) && (nt < maxthreads)) ? maxthreads : nt * 2)
+    {
+        uint64_t tshared = bench_shared(keys, values, k_bench_rows, nt);
+        farmhash64_radix_result_t res;
+        uint64_t tstart = get_time();
+        errors += (farmhash64_radix_aggregate(keys, values, k_bench_rows, bits, nt, &res) != FARMHASH64_RADIX_OK);
+        uint64_t tradix = get_time() - tstart;
+        errors += (res.ngroups > k_bench_groups);
+        farmhash64_radix_result_free(&res);
+        fprintf(stdout, " * %s : %2u threads : shared table %8.2f Mrows/s : radix (%u bits) %8.2f Mrows/s : speedup %5.2f\n",
+                __func__, nt, (double)k_bench_rows * 1000.0 / (double)tshared, bits, (double)k_bench_rows * 1000.0 / (double)tradix, (double)tshared / (double)tradix);
+    }
+    free(keys);
+    free(values);
+    return errors;
+}
+
+int main()
+{
+    int errors = 0;
+
+    errors += test_farmhash64_radix_partition();
+    errors += test_farmhash64_radix_aggregate();
+    errors += benchmark_farmhash64_radix();
+
+    return errors;
+}
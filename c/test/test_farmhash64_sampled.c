@@ -0,0 +1,244 @@
+// Nicola Asuni
+
+#if __STDC_VERSION__ >= 199901L
+#define _XOPEN_SOURCE 600
+#else
+#define _XOPEN_SOURCE 500
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../src/farmhash64_sampled.h"
+
+#define k_data_size (1 << 20)
+
+static char data[k_data_size];
+
+// returns current time in nanoseconds
+uint64_t get_time()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (((uint64_t)t.tv_sec * 1000000000) + (uint64_t)t.tv_nsec);
+}
+
+// same pseudorandom data as the other tests
+void data_setup()
+{
+    static const uint64_t kt = 0xc3a5c85c97cb3127ULL;
+    uint64_t a = 9;
+    uint64_t b = 777;
+    uint8_t u = 0;
+    for (int i = 0; i < k_data_size; i++)
+    {
+        a += b;
+        b += a;
+        a = (a ^ (a >> 41)) * kt;
+        b = (b ^ (b >> 41)) * kt + i;
+        u = b >> 37;
+        memcpy(data + i, &u, 1);  // uint8_t -> char
+    }
+}
+
+// reference model of the sampled bytes of a key longer than the budget
+static int is_sampled(size_t pos, size_t len, size_t budget)
+{
+    if (budget < FARMHASH64_SAMPLED_MIN_BUDGET)
+    {
+        budget = FARMHASH64_SAMPLED_MIN_BUDGET;
+    }
+    if ((pos < FARMHASH64_SAMPLED_EDGE) || (pos >= len - FARMHASH64_SAMPLED_EDGE))
+    {
+        return 1;
+    }
+    size_t nblocks = (budget - (2 * FARMHASH64_SAMPLED_EDGE)) / FARMHASH64_SAMPLED_BLOCK;
+    if (nblocks == 0)
+    {
+        return 0;
+    }
+    size_t stride = (len - (2 * FARMHASH64_SAMPLED_EDGE)) / nblocks;
+    size_t k;
+    for (k = 0; k < nblocks; k++)
+    {
+        size_t start = FARMHASH64_SAMPLED_EDGE + (k * stride) + ((stride - FARMHASH64_SAMPLED_BLOCK) / 2);
+        if ((pos >= start) && (pos < start + FARMHASH64_SAMPLED_BLOCK))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int test_farmhash64_sampled_short()
+{
+    int errors = 0;
+    static const size_t budgets[] = {0, 100, 128, 512, 1000, 4096};
+    size_t b;
+    size_t len;
+    for (b = 0; b < sizeof(budgets) / sizeof(budgets[0]); b++)
+    {
+        size_t max = (budgets[b] < FARMHASH64_SAMPLED_MIN_BUDGET) ? FARMHASH64_SAMPLED_MIN_BUDGET : budgets[b];
+        for (len = 0; len <= max; len = (len < 300) ? len + 1 : len + 37)
+        {
+            if (farmhash64_sampled(data + 3, len, budgets[b]) != farmhash64(data + 3, len))
+            {
+                fprintf(stderr, "%s (budget=%lu) : different from farmhash64 for %lu bytes\n", __func__, budgets[b], len);
+                ++errors;
+            }
+        }
+    }
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors\n", __func__, errors);
+    }
+    return errors;
+}
+
+int test_farmhash64_sampled_bytes()
+{
+    int errors = 0;
+    static const size_t cases[][2] = {{129, 128}, {200, 0}, {1000, 512}, {1000, 999}, {4096, 300}, {5000, 1088}, {10000, 2048}};
+    char *key = (char *)malloc(10000);
+    size_t c;
+    for (c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+    {
+        size_t len = cases[c][0];
+        size_t budget = cases[c][1];
+        memcpy(key, data, len);
+        uint64_t h = farmhash64_sampled(key, len, budget);
+        if (h == farmhash64_sampled(key, len - 1, budget))
+        {
+            fprintf(stderr, "%s (len=%lu budget=%lu) : the length is not hashed\n", __func__, len, budget);
+            ++errors;
+        }
+        // every sampled byte changes the hash, the other bytes do not
+        size_t nsampled = 0;
+        size_t pos;
+        for (pos = 0; pos < len; pos++)
+        {
+            key[pos] ^= 0x20;
+            int changed = (farmhash64_sampled(key, len, budget) != h);
+            key[pos] ^= 0x20;
+            int sampled = is_sampled(pos, len, budget);
+            nsampled += (size_t)sampled;
+            if (changed != sampled)
+            {
+                fprintf(stderr, "%s (len=%lu budget=%lu) : byte %lu %s\n", __func__, len, budget, pos, sampled ? "is not hashed" : "should not be hashed");
+                ++errors;
+                break;
+            }
+        }
+        size_t max = (budget < FARMHASH64_SAMPLED_MIN_BUDGET) ? FARMHASH64_SAMPLED_MIN_BUDGET : budget;
+        if ((nsampled > max) || (nsampled + FARMHASH64_SAMPLED_BLOCK <= max))
+        {
+            fprintf(stderr, "%s (len=%lu budget=%lu) : %lu bytes sampled\n", __func__, len, budget, nsampled);
+            ++errors;
+        }
+    }
+    free(key);
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors\n", __func__, errors);
+    }
+    return errors;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// keys that differ in one sampled interior block only: no collisions, and all the bucket bits used
+int test_farmhash64_sampled_distribution()
+{
+    int errors = 0;
+    const size_t n = 100000;
+    const size_t len = 8192;
+    const size_t budget = FARMHASH64_SAMPLED_DEFAULT_BUDGET;
+    char *key = (char *)malloc(len);
+    uint64_t *h = (uint64_t *)malloc(n * sizeof(uint64_t));
+    uint32_t buckets[1024];
+    memset(buckets, 0, sizeof(buckets));
+    memcpy(key, data, len);
+    // start of the third interior block
+    size_t stride = (len - (2 * FARMHASH64_SAMPLED_EDGE)) / ((budget - (2 * FARMHASH64_SAMPLED_EDGE)) / FARMHASH64_SAMPLED_BLOCK);
+    size_t pos = FARMHASH64_SAMPLED_EDGE + (2 * stride) + ((stride - FARMHASH64_SAMPLED_BLOCK) / 2);
+    size_t i;
+    for (i = 0; i < n; i++)
+    {
+        uint32_t v = (uint32_t)i;
+        memcpy(key + pos, &v, sizeof(v));
+        h[i] = farmhash64_sampled(key, len, budget);
+        buckets[h[i] & 1023]++;
+    }
+    qsort(h, n, sizeof(uint64_t), cmp_u64);
+    for (i = 1; i < n; i++)
+    {
+        if (h[i] == h[i - 1])
+        {
+            fprintf(stderr, "%s : collision\n", __func__);
+            ++errors;
+        }
+    }
+    // about 98 keys per bucket
+    for (i = 0; i < 1024; i++)
+    {
+        if ((buckets[i] < 40) || (buckets[i] > 180))
+        {
+            fprintf(stderr, "%s : bucket %lu has %u keys\n", __func__, i, buckets[i]);
+            ++errors;
+        }
+    }
+    free(key);
+    free(h);
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors\n", __func__, errors);
+    }
+    return errors;
+}
+
+int benchmark_farmhash64_sampled()
+{
+    static const size_t sizes[] = {256, 1024, 4096, 65536, 1 << 20};
+    const size_t budget = FARMHASH64_SAMPLED_DEFAULT_BUDGET;
+    uint64_t sum = 0;
+    size_t s;
+    for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        size_t len = sizes[s];
+        size_t rounds = (1 << 26) / len;
+        size_t r;
+        uint64_t tstart = get_time();
+        for (r = 0; r < rounds; r++)
+        {
+            sum += farmhash64(data + (r & 7), len - 8);
+        }
+        uint64_t tfull = get_time() - tstart;
+        tstart = get_time();
+        for (r = 0; r < rounds; r++)
+        {
+            sum += farmhash64_sampled(data + (r & 7), len - 8, budget);
+        }
+        uint64_t tsampled = get_time() - tstart;
+        fprintf(stdout, " * %s : %7lu bytes : farmhash64 %10.1f ns : farmhash64_sampled (budget %lu) %7.1f ns : speedup %8.1f\n",
+                __func__, len - 8, (double)tfull / rounds, budget, (double)tsampled / rounds, (double)tfull / (double)tsampled);
+    }
+    return (sum == 0);
+}
+
+int main()
+{
+    int errors = 0;
+
+    data_setup();
+    errors += test_farmhash64_sampled_short();
+    errors += test_farmhash64_sampled_bytes();
+    errors += test_farmhash64_sampled_distribution();
+    errors += benchmark_farmhash64_sampled();
+
+    return errors;
+}
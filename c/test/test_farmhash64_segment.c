@@ -0,0 +1,264 @@
+// Nicola Asuni
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../src/farmhash64_segment.h"
+
+static const uint64_t k_test_records = 20000;
+static const size_t k_bench_bytes = 64 << 20;
+
+// returns current time in nanoseconds
+uint64_t get_time()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (((uint64_t)t.tv_sec * 1000000000) + (uint64_t)t.tv_nsec);
+}
+
+// fills a record with bytes derived from its number
+static size_t make_record(uint64_t i, char *buf)
+{
+    size_t len = (size_t)((i * 2654435761U) % 300);
+    if ((i % 1000) == 999)
+    {
+        len = 200000; // larger than a batch of blocks
+    }
+    size_t j;
+    for (j = 0; j < len; j++)
+    {
+        buf[j] = (char)((i * 31) + (j * 7) + (j >> 8));
+    }
+    return len;
+}
+
+// writes the records [from, to) and stores their positions
+static int write_records(farmhash64_segment_writer_t *w, uint64_t from, uint64_t to, uint64_t *pos, char *buf)
+{
+    int errors = 0;
+    uint64_t i;
+    for (i = from; i < to; i++)
+    {
+        size_t len = make_record(i, buf);
+        errors += (farmhash64_segment_append(w, buf, len, &pos[i]) != FARMHASH64_SEGMENT_OK);
+        if ((i % 777) == 0)
+        {
+            errors += (farmhash64_segment_writer_flush(w) != FARMHASH64_SEGMENT_OK);
+        }
+    }
+    return errors;
+}
+
+// reads back the records [0, n) and returns the number of mismatches
+static int check_records(farmhash64_segment_reader_t *r, uint64_t n, const uint64_t *pos, char *buf, char *exp)
+{
+    int errors = 0;
+    uint64_t i;
+    for (i = 0; i < n; i++)
+    {
+        size_t len = make_record(i, exp);
+        int ret = farmhash64_segment_read(r, pos[i], buf, len);
+        if ((ret != FARMHASH64_SEGMENT_OK) || (memcmp(buf, exp, len) != 0))
+        {
+            fprintf(stderr, "%s : record %lu at %lu: %d\n", __func__, (unsigned long)i, (unsigned long)pos[i], ret);
+            errors++;
+        }
+    }
+    return errors;
+}
+
+int test_farmhash64_segment_basic(const char *dir, uint32_t sum_bits)
+{
+    int errors = 0;
+    char path[256];
+    snprintf(path, sizeof(path), "%s/basic%u.seg", dir, sum_bits);
+    uint64_t *pos = (uint64_t *)malloc(k_test_records * sizeof(uint64_t));
+    char *buf = (char *)malloc(200000);
+    char *exp = (char *)malloc(200000);
+    farmhash64_segment_writer_t w;
+    if (farmhash64_segment_writer_open(&w, path, 4096, sum_bits, 42) != FARMHASH64_SEGMENT_OK)
+    {
+        fprintf(stderr, "%s : open error\n", __func__);
+        return 1;
+    }
+    errors += write_records(&w, 0, k_test_records / 2, pos, buf);
+    errors += (farmhash64_segment_writer_sync(&w) != FARMHASH64_SEGMENT_OK);
+    farmhash64_segment_writer_close(&w);
+    // reopen and continue: the block size, checksum and id arguments are ignored
+    errors += (farmhash64_segment_writer_open(&w, path, 512, 96 - sum_bits, 7) != FARMHASH64_SEGMENT_OK);
+    errors += (w.block_size != 4096) || (w.sum_bits != sum_bits) || (w.segment_id != 42);
+    errors += write_records(&w, k_test_records / 2, k_test_records, pos, buf);
+    errors += (farmhash64_segment_writer_sync(&w) != FARMHASH64_SEGMENT_OK);
+    uint64_t end = farmhash64_segment_writer_pos(&w);
+    farmhash64_segment_writer_close(&w);
+    farmhash64_segment_reader_t r;
+    errors += (farmhash64_segment_reader_open(&r, path) != FARMHASH64_SEGMENT_OK);
+    errors += (r.nblocks != end / r.payload);
+    errors += check_records(&r, k_test_records, pos, buf, exp);
+    // outside the data
+    errors += (farmhash64_segment_read(&r, end, buf, 1) != FARMHASH64_SEGMENT_ERR_RANGE);
+    errors += (farmhash64_segment_read(&r, pos[777] + make_record(777, exp), buf, 1) != FARMHASH64_SEGMENT_ERR_RANGE);
+    // every block has been verified by the reads: nothing left to scrub
+    farmhash64_segment_scrub_t res;
+    errors += (farmhash64_segment_scrub(&r, 2, &res) != FARMHASH64_SEGMENT_OK);
+    errors += (res.checked != 0) || (res.corrupt != 0) || (res.first_corrupt != UINT64_MAX);
+    farmhash64_segment_reader_close(&r);
+    errors += (farmhash64_segment_reader_open(&r, path) != FARMHASH64_SEGMENT_OK);
+    errors += (farmhash64_segment_scrub(&r, 3, &res) != FARMHASH64_SEGMENT_OK);
+    errors += (res.checked != r.nblocks) || (res.corrupt != 0);
+    farmhash64_segment_reader_close(&r);
+    // not a segment
+    FILE *f = fopen(path, "r+");
+    fputs("garbage!", f);
+    fclose(f);
+    errors += (farmhash64_segment_reader_open(&r, path) != FARMHASH64_SEGMENT_ERR_FORMAT);
+    errors += (farmhash64_segment_writer_open(&w, path, 4096, sum_bits, 42) != FARMHASH64_SEGMENT_ERR_FORMAT);
+    errors += (farmhash64_segment_writer_open(&w, path, 1000, 64, 42) != FARMHASH64_SEGMENT_ERR_ARGS);
+    unlink(path);
+    free(pos);
+    free(buf);
+    free(exp);
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors\n", __func__, errors);
+    }
+    return errors;
+}
+
+// overwrites len bytes of the file at off with a copy of the bytes at src (or flips a byte if src is 0)
+static void damage(const char *path, off_t off, off_t src, size_t len)
+{
+    char buf[4096];
+    int fd = open(path, O_RDWR);
+    if (src != 0)
+    {
+        pread(fd, buf, len, src);
+    }
+    else
+    {
+        pread(fd, buf, 1, off);
+        buf[0] ^= 0x10;
+        len = 1;
+    }
+    pwrite(fd, buf, len, off);
+    close(fd);
+}
+
+int test_farmhash64_segment_corrupt(const char *dir)
+{
+    int errors = 0;
+    char path[256];
+    snprintf(path, sizeof(path), "%s/corrupt.seg", dir);
+    const uint32_t bs = 1024;
+    farmhash64_segment_writer_t w;
+    errors += (farmhash64_segment_writer_open(&w, path, bs, 64, 1) != FARMHASH64_SEGMENT_OK);
+    char *buf = (char *)malloc(100 * bs);
+    memset(buf, 'x', 100 * bs);
+    errors += (farmhash64_segment_append(&w, buf, 100 * w.payload, NULL) != FARMHASH64_SEGMENT_OK);
+    errors += (farmhash64_segment_writer_sync(&w) != FARMHASH64_SEGMENT_OK);
+    uint32_t payload = w.payload;
+    farmhash64_segment_writer_close(&w);
+    // a flipped bit in block 10, and block 20 replaced by block 30 (same content, wrong place)
+    damage(path, (off_t)(11 * bs) + 5, 0, 0);
+    damage(path, (off_t)(21 * bs), (off_t)(31 * bs), bs);
+    farmhash64_segment_reader_t r;
+    errors += (farmhash64_segment_reader_open(&r, path) != FARMHASH64_SEGMENT_OK);
+    errors += (farmhash64_segment_read(&r, (uint64_t)10 * payload, buf, 1) != FARMHASH64_SEGMENT_ERR_CORRUPT);
+    errors += (farmhash64_segment_read(&r, (uint64_t)9 * payload, buf, 2 * payload) != FARMHASH64_SEGMENT_ERR_CORRUPT);
+    errors += (farmhash64_segment_read(&r, (uint64_t)11 * payload, buf, 9 * payload) != FARMHASH64_SEGMENT_OK);
+    farmhash64_segment_scrub_t res;
+    errors += (farmhash64_segment_scrub(&r, 4, &res) != FARMHASH64_SEGMENT_OK);
+    errors += (res.corrupt != 2) || (res.first_corrupt != 10) || (res.checked != 100 - 2 - 10);
+    farmhash64_segment_reader_close(&r);
+    // torn tail: a garbage block and half a block after the last synced one are dropped on reopen
+    int fd = open(path, O_WRONLY | O_APPEND);
+    errors += (write(fd, buf, bs + (bs / 2)) != (ssize_t)(bs + (bs / 2)));
+    close(fd);
+    errors += (farmhash64_segment_writer_open(&w, path, bs, 64, 1) != FARMHASH64_SEGMENT_OK);
+    errors += (farmhash64_segment_writer_pos(&w) != (uint64_t)100 * payload);
+    farmhash64_segment_writer_close(&w);
+    errors += (farmhash64_segment_reader_open(&r, path) != FARMHASH64_SEGMENT_OK);
+    errors += (r.nblocks != 100);
+    farmhash64_segment_reader_close(&r);
+    unlink(path);
+    free(buf);
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors\n", __func__, errors);
+    }
+    return errors;
+}
+
+int benchmark_farmhash64_segment(const char *dir)
+{
+    int errors = 0;
+    char path[256];
+    snprintf(path, sizeof(path), "%s/bench.seg", dir);
+    const size_t rec = 1000;
+    char *buf = (char *)malloc(rec);
+    memset(buf, 'r', rec);
+    farmhash64_segment_writer_t w;
+    errors += (farmhash64_segment_writer_open(&w, path, 4096, 64, 9) != FARMHASH64_SEGMENT_OK);
+    uint64_t tstart = get_time();
+    size_t i;
+    for (i = 0; i < k_bench_bytes / rec; i++)
+    {
+        errors += (farmhash64_segment_append(&w, buf, rec, NULL) != FARMHASH64_SEGMENT_OK);
+    }
+    errors += (farmhash64_segment_writer_flush(&w) != FARMHASH64_SEGMENT_OK);
+    uint64_t twrite = get_time() - tstart;
+    farmhash64_segment_writer_close(&w);
+    farmhash64_segment_reader_t r;
+    unsigned t;
+    for (t = 1; t <= 4; t *= 4)
+    {
+        errors += (farmhash64_segment_reader_open(&r, path) != FARMHASH64_SEGMENT_OK);
+        farmhash64_segment_scrub_t res;
+        tstart = get_time();
+        errors += (farmhash64_segment_scrub(&r, t, &res) != FARMHASH64_SEGMENT_OK);
+        uint64_t tscrub = get_time() - tstart;
+        errors += (res.checked != r.nblocks) || (res.corrupt != 0);
+        fprintf(stdout, " * %s : scrub %u thread(s) %.2f GB/s\n", __func__, t, (double)r.map_size / (double)tscrub);
+        farmhash64_segment_reader_close(&r);
+    }
+    // lazy verification: the first read of each block verifies it, the second one does not
+    errors += (farmhash64_segment_reader_open(&r, path) != FARMHASH64_SEGMENT_OK);
+    uint64_t tread[2];
+    int pass;
+    for (pass = 0; pass < 2; pass++)
+    {
+        tstart = get_time();
+        for (i = 0; i < k_bench_bytes / rec; i++)
+        {
+            errors += (farmhash64_segment_read(&r, (uint64_t)i * rec, buf, rec) != FARMHASH64_SEGMENT_OK);
+        }
+        tread[pass] = get_time() - tstart;
+    }
+    farmhash64_segment_reader_close(&r);
+    fprintf(stdout, " * %s : append %.2f GB/s, first read %.2f GB/s, verified read %.2f GB/s\n", __func__, (double)k_bench_bytes / (double)twrite, (double)k_bench_bytes / (double)tread[0], (double)k_bench_bytes / (double)tread[1]);
+    unlink(path);
+    free(buf);
+    return errors;
+}
+
+int main()
+{
+    int errors = 0;
+    char dir[] = "/tmp/test_farmhash64_segment_XXXXXX";
+    if (mkdtemp(dir) == NULL)
+    {
+        fprintf(stderr, "unable to create a temporary directory\n");
+        return 1;
+    }
+
+    errors += test_farmhash64_segment_basic(dir, 64);
+    errors += test_farmhash64_segment_basic(dir, 32);
+    errors += test_farmhash64_segment_corrupt(dir);
+    errors += benchmark_farmhash64_segment(dir);
+
+    rmdir(dir);
+    return errors;
+}
@@ -0,0 +1,103 @@
+// Nicola Asuni
+
+#if __STDC_VERSION__ >= 199901L
+#define _XOPEN_SOURCE 600
+#else
+#define _XOPEN_SOURCE 500
+#endif
+
+#ifndef FARMHASH64_STATS
+#define FARMHASH64_STATS
+#endif
+#ifndef FARMHASH64_STATS_CYCLES_SHIFT
+#define FARMHASH64_STATS_CYCLES_SHIFT 1
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include "../src/farmhash64.h"
+
+static char data[1024];
+
+int test_farmhash64_stats_result()
+{
+    int errors = 0;
+    uint64_t h = farmhash64("abcdefghi", 9);
+    if (h != 0x332c8ed4dae5ba42)
+    {
+        fprintf(stderr, "%s : expected %lx but got %lx\n", __func__, 0x332c8ed4dae5ba42, h);
+        ++errors;
+    }
+    return errors;
+}
+
+int test_farmhash64_stats_counters()
+{
+    int errors = 0;
+    size_t i;
+    farmhash64_stats_t st;
+    const size_t lens[] = {0, 1, 16, 17, 32, 33, 64, 65, 1000};
+    const uint64_t exp_calls[FARMHASH64_STATS_BRANCHES] = {3, 2, 2, 2};
+    farmhash64_stats_reset();
+    for (i = 0; i < sizeof(lens) / sizeof(lens[0]); i++)
+    {
+        farmhash64(data, lens[i]);
+    }
+    farmhash64_stats_snapshot(&st);
+    for (i = 0; i < FARMHASH64_STATS_BRANCHES; i++)
+    {
+        if (st.calls[i] != exp_calls[i])
+        {
+            fprintf(stderr, "%s : branch %lu expected %lu calls but got %lu\n", __func__, i, exp_calls[i], st.calls[i]);
+            ++errors;
+        }
+#if FARMHASH64_STATS_CYCLES_SHIFT >= 0
+        uint64_t exp_samples = (exp_calls[i] + (1ULL << FARMHASH64_STATS_CYCLES_SHIFT) - 1) >> FARMHASH64_STATS_CYCLES_SHIFT;
+#else
+        uint64_t exp_samples = 0;
+#endif
+        if (st.samples[i] != exp_samples)
+        {
+            fprintf(stderr, "%s : branch %lu expected %lu samples but got %lu\n", __func__, i, exp_samples, st.samples[i]);
+            ++errors;
+        }
+    }
+    // 0 -> 0; 1 -> 1; 16, 17 -> 5; 32, 33 -> 6; 64, 65 -> 7; 1000 -> 10
+    if ((st.len_calls[0] != 1) || (st.len_calls[1] != 1) || (st.len_calls[5] != 2) || (st.len_calls[6] != 2) || (st.len_calls[7] != 2) || (st.len_calls[10] != 1))
+    {
+        fprintf(stderr, "%s : unexpected length histogram\n", __func__);
+        ++errors;
+    }
+    if ((st.len_bytes[5] != 33) || (st.len_bytes[7] != 129) || (st.len_bytes[10] != 1000))
+    {
+        fprintf(stderr, "%s : unexpected bytes histogram\n", __func__);
+        ++errors;
+    }
+    farmhash64_stats_t sum;
+    memset(&sum, 0, sizeof(sum));
+    farmhash64_stats_merge(&sum, &st);
+    farmhash64_stats_merge(&sum, &st);
+    if (sum.calls[3] != 4)
+    {
+        fprintf(stderr, "%s : expected 4 merged calls but got %lu\n", __func__, sum.calls[3]);
+        ++errors;
+    }
+    farmhash64_stats_reset();
+    farmhash64_stats_snapshot(&st);
+    if (st.calls[0] != 0)
+    {
+        fprintf(stderr, "%s : counters not reset\n", __func__);
+        ++errors;
+    }
+    return errors;
+}
+
+int main()
+{
+    int errors = 0;
+
+    errors += test_farmhash64_stats_result();
+    errors += test_farmhash64_stats_counters();
+
+    return errors;
+}
@@ -0,0 +1,72 @@
+// Nicola Asuni
+
+// FARMHASH64_STATS_SHARED: the counters are shared by the translation units of the program
+// (this file defines them, test_farmhash64_stats_shared_tu.c only declares them).
+
+#if __STDC_VERSION__ >= 199901L
+#define _XOPEN_SOURCE 600
+#else
+#define _XOPEN_SOURCE 500
+#endif
+
+#ifndef FARMHASH64_STATS
+#define FARMHASH64_STATS
+#endif
+#define FARMHASH64_STATS_SHARED
+#define FARMHASH64_STATS_DEFINE
+
+#include <stdio.h>
+#include <string.h>
+#include "../src/farmhash64.h"
+
+uint64_t stats_shared_hash(const char *s, size_t len);
+void stats_shared_snapshot(farmhash64_stats_t *dst);
+
+static char data[1024];
+
+int test_farmhash64_stats_shared()
+{
+    int errors = 0;
+    farmhash64_stats_t st;
+    farmhash64_stats_t other;
+    farmhash64_stats_reset();
+    // 2 calls here, 3 calls in the other translation unit
+    farmhash64(data, 10);
+    farmhash64(data, 100);
+    if (stats_shared_hash("abcdefghi", 9) != 0x332c8ed4dae5ba42)
+    {
+        fprintf(stderr, "%s : unexpected hash from the other translation unit\n", __func__);
+        ++errors;
+    }
+    stats_shared_hash(data, 20);
+    stats_shared_hash(data, 1000);
+    farmhash64_stats_snapshot(&st);
+    stats_shared_snapshot(&other);
+    if ((st.calls[0] != 2) || (st.calls[1] != 1) || (st.calls[2] != 0) || (st.calls[3] != 2))
+    {
+        fprintf(stderr, "%s : expected {2, 1, 0, 2} calls but got {%lu, %lu, %lu, %lu}\n", __func__, st.calls[0], st.calls[1], st.calls[2], st.calls[3]);
+        ++errors;
+    }
+    if (memcmp(&st, &other, sizeof(st)) != 0)
+    {
+        fprintf(stderr, "%s : the translation units see different counters\n", __func__);
+        ++errors;
+    }
+    farmhash64_stats_reset();
+    stats_shared_snapshot(&other);
+    if (other.calls[0] != 0)
+    {
+        fprintf(stderr, "%s : counters not reset in the other translation unit\n", __func__);
+        ++errors;
+    }
+    return errors;
+}
+
+int main()
+{
+    int errors = 0;
+
+    errors += test_farmhash64_stats_shared();
+
+    return errors;
+}
@@ -0,0 +1,20 @@
+// Nicola Asuni
+
+// second translation unit of test_farmhash64_stats_shared.c
+
+#ifndef FARMHASH64_STATS
+#define FARMHASH64_STATS
+#endif
+#define FARMHASH64_STATS_SHARED
+
+#include "../src/farmhash64.h"
+
+uint64_t stats_shared_hash(const char *s, size_t len)
+{
+    return farmhash64(s, len);
+}
+
+void stats_shared_snapshot(farmhash64_stats_t *dst)
+{
+    farmhash64_stats_snapshot(dst);
+}
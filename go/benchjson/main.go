@@ -0,0 +1,116 @@
+// Command benchjson runs the cross-language benchmark (see the "Benchmarks" section of the main README.md).
+//
+// It hashes the data_setup() corpus of the C tests over fixed size classes and prints the results
+// in the farmhash64-bench/1 JSON format shared by all the language ports.
+package main
+
+import (
+	"encoding/json"
+	"fmt"
+	"os"
+	"runtime"
+	"strings"
+	"time"
+
+	farmhash64 "github.com/tecnickcom/farmhash64/go/src"
+)
+
+const dataSize = 1 << 20
+
+var sizes = []int{8, 16, 32, 64, 128, 256, 1024, 4096, 65536, 1048576}
+
+type result struct {
+	Size              int     `json:"size"`
+	Iterations        int     `json:"iterations"`
+	NsPerHash         float64 `json:"ns_per_hash"`
+	GBPerS            float64 `json:"gb_per_s"`
+	AllocsPerHash     float64 `json:"allocs_per_hash"`
+	AllocBytesPerHash float64 `json:"alloc_bytes_per_hash"`
+	Checksum          string  `json:"checksum"`
+}
+
+// dataSetup uses the same pseudorandom generator as data_setup() in c/test/test_farmhash64.c.
+func dataSetup() []byte {
+	const kt uint64 = 0xc3a5c85c97cb3127
+
+	var a, b uint64 = 9, 777
+
+	data := make([]byte, dataSize)
+
+	for i := range data {
+		a += b
+		b += a
+		a = (a ^ (a >> 41)) * kt
+		b = (b^(b>>41))*kt + uint64(i)
+		data[i] = byte(b >> 37)
+	}
+
+	return data
+}
+
+func benchIterations(size int) int {
+	return max(64, (1<<26)/size)
+}
+
+func benchOffset(i, size int) int {
+	if size <= dataSize/2 {
+		return (i & 63) << 6
+	}
+
+	return 0
+}
+
+func benchRun(data []byte, size, iterations int) uint64 {
+	var checksum uint64
+
+	for i := range iterations {
+		off := benchOffset(i, size)
+		checksum += farmhash64.FarmHash64(data[off : off+size])
+	}
+
+	return checksum
+}
+
+func round3(v float64) float64 {
+	return float64(int64(v*1000+0.5)) / 1000
+}
+
+func main() {
+	data := dataSetup()
+	rows := make([]string, 0, len(sizes))
+
+	var ms0, ms1 runtime.MemStats
+
+	for _, size := range sizes {
+		iterations := benchIterations(size)
+		benchRun(data, size, iterations/8)
+
+		runtime.ReadMemStats(&ms0)
+		start := time.Now()
+		checksum := benchRun(data, size, iterations)
+		elapsed := time.Since(start)
+		runtime.ReadMemStats(&ms1)
+
+		ns := float64(elapsed.Nanoseconds()) / float64(iterations)
+
+		row, err := json.Marshal(result{
+			Size:              size,
+			Iterations:        iterations,
+			NsPerHash:         round3(ns),
+			GBPerS:            round3(float64(size) / ns),
+			AllocsPerHash:     float64(ms1.Mallocs-ms0.Mallocs) / float64(iterations),
+			AllocBytesPerHash: float64(ms1.TotalAlloc-ms0.TotalAlloc) / float64(iterations),
+			Checksum:          fmt.Sprintf("%016x", checksum),
+		})
+		if err != nil {
+			fmt.Fprintln(os.Stderr, err)
+			os.Exit(1)
+		}
+
+		rows = append(rows, string(row))
+	}
+
+	fmt.Println(`{"schema":"farmhash64-bench/1","lang":"go","impl":"farmhash64","results":[`)
+	fmt.Println(strings.Join(rows, ",\n"))
+	fmt.Println("]}")
+}
@@ -23,3 +23,21 @@ func ExampleFarmHash32() {
 	// Output:
 	// 4101594851
 }
+
+func ExampleFarmHash64String() {
+	hash := fh.FarmHash64String("Hello, World!")
+	fmt.Println(hash)
+
+	// Output:
+	// 11358326526432651330
+}
+
+func ExampleFarmHash64Batch() {
+	keys := [][]byte{[]byte("Hello, World!"), []byte("")}
+	dst := make([]uint64, len(keys))
+	fh.FarmHash64Batch(dst, keys)
+	fmt.Println(dst)
+
+	// Output:
+	// [11358326526432651330 11160318154034397263]
+}
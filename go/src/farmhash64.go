@@ -15,6 +15,11 @@ This code has been ported/translated by Nicola Asuni (Tecnick.com) to GO code.
 */
 package farmhash64
 
+import (
+	"encoding/binary"
+	"unsafe"
+)
+
 // BASICS
 
 // Some primes between 2^63 and 2^64 for various uses.
@@ -45,13 +50,16 @@ func rotate64(val uint64, shift uint) uint64 {
 	return ((val >> shift) | (val << (64 - shift)))
 }
 
+// The fetch functions are inlined and compiled to single unaligned loads.
+// When the caller reslices s to a known length, the bounds checks are
+// resolved at compile time.
+
 func fetch32(s []byte, idx int) uint64 {
-	return uint64(s[idx+0]) | uint64(s[idx+1])<<8 | uint64(s[idx+2])<<16 | uint64(s[idx+3])<<24
+	return uint64(binary.LittleEndian.Uint32(s[idx:]))
 }
 
 func fetch64(s []byte, idx int) uint64 {
-	return uint64(s[idx+0]) | uint64(s[idx+1])<<8 | uint64(s[idx+2])<<16 | uint64(s[idx+3])<<24 |
-		uint64(s[idx+4])<<32 | uint64(s[idx+5])<<40 | uint64(s[idx+6])<<48 | uint64(s[idx+7])<<56
+	return binary.LittleEndian.Uint64(s[idx:])
 }
 
 // FARMHASH NA
@@ -176,6 +184,8 @@ func weakHashLen32WithSeedsWords(w, x, y, z, a, b uint64) uint128 {
 
 // Return a 16-byte hash for s[0] ... s[31], a, and b.  Quick and dirty.
 func weakHashLen32WithSeeds(s []byte, a, b uint64) uint128 {
+	s = s[:32]
+
 	return weakHashLen32WithSeedsWords(
 		fetch64(s, 0),
 		fetch64(s, 8),
@@ -219,20 +229,21 @@ func FarmHash64(s []byte) uint64 {
 	last64 := s[last64Idx:]
 
 	for len(s) > 64 {
-		x = rotate64(x+y+v.lo+fetch64(s, 8), 37) * k1
-		y = rotate64(y+v.hi+fetch64(s, 48), 42) * k1
+		blk := s[:64:64] // hoists the bounds checks out of the block
+		x = rotate64(x+y+v.lo+fetch64(blk, 8), 37) * k1
+		y = rotate64(y+v.hi+fetch64(blk, 48), 42) * k1
 		x ^= w.hi
-		y += v.lo + fetch64(s, 40)
+		y += v.lo + fetch64(blk, 40)
 		z = rotate64(z+w.lo, 33) * k1
-		v = weakHashLen32WithSeeds(s, v.hi*k1, x+w.lo)
-		w = weakHashLen32WithSeeds(s[32:], z+w.hi, y+fetch64(s, 16))
+		v = weakHashLen32WithSeeds(blk, v.hi*k1, x+w.lo)
+		w = weakHashLen32WithSeeds(blk[32:], z+w.hi, y+fetch64(blk, 16))
 		x, z = z, x
 		s = s[64:]
 	}
 
 	mul := k1 + ((z & 0xff) << 1)
 	// Make s point to the last 64 bytes of input.
-	s = last64
+	s = last64[:64:64]
 	w.lo += (uint64(slen-1) & 63)
 	v.lo += w.lo
 	w.lo += v.lo
@@ -253,3 +264,40 @@ func FarmHash64(s []byte) uint64 {
 func FarmHash32(s []byte) uint32 {
 	return mix64To32(FarmHash64(s))
 }
+
+// FarmHash64String returns a 64-bit fingerprint hash for a string.
+// The string bytes are read in place, so no memory is allocated.
+func FarmHash64String(s string) uint64 {
+	return FarmHash64(unsafe.Slice(unsafe.StringData(s), len(s))) //nolint:gosec // read-only view of the string bytes
+}
+
+// FarmHash32String returns a 32-bit fingerprint hash for a string.
+// NOTE: This is NOT equivalent to the original Fingerprint32 function.
+func FarmHash32String(s string) uint32 {
+	return mix64To32(FarmHash64String(s))
+}
+
+// FarmHash64Batch stores the 64-bit fingerprint hash of keys[i] in dst[i].
+// It panics if dst is shorter than keys.
+//
+// This is a plain loop, with no assembly kernel: the keys are independent, so the CPU
+// already overlaps the hashing of consecutive short keys, and the loop for long keys
+// is throughput bound. Hashing two keys per iteration needs more registers than amd64
+// has and was slower in benchmarks.
+func FarmHash64Batch(dst []uint64, keys [][]byte) {
+	dst = dst[:len(keys)]
+
+	for i, k := range keys {
+		dst[i] = FarmHash64(k)
+	}
+}
+
+// FarmHash64StringBatch stores the 64-bit fingerprint hash of keys[i] in dst[i].
+// It panics if dst is shorter than keys.
+func FarmHash64StringBatch(dst []uint64, keys []string) {
+	dst = dst[:len(keys)]
+
+	for i, k := range keys {
+		dst[i] = FarmHash64String(k)
+	}
+}
@@ -1,6 +1,9 @@
 package farmhash64
 
-import "testing"
+import (
+	"strconv"
+	"testing"
+)
 
 const (
 	testSize = 300
@@ -167,11 +170,142 @@ func TestFarmHash64Strings(t *testing.T) {
 	}
 }
 
+func TestFarmHash64String(t *testing.T) {
+	t.Parallel()
+
+	htd := hashTestData()
+
+	for _, tt := range htd {
+		t.Run("", func(t *testing.T) {
+			t.Parallel()
+
+			h := FarmHash64String(tt.in)
+			if h != tt.oh64 {
+				t.Errorf("FarmHash64String(%q)=%#08x (len=%d), want %#08x", tt.in, h, len(tt.in), tt.oh64)
+			}
+
+			h32 := FarmHash32String(tt.in)
+			if h32 != tt.oh32 {
+				t.Errorf("FarmHash32String(%q)=%#08x (len=%d), want %#08x", tt.in, h32, len(tt.in), tt.oh32)
+			}
+		})
+	}
+}
+
+func TestFarmHash64Batch(t *testing.T) {
+	t.Parallel()
+
+	htd := hashTestData()
+	keys := make([][]byte, len(htd))
+	skeys := make([]string, len(htd))
+
+	for i, tt := range htd {
+		keys[i] = []byte(tt.in)
+		skeys[i] = tt.in
+	}
+
+	dst := make([]uint64, len(htd))
+	sdst := make([]uint64, len(htd))
+
+	FarmHash64Batch(dst, keys)
+	FarmHash64StringBatch(sdst, skeys)
+
+	for i, tt := range htd {
+		if dst[i] != tt.oh64 || sdst[i] != tt.oh64 {
+			t.Errorf("batch hash of %q = %#08x, %#08x, want %#08x", tt.in, dst[i], sdst[i], tt.oh64)
+		}
+	}
+}
+
+//nolint:paralleltest // AllocsPerRun counts the allocations of the whole process
+func TestFarmHash64StringAllocs(t *testing.T) {
+	str := string(dataSetup()[:1000])
+	dst := make([]uint64, 3)
+	keys := []string{str[:10], str[:100], str}
+
+	var sink uint64
+
+	allocs := testing.AllocsPerRun(100, func() {
+		sink += FarmHash64String(str)
+
+		FarmHash64StringBatch(dst, keys)
+	})
+	if allocs != 0 {
+		t.Errorf("FarmHash64String allocated %v times per run, want 0", allocs)
+	}
+
+	if sink == 0 {
+		t.Error("unexpected zero hash")
+	}
+}
+
+func benchmarkSizes() []int {
+	return []int{4, 8, 16, 32, 64, 128, 256, 1024, 4096, 65536}
+}
+
 func BenchmarkFarmHash64(b *testing.B) {
-	buf := []byte("2ZVSmMwBTILcCekZjgZ49Py5RoJUriQ7URkCgZPw")
+	data := dataSetup()
+
+	for _, size := range benchmarkSizes() {
+		buf := data[:size]
+
+		b.Run(strconv.Itoa(size), func(b *testing.B) {
+			b.SetBytes(int64(size))
+			b.ReportAllocs()
+
+			for b.Loop() {
+				FarmHash64(buf)
+			}
+		})
+	}
+}
+
+func BenchmarkFarmHash64String(b *testing.B) {
+	data := string(dataSetup()[:65536])
+
+	for _, size := range benchmarkSizes() {
+		str := data[:size]
+
+		b.Run("conversion/"+strconv.Itoa(size), func(b *testing.B) {
+			b.SetBytes(int64(size))
+			b.ReportAllocs()
+
+			for b.Loop() {
+				FarmHash64([]byte(str))
+			}
+		})
+
+		b.Run("string/"+strconv.Itoa(size), func(b *testing.B) {
+			b.SetBytes(int64(size))
+			b.ReportAllocs()
+
+			for b.Loop() {
+				FarmHash64String(str)
+			}
+		})
+	}
+}
+
+func BenchmarkFarmHash64Batch(b *testing.B) {
+	const (
+		nkeys   = 1024
+		keySize = 16
+	)
+
+	data := dataSetup()
+	keys := make([][]byte, nkeys)
+
+	for i := range nkeys {
+		keys[i] = data[i*keySize : (i+1)*keySize]
+	}
+
+	dst := make([]uint64, nkeys)
+
+	b.SetBytes(nkeys * keySize)
+	b.ReportAllocs()
 
 	for b.Loop() {
-		FarmHash64(buf)
+		FarmHash64Batch(dst, keys)
 	}
 }
 
@@ -0,0 +1,84 @@
+package com.tecnick.farmhash64;
+
+import java.io.IOException;
+import java.lang.management.ManagementFactory;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.Locale;
+
+// Cross-language benchmark (see the "Benchmarks" section of the main README.md).
+// Hashes the data_setup() corpus of the C tests over fixed size classes and writes the results
+// in the farmhash64-bench/1 JSON format shared by all the language ports.
+// Run with "make benchjson": the output file is the first argument.
+// The JVM reports the allocated bytes but not the number of allocations (allocs_per_hash is null).
+public class FarmHash64BenchJson {
+
+    private static final int DATA_SIZE = 1 << 20;
+    private static final int[] SIZES = {8, 16, 32, 64, 128, 256, 1024, 4096, 65536, 1048576};
+
+    // Same pseudorandom generator as data_setup() in c/test/test_farmhash64.c.
+    static byte[] dataSetup() {
+        final long kt = 0xc3a5c85c97cb3127L;
+        long a = 9;
+        long b = 777;
+        byte[] data = new byte[DATA_SIZE];
+        for (int i = 0; i < DATA_SIZE; i++) {
+            a += b;
+            b += a;
+            a = (a ^ (a >>> 41)) * kt;
+            b = (b ^ (b >>> 41)) * kt + i;
+            data[i] = (byte) (b >>> 37);
+        }
+        return data;
+    }
+
+    static int benchIterations(int size) {
+        return Math.max(64, (1 << 26) / size);
+    }
+
+    static int benchOffset(int i, int size) {
+        return (size <= (DATA_SIZE / 2)) ? ((i & 63) << 6) : 0;
+    }
+
+    static long benchRun(byte[] data, int size, int iterations) {
+        long checksum = 0;
+        for (int i = 0; i < iterations; i++) {
+            checksum += FarmHash64.farmhash64(data, benchOffset(i, size), size);
+        }
+        return checksum;
+    }
+
+    public static void main(String[] args) throws IOException {
+        com.sun.management.ThreadMXBean mx = (com.sun.management.ThreadMXBean) ManagementFactory.getThreadMXBean();
+        long tid = Thread.currentThread().threadId();
+        byte[] data = dataSetup();
+        List<String> rows = new ArrayList<>();
+        for (int size : SIZES) {
+            int iterations = benchIterations(size);
+            // longer warmup than the other ports to let the JIT compile the hot loop
+            benchRun(data, size, iterations);
+            long alloc = mx.getThreadAllocatedBytes(tid);
+            long start = System.nanoTime();
+            long checksum = benchRun(data, size, iterations);
+            double ns = (double) (System.nanoTime() - start) / iterations;
+            alloc = mx.getThreadAllocatedBytes(tid) - alloc;
+            rows.add(String.format(Locale.ROOT,
+                    "{\"size\":%d,\"iterations\":%d,\"ns_per_hash\":%.3f,\"gb_per_s\":%.3f,\"allocs_per_hash\":null,\"alloc_bytes_per_hash\":%.3f,\"checksum\":\"%016x\"}",
+                    size, iterations, ns, size / ns, (double) alloc / iterations, checksum));
+        }
+        String json = "{\"schema\":\"farmhash64-bench/1\",\"lang\":\"java\",\"impl\":\"FarmHash64\",\"results\":[\n"
+                + String.join(",\n", rows) + "\n]}\n";
+        if (args.length > 0) {
+            Path out = Path.of(args[0]);
+            if (out.getParent() != null) {
+                Files.createDirectories(out.getParent());
+            }
+            Files.writeString(out, json, StandardCharsets.UTF_8);
+        } else {
+            System.out.print(json);
+        }
+    }
+}
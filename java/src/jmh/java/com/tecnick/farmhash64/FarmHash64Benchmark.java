@@ -0,0 +1,96 @@
+package com.tecnick.farmhash64;
+
+import java.lang.foreign.Arena;
+import java.lang.foreign.MemorySegment;
+import java.nio.ByteBuffer;
+import java.nio.charset.StandardCharsets;
+import java.util.Arrays;
+import java.util.concurrent.TimeUnit;
+
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Level;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Param;
+import org.openjdk.jmh.annotations.Scope;
+import org.openjdk.jmh.annotations.Setup;
+import org.openjdk.jmh.annotations.State;
+import org.openjdk.jmh.annotations.TearDown;
+import org.openjdk.jmh.annotations.Warmup;
+
+// Run with "make bench": the gc profiler reports gc.alloc.rate.norm (bytes allocated per hash).
+@State(Scope.Thread)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.NANOSECONDS)
+@Warmup(iterations = 3, time = 1)
+@Measurement(iterations = 5, time = 1)
+@Fork(1)
+public class FarmHash64Benchmark {
+
+    @Param({"8", "32", "64", "256", "4096", "65536"})
+    public int size;
+
+    private byte[] bytes;
+    private ByteBuffer direct;
+    private Arena arena;
+    private MemorySegment segment;
+    private String ascii;
+    private String unicode;
+
+    @Setup(Level.Trial)
+    public void setup() {
+        bytes = new byte[size];
+        for (int i = 0; i < size; i++) {
+            bytes[i] = (byte) ('a' + (i * 7) % 26);
+        }
+        direct = ByteBuffer.allocateDirect(size);
+        direct.put(bytes);
+        direct.flip();
+        arena = Arena.ofConfined();
+        segment = arena.allocate(size);
+        MemorySegment.copy(MemorySegment.ofArray(bytes), 0, segment, 0, size);
+        ascii = new String(bytes, StandardCharsets.US_ASCII);
+        char[] u = new char[size / 2];
+        Arrays.fill(u, '\u00e9');
+        unicode = new String(u);
+    }
+
+    @TearDown(Level.Trial)
+    public void tearDown() {
+        arena.close();
+    }
+
+    @Benchmark
+    public long byteArray() {
+        return FarmHash64.farmhash64(bytes);
+    }
+
+    @Benchmark
+    public long directBuffer() {
+        return FarmHash64.farmhash64(direct);
+    }
+
+    @Benchmark
+    public long memorySegment() {
+        return FarmHash64Segment.farmhash64(segment, 0, size);
+    }
+
+    // baseline: what callers did before the CharSequence overload
+    @Benchmark
+    public long stringGetBytes() {
+        return FarmHash64.farmhash64(ascii.getBytes(StandardCharsets.UTF_8));
+    }
+
+    @Benchmark
+    public long charSequence() {
+        return FarmHash64.farmhash64(ascii);
+    }
+
+    @Benchmark
+    public long charSequenceUnicode() {
+        return FarmHash64.farmhash64(unicode);
+    }
+}
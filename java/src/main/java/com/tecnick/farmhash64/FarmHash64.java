@@ -15,6 +15,12 @@ This code has been ported/translated by Nicola Asuni (Tecnick.com) to Java code.
 */
 package com.tecnick.farmhash64;
 
+import java.lang.invoke.MethodHandles;
+import java.lang.invoke.VarHandle;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.util.Objects;
+
 public class FarmHash64 {
 
 	private static final int c1 = 0xcc9e2d51;
@@ -24,10 +30,16 @@ public class FarmHash64 {
 	private static final long k1 = 0xb492b66fbe98f273L;
 	private static final long k2 = 0x9ae16a3b2f90404fL;
 
-	private static class UInt128 {
-		public long hi;
-		public long lo;
-	}
+	private static final long seed = 81;
+
+	// Little-endian views used to load a whole word with a single access.
+	private static final VarHandle LE32 = MethodHandles.byteArrayViewVarHandle(int[].class, ByteOrder.LITTLE_ENDIAN);
+	private static final VarHandle LE64 = MethodHandles.byteArrayViewVarHandle(long[].class, ByteOrder.LITTLE_ENDIAN);
+	private static final VarHandle LE32_BUFFER = MethodHandles.byteBufferViewVarHandle(int[].class, ByteOrder.LITTLE_ENDIAN);
+	private static final VarHandle LE64_BUFFER = MethodHandles.byteBufferViewVarHandle(long[].class, ByteOrder.LITTLE_ENDIAN);
+
+	// Per-thread scratch space used to hash a CharSequence as UTF-8, and the hash state for long buffers and segments.
+	private static final ThreadLocal<BlockStream> BLOCK_STREAM = ThreadLocal.withInitial(BlockStream::new);
 
 	private static int rotate32(int val, int shift) {
 		return (val >>> shift) | (val << (32 - shift));
@@ -38,21 +50,19 @@ public class FarmHash64 {
 	}
 
 	private static long fetch32(byte[] s, int idx) {
-		return (s[idx + 0] & 0xFFL)
-				| ((s[idx + 1] & 0xFFL) << 8)
-				| ((s[idx + 2] & 0xFFL) << 16)
-				| ((s[idx + 3] & 0xFFL) << 24);
+		return (int) LE32.get(s, idx) & 0xFFFFFFFFL;
+	}
+
+	static long fetch64(byte[] s, int idx) {
+		return (long) LE64.get(s, idx);
+	}
+
+	private static long fetch32(ByteBuffer s, int idx) {
+		return (int) LE32_BUFFER.get(s, idx) & 0xFFFFFFFFL;
 	}
 
-	private static long fetch64(byte[] s, int idx) {
-		return (s[idx + 0] & 0xFFL)
-				| ((s[idx + 1] & 0xFFL) << 8)
-				| ((s[idx + 2] & 0xFFL) << 16)
-				| ((s[idx + 3] & 0xFFL) << 24)
-				| ((s[idx + 4] & 0xFFL) << 32)
-				| ((s[idx + 5] & 0xFFL) << 40)
-				| ((s[idx + 6] & 0xFFL) << 48)
-				| ((s[idx + 7] & 0xFFL) << 56);
+	private static long fetch64(ByteBuffer s, int idx) {
+		return (long) LE64_BUFFER.get(s, idx);
 	}
 
 	private static long shiftMix(long val) {
@@ -70,7 +80,7 @@ public class FarmHash64 {
 		return ((h * 5) + 0xe6546b64);
 	}
 
-	private static int mix64To32(long x) {
+	static int mix64To32(long x) {
 		return mur((int) (x >>> 32), (int) ((x << 32) >>> 32));
 	}
 
@@ -85,49 +95,39 @@ public class FarmHash64 {
 		return b;
 	}
 
-	private static long hashLen0to16(byte[] s) {
-		long slen = s.length;
+	// The size classes up to 64 bytes take the words they read as arguments,
+	// so that byte arrays, buffers and segments share them and each source is read in place.
 
-		if (slen >= 8) {
-			long mul = k2 + slen * 2;
-			long a = fetch64(s, 0) + k2;
-			long b = fetch64(s, (int) (slen - 8));
-			long c = rotate64(b, 37) * mul + a;
-			long d = (rotate64(a, 25) + b) * mul;
-
-			return hashLen16Mul(c, d, mul);
-		}
+	static long hashLen0to3(long a, long b, long c, long slen) {
+		long y = a + (b << 8);
+		long z = slen + (c << 2);
 
-		if (slen >= 4) {
-			long mul = k2 + slen * 2;
-			long a = fetch32(s, 0);
+		return shiftMix((y * k2) ^ (z * k0)) * k2;
+	}
 
-			return hashLen16Mul(
-					slen + (a << 3),
-					fetch32(s, (int) (slen - 4)),
-					mul);
-		}
+	// a and b are the first and the last 32-bit words.
+	static long hashLen4to7(long a, long b, long slen) {
+		long mul = k2 + slen * 2;
 
-		if (slen > 0) {
-			long a = s[0] & 0xFFL;
-			long b = s[(int) (slen >> 1)] & 0xFFL;
-			long c = s[(int) (slen - 1)] & 0xFFL;
-			long y = a + (b << 8);
-			long z = slen + (c << 2);
+		return hashLen16Mul(slen + (a << 3), b, mul);
+	}
 
-			return shiftMix((y * k2) ^ (z * k0)) * k2;
-		}
+	// a and b are the first and the last 64-bit words.
+	static long hashLen8to16(long a, long b, long slen) {
+		long mul = k2 + slen * 2;
+		a += k2;
+		long c = rotate64(b, 37) * mul + a;
+		long d = (rotate64(a, 25) + b) * mul;
 
-		return k2;
+		return hashLen16Mul(c, d, mul);
 	}
 
-	private static long hashLen17to32(byte[] s) {
-		int slen = s.length;
-		long mul = k2 + (long) slen * 2;
-		long a = fetch64(s, 0) * k1;
-		long b = fetch64(s, 8);
-		long c = fetch64(s, slen - 8) * mul;
-		long d = fetch64(s, slen - 16) * k2;
+	// a and b are the first two 64-bit words, d and c the last two.
+	static long hashLen17to32(long a, long b, long d, long c, long slen) {
+		long mul = k2 + slen * 2;
+		a *= k1;
+		c *= mul;
+		d *= k2;
 
 		return hashLen16Mul(
 				rotate64(a + b, 43) + rotate64(c, 30) + d,
@@ -135,19 +135,17 @@ public class FarmHash64 {
 				mul);
 	}
 
-	private static long hashLen33to64(byte[] s) {
-		int slen = s.length;
-		long mul = k2 + (long) slen * 2;
-		long a = fetch64(s, 0) * k2;
-		long b = fetch64(s, 8);
-		long c = fetch64(s, slen - 8) * mul;
-		long d = fetch64(s, slen - 16) * k2;
+	// a, b, e and f are the first four 64-bit words, g, h, d and c the last four.
+	static long hashLen33to64(long a, long b, long e, long f, long g, long h, long d, long c, long slen) {
+		long mul = k2 + slen * 2;
+		a *= k2;
+		c *= mul;
+		d *= k2;
 		long y = rotate64(a + b, 43) + rotate64(c, 30) + d;
 		long z = hashLen16Mul(y, a + rotate64(b + k2, 18) + c, mul);
-		long e = fetch64(s, 16) * mul;
-		long f = fetch64(s, 24);
-		long g = (y + fetch64(s, slen - 32)) * mul;
-		long h = (z + fetch64(s, slen - 24)) * mul;
+		e *= mul;
+		g = (y + g) * mul;
+		h = (z + h) * mul;
 
 		return hashLen16Mul(
 				rotate64(e + f, 43) + rotate64(g, 30) + h,
@@ -155,103 +153,415 @@ public class FarmHash64 {
 				mul);
 	}
 
-	private static UInt128 weakHashLen32WithSeedsWords(long w, long x, long y, long z, long a, long b) {
-		a += w;
-		b = rotate64(b + a + z, 21);
-		long c = a;
-		a += x;
-		a += y;
-		b += rotate64(a, 44);
+	private static long hashLen0to16(byte[] s, int idx, int slen) {
+		if (slen >= 8) {
+			return hashLen8to16(fetch64(s, idx), fetch64(s, idx + slen - 8), slen);
+		}
 
-		UInt128 result = new UInt128();
-		result.hi = b + c;
-		result.lo = a + z;
+		if (slen >= 4) {
+			return hashLen4to7(fetch32(s, idx), fetch32(s, idx + slen - 4), slen);
+		}
 
-		return result;
-	}
+		if (slen > 0) {
+			return hashLen0to3(
+					s[idx] & 0xFFL,
+					s[idx + (slen >> 1)] & 0xFFL,
+					s[idx + slen - 1] & 0xFFL,
+					slen);
+		}
 
-	private static UInt128 weakHashLen32WithSeeds(byte[] s, int idx, long a, long b) {
-		return weakHashLen32WithSeedsWords(
-				fetch64(s, idx + 0),
-				fetch64(s, idx + 8),
-				fetch64(s, idx + 16),
-				fetch64(s, idx + 24),
-				a,
-				b);
+		return k2;
 	}
 
-	public static long farmhash64(byte[] s) {
-		int slen = s.length;
-
-		long seed = 81;
+	private static long hashLen17to32(byte[] s, int idx, int slen) {
+		int end = idx + slen;
 
+		return hashLen17to32(
+				fetch64(s, idx), fetch64(s, idx + 8),
+				fetch64(s, end - 16), fetch64(s, end - 8),
+				slen);
+	}
 
-		if (slen <= 32) {
-			if (slen <= 16) {
-				return hashLen0to16(s);
-			}
-			
-			return hashLen17to32(s);
-		}
+	private static long hashLen33to64(byte[] s, int idx, int slen) {
+		int end = idx + slen;
 
-		if (slen <= 64) {
-			return hashLen33to64(s);
-		}
+		return hashLen33to64(
+				fetch64(s, idx), fetch64(s, idx + 8), fetch64(s, idx + 16), fetch64(s, idx + 24),
+				fetch64(s, end - 32), fetch64(s, end - 24), fetch64(s, end - 16), fetch64(s, end - 8),
+				slen);
+	}
 
+	private static long hashLen65Plus(byte[] s, int idx, int slen) {
 		// For strings over 64 bytes we loop.
 		// Internal state consists of 56 bytes: v, w, x, y, and z.
-		UInt128 v = new UInt128();
-		UInt128 w = new UInt128();
-		long x = seed * k2 + fetch64(s, 0);
+		// The v and w pairs are kept in locals so that no object is allocated per block.
+		long vlo = 0;
+		long vhi = 0;
+		long wlo = 0;
+		long whi = 0;
+		long x = seed * k2 + fetch64(s, idx);
 		long y = seed * k1 + 113;
 		long z = shiftMix(y * k2 + 113) * k2;
-		long tmp = 0;
+		long a;
+		long b;
+		long c;
+		long tmp;
 
 		// Set end so that after the loop we have 1 to 64 bytes left to process.
-		int endIdx = ((slen - 1) >> 6) << 6;
-		int last64Idx = endIdx + ((slen - 1) & 63) - 63;
-		int idx = 0;
-
-		while (slen > 64) {
-			x = rotate64(x + y + v.lo + fetch64(s, idx + 8), 37) * k1;
-			y = rotate64(y + v.hi + fetch64(s, idx + 48), 42) * k1;
-			x ^= w.hi;
-			y += v.lo + fetch64(s, idx + 40);
-			z = rotate64(z + w.lo, 33) * k1;
-			v = weakHashLen32WithSeeds(s, idx, v.hi * k1, x + w.lo);
-			w = weakHashLen32WithSeeds(s, idx + 32, z + w.hi, y + fetch64(s, idx + 16));
+		int endIdx = idx + (((slen - 1) >> 6) << 6);
+		int last64Idx = idx + slen - 64;
+
+		for (; idx < endIdx; idx += 64) {
+			x = rotate64(x + y + vlo + fetch64(s, idx + 8), 37) * k1;
+			y = rotate64(y + vhi + fetch64(s, idx + 48), 42) * k1;
+			x ^= whi;
+			y += vlo + fetch64(s, idx + 40);
+			z = rotate64(z + wlo, 33) * k1;
+			// v = weakHashLen32WithSeeds(s + idx, v.hi * k1, x + w.lo)
+			a = vhi * k1 + fetch64(s, idx);
+			b = rotate64(x + wlo + a + fetch64(s, idx + 24), 21);
+			c = a;
+			a += fetch64(s, idx + 8) + fetch64(s, idx + 16);
+			vlo = a + fetch64(s, idx + 24);
+			vhi = b + rotate64(a, 44) + c;
+			// w = weakHashLen32WithSeeds(s + idx + 32, z + w.hi, y + fetch64(s + idx + 16))
+			a = z + whi + fetch64(s, idx + 32);
+			b = rotate64(y + fetch64(s, idx + 16) + a + fetch64(s, idx + 56), 21);
+			c = a;
+			a += fetch64(s, idx + 40) + fetch64(s, idx + 48);
+			wlo = a + fetch64(s, idx + 56);
+			whi = b + rotate64(a, 44) + c;
 			tmp = x;
 			x = z;
 			z = tmp;
-			idx += 64;
-			slen -= 64;
 		}
 
 		long mul = k1 + ((z & 0xFFL) << 1);
 
-		// Make s point to the last 64 bytes of input.
+		// Make idx point to the last 64 bytes of input.
 		idx = last64Idx;
-		w.lo += ((long) slen - 1) & 63;
-		v.lo += w.lo;
-		w.lo += v.lo;
-		x = rotate64(x + y + v.lo + fetch64(s, idx + 8), 37) * mul;
-		y = rotate64(y + v.hi + fetch64(s, idx + 48), 42) * mul;
-		x ^= w.hi * 9;
-		y += v.lo * 9 + fetch64(s, idx + 40);
-		z = rotate64(z + w.lo, 33) * mul;
-		v = weakHashLen32WithSeeds(s, idx, v.hi * mul, x + w.lo);
-		w = weakHashLen32WithSeeds(s, idx + 32, z + w.hi, y + fetch64(s, idx + 16));
-		tmp = x;
-		x = z;
-		z = tmp;
-
+		wlo += (slen - 1) & 63;
+		vlo += wlo;
+		wlo += vlo;
+		x = rotate64(x + y + vlo + fetch64(s, idx + 8), 37) * mul;
+		y = rotate64(y + vhi + fetch64(s, idx + 48), 42) * mul;
+		x ^= whi * 9;
+		y += vlo * 9 + fetch64(s, idx + 40);
+		z = rotate64(z + wlo, 33) * mul;
+		a = vhi * mul + fetch64(s, idx);
+		b = rotate64(x + wlo + a + fetch64(s, idx + 24), 21);
+		c = a;
+		a += fetch64(s, idx + 8) + fetch64(s, idx + 16);
+		vlo = a + fetch64(s, idx + 24);
+		vhi = b + rotate64(a, 44) + c;
+		a = z + whi + fetch64(s, idx + 32);
+		b = rotate64(y + fetch64(s, idx + 16) + a + fetch64(s, idx + 56), 21);
+		c = a;
+		a += fetch64(s, idx + 40) + fetch64(s, idx + 48);
+		wlo = a + fetch64(s, idx + 56);
+		whi = b + rotate64(a, 44) + c;
+
+		// x and z are swapped here.
 		return hashLen16Mul(
-				hashLen16Mul(v.lo, w.lo, mul) + shiftMix(y) * k0 + z,
-				hashLen16Mul(v.hi, w.hi, mul) + x,
+				hashLen16Mul(vlo, wlo, mul) + shiftMix(y) * k0 + x,
+				hashLen16Mul(vhi, whi, mul) + z,
 				mul);
 	}
 
+	static long hash(byte[] s, int idx, int slen) {
+		if (slen <= 32) {
+			if (slen <= 16) {
+				return hashLen0to16(s, idx, slen);
+			}
+
+			return hashLen17to32(s, idx, slen);
+		}
+
+		if (slen <= 64) {
+			return hashLen33to64(s, idx, slen);
+		}
+
+		return hashLen65Plus(s, idx, slen);
+	}
+
+	// Returns the length of the UTF-8 encoding of s, as produced by String.getBytes(UTF_8).
+	private static long utf8Length(CharSequence s) {
+		int n = s.length();
+		long slen = n;
+
+		for (int i = 0; i < n; i++) {
+			char ch = s.charAt(i);
+
+			if (ch < 0x80) {
+				continue;
+			}
+
+			if (ch < 0x800) {
+				slen += 1;
+			} else if (!Character.isSurrogate(ch)) {
+				slen += 2;
+			} else if (Character.isHighSurrogate(ch) && (i + 1 < n) && Character.isLowSurrogate(s.charAt(i + 1))) {
+				// 4 bytes for 2 chars
+				slen += 2;
+				i++;
+			}
+			// unpaired surrogates are replaced by a single '?'
+		}
+
+		return slen;
+	}
+
+	static BlockStream blockStream() {
+		return BLOCK_STREAM.get();
+	}
+
+	/*
+	 * Hash state of an input over 64 bytes that is not in a byte array, updated one 64-byte block at a time.
+	 * The UTF-8 encoding of a CharSequence is streamed through buf; direct buffers (and MemorySegments,
+	 * see FarmHash64Segment) are read in place and their words passed to block and finish.
+	 * For the UTF-8 encoding the buffer holds the previous 64-byte block, the current block and room
+	 * for one encoded code point; the tail of the previous block is needed
+	 * because the final step rereads the last 64 bytes of the input.
+	 */
+	static final class BlockStream {
+		final byte[] buf = new byte[64 + 64 + 4];
+		long vlo;
+		long vhi;
+		long wlo;
+		long whi;
+		long x;
+		long y;
+		long z;
+
+		long hash(CharSequence s, long slen) {
+			final byte[] b = buf;
+			final int n = s.length();
+			final long blocks = (slen - 1) >> 6; // blocks processed before the last 1 to 64 bytes
+			long done = 0;
+			int pos = 64;
+
+			for (int i = 0; i < n; i++) {
+				char ch = s.charAt(i);
+
+				if (ch < 0x80) {
+					b[pos++] = (byte) ch;
+				} else if (ch < 0x800) {
+					b[pos++] = (byte) (0xC0 | (ch >> 6));
+					b[pos++] = (byte) (0x80 | (ch & 0x3F));
+				} else if (!Character.isSurrogate(ch)) {
+					b[pos++] = (byte) (0xE0 | (ch >> 12));
+					b[pos++] = (byte) (0x80 | ((ch >> 6) & 0x3F));
+					b[pos++] = (byte) (0x80 | (ch & 0x3F));
+				} else if (Character.isHighSurrogate(ch) && (i + 1 < n) && Character.isLowSurrogate(s.charAt(i + 1))) {
+					int cp = Character.toCodePoint(ch, s.charAt(++i));
+					b[pos++] = (byte) (0xF0 | (cp >> 18));
+					b[pos++] = (byte) (0x80 | ((cp >> 12) & 0x3F));
+					b[pos++] = (byte) (0x80 | ((cp >> 6) & 0x3F));
+					b[pos++] = (byte) (0x80 | (cp & 0x3F));
+				} else {
+					b[pos++] = (byte) '?';
+				}
+
+				if ((pos >= 128) && (done < blocks)) {
+					if (done == 0) {
+						init(fetch64(b, 64));
+					}
+					block(b, 64);
+					done++;
+					System.arraycopy(b, 64, b, 0, pos - 64);
+					pos -= 64;
+				}
+			}
+
+			if (slen <= 64) {
+				return FarmHash64.hash(b, 64, (int) slen);
+			}
+
+			return finish(b, pos - 64, slen);
+		}
+
+		// Hashes slen > 64 bytes of a buffer from the absolute index pos.
+		long hash(ByteBuffer s, int pos, int slen) {
+			final int end = pos + (((slen - 1) >> 6) << 6);
+			init(fetch64(s, pos));
+
+			for (int i = pos; i < end; i += 64) {
+				block(
+						fetch64(s, i), fetch64(s, i + 8), fetch64(s, i + 16), fetch64(s, i + 24),
+						fetch64(s, i + 32), fetch64(s, i + 40), fetch64(s, i + 48), fetch64(s, i + 56));
+			}
+
+			final int last = pos + slen - 64;
+
+			return finish(
+					fetch64(s, last), fetch64(s, last + 8), fetch64(s, last + 16), fetch64(s, last + 24),
+					fetch64(s, last + 32), fetch64(s, last + 40), fetch64(s, last + 48), fetch64(s, last + 56),
+					slen);
+		}
+
+		void init(long first64) {
+			vlo = 0;
+			vhi = 0;
+			wlo = 0;
+			whi = 0;
+			x = seed * k2 + first64;
+			y = seed * k1 + 113;
+			z = shiftMix(y * k2 + 113) * k2;
+		}
+
+		void block(byte[] s, int idx) {
+			block(
+					fetch64(s, idx), fetch64(s, idx + 8), fetch64(s, idx + 16), fetch64(s, idx + 24),
+					fetch64(s, idx + 32), fetch64(s, idx + 40), fetch64(s, idx + 48), fetch64(s, idx + 56));
+		}
+
+		// s0 ... s7 are the eight 64-bit words of the block.
+		void block(long s0, long s1, long s2, long s3, long s4, long s5, long s6, long s7) {
+			long a;
+			long b;
+			long c;
+			long tmp;
+
+			x = rotate64(x + y + vlo + s1, 37) * k1;
+			y = rotate64(y + vhi + s6, 42) * k1;
+			x ^= whi;
+			y += vlo + s5;
+			z = rotate64(z + wlo, 33) * k1;
+			a = vhi * k1 + s0;
+			b = rotate64(x + wlo + a + s3, 21);
+			c = a;
+			a += s1 + s2;
+			vlo = a + s3;
+			vhi = b + rotate64(a, 44) + c;
+			a = z + whi + s4;
+			b = rotate64(y + s2 + a + s7, 21);
+			c = a;
+			a += s5 + s6;
+			wlo = a + s7;
+			whi = b + rotate64(a, 44) + c;
+			tmp = x;
+			x = z;
+			z = tmp;
+		}
+
+		long finish(byte[] s, int idx, long slen) {
+			return finish(
+					fetch64(s, idx), fetch64(s, idx + 8), fetch64(s, idx + 16), fetch64(s, idx + 24),
+					fetch64(s, idx + 32), fetch64(s, idx + 40), fetch64(s, idx + 48), fetch64(s, idx + 56),
+					slen);
+		}
+
+		// s0 ... s7 are the eight 64-bit words of the last 64 bytes of the input.
+		long finish(long s0, long s1, long s2, long s3, long s4, long s5, long s6, long s7, long slen) {
+			long mul = k1 + ((z & 0xFFL) << 1);
+			long a;
+			long b;
+			long c;
+
+			wlo += (slen - 1) & 63;
+			vlo += wlo;
+			wlo += vlo;
+			x = rotate64(x + y + vlo + s1, 37) * mul;
+			y = rotate64(y + vhi + s6, 42) * mul;
+			x ^= whi * 9;
+			y += vlo * 9 + s5;
+			z = rotate64(z + wlo, 33) * mul;
+			a = vhi * mul + s0;
+			b = rotate64(x + wlo + a + s3, 21);
+			c = a;
+			a += s1 + s2;
+			vlo = a + s3;
+			vhi = b + rotate64(a, 44) + c;
+			a = z + whi + s4;
+			b = rotate64(y + s2 + a + s7, 21);
+			c = a;
+			a += s5 + s6;
+			wlo = a + s7;
+			whi = b + rotate64(a, 44) + c;
+
+			return hashLen16Mul(
+					hashLen16Mul(vlo, wlo, mul) + shiftMix(y) * k0 + x,
+					hashLen16Mul(vhi, whi, mul) + z,
+					mul);
+		}
+	}
+
+	// Hashes slen bytes of a buffer from the absolute index idx, reading the words in place.
+	private static long hash(ByteBuffer s, int idx, int slen) {
+		final int end = idx + slen;
+
+		if (slen <= 16) {
+			if (slen >= 8) {
+				return hashLen8to16(fetch64(s, idx), fetch64(s, end - 8), slen);
+			}
+
+			if (slen >= 4) {
+				return hashLen4to7(fetch32(s, idx), fetch32(s, end - 4), slen);
+			}
+
+			if (slen > 0) {
+				return hashLen0to3(s.get(idx) & 0xFFL, s.get(idx + (slen >> 1)) & 0xFFL, s.get(end - 1) & 0xFFL, slen);
+			}
+
+			return k2;
+		}
+
+		if (slen <= 32) {
+			return hashLen17to32(
+					fetch64(s, idx), fetch64(s, idx + 8),
+					fetch64(s, end - 16), fetch64(s, end - 8),
+					slen);
+		}
+
+		if (slen <= 64) {
+			return hashLen33to64(
+					fetch64(s, idx), fetch64(s, idx + 8), fetch64(s, idx + 16), fetch64(s, idx + 24),
+					fetch64(s, end - 32), fetch64(s, end - 24), fetch64(s, end - 16), fetch64(s, end - 8),
+					slen);
+		}
+
+		return BLOCK_STREAM.get().hash(s, idx, slen);
+	}
+
+	public static long farmhash64(byte[] s) {
+		return hash(s, 0, s.length);
+	}
+
+	public static long farmhash64(byte[] s, int off, int len) {
+		Objects.checkFromIndexSize(off, len, s.length);
+
+		return hash(s, off, len);
+	}
+
+	// Hashes the remaining bytes of the buffer; the buffer position is not modified.
+	// Direct and read-only buffers are read in place with little-endian word loads.
+	public static long farmhash64(ByteBuffer s) {
+		if (s.hasArray()) {
+			return hash(s.array(), s.arrayOffset() + s.position(), s.remaining());
+		}
+
+		return hash(s, s.position(), s.remaining());
+	}
+
+	// Hashes the UTF-8 encoding of s without allocating; the result is the same
+	// as farmhash64(s.toString().getBytes(StandardCharsets.UTF_8)).
+	public static long farmhash64(CharSequence s) {
+		return BLOCK_STREAM.get().hash(s, utf8Length(s));
+	}
+
 	public static int farmhash32(byte[] s) {
 		return mix64To32(farmhash64(s));
 	}
+
+	public static int farmhash32(byte[] s, int off, int len) {
+		return mix64To32(farmhash64(s, off, len));
+	}
+
+	public static int farmhash32(ByteBuffer s) {
+		return mix64To32(farmhash64(s));
+	}
+
+	public static int farmhash32(CharSequence s) {
+		return mix64To32(farmhash64(s));
+	}
 }
@@ -0,0 +1,98 @@
+/*
+FarmHash64 and FarmHash32 of the bytes of a MemorySegment (java.lang.foreign, final since Java 22).
+
+This class is compiled for Java 22 and shipped in the META-INF/versions/22 section of the multi-release jar,
+so the rest of the library keeps working on Java 21. The segment is read in place with little-endian
+word loads, which are passed to the same size classes and block steps as the words of a byte array.
+*/
+package com.tecnick.farmhash64;
+
+import java.lang.foreign.MemorySegment;
+import java.lang.foreign.ValueLayout;
+import java.nio.ByteOrder;
+import java.util.Objects;
+
+public final class FarmHash64Segment {
+
+	// The input can start at any offset, so the word layouts must allow unaligned access.
+	private static final ValueLayout.OfInt LE32 = ValueLayout.JAVA_INT_UNALIGNED.withOrder(ByteOrder.LITTLE_ENDIAN);
+	private static final ValueLayout.OfLong LE64 = ValueLayout.JAVA_LONG_UNALIGNED.withOrder(ByteOrder.LITTLE_ENDIAN);
+
+	private static final byte[] EMPTY = new byte[0];
+
+	private FarmHash64Segment() {
+	}
+
+	private static long fetch8(MemorySegment s, long idx) {
+		return s.get(ValueLayout.JAVA_BYTE, idx) & 0xFFL;
+	}
+
+	private static long fetch32(MemorySegment s, long idx) {
+		return s.get(LE32, idx) & 0xFFFFFFFFL;
+	}
+
+	private static long fetch64(MemorySegment s, long idx) {
+		return s.get(LE64, idx);
+	}
+
+	private static long hash(MemorySegment s, long idx, long slen) {
+		final long end = idx + slen;
+
+		if (slen <= 16) {
+			if (slen >= 8) {
+				return FarmHash64.hashLen8to16(fetch64(s, idx), fetch64(s, end - 8), slen);
+			}
+
+			if (slen >= 4) {
+				return FarmHash64.hashLen4to7(fetch32(s, idx), fetch32(s, end - 4), slen);
+			}
+
+			if (slen > 0) {
+				return FarmHash64.hashLen0to3(fetch8(s, idx), fetch8(s, idx + (slen >> 1)), fetch8(s, end - 1), slen);
+			}
+
+			return FarmHash64.hash(EMPTY, 0, 0);
+		}
+
+		if (slen <= 32) {
+			return FarmHash64.hashLen17to32(
+					fetch64(s, idx), fetch64(s, idx + 8),
+					fetch64(s, end - 16), fetch64(s, end - 8),
+					slen);
+		}
+
+		if (slen <= 64) {
+			return FarmHash64.hashLen33to64(
+					fetch64(s, idx), fetch64(s, idx + 8), fetch64(s, idx + 16), fetch64(s, idx + 24),
+					fetch64(s, end - 32), fetch64(s, end - 24), fetch64(s, end - 16), fetch64(s, end - 8),
+					slen);
+		}
+
+		final FarmHash64.BlockStream st = FarmHash64.blockStream();
+		final long blocksEnd = idx + (((slen - 1) >> 6) << 6);
+		st.init(fetch64(s, idx));
+
+		for (long i = idx; i < blocksEnd; i += 64) {
+			st.block(
+					fetch64(s, i), fetch64(s, i + 8), fetch64(s, i + 16), fetch64(s, i + 24),
+					fetch64(s, i + 32), fetch64(s, i + 40), fetch64(s, i + 48), fetch64(s, i + 56));
+		}
+
+		final long last = end - 64;
+
+		return st.finish(
+				fetch64(s, last), fetch64(s, last + 8), fetch64(s, last + 16), fetch64(s, last + 24),
+				fetch64(s, last + 32), fetch64(s, last + 40), fetch64(s, last + 48), fetch64(s, last + 56),
+				slen);
+	}
+
+	public static long farmhash64(MemorySegment s, long off, long len) {
+		Objects.checkFromIndexSize(off, len, s.byteSize());
+
+		return hash(s, off, len);
+	}
+
+	public static int farmhash32(MemorySegment s, long off, long len) {
+		return FarmHash64.mix64To32(farmhash64(s, off, len));
+	}
+}
@@ -1,7 +1,12 @@
 package com.tecnick.farmhash64;
 
 import static org.junit.jupiter.api.Assertions.assertEquals;
+import java.lang.foreign.Arena;
+import java.lang.foreign.MemorySegment;
+import java.nio.ByteBuffer;
+import java.nio.charset.StandardCharsets;
 import java.util.Arrays;
+import java.util.Random;
 import java.util.stream.Stream;
 
 import org.junit.jupiter.api.Test;
@@ -175,6 +180,94 @@ public class FarmHash64Test {
         assertEquals(oh32, h);
     }
 
+    @ParameterizedTest
+    @MethodSource("hashTestData_Parameters")
+    public void farmhash64CharSequence(int oh32, long oh64, String in) throws Throwable {
+        assertEquals(oh64, FarmHash64.farmhash64(in));
+        assertEquals(oh64, FarmHash64.farmhash64(new StringBuilder(in)));
+        assertEquals(oh32, FarmHash64.farmhash32(in));
+    }
+
+    @ParameterizedTest
+    @MethodSource("hashTestData_Parameters")
+    public void farmhash64Buffer(int oh32, long oh64, String in) throws Throwable {
+        byte[] b = in.getBytes(StandardCharsets.UTF_8);
+        ByteBuffer heap = ByteBuffer.allocate(b.length + 3);
+        heap.position(3);
+        heap.put(b);
+        heap.position(3);
+        assertEquals(oh64, FarmHash64.farmhash64(heap.slice()));
+        assertEquals(oh64, FarmHash64.farmhash64(heap));
+        assertEquals(3, heap.position());
+        assertEquals(oh64, FarmHash64.farmhash64(heap.asReadOnlyBuffer()));
+        ByteBuffer direct = ByteBuffer.allocateDirect(b.length);
+        direct.put(b);
+        direct.flip();
+        assertEquals(oh64, FarmHash64.farmhash64(direct));
+        assertEquals(oh32, FarmHash64.farmhash32(direct));
+    }
+
+    @ParameterizedTest
+    @MethodSource("hashTestData_Parameters")
+    public void farmhash64Segment(int oh32, long oh64, String in) throws Throwable {
+        byte[] b = in.getBytes(StandardCharsets.UTF_8);
+        try (Arena arena = Arena.ofConfined()) {
+            MemorySegment seg = arena.allocate(b.length + 5);
+            MemorySegment.copy(MemorySegment.ofArray(b), 0, seg, 5, b.length);
+            assertEquals(oh64, FarmHash64Segment.farmhash64(seg, 5, b.length));
+            assertEquals(oh32, FarmHash64Segment.farmhash32(seg, 5, b.length));
+        }
+        assertEquals(oh64, FarmHash64Segment.farmhash64(MemorySegment.ofArray(b), 0, b.length));
+    }
+
+    // direct buffers and segments are read in place at unaligned offsets: check every size class and block boundary
+    @Test
+    public void farmhash64BlockStreamLengths() {
+        byte[] data = Arrays.copyOf(dataSetup(), 4096);
+        ByteBuffer direct = ByteBuffer.allocateDirect(data.length);
+        direct.put(data);
+        ByteBuffer readOnly = ByteBuffer.wrap(data).asReadOnlyBuffer();
+        MemorySegment seg = MemorySegment.ofArray(data);
+
+        try (Arena arena = Arena.ofConfined()) {
+            MemorySegment offHeap = arena.allocate(data.length);
+            MemorySegment.copy(seg, 0, offHeap, 0, data.length);
+
+            for (int len = 0; len < 600; len++) {
+                int off = len % 7;
+                long exp = FarmHash64.farmhash64(data, off, len);
+                direct.limit(off + len);
+                direct.position(off);
+                readOnly.limit(off + len);
+                readOnly.position(off);
+                assertEquals(exp, FarmHash64.farmhash64(direct), "direct buffer | len: " + len);
+                assertEquals(exp, FarmHash64.farmhash64(readOnly), "read-only buffer | len: " + len);
+                assertEquals(exp, FarmHash64Segment.farmhash64(seg, off, len), "segment | len: " + len);
+                assertEquals(exp, FarmHash64Segment.farmhash64(offHeap, off, len), "off-heap segment | len: " + len);
+            }
+        }
+
+        direct.clear();
+        assertEquals(FarmHash64.farmhash64(data), FarmHash64.farmhash64(direct));
+    }
+
+    @Test
+    public void farmhash64CharSequenceUtf8() {
+        Random rnd = new Random(42);
+        char[] pool = {'a', 'Z', '7', '\u00e9', '\u00df', '\u0416', '\u20ac', '\u4e2d', '\ud83d', '\ude00'};
+
+        for (int n = 0; n < 600; n++) {
+            StringBuilder sb = new StringBuilder();
+            for (int i = 0; i < n; i++) {
+                // the pool contains both paired and unpaired surrogates
+                sb.append(pool[rnd.nextInt(pool.length)]);
+            }
+            String str = sb.toString();
+            long exp = FarmHash64.farmhash64(str.getBytes(StandardCharsets.UTF_8));
+            assertEquals(exp, FarmHash64.farmhash64(str), "length: " + n + " | string: " + str);
+        }
+    }
+
     private byte[] dataSetup() {
         final long kt = 0xc3a5c85c97cb3127L;
 
@@ -201,6 +294,8 @@ public class FarmHash64Test {
         long h = FarmHash64.farmhash64(s);
         int a = (int) (h >>> 32);
 
+        assertEquals(h, FarmHash64.farmhash64(data, offset, hlen), "offset: " + offset + " | hlen:" + hlen);
+
         long[] exp = expectedFarmHash64();
 
         assertEquals((int) exp[index], a, " | index: " + index + " | hlen:" + hlen + " | h: " + h);
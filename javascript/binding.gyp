@@ -0,0 +1,16 @@
+{
+    "targets": [
+        {
+            "target_name": "farmhash64",
+            "sources": ["native/farmhash64_napi.c"],
+            "include_dirs": ["../c/src"],
+            "cflags": ["-O3", "-std=c11", "-Wall", "-Wextra", "-pedantic"],
+            "xcode_settings": {
+                "OTHER_CFLAGS": ["-O3", "-std=c11", "-Wall", "-Wextra"]
+            },
+            "msvs_settings": {
+                "VCCLCompilerTool": {"Optimization": 2}
+            }
+        }
+    ]
+}
@@ -0,0 +1,454 @@
+// Node.js farmhash64 Native Addon
+//
+// N-API bindings for the header-only C implementation.
+// Binary inputs (Buffer, TypedArray, DataView, ArrayBuffer) are hashed in place without copying,
+// except by farmhash64Async, which hashes a private copy on the libuv threadpool.
+// Strings are hashed as UTF-8, like the pure Javascript implementation in src/farmhash64.js.
+// farmhash64Batch and farmhash64Async also take plain arrays of bytes, like the Javascript implementation.
+//
+// @category   Libraries
+// @author     Nicola Asuni <nicola.asuni@tecnick.com>
+// @license    MIT (see LICENSE)
+// @link       https://github.com/tecnickcom/farmhash64
+
+#define NAPI_VERSION 8
+
+#include <stdlib.h>
+#include <string.h>
+#include <node_api.h>
+#include "../../c/src/farmhash64.h"
+
+// strings up to this size (in UTF-8 bytes) are encoded on the stack
+#define FH_STACK_STR 256
+
+// output types, passed as callback data
+#define FH_OUT_OBJECT 0 // {hi, lo}
+#define FH_OUT_BIGINT 1 // unsigned BigInt
+#define FH_OUT_UINT32 2 // 32-bit hash as a number
+#define FH_OUT_INTO 3   // {hi, lo} stored in the Uint32Array passed as second argument
+#define FH_IN_STRING 4  // the input is a string
+
+static const char *const fh_err_binary = "farmhash64: unsupported input type";
+static const char *const fh_err_string = "farmhash64: expected a string";
+static const char *const fh_err_out = "farmhash64: expected a Uint32Array output of length 2";
+static const char *const fh_err_memory = "farmhash64: out of memory";
+
+// Sets data/len to the bytes of a binary input without copying.
+// Returns napi_invalid_arg if the value is not a binary type.
+static napi_status get_bytes(napi_env env, napi_value v, const char **data, size_t *len)
+{
+    bool is = false;
+    void *p = NULL;
+    size_t n = 0;
+    napi_value ab;
+    size_t off = 0;
+    if ((napi_is_typedarray(env, v, &is) == napi_ok) && is)
+    {
+        napi_typedarray_type type;
+        napi_status st = napi_get_typedarray_info(env, v, &type, &n, &p, &ab, &off);
+        if (st != napi_ok)
+        {
+            return st;
+        }
+        switch (type)
+        {
+        case napi_int16_array:
+        case napi_uint16_array:
+            n *= 2;
+            break;
+        case napi_int32_array:
+        case napi_uint32_array:
+        case napi_float32_array:
+            n *= 4;
+            break;
+        case napi_float64_array:
+        case napi_bigint64_array:
+        case napi_biguint64_array:
+            n *= 8;
+            break;
+        default:
+            break;
+        }
+    }
+    else if ((napi_is_dataview(env, v, &is) == napi_ok) && is)
+    {
+        napi_status st = napi_get_dataview_info(env, v, &n, &p, &ab, &off);
+        if (st != napi_ok)
+        {
+            return st;
+        }
+    }
+    else if ((napi_is_arraybuffer(env, v, &is) == napi_ok) && is)
+    {
+        napi_status st = napi_get_arraybuffer_info(env, v, &p, &n);
+        if (st != napi_ok)
+        {
+            return st;
+        }
+    }
+    else
+    {
+        return napi_invalid_arg;
+    }
+    *data = (n > 0) ? (const char *)p : "";
+    *len = n;
+    return napi_ok;
+}
+
+// Encodes a string as UTF-8 into buf (size bufsize) or into a new heap buffer if it does not fit.
+// Returns the encoded string (to be released with free() if different from buf) or NULL.
+static char *get_utf8(napi_env env, napi_value v, char *buf, size_t bufsize, size_t *len)
+{
+    size_t n = 0;
+    if (napi_get_value_string_utf8(env, v, NULL, 0, &n) != napi_ok)
+    {
+        return NULL;
+    }
+    char *s = buf;
+    if (n >= bufsize)
+    {
+        s = (char *)malloc(n + 1);
+        if (s == NULL)
+        {
+            napi_throw_error(env, NULL, fh_err_memory);
+            return NULL;
+        }
+    }
+    napi_get_value_string_utf8(env, v, s, n + 1, len);
+    return s;
+}
+
+// Copies a plain array of byte values into a new heap buffer (at least 1 byte, to be released with free()).
+// Returns NULL and throws if the value is not an array of numbers or if the allocation fails.
+static char *get_array_bytes(napi_env env, napi_value v, size_t *len)
+{
+    uint32_t n = 0;
+    uint32_t i;
+    if (napi_get_array_length(env, v, &n) != napi_ok)
+    {
+        napi_throw_type_error(env, NULL, fh_err_binary);
+        return NULL;
+    }
+    char *b = (char *)malloc((size_t)n + 1);
+    if (b == NULL)
+    {
+        napi_throw_error(env, NULL, fh_err_memory);
+        return NULL;
+    }
+    for (i = 0; i < n; i++)
+    {
+        napi_value e;
+        uint32_t x = 0;
+        if ((napi_get_element(env, v, i, &e) != napi_ok) || (napi_get_value_uint32(env, e, &x) != napi_ok))
+        {
+            free(b);
+            napi_throw_type_error(env, NULL, fh_err_binary);
+            return NULL;
+        }
+        b[i] = (char)(uint8_t)x; // same truncation as Uint8Array
+    }
+    *len = n;
+    return b;
+}
+
+// Hashes a string or binary value; returns 0 and throws a TypeError if the value has another type.
+static int hash_value(napi_env env, napi_value v, int string, uint64_t *h)
+{
+    if (string)
+    {
+        char buf[FH_STACK_STR];
+        size_t len = 0;
+        char *s = get_utf8(env, v, buf, sizeof(buf), &len);
+        if (s == NULL)
+        {
+            bool pending = false;
+            napi_is_exception_pending(env, &pending);
+            if (!pending)
+            {
+                napi_throw_type_error(env, NULL, fh_err_string);
+            }
+            return 0;
+        }
+        *h = farmhash64(s, len);
+        if (s != buf)
+        {
+            free(s);
+        }
+        return 1;
+    }
+    const char *data = NULL;
+    size_t len = 0;
+    if (get_bytes(env, v, &data, &len) != napi_ok)
+    {
+        napi_throw_type_error(env, NULL, fh_err_binary);
+        return 0;
+    }
+    *h = farmhash64(data, len);
+    return 1;
+}
+
+static napi_value make_u64_object(napi_env env, uint64_t h)
+{
+    napi_value obj;
+    napi_value hi;
+    napi_value lo;
+    napi_create_object(env, &obj);
+    napi_create_uint32(env, (uint32_t)(h >> 32), &hi);
+    napi_create_uint32(env, (uint32_t)h, &lo);
+    napi_set_named_property(env, obj, "hi", hi);
+    napi_set_named_property(env, obj, "lo", lo);
+    return obj;
+}
+
+// Stores the 64-bit hash in the Uint32Array out as [hi, lo].
+// Creating the {hi, lo} object on the Javascript side is several times faster than make_u64_object.
+static int store_u64(napi_env env, napi_value out, uint64_t h)
+{
+    bool is = false;
+    napi_typedarray_type type;
+    size_t n = 0;
+    void *p = NULL;
+    if ((napi_is_typedarray(env, out, &is) != napi_ok) || !is
+            || (napi_get_typedarray_info(env, out, &type, &n, &p, NULL, NULL) != napi_ok)
+            || (type != napi_uint32_array) || (n < 2))
+    {
+        napi_throw_type_error(env, NULL, fh_err_out);
+        return 0;
+    }
+    ((uint32_t *)p)[0] = (uint32_t)(h >> 32);
+    ((uint32_t *)p)[1] = (uint32_t)h;
+    return 1;
+}
+
+// farmhash64(s), farmhash64BigInt(s), farmhash32(s), farmhash64Into(s, out) and the strFarmhash* variants,
+// selected by the callback data flags.
+static napi_value napi_farmhash(napi_env env, napi_callback_info info)
+{
+    size_t argc = 2;
+    napi_value argv[2];
+    void *flags = NULL;
+    napi_value ret = NULL;
+    uint64_t h = 0;
+    if (napi_get_cb_info(env, info, &argc, argv, NULL, &flags) != napi_ok)
+    {
+        return NULL;
+    }
+    if (argc < 1)
+    {
+        napi_get_undefined(env, &argv[0]);
+    }
+    if (argc < 2)
+    {
+        napi_get_undefined(env, &argv[1]);
+    }
+    int mode = (int)(intptr_t)flags;
+    if (!hash_value(env, argv[0], (mode & FH_IN_STRING), &h))
+    {
+        return NULL;
+    }
+    switch (mode & ~FH_IN_STRING)
+    {
+    case FH_OUT_BIGINT:
+        napi_create_bigint_uint64(env, h, &ret);
+        break;
+    case FH_OUT_UINT32:
+        napi_create_uint32(env, mix_64_to_32(h), &ret);
+        break;
+    case FH_OUT_INTO:
+        if (store_u64(env, argv[1], h))
+        {
+            napi_get_undefined(env, &ret);
+        }
+        break;
+    default:
+        ret = make_u64_object(env, h);
+        break;
+    }
+    return ret;
+}
+
+// farmhash64Batch(keys) : hashes an array of binary values, plain arrays of bytes or strings into a new BigUint64Array.
+static napi_value napi_farmhash64_batch(napi_env env, napi_callback_info info)
+{
+    size_t argc = 1;
+    napi_value argv[1];
+    bool is = false;
+    uint32_t n = 0;
+    uint32_t i;
+    void *out = NULL;
+    napi_value ab;
+    napi_value ret;
+    if (napi_get_cb_info(env, info, &argc, argv, NULL, NULL) != napi_ok)
+    {
+        return NULL;
+    }
+    if ((argc < 1) || (napi_is_array(env, argv[0], &is) != napi_ok) || !is)
+    {
+        napi_throw_type_error(env, NULL, "farmhash64: expected an array of keys");
+        return NULL;
+    }
+    napi_get_array_length(env, argv[0], &n);
+    if ((napi_create_arraybuffer(env, (size_t)n * sizeof(uint64_t), &out, &ab) != napi_ok)
+            || (napi_create_typedarray(env, napi_biguint64_array, n, ab, 0, &ret) != napi_ok))
+    {
+        return NULL;
+    }
+    uint64_t *h = (uint64_t *)out;
+    for (i = 0; i < n; i++)
+    {
+        napi_value v;
+        napi_valuetype type;
+        napi_get_element(env, argv[0], i, &v);
+        napi_typeof(env, v, &type);
+        if ((type == napi_object) && (napi_is_array(env, v, &is) == napi_ok) && is)
+        {
+            size_t len = 0;
+            char *b = get_array_bytes(env, v, &len);
+            if (b == NULL)
+            {
+                return NULL;
+            }
+            h[i] = farmhash64(b, len);
+            free(b);
+        }
+        else if (!hash_value(env, v, (type == napi_string), &h[i]))
+        {
+            return NULL;
+        }
+    }
+    return ret;
+}
+
+typedef struct fh_async_t
+{
+    napi_async_work work;
+    napi_deferred deferred;
+    char *owned; // copy of the input (UTF-8 for a string), owned by the async work
+    size_t len;
+    uint64_t hash;
+} fh_async_t;
+
+static void async_execute(napi_env env, void *data)
+{
+    (void)env;
+    fh_async_t *a = (fh_async_t *)data;
+    a->hash = farmhash64(a->owned, a->len);
+}
+
+static void async_complete(napi_env env, napi_status status, void *data)
+{
+    fh_async_t *a = (fh_async_t *)data;
+    napi_value v;
+    if (status == napi_ok)
+    {
+        napi_create_bigint_uint64(env, a->hash, &v);
+        napi_resolve_deferred(env, a->deferred, v);
+    }
+    else
+    {
+        napi_value msg;
+        napi_create_string_utf8(env, "farmhash64: async hashing failed", NAPI_AUTO_LENGTH, &msg);
+        napi_create_error(env, NULL, msg, &v);
+        napi_reject_deferred(env, a->deferred, v);
+    }
+    napi_delete_async_work(env, a->work);
+    free(a->owned);
+    free(a);
+}
+
+// farmhash64Async(s) : hashes a binary value, plain array of bytes or string on the libuv threadpool.
+// Returns a Promise resolved with the 64-bit hash as an unsigned BigInt.
+// The input is copied before the call returns: a napi reference does not prevent an ArrayBuffer
+// from being detached (transferred), so the threadpool never reads memory owned by Javascript.
+static napi_value napi_farmhash64_async(napi_env env, napi_callback_info info)
+{
+    size_t argc = 1;
+    napi_value argv[1];
+    napi_valuetype type = napi_undefined;
+    napi_value promise;
+    napi_value name;
+    if (napi_get_cb_info(env, info, &argc, argv, NULL, NULL) != napi_ok)
+    {
+        return NULL;
+    }
+    if (argc > 0)
+    {
+        napi_typeof(env, argv[0], &type);
+    }
+    fh_async_t *a = (fh_async_t *)calloc(1, sizeof(fh_async_t));
+    if (a == NULL)
+    {
+        napi_throw_error(env, NULL, fh_err_memory);
+        return NULL;
+    }
+    bool is = false;
+    const char *data = NULL;
+    if (type == napi_string)
+    {
+        a->owned = get_utf8(env, argv[0], NULL, 0, &a->len);
+    }
+    else if ((type == napi_object) && (napi_is_array(env, argv[0], &is) == napi_ok) && is)
+    {
+        a->owned = get_array_bytes(env, argv[0], &a->len);
+    }
+    else if ((argc < 1) || (get_bytes(env, argv[0], &data, &a->len) != napi_ok))
+    {
+        napi_throw_type_error(env, NULL, fh_err_binary);
+    }
+    else
+    {
+        a->owned = (char *)malloc(a->len + 1);
+        if (a->owned == NULL)
+        {
+            napi_throw_error(env, NULL, fh_err_memory);
+        }
+        else
+        {
+            memcpy(a->owned, data, a->len);
+        }
+    }
+    if (a->owned == NULL)
+    {
+        free(a);
+        return NULL;
+    }
+    napi_create_string_utf8(env, "farmhash64Async", NAPI_AUTO_LENGTH, &name);
+    if ((napi_create_async_work(env, NULL, name, async_execute, async_complete, a, &a->work) != napi_ok)
+            || (napi_create_promise(env, &a->deferred, &promise) != napi_ok)
+            || (napi_queue_async_work(env, a->work) != napi_ok))
+    {
+        if (a->work != NULL)
+        {
+            napi_delete_async_work(env, a->work);
+        }
+        free(a->owned);
+        free(a);
+        napi_throw_error(env, NULL, "farmhash64: unable to queue async work");
+        return NULL;
+    }
+    return promise;
+}
+
+static napi_value init(napi_env env, napi_value exports)
+{
+    napi_property_descriptor desc[] =
+    {
+        {"farmhash64", NULL, napi_farmhash, NULL, NULL, NULL, napi_enumerable, (void *)FH_OUT_OBJECT},
+        {"farmhash64BigInt", NULL, napi_farmhash, NULL, NULL, NULL, napi_enumerable, (void *)FH_OUT_BIGINT},
+        {"farmhash32", NULL, napi_farmhash, NULL, NULL, NULL, napi_enumerable, (void *)FH_OUT_UINT32},
+        {"farmhash64Into", NULL, napi_farmhash, NULL, NULL, NULL, napi_enumerable, (void *)FH_OUT_INTO},
+        {"strFarmhash64", NULL, napi_farmhash, NULL, NULL, NULL, napi_enumerable, (void *)(FH_IN_STRING | FH_OUT_OBJECT)},
+        {"strFarmhash64BigInt", NULL, napi_farmhash, NULL, NULL, NULL, napi_enumerable, (void *)(FH_IN_STRING | FH_OUT_BIGINT)},
+        {"strFarmhash32", NULL, napi_farmhash, NULL, NULL, NULL, napi_enumerable, (void *)(FH_IN_STRING | FH_OUT_UINT32)},
+        {"strFarmhash64Into", NULL, napi_farmhash, NULL, NULL, NULL, napi_enumerable, (void *)(FH_IN_STRING | FH_OUT_INTO)},
+        {"farmhash64Batch", NULL, napi_farmhash64_batch, NULL, NULL, NULL, napi_enumerable, NULL},
+        {"farmhash64Async", NULL, napi_farmhash64_async, NULL, NULL, NULL, napi_enumerable, NULL},
+    };
+    if (napi_define_properties(env, exports, sizeof(desc) / sizeof(desc[0]), desc) != napi_ok)
+    {
+        return NULL;
+    }
+    return exports;
+}
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, init)
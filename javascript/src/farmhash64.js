@@ -19,540 +19,542 @@
  *
  * NOTE: Javascript has no support for unsigned integers.
  *       The function strFarmhash64Hex is provided to calculate the 64-bit hash value from a string and return it as a fixed-length hexadecimal string.
+ *       The functions farmhash64BigInt and strFarmhash64BigInt return the 64-bit hash value as an unsigned BigInt.
  *
  * @category   Libraries
  * @license    see LICENSE file
  * @link       https://github.com/tecnickcom/farmhash64
  */
 
-const k0 = {
-    hi: 0xc3a5c85c,
-    lo: 0x97cb3127,
-};
-const k1 = {
-    hi: 0xb492b66f,
-    lo: 0xbe98f273,
-};
-const k2 = {
-    hi: 0x9ae16a3b,
-    lo: 0x2f90404f,
-};
-
-const c1 = 0xcc9e2d51;
-const c2 = 0x1b873593;
-
-function u64Add(a, b) {
-    const losum = a.lo + b.lo;
-    const cb = losum >>> 0 < a.lo >>> 0 || losum >>> 0 < b.lo >>> 0 ? 1 : 0;
-    return {
-        hi: (a.hi + b.hi + cb) >>> 0,
-        lo: (losum) >>> 0,
-    };
+// 64-bit values are handled as (hi, lo) pairs of 32-bit integers kept in local variables.
+// Helpers that produce a 64-bit value store it in the rh/rl result registers
+// instead of returning a new object, so hashing allocates no memory.
+
+const k0h = 0xc3a5c85c | 0;
+const k0l = 0x97cb3127 | 0;
+const k1h = 0xb492b66f | 0;
+const k1l = 0xbe98f273 | 0;
+const k2h = 0x9ae16a3b | 0;
+const k2l = 0x2f90404f | 0;
+
+const c1 = 0xcc9e2d51 | 0;
+const c2 = 0x1b873593 | 0;
+
+// result registers: high and low 32 bits of the last 64-bit result
+let rh = 0;
+let rl = 0;
+
+// result registers of weakHashLen32WithSeeds: first (lo) and second (hi) 64-bit values
+let plh = 0;
+let pll = 0;
+let phh = 0;
+let phl = 0;
+
+function add64(ah, al, bh, bl) {
+    const lo = (al >>> 0) + (bl >>> 0);
+    rl = lo | 0;
+    rh = (ah + bh + (lo > 0xffffffff ? 1 : 0)) | 0;
 }
 
-function u32Split16(a) {
-    return {
-        hi: (a >>> 16) & 0xffff,
-        lo: (a >>> 0) & 0xffff,
-    };
+function mul64(ah, al, bh, bl) {
+    // The low word is exact with Math.imul. The double product of the low words is
+    // within 2^12 of the exact value, so subtracting the exact low word and rounding
+    // recovers the exact high word.
+    const lo = Math.imul(al, bl);
+    const hi = Math.round(((al >>> 0) * (bl >>> 0) - (lo >>> 0)) * 2.3283064365386963e-10);
+    rl = lo;
+    rh = (hi + Math.imul(ah, bl) + Math.imul(al, bh)) | 0;
 }
 
-function u32Mul(a, b) {
-    const x = u32Split16(a);
-    const y = u32Split16(b);
-    return (x.lo * y.lo + (((x.hi * y.lo + x.lo * y.hi) << 16) >>> 0)) >>> 0;
+function rotr32(a, s) {
+    return (a >>> s) | (a << (32 - s));
 }
 
-function u32Mul64(a, b) {
-    const x = u32Split16(a);
-    const y = u32Split16(b);
-    const s = {
-        hi: u32Mul(x.hi, y.hi),
-        lo: u32Mul(x.lo, y.lo),
-    };
-    const t = u32Mul(x.hi, y.lo);
-    const u = u32Mul(x.lo, y.hi);
-    const v = {
-        hi: t >>> 16,
-        lo: (t << 16) >>> 0,
-    };
-    const w = {
-        hi: u >>> 16,
-        lo: (u << 16) >>> 0,
-    };
-    return u64Add(u64Add(s, v), w);
+// Rotate right by 0 < s < 64, s != 32.
+function rotr64(h, l, s) {
+    if (s > 32) {
+        const t = h;
+        h = l;
+        l = t;
+        s -= 32;
+    }
+    rh = (h >>> s) | (l << (32 - s));
+    rl = (l >>> s) | (h << (32 - s));
 }
 
-function u64Mul(a, b) {
-    return u64Add({
-            hi: (u32Mul(a.hi, b.lo) + u32Mul(a.lo, b.hi)) >>> 0,
-            lo: 0,
-        },
-        u32Mul64(a.lo, b.lo)
-    );
+function fetch32(s, i) {
+    return s[i] | (s[i + 1] << 8) | (s[i + 2] << 16) | (s[i + 3] << 24);
 }
 
-function u32RotR(a, s) {
-    if (s <= 0 || s >= 32) {
-        return a >>> 0;
-    }
-    return ((a << (32 - s)) >>> 0) | (a >>> s);
+function mur(a, h) {
+    a = Math.imul(a, c1);
+    a = rotr32(a, 17);
+    a = Math.imul(a, c2);
+    h ^= a;
+    h = rotr32(h, 19);
+    return (Math.imul(h, 5) + 0xe6546b64) >>> 0;
 }
 
-function u64RotR(a, s) {
-    if (s <= 0 || s >= 64) {
-        return {
-            hi: a.hi >>> 0,
-            lo: a.lo >>> 0,
-        };
-    }
-    if (s < 32) {
-        const sl = 32 - s;
-        return {
-            hi: (((a.lo << sl) >>> 0) | (a.hi >>> s)) >>> 0,
-            lo: (((a.hi << sl) >>> 0) | (a.lo >>> s)) >>> 0,
-        };
-    }
-    if (s === 32) {
-        return {
-            hi: a.lo >>> 0,
-            lo: a.hi >>> 0,
-        };
-    }
-    const sl = 64 - s;
-    const sr = s - 32;
-    return {
-        hi: (((a.hi << sl) >>> 0) | (a.lo >>> sr)) >>> 0,
-        lo: (((a.lo << sl) >>> 0) | (a.hi >>> sr)) >>> 0,
-    };
+function mix64To32(h, l) {
+    return mur(h, l);
 }
 
-function u64ShiftL(a, s) {
-    if (s <= 0 || s >= 64) {
-        return {
-            hi: a.hi >>> 0,
-            lo: a.lo >>> 0,
-        };
-    }
-    if (s < 32) {
-        return {
-            hi: (a.lo >>> (32 - s)) | ((a.hi << s) >>> 0),
-            lo: (a.lo << s) >>> 0,
-        };
-    }
-    return {
-        hi: (a.lo << (s - 32)) >>> 0,
-        lo: 0,
-    };
+function hashLen16Mul(uh, ul, vh, vl, mh, ml) {
+    mul64(uh ^ vh, ul ^ vl, mh, ml);
+    const ah = rh;
+    const al = rl ^ (rh >>> 15);
+    mul64(vh ^ ah, vl ^ al, mh, ml);
+    const bh = rh;
+    const bl = rl ^ (rh >>> 15);
+    mul64(bh, bl, mh, ml);
 }
 
-function u64ShiftR(a, s) {
-    if (s <= 0 || s >= 64) {
-        return {
-            hi: a.hi >>> 0,
-            lo: a.lo >>> 0,
-        };
+function hashLen0to16(s, i, slen) {
+    if (slen >= 8) {
+        add64(k2h, k2l, 0, slen * 2);
+        const mh = rh;
+        const ml = rl;
+        add64(fetch32(s, i + 4), fetch32(s, i), k2h, k2l);
+        const ah = rh;
+        const al = rl;
+        const bh = fetch32(s, i + slen - 4);
+        const bl = fetch32(s, i + slen - 8);
+        rotr64(bh, bl, 37);
+        mul64(rh, rl, mh, ml);
+        add64(rh, rl, ah, al);
+        const ch = rh;
+        const cl = rl;
+        rotr64(ah, al, 25);
+        add64(rh, rl, bh, bl);
+        mul64(rh, rl, mh, ml);
+        hashLen16Mul(ch, cl, rh, rl, mh, ml);
+        return;
     }
-    if (s < 32) {
-        return {
-            hi: a.hi >>> s,
-            lo: (a.hi << (32 - s)) | (a.lo >>> s),
-        };
+
+    if (slen >= 4) {
+        add64(k2h, k2l, 0, slen * 2);
+        const mh = rh;
+        const ml = rl;
+        const a = fetch32(s, i);
+        add64(a >>> 29, a << 3, 0, slen);
+        hashLen16Mul(rh, rl, 0, fetch32(s, i + slen - 4), mh, ml);
+        return;
     }
-    return {
-        hi: 0,
-        lo: a.hi >>> (s - 32),
-    };
-}
 
-function u64XOR(a, b) {
-    return {
-        hi: (a.hi ^ b.hi) >>> 0,
-        lo: (a.lo ^ b.lo) >>> 0,
-    };
-}
+    if (slen > 0) {
+        const y = s[i] + (s[i + (slen >>> 1)] << 8);
+        const z = slen + (s[i + slen - 1] << 2);
+        mul64(0, y, k2h, k2l);
+        const th = rh;
+        const tl = rl;
+        mul64(0, z, k0h, k0l);
+        const xh = th ^ rh;
+        const xl = tl ^ rl;
+        mul64(xh, xl ^ (xh >>> 15), k2h, k2l);
+        return;
+    }
 
-function fetchU32(s, i) {
-    const lo =
-        (s[i + 0] >>> 0) |
-        ((s[i + 1] << 8) >>> 0) |
-        ((s[i + 2] << 16) >>> 0) |
-        ((s[i + 3] << 24) >>> 0);
-    return {
-        hi: 0,
-        lo: lo >>> 0,
-    };
+    rh = k2h;
+    rl = k2l;
 }
 
-function fetchU64(s, i) {
-    const lo =
-        (s[i + 0] >>> 0) |
-        ((s[i + 1] << 8) >>> 0) |
-        ((s[i + 2] << 16) >>> 0) |
-        ((s[i + 3] << 24) >>> 0);
-    const hi =
-        ((s[i + 4]) >>> 0) |
-        ((s[i + 5] << 8) >>> 0) |
-        ((s[i + 6] << 16) >>> 0) |
-        ((s[i + 7] << 24) >>> 0);
-    return {
-        hi: hi >>> 0,
-        lo: lo >>> 0,
-    };
+function hashLen17to32(s, i, slen) {
+    add64(k2h, k2l, 0, slen * 2);
+    const mh = rh;
+    const ml = rl;
+    mul64(fetch32(s, i + 4), fetch32(s, i), k1h, k1l);
+    const ah = rh;
+    const al = rl;
+    const bh = fetch32(s, i + 12);
+    const bl = fetch32(s, i + 8);
+    mul64(fetch32(s, i + slen - 4), fetch32(s, i + slen - 8), mh, ml);
+    const ch = rh;
+    const cl = rl;
+    mul64(fetch32(s, i + slen - 12), fetch32(s, i + slen - 16), k2h, k2l);
+    const dh = rh;
+    const dl = rl;
+    // u = rotate(a + b, 43) + rotate(c, 30) + d
+    add64(ah, al, bh, bl);
+    rotr64(rh, rl, 43);
+    const uh = rh;
+    const ul = rl;
+    rotr64(ch, cl, 30);
+    add64(rh, rl, uh, ul);
+    add64(rh, rl, dh, dl);
+    const vh = rh;
+    const vl = rl;
+    // v = a + rotate(b + k2, 18) + c
+    add64(bh, bl, k2h, k2l);
+    rotr64(rh, rl, 18);
+    add64(rh, rl, ah, al);
+    add64(rh, rl, ch, cl);
+    hashLen16Mul(vh, vl, rh, rl, mh, ml);
 }
 
-function shiftMix(v) {
-    return u64XOR(v, u64ShiftR(v, 47));
+function hashLen33to64(s, i, slen) {
+    add64(k2h, k2l, 0, slen * 2);
+    const mh = rh;
+    const ml = rl;
+    mul64(fetch32(s, i + 4), fetch32(s, i), k2h, k2l);
+    const ah = rh;
+    const al = rl;
+    const bh = fetch32(s, i + 12);
+    const bl = fetch32(s, i + 8);
+    mul64(fetch32(s, i + slen - 4), fetch32(s, i + slen - 8), mh, ml);
+    const ch = rh;
+    const cl = rl;
+    mul64(fetch32(s, i + slen - 12), fetch32(s, i + slen - 16), k2h, k2l);
+    const dh = rh;
+    const dl = rl;
+    // y = rotate(a + b, 43) + rotate(c, 30) + d
+    add64(ah, al, bh, bl);
+    rotr64(rh, rl, 43);
+    const th = rh;
+    const tl = rl;
+    rotr64(ch, cl, 30);
+    add64(rh, rl, th, tl);
+    add64(rh, rl, dh, dl);
+    const yh = rh;
+    const yl = rl;
+    // z = hashLen16Mul(y, a + rotate(b + k2, 18) + c, mul)
+    add64(bh, bl, k2h, k2l);
+    rotr64(rh, rl, 18);
+    add64(rh, rl, ah, al);
+    add64(rh, rl, ch, cl);
+    hashLen16Mul(yh, yl, rh, rl, mh, ml);
+    const zh = rh;
+    const zl = rl;
+    mul64(fetch32(s, i + 20), fetch32(s, i + 16), mh, ml);
+    const eh = rh;
+    const el = rl;
+    const fh = fetch32(s, i + 28);
+    const fl = fetch32(s, i + 24);
+    add64(yh, yl, fetch32(s, i + slen - 28), fetch32(s, i + slen - 32));
+    mul64(rh, rl, mh, ml);
+    const gh = rh;
+    const gl = rl;
+    add64(zh, zl, fetch32(s, i + slen - 20), fetch32(s, i + slen - 24));
+    mul64(rh, rl, mh, ml);
+    const hh = rh;
+    const hl = rl;
+    // u = rotate(e + f, 43) + rotate(g, 30) + h
+    add64(eh, el, fh, fl);
+    rotr64(rh, rl, 43);
+    const uh = rh;
+    const ul = rl;
+    rotr64(gh, gl, 30);
+    add64(rh, rl, uh, ul);
+    add64(rh, rl, hh, hl);
+    const vh = rh;
+    const vl = rl;
+    // v = e + rotate(f + a, 18) + g
+    add64(fh, fl, ah, al);
+    rotr64(rh, rl, 18);
+    add64(rh, rl, eh, el);
+    add64(rh, rl, gh, gl);
+    hashLen16Mul(vh, vl, rh, rl, mh, ml);
 }
 
-function mur(a, h) {
-    a = u32Mul(a, c1);
-    a = u32RotR(a, 17);
-    a = u32Mul(a, c2);
-    h = h ^ a;
-    h = u32RotR(h, 19);
-    return (u32Mul(h, 5) + 0xe6546b64) >>> 0;
+// Stores in (plh, pll) and (phh, phl) the first and second 64-bit values of the
+// 16-byte hash for s[i] ... s[i + 31], a, and b.  Quick and dirty.
+function weakHashLen32WithSeeds(s, i, ah, al, bh, bl) {
+    const zh = fetch32(s, i + 28);
+    const zl = fetch32(s, i + 24);
+    // a += w
+    add64(ah, al, fetch32(s, i + 4), fetch32(s, i));
+    ah = rh;
+    al = rl;
+    // b = rotate(b + a + z, 21)
+    add64(bh, bl, ah, al);
+    add64(rh, rl, zh, zl);
+    rotr64(rh, rl, 21);
+    bh = rh;
+    bl = rl;
+    const ch = ah;
+    const cl = al;
+    // a += x + y
+    add64(ah, al, fetch32(s, i + 12), fetch32(s, i + 8));
+    add64(rh, rl, fetch32(s, i + 20), fetch32(s, i + 16));
+    ah = rh;
+    al = rl;
+    // b += rotate(a, 44)
+    rotr64(ah, al, 44);
+    add64(rh, rl, bh, bl);
+    add64(rh, rl, ch, cl);
+    phh = rh;
+    phl = rl;
+    add64(ah, al, zh, zl);
+    plh = rh;
+    pll = rl;
 }
 
-function mix64To32(v) {
-    return mur(v.hi, v.lo);
-}
+function hashLen65Plus(s, i, slen) {
+    // Internal state consists of 56 bytes: v, w, x, y, and z.
+    let vlh = 0;
+    let vll = 0;
+    let vhh = 0;
+    let vhl = 0;
+    let wlh = 0;
+    let wll = 0;
+    let whh = 0;
+    let whl = 0;
+    // x = seed * k2 + fetch64(s), y = seed * k1 + 113, z = shiftMix(y * k2 + 113) * k2, with seed = 81
+    mul64(0, 81, k2h, k2l);
+    add64(rh, rl, fetch32(s, i + 4), fetch32(s, i));
+    let xh = rh;
+    let xl = rl;
+    mul64(0, 81, k1h, k1l);
+    add64(rh, rl, 0, 113);
+    let yh = rh;
+    let yl = rl;
+    mul64(yh, yl, k2h, k2l);
+    add64(rh, rl, 0, 113);
+    mul64(rh, rl ^ (rh >>> 15), k2h, k2l);
+    let zh = rh;
+    let zl = rl;
+    let mh = k1h;
+    let ml = k1l;
+    let tmp = 0;
+
+    // Set end so that after the loop we have 1 to 64 bytes left to process.
+    const endIdx = i + (((slen - 1) >>> 6) << 6);
+    const last64Idx = i + slen - 64;
+
+    for (;;) {
+        const last = i === last64Idx;
+        if (last) {
+            // The final block uses a multiplier derived from z.
+            add64(k1h, k1l, 0, (zl & 0xff) << 1);
+            mh = rh;
+            ml = rl;
+            add64(wlh, wll, 0, (slen - 1) & 63);
+            add64(vlh, vll, rh, rl);
+            vlh = rh;
+            vll = rl;
+            add64(wlh, wll, 0, (slen - 1) & 63);
+            add64(rh, rl, vlh, vll);
+            wlh = rh;
+            wll = rl;
+        }
+        // x = rotate(x + y + v.lo + fetch64(s + 8), 37) * mul
+        add64(xh, xl, yh, yl);
+        add64(rh, rl, vlh, vll);
+        add64(rh, rl, fetch32(s, i + 12), fetch32(s, i + 8));
+        rotr64(rh, rl, 37);
+        mul64(rh, rl, mh, ml);
+        xh = rh;
+        xl = rl;
+        // y = rotate(y + v.hi + fetch64(s + 48), 42) * mul
+        add64(yh, yl, vhh, vhl);
+        add64(rh, rl, fetch32(s, i + 52), fetch32(s, i + 48));
+        rotr64(rh, rl, 42);
+        mul64(rh, rl, mh, ml);
+        yh = rh;
+        yl = rl;
+        if (last) {
+            // x ^= w.hi * 9; y += v.lo * 9 + fetch64(s + 40)
+            mul64(whh, whl, 0, 9);
+            xh ^= rh;
+            xl ^= rl;
+            mul64(vlh, vll, 0, 9);
+        } else {
+            // x ^= w.hi; y += v.lo + fetch64(s + 40)
+            xh ^= whh;
+            xl ^= whl;
+            rh = vlh;
+            rl = vll;
+        }
+        add64(rh, rl, yh, yl);
+        add64(rh, rl, fetch32(s, i + 44), fetch32(s, i + 40));
+        yh = rh;
+        yl = rl;
+        // z = rotate(z + w.lo, 33) * mul
+        add64(zh, zl, wlh, wll);
+        rotr64(rh, rl, 33);
+        mul64(rh, rl, mh, ml);
+        zh = rh;
+        zl = rl;
+        // v = weakHashLen32WithSeeds(s, v.hi * mul, x + w.lo)
+        mul64(vhh, vhl, mh, ml);
+        const th = rh;
+        const tl = rl;
+        add64(xh, xl, wlh, wll);
+        weakHashLen32WithSeeds(s, i, th, tl, rh, rl);
+        vlh = plh;
+        vll = pll;
+        vhh = phh;
+        vhl = phl;
+        // w = weakHashLen32WithSeeds(s + 32, z + w.hi, y + fetch64(s + 16))
+        add64(yh, yl, fetch32(s, i + 20), fetch32(s, i + 16));
+        const uh = rh;
+        const ul = rl;
+        add64(zh, zl, whh, whl);
+        weakHashLen32WithSeeds(s, i + 32, rh, rl, uh, ul);
+        wlh = plh;
+        wll = pll;
+        whh = phh;
+        whl = phl;
+        // swap x and z
+        tmp = xh;
+        xh = zh;
+        zh = tmp;
+        tmp = xl;
+        xl = zl;
+        zl = tmp;
+        if (last) {
+            break;
+        }
+        i += 64;
+        if (i === endIdx) {
+            // Make i point to the last 64 bytes of input.
+            i = last64Idx;
+        }
+    }
 
-function hashLen16Mul(u, v, mul) {
-    a = u64Mul(u64XOR(u, v), mul);
-    a = u64XOR(a, u64ShiftR(a, 47));
-    b = u64Mul(u64XOR(v, a), mul);
-    b = u64XOR(b, u64ShiftR(b, 47));
-    b = u64Mul(b, mul);
-    return b;
+    // hashLen16Mul(hashLen16Mul(v.lo, w.lo, mul) + shiftMix(y) * k0 + z, hashLen16Mul(v.hi, w.hi, mul) + x, mul)
+    hashLen16Mul(vhh, vhl, whh, whl, mh, ml);
+    add64(rh, rl, xh, xl);
+    const bh = rh;
+    const bl = rl;
+    mul64(yh, yl ^ (yh >>> 15), k0h, k0l);
+    const th = rh;
+    const tl = rl;
+    hashLen16Mul(vlh, vll, wlh, wll, mh, ml);
+    add64(rh, rl, th, tl);
+    add64(rh, rl, zh, zl);
+    hashLen16Mul(rh, rl, bh, bl, mh, ml);
 }
 
-function hashLen0to16(s) {
-    const slen = s.length;
-    const slen64 = {
-        hi: 0,
-        lo: slen >>> 0,
-    };
-
-    if (slen >= 8) {
-        const mul = u64Add(
-            k2,
-            u64Mul(slen64, {
-                hi: 0,
-                lo: 2,
-            })
-        );
-        const a = u64Add(fetchU64(s, 0), k2);
-        const b = fetchU64(s, slen - 8);
-        const br = u64RotR(b, 37);
-        const dr = u64RotR(a, 25);
-        const c = u64Add(u64Mul(br, mul), a);
-        const d = u64Mul(u64Add(dr, b), mul);
-
-        return hashLen16Mul(c, d, mul);
-    }
-
-    if (slen >= 4) {
-        const mul = u64Add(
-            k2,
-            u64Mul(slen64, {
-                hi: 0,
-                lo: 2,
-            })
-        );
-        const a = fetchU32(s, 0);
-        const u = u64Add(slen64, u64ShiftL(a, 3));
-        const v = fetchU32(s, slen - 4);
-        return hashLen16Mul(u, v, mul);
+// Computes the hash of s[i] ... s[i + slen - 1] into the rh/rl registers.
+function hash(s, i, slen) {
+    if (slen <= 32) {
+        if (slen <= 16) {
+            hashLen0to16(s, i, slen);
+            return;
+        }
+        hashLen17to32(s, i, slen);
+        return;
     }
-
-    if (slen > 0) {
-        const a = s[0] >>> 0;
-        const b = s[slen >>> 1] >>> 0;
-        const c = s[slen - 1] >>> 0;
-        const y = (a + (b << 8)) >>> 0;
-        const z = (slen + (c << 2)) >>> 0;
-
-        return u64Mul(
-            shiftMix(
-                u64XOR(
-                    u64Mul({
-                            hi: 0,
-                            lo: y,
-                        },
-                        k2
-                    ),
-                    u64Mul({
-                            hi: 0,
-                            lo: z,
-                        },
-                        k0
-                    )
-                )
-            ),
-            k2
-        );
+    if (slen <= 64) {
+        hashLen33to64(s, i, slen);
+        return;
     }
-
-    return k2;
+    hashLen65Plus(s, i, slen);
 }
 
-function hashLen17to32(s) {
-    const slen = s.length;
-    const slen64 = {
-        hi: 0,
-        lo: slen >>> 0,
-    };
-    const mul = u64Add(
-        k2,
-        u64Mul(slen64, {
-            hi: 0,
-            lo: 2,
-        })
-    );
-    const a = u64Mul(fetchU64(s, 0), k1);
-    const b = fetchU64(s, 8);
-    const c = u64Mul(fetchU64(s, slen - 8), mul);
-    const d = u64Mul(fetchU64(s, slen - 16), k2);
-
-    return hashLen16Mul(
-        u64Add(u64Add(u64RotR(u64Add(a, b), 43), u64RotR(c, 30)), d),
-        u64Add(u64Add(a, u64RotR(u64Add(b, k2), 18)), c),
-        mul
-    );
-}
-
-function hashLen33to64(s) {
-    const slen = s.length;
-    const slen64 = {
-        hi: 0,
-        lo: slen >>> 0,
-    };
-    const mul = u64Add(
-        k2,
-        u64Mul(slen64, {
-            hi: 0,
-            lo: 2,
-        })
-    );
-    const a = u64Mul(fetchU64(s, 0), k2);
-    const b = fetchU64(s, 8);
-    const c = u64Mul(fetchU64(s, slen - 8), mul);
-    const d = u64Mul(fetchU64(s, slen - 16), k2);
-    const y = u64Add(u64Add(u64RotR(u64Add(a, b), 43), u64RotR(c, 30)), d);
-    const z = hashLen16Mul(
-        y,
-        u64Add(u64Add(a, u64RotR(u64Add(b, k2), 18)), c),
-        mul
-    );
-    const e = u64Mul(fetchU64(s, 16), mul);
-    const f = fetchU64(s, 24);
-    const g = u64Mul(u64Add(y, fetchU64(s, slen - 32)), mul);
-    const h = u64Mul(u64Add(z, fetchU64(s, slen - 24)), mul);
-    return hashLen16Mul(
-        u64Add(u64Add(u64RotR(u64Add(e, f), 43), u64RotR(g, 30)), h),
-        u64Add(u64Add(e, u64RotR(u64Add(f, a), 18)), g),
-        mul
-    );
+// Returns a Uint8Array view of any supported binary input (Uint8Array, Buffer, other TypedArray, DataView, ArrayBuffer).
+function toBytes(s) {
+    if (s instanceof Uint8Array || Array.isArray(s)) {
+        return s;
+    }
+    if (ArrayBuffer.isView(s)) {
+        return new Uint8Array(s.buffer, s.byteOffset, s.byteLength);
+    }
+    if (s instanceof ArrayBuffer) {
+        return new Uint8Array(s);
+    }
+    throw new TypeError("farmhash64: unsupported input type");
 }
 
-function weakHashLen32WithSeedsWords(w, x, y, z, a, b) {
-    a = u64Add(a, w);
-    b = u64RotR(u64Add(u64Add(b, a), z), 21);
-    c = a;
-    a = u64Add(a, x);
-    a = u64Add(a, y);
-    b = u64Add(b, u64RotR(a, 44));
-    return {
-        hi: u64Add(b, c),
-        lo: u64Add(a, z),
-    };
-}
+// Shared UTF-8 encoder and scratch buffer used to hash strings.
+const textEncoder = new TextEncoder();
+let strBuf = new Uint8Array(256);
 
-function weakHashLen32WithSeeds(s, idx, a, b) {
-    return weakHashLen32WithSeedsWords(
-        fetchU64(s, idx + 0),
-        fetchU64(s, idx + 8),
-        fetchU64(s, idx + 16),
-        fetchU64(s, idx + 24),
-        a,
-        b
-    );
+// Encodes str as UTF-8 into strBuf and returns the number of bytes written.
+function encodeStr(str) {
+    const maxlen = str.length * 3;
+    if (maxlen > strBuf.length) {
+        strBuf = new Uint8Array(Math.max(maxlen, strBuf.length * 2));
+    }
+    // Short ASCII strings are copied with a loop: encodeInto returns a new result object on every call,
+    // which costs more than the loop up to about 16 characters.
+    const len = str.length;
+    if (len > 16) {
+        return textEncoder.encodeInto(str, strBuf).written;
+    }
+    for (let i = 0; i < len; i++) {
+        const c = str.charCodeAt(i);
+        if (c >= 0x80) {
+            return i + textEncoder.encodeInto(str.substring(i), strBuf.subarray(i)).written;
+        }
+        strBuf[i] = c;
+    }
+    return len;
 }
 
 function _testData(size) {
-    const kt = {
-        hi: 0xc3a5c85c,
-        lo: 0x97cb3127,
-    };
     const data = new Uint8Array(size);
-    var a = {
-        hi: 0,
-        lo: 9,
-    };
-    var b = {
-        hi: 0,
-        lo: 777,
-    };
+    let ah = 0;
+    let al = 9;
+    let bh = 0;
+    let bl = 777;
     for (let i = 0; i < size; i++) {
-        a = u64Add(a, b);
-        b = u64Add(b, a);
-        a = u64Mul(u64XOR(a, u64ShiftR(a, 41)), kt);
-        b = u64Add(u64Mul(u64XOR(b, u64ShiftR(b, 41)), kt), {
-            hi: 0,
-            lo: i,
-        });
-        data[i] = (u64ShiftR(b, 37).lo & 0xff);
+        add64(ah, al, bh, bl);
+        ah = rh;
+        al = rl;
+        add64(bh, bl, ah, al);
+        bh = rh;
+        bl = rl;
+        // a = (a ^ (a >> 41)) * kt, with kt = k0
+        mul64(ah, al ^ (ah >>> 9), k0h, k0l);
+        ah = rh;
+        al = rl;
+        // b = (b ^ (b >> 41)) * kt + i
+        mul64(bh, bl ^ (bh >>> 9), k0h, k0l);
+        add64(rh, rl, 0, i);
+        bh = rh;
+        bl = rl;
+        data[i] = (bh >>> 5) & 0xff;
     }
     return data;
 }
 
+// Scratch view used to build a 64-bit BigInt with a single allocation.
+const bigView = new DataView(new ArrayBuffer(8));
+
+function toBigInt(h, l) {
+    bigView.setInt32(0, h);
+    bigView.setInt32(4, l);
+    return bigView.getBigUint64(0);
+}
+
 /**
  * Calculates the 64-bit FarmHash hash value for the given byte array.
  *
- * @param {Uint8Array} s - The input byte array to be hashed.
+ * @param {Uint8Array|Buffer|ArrayBufferView|ArrayBuffer} s - The input bytes to be hashed.
  * @returns {object} The 64-bit hash value as an object with properties `hi` and `lo`, representing the high and low 32 bits respectively.
  */
 function farmhash64(s) {
-    var slen = s.length;
-
-
-    if (slen <= 32) {
-        if (slen <= 16) {
-            return hashLen0to16(s);
-        }
-
-        return hashLen17to32(s);
-    }
-
-    if (slen <= 64) {
-        return hashLen33to64(s);
-    }
-
-    var v = {
-        hi: {
-            hi: 0,
-            lo: 0,
-        },
-        lo: {
-            hi: 0,
-            lo: 0,
-        },
-    };
-
-    var w = {
-        hi: {
-            hi: 0,
-            lo: 0,
-        },
-        lo: {
-            hi: 0,
-            lo: 0,
-        },
-    };
-
-    const seed = {
-        hi: 0,
-        lo: 81,
-    };
-
-    const a113 = {
-        hi: 0,
-        lo: 113,
+    s = toBytes(s);
+    hash(s, 0, s.length);
+    return {
+        hi: rh >>> 0,
+        lo: rl >>> 0,
     };
+}
 
-    var x = u64Add(u64Mul(seed, k2), fetchU64(s, 0));
-    var y = u64Add(u64Mul(seed, k1), a113);
-    var z = u64Mul(shiftMix(u64Add(u64Mul(y, k2), a113)), k2);
-
-    const endIdx = ((slen - 1) >>> 6) << 6;
-    const last64Idx = endIdx + (((slen - 1) >>> 0) & 63) - 63;
-
-    var idx = 0;
-
-    while (slen > 64) {
-        x = u64Mul(
-            u64RotR(u64Add(u64Add(u64Add(x, y), v.lo), fetchU64(s, idx + 8)), 37),
-            k1
-        );
-        y = u64Mul(u64RotR(u64Add(u64Add(y, v.hi), fetchU64(s, idx + 48)), 42), k1);
-        x = u64XOR(x, w.hi);
-        y = u64Add(y, u64Add(v.lo, fetchU64(s, idx + 40)));
-        z = u64Mul(u64RotR(u64Add(z, w.lo), 33), k1);
-        v = weakHashLen32WithSeeds(s, idx, u64Mul(v.hi, k1), u64Add(x, w.lo));
-        w = weakHashLen32WithSeeds(
-            s,
-            idx + 32,
-            u64Add(z, w.hi),
-            u64Add(y, fetchU64(s, idx + 16))
-        );
-        tmp = x;
-        x = z;
-        z = tmp;
-        idx += 64;
-        slen -= 64;
-    }
-
-    mul = u64Add(k1, {
-        hi: 0,
-        lo: (((z.lo >>> 0) & 0xff) << 1) >>> 0,
-    });
-    idx = last64Idx;
-    w.lo = u64Add(w.lo, {
-        hi: 0,
-        lo: ((slen - 1) & 63) >>> 0,
-    });
-    v.lo = u64Add(v.lo, w.lo);
-    w.lo = u64Add(w.lo, v.lo);
-    x = u64Mul(
-        u64RotR(u64Add(u64Add(u64Add(x, y), v.lo), fetchU64(s, idx + 8)), 37),
-        mul
-    );
-    y = u64Mul(u64RotR(u64Add(u64Add(y, v.hi), fetchU64(s, idx + 48)), 42), mul);
-    x = u64XOR(
-        x,
-        u64Mul(w.hi, {
-            hi: 0,
-            lo: 9,
-        })
-    );
-    y = u64Add(
-        y,
-        u64Add(
-            u64Mul(v.lo, {
-                hi: 0,
-                lo: 9,
-            }),
-            fetchU64(s, idx + 40)
-        )
-    );
-    z = u64Mul(u64RotR(u64Add(z, w.lo), 33), mul);
-    v = weakHashLen32WithSeeds(s, idx, u64Mul(v.hi, mul), u64Add(x, w.lo));
-    w = weakHashLen32WithSeeds(
-        s,
-        idx + 32,
-        u64Add(z, w.hi),
-        u64Add(y, fetchU64(s, idx + 16))
-    );
-    tmp = x;
-    x = z;
-    z = tmp;
-
-    return hashLen16Mul(
-        u64Add(u64Add(hashLen16Mul(v.lo, w.lo, mul), u64Mul(shiftMix(y), k0)), z),
-        u64Add(hashLen16Mul(v.hi, w.hi, mul), x),
-        mul
-    );
+/**
+ * Calculates the 64-bit FarmHash hash value for the given byte array.
+ *
+ * @param {Uint8Array|Buffer|ArrayBufferView|ArrayBuffer} s - The input bytes to be hashed.
+ * @returns {bigint} The 64-bit hash value as an unsigned BigInt.
+ */
+function farmhash64BigInt(s) {
+    s = toBytes(s);
+    hash(s, 0, s.length);
+    return toBigInt(rh, rl);
 }
 
 /**
  * Calculates a 32-bit hash value using the FarmHash64 algorithm.
  *
- * @param {string} s - The input string to hash.
+ * @param {Uint8Array|Buffer|ArrayBufferView|ArrayBuffer} s - The input bytes to be hashed.
  * @returns {number} The 32-bit hash value.
  */
 function farmhash32(s) {
-    return mix64To32(farmhash64(s));
+    s = toBytes(s);
+    hash(s, 0, s.length);
+    return mix64To32(rh, rl);
 }
 
 /**
@@ -562,8 +564,24 @@ function farmhash32(s) {
  * @returns {object} The 64-bit hash value as an object with properties `hi` and `lo`, representing the high and low 32 bits respectively.
  */
 function strFarmhash64(str) {
-    const s = new TextEncoder().encode(str);
-    return farmhash64(s);
+    const slen = encodeStr(str); // may replace strBuf
+    hash(strBuf, 0, slen);
+    return {
+        hi: rh >>> 0,
+        lo: rl >>> 0,
+    };
+}
+
+/**
+ * Calculates the farmhash64 hash value for a given string.
+ *
+ * @param {string} str - The input string to be hashed.
+ * @returns {bigint} The 64-bit hash value as an unsigned BigInt.
+ */
+function strFarmhash64BigInt(str) {
+    const slen = encodeStr(str); // may replace strBuf
+    hash(strBuf, 0, slen);
+    return toBigInt(rh, rl);
 }
 
 /**
@@ -573,8 +591,34 @@ function strFarmhash64(str) {
  * @returns {number} The 32-bit hash value.
  */
 function strFarmhash32(str) {
-    const s = new TextEncoder().encode(str);
-    return farmhash32(s);
+    const slen = encodeStr(str); // may replace strBuf
+    hash(strBuf, 0, slen);
+    return mix64To32(rh, rl);
+}
+
+/**
+ * Calculates the 64-bit FarmHash hash values for a list of keys.
+ *
+ * @param {Array<Uint8Array|Buffer|ArrayBufferView|ArrayBuffer|Array<number>|string>} keys - The keys to be hashed; strings are hashed as UTF-8.
+ * @returns {BigUint64Array} The 64-bit hash value of each key, in the same order.
+ */
+function farmhash64Batch(keys) {
+    const n = keys.length;
+    const out = new BigUint64Array(n);
+    let s = null;
+    let slen = 0;
+    for (let k = 0; k < n; k++) {
+        s = keys[k];
+        if (typeof s === "string") {
+            slen = encodeStr(s); // may replace strBuf
+            hash(strBuf, 0, slen);
+        } else {
+            s = toBytes(s);
+            hash(s, 0, s.length);
+        }
+        out[k] = toBigInt(rh, rl);
+    }
+    return out;
 }
 
 function padL08(s) {
@@ -625,8 +669,11 @@ if (typeof module !== "undefined") {
     module.exports = {
         farmhash32: farmhash32,
         farmhash64: farmhash64,
+        farmhash64BigInt: farmhash64BigInt,
+        farmhash64Batch: farmhash64Batch,
         strFarmhash32: strFarmhash32,
         strFarmhash64: strFarmhash64,
+        strFarmhash64BigInt: strFarmhash64BigInt,
         strFarmhash32Hex: strFarmhash32Hex,
         strFarmhash64Hex: strFarmhash64Hex,
         hex32: hex32,
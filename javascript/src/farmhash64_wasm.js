@@ -0,0 +1,253 @@
+/** FarmHash64 Javascript Library WebAssembly Backend
+ *
+ * farmhash64_wasm.js
+ *
+ *
+ * Loads the WebAssembly build of the C implementation (target/wasm/farmhash64.wasm, built from wasm/farmhash64_wasm.c with "make wasm")
+ * for the runtimes that can not load the native N-API addon, such as browsers and edge workers.
+ * It exposes the same functions as farmhash64.js and returns identical results.
+ *
+ * The inputs are copied into the module linear memory before hashing, and strings are encoded as UTF-8 directly into it.
+ * farmhash64Batch hashes all the keys with a single call into the module.
+ *
+ * Usage:
+ *   - Node.js: loadFile("target/wasm/farmhash64.wasm") returns the library synchronously;
+ *   - other runtimes: load(source) returns a Promise of the library, where source is a WebAssembly.Module
+ *     (e.g. a .wasm import in an edge worker), a Response (e.g. fetch("farmhash64.wasm")), or the module bytes.
+ *
+ * @category   Libraries
+ * @license    see LICENSE file
+ * @link       https://github.com/tecnickcom/farmhash64
+ */
+
+const js = require("./farmhash64.js");
+
+const WASM_PAGE = 65536;
+
+// inputs up to this size (in bytes or string characters) are copied with a loop
+const SHORT_INPUT = 32;
+
+// Returns a Uint8Array view of any supported binary input (Uint8Array, Buffer, other TypedArray, DataView, ArrayBuffer),
+// or the input itself for a plain array of bytes (copied into the linear memory like a Uint8Array).
+function toBytes(s) {
+    if (s instanceof Uint8Array || Array.isArray(s)) {
+        return s;
+    }
+    if (ArrayBuffer.isView(s)) {
+        return new Uint8Array(s.buffer, s.byteOffset, s.byteLength);
+    }
+    if (s instanceof ArrayBuffer) {
+        return new Uint8Array(s);
+    }
+    throw new TypeError("farmhash64: unsupported input type");
+}
+
+/**
+ * Instantiates a compiled farmhash64 WebAssembly module.
+ *
+ * @param {WebAssembly.Module} module - The compiled target/wasm/farmhash64.wasm module.
+ * @returns {object} The library, with the same functions as farmhash64.js.
+ */
+function create(module) {
+    const wasm = new WebAssembly.Instance(module, {}).exports;
+    const memory = wasm.memory;
+    const textEncoder = new TextEncoder();
+    // Linear memory layout from heap_base: 8 bytes for the farmhash64_into result, then the input.
+    const outPtr = wasm.heap_base();
+    const inPtr = outPtr + 16;
+    let u8 = new Uint8Array(memory.buffer);
+    let u32 = new Uint32Array(memory.buffer);
+
+    // Grows the linear memory to hold size bytes of input.
+    // The views are recreated because growing detaches the previous buffer.
+    function reserve(size) {
+        const need = inPtr + size;
+        if (need > memory.buffer.byteLength) {
+            memory.grow(Math.ceil((need - memory.buffer.byteLength) / WASM_PAGE));
+            u8 = new Uint8Array(memory.buffer);
+            u32 = new Uint32Array(memory.buffer);
+        }
+    }
+
+    // the short inputs are copied without checking the memory size
+    reserve(SHORT_INPUT * 3);
+
+    // Copies the bytes of b at ptr, with a loop for short inputs: TypedArray.set has a higher fixed cost.
+    function copyAt(b, ptr) {
+        const len = b.length;
+        if (len <= SHORT_INPUT) {
+            for (let i = 0; i < len; i++) {
+                u8[ptr + i] = b[i];
+            }
+        } else {
+            u8.set(b, ptr);
+        }
+        return len;
+    }
+
+    // Encodes str as UTF-8 at ptr and returns the number of bytes written.
+    // Short strings are copied with a loop up to the first non-ASCII character.
+    function encodeAt(str, ptr) {
+        const len = str.length;
+        if (len <= SHORT_INPUT) {
+            for (let i = 0; i < len; i++) {
+                const c = str.charCodeAt(i);
+                if (c >= 0x80) {
+                    return i + textEncoder.encodeInto(str.substring(i), u8.subarray(ptr + i, ptr + (len * 3))).written;
+                }
+                u8[ptr + i] = c;
+            }
+            return len;
+        }
+        return textEncoder.encodeInto(str, u8.subarray(ptr, ptr + (len * 3))).written;
+    }
+
+    // Copies the bytes of a binary input into the linear memory and returns their number.
+    function copyBytes(s) {
+        const b = toBytes(s);
+        if (b.length > SHORT_INPUT) {
+            reserve(b.length);
+        }
+        return copyAt(b, inPtr);
+    }
+
+    // Encodes str as UTF-8 into the linear memory and returns the number of bytes written.
+    function copyStr(str) {
+        if (str.length > SHORT_INPUT) {
+            reserve(str.length * 3);
+        }
+        return encodeAt(str, inPtr);
+    }
+
+    function hash64(len) {
+        wasm.farmhash64_into(inPtr, len, outPtr);
+        return {
+            hi: u32[(outPtr >>> 2) + 1],
+            lo: u32[outPtr >>> 2],
+        };
+    }
+
+    // Plain arrays of bytes are hashed in Javascript, like with the native addon.
+    function binaryInput(wasmFn, jsFn) {
+        return function(s) {
+            return Array.isArray(s) ? jsFn(s) : wasmFn(copyBytes(s));
+        };
+    }
+
+    function farmhash64BigInt(len) {
+        return BigInt.asUintN(64, wasm.farmhash64(inPtr, len));
+    }
+
+    function farmhash32(len) {
+        return wasm.farmhash32(inPtr, len) >>> 0;
+    }
+
+    function strFarmhash64(str) {
+        return hash64(copyStr(str));
+    }
+
+    function strFarmhash64BigInt(str) {
+        return farmhash64BigInt(copyStr(str));
+    }
+
+    function strFarmhash32(str) {
+        return farmhash32(copyStr(str));
+    }
+
+    /**
+     * Calculates the 64-bit FarmHash hash values for a list of keys with a single call into the module.
+     *
+     * @param {Array<Uint8Array|Buffer|ArrayBufferView|ArrayBuffer|Array<number>|string>} keys - The keys to be hashed; strings are hashed as UTF-8.
+     * @returns {BigUint64Array} The 64-bit hash value of each key, in the same order.
+     */
+    function farmhash64Batch(keys) {
+        const n = keys.length;
+        let size = 0;
+        let k = 0;
+        for (k = 0; k < n; k++) {
+            size += (typeof keys[k] === "string") ? (keys[k].length * 3) : toBytes(keys[k]).length;
+        }
+        // layout: n hashes, n + 1 key offsets, key bytes
+        const hashPtr = inPtr;
+        const offPtr = hashPtr + (n * 8);
+        const dataPtr = offPtr + ((n + 1) * 4);
+        reserve((dataPtr - inPtr) + size);
+        let pos = 0;
+        for (k = 0; k < n; k++) {
+            u32[(offPtr >>> 2) + k] = pos;
+            pos += (typeof keys[k] === "string") ? encodeAt(keys[k], dataPtr + pos) : copyAt(toBytes(keys[k]), dataPtr + pos);
+        }
+        u32[(offPtr >>> 2) + n] = pos;
+        wasm.farmhash64_batch(dataPtr, offPtr, n, hashPtr);
+        return new BigUint64Array(memory.buffer, hashPtr, n).slice();
+    }
+
+    /**
+     * Calculates the 64-bit FarmHash hash value for the given input asynchronously.
+     * The hash is computed on the calling thread before returning, so the input can be modified
+     * (or its ArrayBuffer transferred) as soon as the call returns, like with the native addon.
+     *
+     * @param {Uint8Array|Buffer|ArrayBufferView|ArrayBuffer|Array<number>|string} s - The input to be hashed; strings are hashed as UTF-8.
+     * @returns {Promise<bigint>} The 64-bit hash value as an unsigned BigInt.
+     */
+    function farmhash64Async(s) {
+        return Promise.resolve((typeof s === "string") ? strFarmhash64BigInt(s) : farmhash64BigInt(copyBytes(s)));
+    }
+
+    return {
+        farmhash32: binaryInput(farmhash32, js.farmhash32),
+        farmhash64: binaryInput(hash64, js.farmhash64),
+        farmhash64BigInt: binaryInput(farmhash64BigInt, js.farmhash64BigInt),
+        farmhash64Batch: farmhash64Batch,
+        farmhash64Async: farmhash64Async,
+        strFarmhash32: strFarmhash32,
+        strFarmhash64: strFarmhash64,
+        strFarmhash64BigInt: strFarmhash64BigInt,
+        strFarmhash32Hex: function(str) {
+            return js.hex32(strFarmhash32(str));
+        },
+        strFarmhash64Hex: function(str) {
+            return js.hex64(strFarmhash64(str));
+        },
+        hex32: js.hex32,
+        hex64: js.hex64,
+        _testData: js._testData,
+        native: false,
+        wasm: true,
+    };
+}
+
+/**
+ * Compiles and instantiates the farmhash64 WebAssembly module.
+ *
+ * @param {WebAssembly.Module|Response|Promise<Response>|ArrayBuffer|ArrayBufferView} source - The module, or a source of its bytes.
+ * @returns {Promise<object>} The library, with the same functions as farmhash64.js.
+ */
+async function load(source) {
+    source = await source;
+    if (source instanceof WebAssembly.Module) {
+        return create(source);
+    }
+    if ((typeof Response !== "undefined") && (source instanceof Response)) {
+        return create(await WebAssembly.compile(await source.arrayBuffer()));
+    }
+    return create(await WebAssembly.compile(source));
+}
+
+/**
+ * Loads the farmhash64 WebAssembly module from a file (Node.js only).
+ *
+ * @param {string} path - Path of the farmhash64.wasm file.
+ * @returns {object} The library, with the same functions as farmhash64.js.
+ */
+function loadFile(path) {
+    return create(new WebAssembly.Module(require("fs").readFileSync(path)));
+}
+
+if (typeof module !== "undefined") {
+    module.exports = {
+        create: create,
+        load: load,
+        loadFile: loadFile,
+    };
+}
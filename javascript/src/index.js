@@ -0,0 +1,141 @@
+/** FarmHash64 Javascript Library Loader
+ *
+ * index.js
+ *
+ *
+ * Loads the native N-API addon (build/Release/farmhash64.node, built from native/farmhash64_napi.c).
+ * When the addon is not available it loads the WebAssembly module (target/wasm/farmhash64.wasm, see farmhash64_wasm.js),
+ * and then falls back to the pure Javascript implementation in farmhash64.js.
+ * All the backends return identical results for the same input.
+ *
+ * The native backend hashes Buffer, TypedArray, DataView and ArrayBuffer inputs without copying them,
+ * and provides farmhash64Async to hash large inputs on the libuv threadpool without blocking the event loop.
+ * Every backend accepts the same inputs, including plain arrays of bytes, and throws the same TypeError otherwise.
+ *
+ * Set the environment variable FARMHASH64_NO_NATIVE=1 to skip the native addon,
+ * and FARMHASH64_NO_WASM=1 to skip the WebAssembly module.
+ *
+ * @category   Libraries
+ * @license    see LICENSE file
+ * @link       https://github.com/tecnickcom/farmhash64
+ */
+
+const js = require("./farmhash64.js");
+
+function loadNative() {
+    if (typeof process === "undefined" || process.env.FARMHASH64_NO_NATIVE) {
+        return null;
+    }
+    try {
+        return require("../build/Release/farmhash64.node");
+    } catch (e) {
+        return null;
+    }
+}
+
+function loadWasm() {
+    if (typeof WebAssembly === "undefined" || typeof process === "undefined" || process.env.FARMHASH64_NO_WASM) {
+        return null;
+    }
+    try {
+        return require("./farmhash64_wasm.js").loadFile(require("path").join(__dirname, "../target/wasm/farmhash64.wasm"));
+    } catch (e) {
+        return null;
+    }
+}
+
+const native = loadNative();
+const wasm = (native === null) ? loadWasm() : null;
+
+// The native functions only take binary inputs: plain arrays of bytes are hashed in Javascript.
+function binaryInput(nativeFn, jsFn) {
+    return function(s) {
+        return Array.isArray(s) ? jsFn(s) : nativeFn(s);
+    };
+}
+
+/**
+ * Calculates the 64-bit FarmHash hash value for the given input without blocking the event loop.
+ * With the native backend the hash of a copy of the input is computed on the libuv threadpool;
+ * the other backends hash the input before returning. In both cases the input can be modified,
+ * or its ArrayBuffer transferred, as soon as the call returns.
+ *
+ * @param {Uint8Array|Buffer|ArrayBufferView|ArrayBuffer|Array<number>|string} s - The input to be hashed; strings are hashed as UTF-8.
+ * @returns {Promise<bigint>} The 64-bit hash value as an unsigned BigInt.
+ */
+function jsFarmhash64Async(s) {
+    const h = (typeof s === "string") ? js.strFarmhash64BigInt(s) : js.farmhash64BigInt(s);
+    return new Promise(function(resolve) {
+        setImmediate(function() {
+            resolve(h);
+        });
+    });
+}
+
+// The {hi, lo} results are built here from a shared output array:
+// creating objects from N-API is several times slower than the hash itself for short inputs.
+const out = new Uint32Array(2);
+
+function nativeFarmhash64(s) {
+    native.farmhash64Into(s, out);
+    return {
+        hi: out[0],
+        lo: out[1],
+    };
+}
+
+function nativeStrFarmhash64(str) {
+    native.strFarmhash64Into(str, out);
+    return {
+        hi: out[0],
+        lo: out[1],
+    };
+}
+
+function strFarmhash64Hex(str) {
+    return js.hex64(nativeStrFarmhash64(str));
+}
+
+function strFarmhash32Hex(str) {
+    return js.hex32(native.strFarmhash32(str));
+}
+
+if (native !== null) {
+    module.exports = {
+        farmhash32: binaryInput(native.farmhash32, js.farmhash32),
+        farmhash64: binaryInput(nativeFarmhash64, js.farmhash64),
+        farmhash64BigInt: binaryInput(native.farmhash64BigInt, js.farmhash64BigInt),
+        farmhash64Batch: native.farmhash64Batch,
+        farmhash64Async: native.farmhash64Async,
+        strFarmhash32: native.strFarmhash32,
+        strFarmhash64: nativeStrFarmhash64,
+        strFarmhash64BigInt: native.strFarmhash64BigInt,
+        strFarmhash32Hex: strFarmhash32Hex,
+        strFarmhash64Hex: strFarmhash64Hex,
+        hex32: js.hex32,
+        hex64: js.hex64,
+        _testData: js._testData,
+        native: true,
+        wasm: false,
+    };
+} else if (wasm !== null) {
+    module.exports = wasm;
+} else {
+    module.exports = {
+        farmhash32: js.farmhash32,
+        farmhash64: js.farmhash64,
+        farmhash64BigInt: js.farmhash64BigInt,
+        farmhash64Batch: js.farmhash64Batch,
+        farmhash64Async: jsFarmhash64Async,
+        strFarmhash32: js.strFarmhash32,
+        strFarmhash64: js.strFarmhash64,
+        strFarmhash64BigInt: js.strFarmhash64BigInt,
+        strFarmhash32Hex: js.strFarmhash32Hex,
+        strFarmhash64Hex: js.strFarmhash64Hex,
+        hex32: js.hex32,
+        hex64: js.hex64,
+        _testData: js._testData,
+        native: false,
+        wasm: false,
+    };
+}
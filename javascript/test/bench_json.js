@@ -0,0 +1,71 @@
+/** FarmHash64 Javascript Library Cross-Language Benchmark
+ *
+ * bench_json.js
+ *
+ *
+ * Hashes the data_setup() corpus of the C tests over fixed size classes with the library
+ * loaded from the path given as first argument (native addon, WebAssembly module or Javascript fallback),
+ * and prints the results in the farmhash64-bench/1 JSON format shared by all the language ports.
+ * Heap allocations are not measurable from Javascript and are reported as null.
+ *
+ * @category   Libraries
+ * @license    see LICENSE file
+ * @link       https://github.com/tecnickcom/farmhash64
+ */
+
+const lib = require(process.argv[2]);
+
+const DATA_SIZE = 1 << 20;
+const SIZES = [8, 16, 32, 64, 128, 256, 1024, 4096, 65536, 1048576];
+
+function benchIterations(size) {
+    return Math.max(64, Math.floor((1 << 26) / size));
+}
+
+function benchOffset(i, size) {
+    return (size <= (DATA_SIZE / 2)) ? ((i & 63) << 6) : 0;
+}
+
+// Returns the wrapping 64-bit sum of the hashes as {hi, lo}.
+function benchRun(data, size, iterations) {
+    let hi = 0;
+    let lo = 0;
+    for (let i = 0; i < iterations; i++) {
+        const off = benchOffset(i, size);
+        const h = lib.farmhash64(data.subarray(off, off + size));
+        lo += h.lo;
+        hi = (hi + h.hi + (lo > 0xffffffff ? 1 : 0)) >>> 0;
+        lo >>>= 0;
+    }
+    return {
+        hi: hi,
+        lo: lo,
+    };
+}
+
+function main() {
+    const data = lib._testData(DATA_SIZE);
+    const rows = [];
+    for (const size of SIZES) {
+        const iterations = benchIterations(size);
+        benchRun(data, size, Math.floor(iterations / 8));
+        const start = process.hrtime.bigint();
+        const checksum = benchRun(data, size, iterations);
+        const ns = Number(process.hrtime.bigint() - start) / iterations;
+        rows.push(JSON.stringify({
+            size: size,
+            iterations: iterations,
+            ns_per_hash: Number(ns.toFixed(3)),
+            gb_per_s: Number((size / ns).toFixed(3)),
+            allocs_per_hash: null,
+            alloc_bytes_per_hash: null,
+            checksum: lib.hex64(checksum),
+        }));
+    }
+    console.log("{\"schema\":\"farmhash64-bench/1\",\"lang\":\"javascript\",\"impl\":\"" +
+        (lib.native ? "native" : (lib.wasm ? "wasm" : "javascript")) + "\",\"results\":[");
+    console.log(rows.join(",\n"));
+    console.log("]}");
+}
+
+main();
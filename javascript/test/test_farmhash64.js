@@ -10,8 +10,10 @@
 const {
     // farmhash32,
     farmhash64,
+    farmhash64BigInt,
     strFarmhash32,
     strFarmhash64,
+    strFarmhash64BigInt,
     strFarmhash32Hex,
     strFarmhash64Hex,
     hex32,
@@ -654,6 +656,87 @@ function test_strFarmhash32Hex() {
     return errors;
 }
 
+function test_strFarmhash64BigInt() {
+    var errors = 0;
+    var h = 0;
+    var exp = 0;
+    var i = 0;
+    for (i = 0; i < test_data.length; i++) {
+        h = strFarmhash64BigInt(test_data[i][3]);
+        exp = BigInt("0x" + test_data[i][2]);
+        if (h !== exp) {
+            console.error(
+                "strFarmhash64BigInt: (" +
+                i +
+                ") expected " +
+                exp.toString(16) +
+                " but got " +
+                h.toString(16)
+            );
+            ++errors;
+        }
+    }
+    return errors;
+}
+
+function test_strFarmhash64Long() {
+    // long strings, including multi-byte characters, grow the internal encoding buffer
+    var errors = 0;
+    var str = "";
+    var exp = "";
+    var i = 0;
+    for (i = 0; i < 12; i++) {
+        str += "\u00e8\u4e2d\ud83d\ude00" + str + i;
+        exp = hex64(farmhash64(Buffer.from(str, "utf8")));
+        if (strFarmhash64Hex(str) !== exp || strFarmhash64Hex(str) !== exp) {
+            console.error("strFarmhash64Long: (" + i + ") mismatch for length " + str.length);
+            ++errors;
+        }
+    }
+    return errors;
+}
+
+function test_farmhash64Inputs() {
+    // every supported input type must hash the same bytes to the same value
+    var errors = 0;
+    const data = _testData(1000);
+    const exp = farmhash64(data.slice(13, 13 + 300));
+    const buf = new ArrayBuffer(400);
+    const view = new Uint8Array(buf, 50, 300);
+    view.set(data.subarray(13, 13 + 300));
+    const inputs = [
+        data.subarray(13, 13 + 300),
+        Buffer.from(view),
+        Array.from(view),
+        new DataView(buf, 50, 300),
+        new Uint16Array(buf, 50, 150),
+        buf.slice(50, 350),
+    ];
+    var h = 0;
+    var i = 0;
+    for (i = 0; i < inputs.length; i++) {
+        h = farmhash64(inputs[i]);
+        if (h.hi != exp.hi || h.lo != exp.lo) {
+            console.error("farmhash64Inputs: (" + i + ") expected " + hex64(exp) + " but got " + hex64(h));
+            ++errors;
+        }
+        if (farmhash64BigInt(inputs[i]) !== BigInt("0x" + hex64(exp))) {
+            console.error("farmhash64BigInt: (" + i + ") expected " + hex64(exp));
+            ++errors;
+        }
+    }
+    try {
+        farmhash64(12345);
+        console.error("farmhash64Inputs: expected TypeError");
+        ++errors;
+    } catch (e) {
+        if (!(e instanceof TypeError)) {
+            ++errors;
+        }
+    }
+    return errors;
+}
+
 function testDataItemFarmHash64(data, offset, hlen, index) {
     const begin = offset >>> 0;
     const end = (begin + hlen) >>> 0;
@@ -710,6 +793,9 @@ errors += test_strFarmhash64();
 errors += test_strFarmhash64Hex();
 errors += test_strFarmhash32();
 errors += test_strFarmhash32Hex();
+errors += test_strFarmhash64BigInt();
+errors += test_strFarmhash64Long();
+errors += test_farmhash64Inputs();
 errors += test_farmhash64();
 
 if (errors > 0) {
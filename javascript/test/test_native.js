@@ -0,0 +1,163 @@
+/** FarmHash64 Javascript Library Native Addon Test
+ *
+ * test_native.js
+ *
+ * Checks that the library loaded by src/index.js (native addon, WebAssembly module or Javascript fallback)
+ * returns the same values as the pure Javascript implementation, and accepts and rejects the same inputs.
+ * Fails when the native addon is not loaded and the environment variable FARMHASH64_REQUIRE_NATIVE is set
+ * (as in CI), unless FARMHASH64_NO_NATIVE is also set.
+ * Run with --expose-gc to collect the detached input of farmhash64Async while it is hashed.
+ *
+ * @category   Libraries
+ * @license    see LICENSE file
+ * @link       https://github.com/tecnickcom/farmhash64
+ */
+
+const lib = require(process.argv[2]);
+const js = require(process.argv[3]);
+
+function test_farmhash64Same() {
+    var errors = 0;
+    const data = js._testData(1 << 16);
+    var a = null;
+    var b = null;
+    var len = 0;
+    var off = 0;
+    for (len = 0; len < 1024; len = len < 130 ? len + 1 : len + 97) {
+        for (off = 0; off < 8; off += 3) {
+            const s = data.subarray(off, off + len);
+            a = lib.farmhash64(s);
+            b = js.farmhash64(s);
+            if (a.hi !== b.hi || a.lo !== b.lo || lib.farmhash32(s) !== js.farmhash32(s) ||
+                lib.farmhash64BigInt(s) !== js.farmhash64BigInt(s)) {
+                console.error("farmhash64Same: mismatch at offset " + off + " length " + len);
+                ++errors;
+            }
+        }
+    }
+    // other views and plain arrays
+    const inputs = [
+        Buffer.from(data.subarray(5, 300)),
+        new DataView(data.buffer, 5, 295),
+        new Uint16Array(data.buffer, 6, 100),
+        new Float64Array(data.buffer, 8, 30),
+        data.buffer.slice(5, 300),
+        Array.from(data.subarray(5, 300)),
+    ];
+    for (var i = 0; i < inputs.length; i++) {
+        if (lib.farmhash64BigInt(inputs[i]) !== js.farmhash64BigInt(inputs[i])) {
+            console.error("farmhash64Same: mismatch for input " + i);
+            ++errors;
+        }
+    }
+    return errors;
+}
+
+function test_strFarmhash64Same() {
+    var errors = 0;
+    // includes multi-byte characters and an unpaired surrogate
+    const strs = ["", "a", "hello world", "è中😀", "x\ud800y", "abc".repeat(500)];
+    for (var i = 0; i < strs.length; i++) {
+        if (lib.strFarmhash64Hex(strs[i]) !== js.strFarmhash64Hex(strs[i]) ||
+            lib.strFarmhash32(strs[i]) !== js.strFarmhash32(strs[i]) ||
+            lib.strFarmhash64BigInt(strs[i]) !== js.strFarmhash64BigInt(strs[i])) {
+            console.error("strFarmhash64Same: mismatch for string " + i);
+            ++errors;
+        }
+    }
+    return errors;
+}
+
+function test_farmhash64Batch() {
+    var errors = 0;
+    const data = js._testData(4096);
+    const keys = [];
+    for (var i = 0; i < 200; i++) {
+        // binary views, strings and plain arrays of bytes
+        keys.push((i % 3 === 0) ? Array.from(data.subarray(i, i * 3)) : ((i & 1) ? data.subarray(i, i * 7) : "key-" + i));
+    }
+    const a = lib.farmhash64Batch(keys);
+    const b = js.farmhash64Batch(keys);
+    if (!(a instanceof BigUint64Array) || a.length !== keys.length) {
+        console.error("farmhash64Batch: expected a BigUint64Array of " + keys.length + " elements");
+        return 1;
+    }
+    for (i = 0; i < keys.length; i++) {
+        if (a[i] !== b[i]) {
+            console.error("farmhash64Batch: mismatch at index " + i);
+            ++errors;
+        }
+    }
+    // invalid keys are rejected by every backend
+    const invalid = [1, null, {}, true];
+    for (i = 0; i < invalid.length; i++) {
+        try {
+            lib.farmhash64Batch(["a", invalid[i]]);
+            console.error("farmhash64Batch: expected TypeError for invalid key " + i);
+            ++errors;
+        } catch (e) {
+            if (!(e instanceof TypeError)) {
+                console.error("farmhash64Batch: expected TypeError for invalid key " + i + ", got " + e);
+                ++errors;
+            }
+        }
+    }
+    return errors;
+}
+
+async function test_farmhash64Async() {
+    var errors = 0;
+    const data = js._testData(1 << 20);
+    const inputs = [data, data.subarray(3, 1000), "async 中", "", Array.from(data.subarray(7, 300))];
+    const hashes = await Promise.all(inputs.map(lib.farmhash64Async));
+    for (var i = 0; i < inputs.length; i++) {
+        const exp = (typeof inputs[i] === "string") ? js.strFarmhash64BigInt(inputs[i]) : js.farmhash64BigInt(inputs[i]);
+        if (hashes[i] !== exp) {
+            console.error("farmhash64Async: mismatch for input " + i);
+            ++errors;
+        }
+    }
+    return errors;
+}
+
+// the input can be transferred (detached) as soon as farmhash64Async returns
+async function test_farmhash64AsyncDetach() {
+    const ab = js._testData(1 << 22).buffer.slice(0);
+    const exp = js.farmhash64BigInt(ab);
+    const p = lib.farmhash64Async(ab);
+    structuredClone(ab, {
+        transfer: [ab]
+    });
+    if (typeof global.gc === "function") {
+        global.gc();
+    }
+    if (ab.byteLength !== 0 || await p !== exp) {
+        console.error("farmhash64AsyncDetach: mismatch after detaching the input");
+        return 1;
+    }
+    return 0;
+}
+
+async function main() {
+    var errors = 0;
+
+    if (process.env.FARMHASH64_REQUIRE_NATIVE && !process.env.FARMHASH64_NO_NATIVE && !lib.native) {
+        console.error("FAILED: the native addon is not loaded (FARMHASH64_REQUIRE_NATIVE is set)");
+        process.exit(1);
+    }
+
+    errors += test_farmhash64Same();
+    errors += test_strFarmhash64Same();
+    errors += test_farmhash64Batch();
+    errors += await test_farmhash64Async();
+    errors += await test_farmhash64AsyncDetach();
+
+    if (errors > 0) {
+        console.log("FAILED: " + errors);
+        process.exit(1);
+    } else {
+        console.log("OK (" + (lib.native ? "native" : (lib.wasm ? "wasm" : "javascript")) + ")");
+    }
+}
+
+main();
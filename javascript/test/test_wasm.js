@@ -0,0 +1,188 @@
+/** FarmHash64 Javascript Library WebAssembly Backend Test
+ *
+ * test_wasm.js
+ *
+ * Checks that the WebAssembly module given as first argument (target/wasm/farmhash64.wasm, see "make wasm")
+ * returns the same values as the pure Javascript implementation, and compares their speed.
+ * The test is skipped when the module has not been built, and fails instead
+ * when the environment variable FARMHASH64_REQUIRE_WASM is set (as in CI).
+ *
+ * @category   Libraries
+ * @license    see LICENSE file
+ * @link       https://github.com/tecnickcom/farmhash64
+ */
+
+const fs = require("fs");
+const loader = require("../src/farmhash64_wasm.js");
+const js = require("../src/farmhash64.js");
+
+function test_farmhash64Same(lib) {
+    var errors = 0;
+    const data = js._testData(1 << 16);
+    var a = null;
+    var b = null;
+    var len = 0;
+    var off = 0;
+    for (len = 0; len < 1024; len = len < 130 ? len + 1 : len + 97) {
+        for (off = 0; off < 8; off += 3) {
+            const s = data.subarray(off, off + len);
+            a = lib.farmhash64(s);
+            b = js.farmhash64(s);
+            if (a.hi !== b.hi || a.lo !== b.lo || lib.farmhash32(s) !== js.farmhash32(s) ||
+                lib.farmhash64BigInt(s) !== js.farmhash64BigInt(s)) {
+                console.error("farmhash64Same: mismatch at offset " + off + " length " + len);
+                ++errors;
+            }
+        }
+    }
+    // larger than the initial linear memory
+    if (lib.farmhash64BigInt(js._testData(3 << 20)) !== js.farmhash64BigInt(js._testData(3 << 20))) {
+        console.error("farmhash64Same: mismatch for a 3 MiB input");
+        ++errors;
+    }
+    const inputs = [
+        Buffer.from(data.subarray(5, 300)),
+        new DataView(data.buffer, 5, 295),
+        new Uint16Array(data.buffer, 6, 100),
+        data.buffer.slice(5, 300),
+        Array.from(data.subarray(5, 300)),
+    ];
+    for (var i = 0; i < inputs.length; i++) {
+        if (lib.farmhash64BigInt(inputs[i]) !== js.farmhash64BigInt(inputs[i])) {
+            console.error("farmhash64Same: mismatch for input " + i);
+            ++errors;
+        }
+    }
+    return errors;
+}
+
+function test_strFarmhash64Same(lib) {
+    var errors = 0;
+    const strs = ["", "a", "hello world", "è中😀", "x\ud800y", "abc".repeat(500)];
+    for (var i = 0; i < strs.length; i++) {
+        if (lib.strFarmhash64Hex(strs[i]) !== js.strFarmhash64Hex(strs[i]) ||
+            lib.strFarmhash32Hex(strs[i]) !== js.strFarmhash32Hex(strs[i]) ||
+            lib.strFarmhash64BigInt(strs[i]) !== js.strFarmhash64BigInt(strs[i])) {
+            console.error("strFarmhash64Same: mismatch for string " + i);
+            ++errors;
+        }
+    }
+    return errors;
+}
+
+function test_farmhash64Batch(lib) {
+    var errors = 0;
+    const data = js._testData(1 << 16);
+    const keys = [];
+    var i = 0;
+    // every pair of short key lengths, then mixed keys
+    for (var n0 = 0; n0 < 20; n0++) {
+        for (var n1 = 0; n1 < 20; n1++) {
+            keys.push(data.subarray(i, i + n0));
+            keys.push(data.subarray(i + 1, i + 1 + n1));
+            i += 7;
+        }
+    }
+    for (i = 0; i < 201; i++) {
+        keys.push((i & 1) ? data.subarray(i, i * 7) : "key-" + i);
+    }
+    const a = lib.farmhash64Batch(keys);
+    const b = js.farmhash64Batch(keys);
+    if (!(a instanceof BigUint64Array) || a.length !== keys.length) {
+        console.error("farmhash64Batch: expected a BigUint64Array of " + keys.length + " elements");
+        return 1;
+    }
+    for (i = 0; i < keys.length; i++) {
+        if (a[i] !== b[i]) {
+            console.error("farmhash64Batch: mismatch at index " + i);
+            ++errors;
+        }
+    }
+    if (lib.farmhash64Batch([]).length !== 0) {
+        console.error("farmhash64Batch: expected an empty result");
+        ++errors;
+    }
+    return errors;
+}
+
+async function test_farmhash64Async(lib) {
+    var errors = 0;
+    const data = js._testData(1 << 16);
+    const inputs = [data, data.subarray(3, 1000), "async 中", ""];
+    const hashes = await Promise.all(inputs.map(lib.farmhash64Async));
+    for (var i = 0; i < inputs.length; i++) {
+        const exp = (typeof inputs[i] === "string") ? js.strFarmhash64BigInt(inputs[i]) : js.farmhash64BigInt(inputs[i]);
+        if (hashes[i] !== exp) {
+            console.error("farmhash64Async: mismatch for input " + i);
+            ++errors;
+        }
+    }
+    return errors;
+}
+
+// Returns the time in nanoseconds per call of fn over the inputs.
+function benchTime(fn, inputs, rounds) {
+    const start = process.hrtime.bigint();
+    for (var r = 0; r < rounds; r++) {
+        for (var i = 0; i < inputs.length; i++) {
+            fn(inputs[i]);
+        }
+    }
+    return Number(process.hrtime.bigint() - start) / (rounds * inputs.length);
+}
+
+function benchmark_farmhash64(lib) {
+    const data = js._testData(1 << 20);
+    const sizes = [8, 16, 64, 1024, 65536];
+    for (var k = 0; k < sizes.length; k++) {
+        const size = sizes[k];
+        const inputs = [];
+        for (var i = 0; i < 64; i++) {
+            inputs.push(data.subarray(i * 64, (i * 64) + size));
+        }
+        const rounds = Math.max(4, Math.floor((1 << 22) / (64 * size)));
+        benchTime(js.farmhash64, inputs, rounds);
+        benchTime(lib.farmhash64, inputs, rounds);
+        const tjs = benchTime(js.farmhash64, inputs, rounds);
+        const twasm = benchTime(lib.farmhash64, inputs, rounds);
+        console.log(" * farmhash64 " + size + " bytes: javascript " + tjs.toFixed(1) + " ns, wasm " + twasm.toFixed(1) + " ns (" + (tjs / twasm).toFixed(1) + "x)");
+    }
+    const keys = [];
+    for (i = 0; i < 10000; i++) {
+        keys.push("user:" + i);
+    }
+    js.farmhash64Batch(keys);
+    lib.farmhash64Batch(keys);
+    const tjs = benchTime(js.farmhash64Batch, [keys], 20) / keys.length;
+    const twasm = benchTime(lib.farmhash64Batch, [keys], 20) / keys.length;
+    console.log(" * farmhash64Batch short string keys: javascript " + tjs.toFixed(1) + " ns/key, wasm " + twasm.toFixed(1) + " ns/key (" + (tjs / twasm).toFixed(1) + "x)");
+}
+
+async function main() {
+    const path = process.argv[2];
+    if (!fs.existsSync(path)) {
+        if (process.env.FARMHASH64_REQUIRE_WASM) {
+            console.error("FAILED: " + path + " not found (FARMHASH64_REQUIRE_WASM is set)");
+            process.exit(1);
+        }
+        console.log("SKIP (" + path + " not found: run make wasm)");
+        return;
+    }
+    const lib = loader.loadFile(path);
+    var errors = 0;
+
+    errors += test_farmhash64Same(lib);
+    errors += test_strFarmhash64Same(lib);
+    errors += test_farmhash64Batch(lib);
+    errors += await test_farmhash64Async(lib);
+    errors += test_farmhash64Same(await loader.load(fs.readFileSync(path)));
+
+    if (errors > 0) {
+        console.log("FAILED: " + errors);
+        process.exit(1);
+    }
+    benchmark_farmhash64(lib);
+    console.log("OK (wasm)");
+}
+
+main();
@@ -0,0 +1,57 @@
+// farmhash64 WebAssembly Module
+//
+// WebAssembly build of the header-only C implementation, for the Javascript runtimes
+// that can not load native addons (browsers, edge workers).
+// The functions take their inputs from the module linear memory and are called by src/farmhash64_wasm.js.
+// Build with "make wasm" (clang --target=wasm32, no libc).
+//
+// @category   Libraries
+// @author     Nicola Asuni <nicola.asuni@tecnick.com>
+// @license    MIT (see LICENSE)
+// @link       https://github.com/tecnickcom/farmhash64
+
+#include <stdint.h>
+#include "../../c/src/farmhash64.h"
+
+#define FH_EXPORT(name) __attribute__((export_name(name)))
+
+// first free byte of the linear memory after the stack and static data (set by wasm-ld)
+extern unsigned char __heap_base;
+
+// Returns the address of the first free byte of the linear memory.
+// The loader owns the memory from here on: there is no allocator in the module.
+FH_EXPORT("heap_base") uint32_t fh_heap_base(void)
+{
+    return (uint32_t)(uintptr_t)&__heap_base;
+}
+
+// Returns the 64-bit hash of s[0:len] (an unsigned BigInt in Javascript).
+FH_EXPORT("farmhash64") uint64_t fh_farmhash64(const char *s, uint32_t len)
+{
+    return farmhash64(s, len);
+}
+
+// Stores the 64-bit hash of s[0:len] in out, to build {hi, lo} results without BigInt conversions.
+FH_EXPORT("farmhash64_into") void fh_farmhash64_into(const char *s, uint32_t len, uint64_t *out)
+{
+    *out = farmhash64(s, len);
+}
+
+// Returns the 32-bit hash of s[0:len].
+FH_EXPORT("farmhash32") uint32_t fh_farmhash32(const char *s, uint32_t len)
+{
+    return farmhash32(s, len);
+}
+
+// Hashes n keys stored back to back in data: key i is data[off[i]:off[i+1]].
+// One call for all the keys: the cost of a call from Javascript is several times the hash of a short key.
+// The keys are hashed one at a time: WebAssembly has no 64-bit lane multiplication in hardware on the
+// common targets (i64x2.mul is emulated), and a two-lane SIMD128 version measured slower in V8.
+FH_EXPORT("farmhash64_batch") void fh_farmhash64_batch(const char *data, const uint32_t *off, uint32_t n, uint64_t *out)
+{
+    uint32_t i;
+    for (i = 0; i < n; i++)
+    {
+        out[i] = farmhash64(data + off[i], off[i + 1] - off[i]);
+    }
+}
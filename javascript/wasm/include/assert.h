@@ -0,0 +1,9 @@
+// Minimal freestanding <assert.h> for the WebAssembly build (see ../farmhash64_wasm.c).
+// Assertions are always disabled: there is no runtime to report them.
+
+#ifndef FARMHASH64_WASM_ASSERT_H
+#define FARMHASH64_WASM_ASSERT_H
+
+#define assert(x) ((void)0)
+
+#endif
@@ -0,0 +1,9 @@
+// Minimal freestanding <stdlib.h> for the WebAssembly build (see ../farmhash64_wasm.c).
+// The hash functions only need size_t from it.
+
+#ifndef FARMHASH64_WASM_STDLIB_H
+#define FARMHASH64_WASM_STDLIB_H
+
+#include <stddef.h>
+
+#endif
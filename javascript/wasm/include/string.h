@@ -0,0 +1,13 @@
+// Minimal freestanding <string.h> for the WebAssembly build (see ../farmhash64_wasm.c).
+// -ffreestanding disables the implicit builtins: map them back explicitly, so that
+// fixed-size copies become plain loads and the others become bulk memory instructions.
+
+#ifndef FARMHASH64_WASM_STRING_H
+#define FARMHASH64_WASM_STRING_H
+
+#include <stddef.h>
+
+#define memcpy(dst, src, n) __builtin_memcpy((dst), (src), (n))
+#define memset(dst, c, n) __builtin_memset((dst), (c), (n))
+
+#endif
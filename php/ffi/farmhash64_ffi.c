@@ -0,0 +1,71 @@
+// PHP farmhash64 FFI Library
+//
+// Shared library exposing the header-only C implementation to the PHP FFI extension (ext-ffi).
+// Build it with "make ffi" and load it with Com\Tecnick\FarmHash64\FarmHash64::create().
+//
+// The batch functions take all the keys concatenated in a single buffer and their lengths
+// packed as little-endian 64-bit integers, so a PHP array can be hashed with a single FFI call.
+//
+// @category   Libraries
+// @author     Nicola Asuni <nicola.asuni@tecnick.com>
+// @license    MIT (see LICENSE)
+// @link       https://github.com/tecnickcom/farmhash64
+
+#include "../../c/src/farmhash64.h"
+
+#if defined(_WIN32)
+#define FARMHASH64_FFI_API __declspec(dllexport)
+#else
+#define FARMHASH64_FFI_API __attribute__((visibility("default")))
+#endif
+
+FARMHASH64_FFI_API uint64_t farmhash64_ffi_hash64(const char *s, size_t len)
+{
+    return farmhash64(s, len);
+}
+
+FARMHASH64_FFI_API uint32_t farmhash64_ffi_hash32(const char *s, size_t len)
+{
+    return farmhash32(s, len);
+}
+
+// Reads the length of the i-th key from the packed lengths buffer (unaligned, little-endian).
+static inline size_t batch_len(const char *lens, size_t i)
+{
+    return (size_t)fetch64(lens + (i * 8));
+}
+
+// Stores the n lower bytes of v in little-endian order.
+static inline void store_le(uint8_t *out, uint64_t v, int n)
+{
+    int i;
+    for (i = 0; i < n; i++)
+    {
+        out[i] = (uint8_t)(v >> (i * 8));
+    }
+}
+
+// Hashes n keys concatenated in data, with lengths packed in lens (pack('P*', ...) in PHP),
+// and writes the 64-bit hashes to out as little-endian 64-bit integers.
+FARMHASH64_FFI_API void farmhash64_ffi_batch64(const char *data, const char *lens, size_t n, uint8_t *out)
+{
+    size_t i;
+    for (i = 0; i < n; i++)
+    {
+        size_t len = batch_len(lens, i);
+        store_le(out + (i * 8), farmhash64(data, len), 8);
+        data += len;
+    }
+}
+
+// Same as farmhash64_ffi_batch64, but writes the 32-bit hashes as little-endian 32-bit integers.
+FARMHASH64_FFI_API void farmhash64_ffi_batch32(const char *data, const char *lens, size_t n, uint8_t *out)
+{
+    size_t i;
+    for (i = 0; i < n; i++)
+    {
+        size_t len = batch_len(lens, i);
+        store_le(out + (i * 4), farmhash32(data, len), 4);
+        data += len;
+    }
+}
@@ -27,6 +27,9 @@ declare(strict_types=1);
  *       The function farmhash64Hex is provided to calculate the 64-bit hash value from a string
  *       and return it as a fixed-length hexadecimal string.
  *
+ * Use FarmHash64::create() to get the FFI backend (FarmHash64FFI), which calls the compiled C library,
+ * when the FFI extension is available. This class is the pure PHP fallback and returns identical values.
+ *
  * @category   Libraries
  * @license    see LICENSE file
  * @link       https://github.com/tecnickcom/farmhash64
@@ -66,6 +69,20 @@ class FarmHash64
     private const C1 = 0xcc9e_2d51;
     private const C2 = 0x1b87_3593;
 
+    /**
+     * Returns the fastest available implementation:
+     * FarmHash64FFI when the FFI extension and the compiled library are available,
+     * otherwise this pure PHP implementation. Both return identical values.
+     *
+     * @param ?string $lib Optional path of the compiled library (see FarmHash64FFI::load).
+     *
+     * @return FarmHash64 The hashing object.
+     */
+    public static function create(?string $lib = null): self
+    {
+        return FarmHash64FFI::load($lib) ?? new self();
+    }
+
     /**
      * @param Uint64S32 $a
      * @param Uint64S32 $b
@@ -685,6 +702,38 @@ class FarmHash64
         return $this->mix64To32($this->farmhash64($s));
     }
 
+    /**
+     * Calculates the 64-bit FarmHash hash values for an array of strings.
+     *
+     * @param array<array-key, string> $keys The input strings to calculate the hash values for.
+     *
+     * @return array<array-key, Uint64S32> The 64-bit hash values, with the same keys as the input array.
+     */
+    public function farmhash64Batch(array $keys): array
+    {
+        $ret = [];
+        foreach ($keys as $k => $s) {
+            $ret[$k] = $this->farmhash64($s);
+        }
+        return $ret;
+    }
+
+    /**
+     * Calculates the 32-bit FarmHash hash values for an array of strings.
+     *
+     * @param array<array-key, string> $keys The input strings to calculate the hash values for.
+     *
+     * @return array<array-key, int> The 32-bit hash values, with the same keys as the input array.
+     */
+    public function farmhash32Batch(array $keys): array
+    {
+        $ret = [];
+        foreach ($keys as $k => $s) {
+            $ret[$k] = $this->farmhash32($s);
+        }
+        return $ret;
+    }
+
     /**
      * Calculates the FarmHash64 hash value of a given string and returns it in hexadecimal format.
      *
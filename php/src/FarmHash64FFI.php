@@ -0,0 +1,192 @@
+<?php
+
+declare(strict_types=1);
+
+/** FarmHash64 PHP Library - FFI backend
+ *
+ * FarmHash64FFI.php
+ *
+ *
+ * FarmHash64 implementation calling the compiled C library (ffi/farmhash64_ffi.c, built with "make ffi")
+ * through the PHP FFI extension (ext-ffi), instead of emulating the unsigned 64-bit arithmetic in PHP.
+ * It returns the same values as the pure PHP FarmHash64 class.
+ *
+ * @category   Libraries
+ * @license    see LICENSE file
+ * @link       https://github.com/tecnickcom/farmhash64
+ */
+
+namespace Com\Tecnick\FarmHash64;
+
+use FFI;
+
+/**
+ * The FarmHash64FFI class computes the FarmHash64 and FarmHash32 hash values with the compiled C library.
+ *
+ * The batch methods hash a whole PHP array with a single FFI call:
+ * the keys are concatenated in one string and their lengths are packed in another.
+ *
+ * @package FarmHash64
+ *
+ * @phpstan-import-type Uint64S32 from FarmHash64
+ */
+class FarmHash64FFI extends FarmHash64
+{
+    /**
+     * Environment variable containing the path of the compiled library.
+     */
+    public const LIB_ENV = 'FARMHASH64_LIB';
+
+    private const CDEF = '
+        uint64_t farmhash64_ffi_hash64(const char *s, size_t len);
+        uint32_t farmhash64_ffi_hash32(const char *s, size_t len);
+        void farmhash64_ffi_batch64(const char *data, const char *lens, size_t n, uint8_t *out);
+        void farmhash64_ffi_batch32(const char *data, const char *lens, size_t n, uint8_t *out);
+    ';
+
+    private const MASK32 = 0xffff_ffff;
+
+    private FFI $ffi;
+
+    /**
+     * @param string $lib Path or name of the compiled library.
+     *
+     * @throws \FFI\Exception If the library cannot be loaded.
+     */
+    public function __construct(string $lib)
+    {
+        $this->ffi = FFI::cdef(self::CDEF, $lib);
+    }
+
+    /**
+     * Loads the compiled library.
+     * When no path is given, the library is searched in the path set by the FARMHASH64_LIB
+     * environment variable, then in the target/ffi directory of this package, then in the system library path.
+     *
+     * @param ?string $lib Optional path of the compiled library.
+     *
+     * @return ?FarmHash64FFI The hashing object, or null if the FFI extension or the library are not available.
+     */
+    public static function load(?string $lib = null): ?self
+    {
+        if (!extension_loaded('ffi')) {
+            return null;
+        }
+        foreach ($lib !== null ? [$lib] : self::defaultPaths() as $path) {
+            try {
+                return new self($path);
+            } catch (\Throwable) {
+                continue;
+            }
+        }
+        return null;
+    }
+
+    /**
+     * @return list<string>
+     */
+    private static function defaultPaths(): array
+    {
+        $name = match (PHP_OS_FAMILY) {
+            'Windows' => 'farmhash64.dll',
+            'Darwin' => 'libfarmhash64.dylib',
+            default => 'libfarmhash64.so',
+        };
+        $paths = [];
+        $env = getenv(self::LIB_ENV);
+        if (is_string($env) && $env !== '') {
+            $paths[] = $env;
+        }
+        $paths[] = __DIR__ . '/../target/ffi/' . $name;
+        $paths[] = $name;
+        return $paths;
+    }
+
+    /**
+     * Calculates the 64-bit FarmHash hash value for the given string.
+     *
+     * @param string &$s The input string to calculate the hash value for.
+     *
+     * @return Uint64S32 The 64-bit hash value split into two uint32 parts.
+     */
+    public function farmhash64(string &$s): array
+    {
+        /** @var int $h */
+        $h = $this->ffi->farmhash64_ffi_hash64($s, strlen($s));
+        return [
+            'hi' => ($h >> 32) & self::MASK32,
+            'lo' => $h & self::MASK32,
+        ];
+    }
+
+    /**
+     * Calculates the 32-bit FarmHash hash value for the given string.
+     *
+     * @param string &$s The input string to calculate the hash value for.
+     *
+     * @return int The 32-bit hash value.
+     */
+    public function farmhash32(string &$s): int
+    {
+        /** @var int */
+        return $this->ffi->farmhash64_ffi_hash32($s, strlen($s));
+    }
+
+    /**
+     * Calculates the 64-bit FarmHash hash values for an array of strings with a single FFI call.
+     *
+     * @param array<array-key, string> $keys The input strings to calculate the hash values for.
+     *
+     * @return array<array-key, Uint64S32> The 64-bit hash values, with the same keys as the input array.
+     */
+    public function farmhash64Batch(array $keys): array
+    {
+        // little-endian 32-bit words, starting at index 1: lo, hi, lo, hi, ...
+        $words = $this->batch('farmhash64_ffi_batch64', $keys, 8);
+        $ret = [];
+        $i = 1;
+        foreach (array_keys($keys) as $k) {
+            $ret[$k] = [
+                'hi' => $words[$i + 1],
+                'lo' => $words[$i],
+            ];
+            $i += 2;
+        }
+        return $ret;
+    }
+
+    /**
+     * Calculates the 32-bit FarmHash hash values for an array of strings with a single FFI call.
+     *
+     * @param array<array-key, string> $keys The input strings to calculate the hash values for.
+     *
+     * @return array<array-key, int> The 32-bit hash values, with the same keys as the input array.
+     */
+    public function farmhash32Batch(array $keys): array
+    {
+        $words = $this->batch('farmhash64_ffi_batch32', $keys, 4);
+        return array_combine(array_keys($keys), array_values($words));
+    }
+
+    /**
+     * Calls a batch function of the library and returns its output as unsigned 32-bit words.
+     *
+     * @param string $fn Name of the library batch function.
+     * @param array<array-key, string> $keys The input strings.
+     * @param int $size Size in bytes of each output hash.
+     *
+     * @return array<int, int> The output words, indexed from 1.
+     */
+    private function batch(string $fn, array $keys, int $size): array
+    {
+        $num = count($keys);
+        if ($num === 0) {
+            return [];
+        }
+        $keys = array_values($keys);
+        $out = $this->ffi->new('uint8_t[' . ($num * $size) . ']');
+        $this->ffi->$fn(implode('', $keys), pack('P*', ...array_map('strlen', $keys)), $num, $out);
+        /** @var array<int, int> */
+        return unpack('V*', FFI::string($out, $num * $size));
+    }
+}
@@ -0,0 +1,49 @@
+<?php
+
+declare(strict_types=1);
+
+namespace Test;
+
+use Com\Tecnick\FarmHash64\FarmHash64;
+use Com\Tecnick\FarmHash64\FarmHash64FFI;
+
+/**
+ * Runs all the FarmHash64 tests against the FFI backend.
+ * The tests are skipped when the FFI extension or the compiled library ("make ffi") are not available.
+ */
+class FarmHash64FFITest extends FarmHash64Test
+{
+    protected function getTestObject(): FarmHash64
+    {
+        $obj = FarmHash64FFI::load();
+        if ($obj === null) {
+            static::markTestSkipped('FFI extension or compiled library not available');
+        }
+        return $obj;
+    }
+
+    public function testCreate(): void
+    {
+        $obj = FarmHash64::create();
+        if (FarmHash64FFI::load() !== null) {
+            static::assertInstanceOf(FarmHash64FFI::class, $obj);
+        }
+        static::assertInstanceOf(FarmHash64::class, FarmHash64::create('/nonexistent/libfarmhash64.so'));
+        static::assertNotInstanceOf(FarmHash64FFI::class, FarmHash64::create('/nonexistent/libfarmhash64.so'));
+    }
+
+    public function testSameAsPurePHP(): void
+    {
+        $ffi = $this->getTestObject();
+        $php = new FarmHash64();
+        $keys = [];
+        $data = '';
+        for ($i = 0; $i < 300; $i++) {
+            $data .= chr(($i * 31 + ($i >> 3)) & 0xff);
+            $keys['k' . $i] = $data;
+        }
+        static::assertSame($php->farmhash64Batch($keys), $ffi->farmhash64Batch($keys));
+        static::assertSame($php->farmhash32Batch($keys), $ffi->farmhash32Batch($keys));
+        static::assertSame([], $ffi->farmhash64Batch([]));
+    }
+}
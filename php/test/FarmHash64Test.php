@@ -452,4 +452,28 @@ class FarmHash64Test extends TestCase
             static::assertEquals($data[2], $h);
         }
     }
+
+    public function testFarmhash64Batch(): void
+    {
+        $keys = [];
+        foreach (self::TEST_DATA as $i => $data) {
+            $keys['key' . $i] = $data[3];
+        }
+        $hashes = $this->getTestObject()->farmhash64Batch($keys);
+        static::assertCount(count($keys), $hashes);
+        foreach (self::TEST_DATA as $i => $data) {
+            static::assertEquals($data[1]['hi'], $hashes['key' . $i]['hi']);
+            static::assertEquals($data[1]['lo'], $hashes['key' . $i]['lo']);
+        }
+    }
+
+    public function testFarmhash32Batch(): void
+    {
+        $keys = array_column(self::TEST_DATA, 3);
+        $hashes = $this->getTestObject()->farmhash32Batch($keys);
+        static::assertSame(array_keys($keys), array_keys($hashes));
+        foreach (self::TEST_DATA as $i => $data) {
+            static::assertEquals($data[0], $hashes[$i]);
+        }
+    }
 }
@@ -21,25 +21,23 @@
 
 static PyObject* py_farmhash64(PyObject *Py_UNUSED(ignored), PyObject *args, PyObject *keywds)
 {
-    const char *s;
-    Py_ssize_t len;
+    Py_buffer s;
     static char *kwlist[] = {"s", NULL};
-    if (!PyArg_ParseTupleAndKeywords(args, keywds, "y", kwlist, &s))
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "y*", kwlist, &s))
         return NULL;
-    len = strlen(s);
-    uint64_t h = farmhash64(s, len);
+    uint64_t h = farmhash64((const char *)s.buf, (size_t)s.len);
+    PyBuffer_Release(&s);
     return Py_BuildValue("K", h);
 }
 
 static PyObject* py_farmhash32(PyObject *Py_UNUSED(ignored), PyObject *args, PyObject *keywds)
 {
-    const char *s;
-    Py_ssize_t len;
+    Py_buffer s;
     static char *kwlist[] = {"s", NULL};
-    if (!PyArg_ParseTupleAndKeywords(args, keywds, "y", kwlist, &s))
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "y*", kwlist, &s))
         return NULL;
-    len = strlen(s);
-    uint32_t h = farmhash32(s, len);
+    uint32_t h = farmhash32((const char *)s.buf, (size_t)s.len);
+    PyBuffer_Release(&s);
     return Py_BuildValue("I", h);
 }
 
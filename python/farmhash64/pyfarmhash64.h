@@ -18,8 +18,8 @@ PyMODINIT_FUNC initfarmhash64(void);
 "\n"\
 "Parameters\n"\
 "----------\n"\
-"s : bytes\n"\
-"    String to process.\n"\
+"s : bytes-like object (bytes, bytearray, memoryview)\n"\
+"    Bytes to process, including any NUL byte.\n"\
 "\n"\
 "Returns\n"\
 "-------\n"\
@@ -36,8 +36,8 @@ PyMODINIT_FUNC initfarmhash64(void);
 "\n"\
 "Parameters\n"\
 "----------\n"\
-"s : bytes\n"\
-"    String to process.\n"\
+"s : bytes-like object (bytes, bytearray, memoryview)\n"\
+"    Bytes to process, including any NUL byte.\n"\
 "\n"\
 "Returns\n"\
 "-------\n"\
@@ -0,0 +1,80 @@
+"""Cross-language benchmark for the farmhash64 module.
+
+Hashes the data_setup() corpus of the C tests over fixed size classes
+and prints the results in the farmhash64-bench/1 JSON format shared by all the language ports.
+Slices are passed as memoryview objects, so the input is never copied.
+Heap allocations are not measurable from Python and are reported as null.
+"""
+
+import json
+import time
+
+import farmhash64 as fh
+
+DATA_SIZE = 1 << 20
+SIZES = [8, 16, 32, 64, 128, 256, 1024, 4096, 65536, 1048576]
+MASK64 = 0xFFFFFFFFFFFFFFFF
+
+
+def data_setup():
+    """Same pseudorandom generator as data_setup() in c/test/test_farmhash64.c."""
+    kt = 0xC3A5C85C97CB3127
+    a = 9
+    b = 777
+    data = bytearray(DATA_SIZE)
+    for i in range(DATA_SIZE):
+        a = (a + b) & MASK64
+        b = (b + a) & MASK64
+        a = ((a ^ (a >> 41)) * kt) & MASK64
+        b = (((b ^ (b >> 41)) * kt) + i) & MASK64
+        data[i] = (b >> 37) & 0xFF
+    return bytes(data)
+
+
+def bench_iterations(size):
+    return max(64, (1 << 26) // size)
+
+
+def bench_run(slices, iterations):
+    farmhash64 = fh.farmhash64
+    nslices = len(slices)
+    checksum = 0
+    for i in range(iterations):
+        checksum += farmhash64(slices[i % nslices])
+    return checksum & MASK64
+
+
+def main():
+    data = memoryview(data_setup())
+    results = []
+    for size in SIZES:
+        iterations = bench_iterations(size)
+        # the slice offsets follow the same pattern as the other ports: (i & 63) << 6
+        if size <= DATA_SIZE // 2:
+            slices = [data[(i << 6) : (i << 6) + size] for i in range(64)]
+        else:
+            slices = [data[:size]]
+        bench_run(slices, iterations // 8)
+        start = time.perf_counter_ns()
+        checksum = bench_run(slices, iterations)
+        ns = (time.perf_counter_ns() - start) / iterations
+        results.append(
+            {
+                "size": size,
+                "iterations": iterations,
+                "ns_per_hash": round(ns, 3),
+                "gb_per_s": round(size / ns, 3),
+                "allocs_per_hash": None,
+                "alloc_bytes_per_hash": None,
+                "checksum": "%016x" % checksum,
+            }
+        )
+    print(
+        '{"schema":"farmhash64-bench/1","lang":"python","impl":"pyfarmhash64","results":['
+    )
+    print(",\n".join(json.dumps(r, separators=(",", ":")) for r in results))
+    print("]}")
+
+
+if __name__ == "__main__":
+    main()
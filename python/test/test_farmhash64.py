@@ -125,6 +125,17 @@ class TestFunctions(TestCase):
             h = fh.farmhash32(test_input.encode("unicode_escape"))
             self.assertEqual(h, expected32)
 
+    def test_farmhash64_binary(self):
+        # embedded NUL bytes are part of the input
+        self.assertNotEqual(fh.farmhash64(b"a\x00b"), fh.farmhash64(b"a"))
+        self.assertNotEqual(fh.farmhash32(b"a\x00b"), fh.farmhash32(b"a"))
+        self.assertEqual(fh.farmhash64(b"\x00"), 0xBE6056EDF5E94B54)
+        # any contiguous bytes-like object is hashed without copying
+        data = b"0123456789^0123456789"
+        self.assertEqual(fh.farmhash64(memoryview(b"xx" + data)[2:]), 0xDEBCBA8E6F3EABD1)
+        self.assertEqual(fh.farmhash64(bytearray(data)), 0xDEBCBA8E6F3EABD1)
+        self.assertEqual(fh.farmhash32(memoryview(data)), 0xA329652E)
+
 
 class TestBenchmark(object):
     def test_farmhash64_benchmark(self, benchmark):
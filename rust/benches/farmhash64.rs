@@ -0,0 +1,66 @@
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use farmhash64::*;
+use std::hash::Hasher;
+
+const SIZES: [usize; 10] = [4, 8, 16, 32, 64, 128, 256, 1024, 4096, 65536];
+
+fn bench_data(size: usize) -> Vec<u8> {
+    (0..size).map(|i| (i * 31 + (i >> 8)) as u8).collect()
+}
+
+fn bench_farmhash64(c: &mut Criterion) {
+    let mut group = c.benchmark_group("farmhash64");
+
+    for size in SIZES {
+        let data = bench_data(size);
+        group.throughput(Throughput::Bytes(size as u64));
+        group.bench_with_input(BenchmarkId::from_parameter(size), &data, |b, data| {
+            b.iter(|| farmhash64(black_box(data)))
+        });
+    }
+
+    group.finish();
+}
+
+fn bench_farmhasher(c: &mut Criterion) {
+    let mut group = c.benchmark_group("farmhasher");
+
+    for size in SIZES {
+        let data = bench_data(size);
+        group.throughput(Throughput::Bytes(size as u64));
+        // the input is written in 16-byte pieces to exercise the streaming buffer
+        group.bench_with_input(BenchmarkId::from_parameter(size), &data, |b, data| {
+            b.iter(|| {
+                let mut hasher = FarmHasher::new();
+                for chunk in black_box(data).chunks(16) {
+                    hasher.write(chunk);
+                }
+                hasher.finish()
+            })
+        });
+    }
+
+    group.finish();
+}
+
+fn bench_farmhash64_batch(c: &mut Criterion) {
+    let mut group = c.benchmark_group("farmhash64_batch");
+    let data = bench_data(1024 * 16);
+    let keys: Vec<&[u8]> = data.chunks_exact(16).collect();
+    let mut out = vec![0u64; keys.len()];
+
+    group.throughput(Throughput::Elements(keys.len() as u64));
+    group.bench_function("1024x16", |b| {
+        b.iter(|| farmhash64_batch(black_box(&keys), &mut out))
+    });
+
+    group.finish();
+}
+
+criterion_group!(
+    benches,
+    bench_farmhash64,
+    bench_farmhasher,
+    bench_farmhash64_batch
+);
+criterion_main!(benches);
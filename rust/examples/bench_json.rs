@@ -0,0 +1,102 @@
+// Cross-language benchmark (see the "Benchmarks" section of the main README.md).
+// Hashes the data_setup() corpus of the C tests over fixed size classes and prints
+// the results in the farmhash64-bench/1 JSON format shared by all the language ports.
+//
+// Run with: cargo run --release --example bench_json
+
+use farmhash64::farmhash64;
+use std::alloc::{GlobalAlloc, Layout, System};
+use std::hint::black_box;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::time::Instant;
+
+const DATA_SIZE: usize = 1 << 20;
+const SIZES: [usize; 10] = [8, 16, 32, 64, 128, 256, 1024, 4096, 65536, 1048576];
+
+// Global allocator counting the heap allocations made while hashing.
+struct CountingAlloc;
+
+static ALLOCS: AtomicU64 = AtomicU64::new(0);
+static ALLOC_BYTES: AtomicU64 = AtomicU64::new(0);
+
+unsafe impl GlobalAlloc for CountingAlloc {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        ALLOCS.fetch_add(1, Ordering::Relaxed);
+        ALLOC_BYTES.fetch_add(layout.size() as u64, Ordering::Relaxed);
+        System.alloc(layout)
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        System.dealloc(ptr, layout)
+    }
+}
+
+#[global_allocator]
+static GLOBAL: CountingAlloc = CountingAlloc;
+
+// Same pseudorandom generator as data_setup() in c/test/test_farmhash64.c.
+fn data_setup() -> Vec<u8> {
+    const KT: u64 = 0xc3a5c85c97cb3127;
+    let mut a: u64 = 9;
+    let mut b: u64 = 777;
+    (0..DATA_SIZE)
+        .map(|i| {
+            a = a.wrapping_add(b);
+            b = b.wrapping_add(a);
+            a = (a ^ (a >> 41)).wrapping_mul(KT);
+            b = (b ^ (b >> 41)).wrapping_mul(KT).wrapping_add(i as u64);
+            (b >> 37) as u8
+        })
+        .collect()
+}
+
+fn bench_iterations(size: usize) -> u64 {
+    ((1u64 << 26) / size as u64).max(64)
+}
+
+fn bench_offset(i: u64, size: usize) -> usize {
+    if size <= DATA_SIZE / 2 {
+        ((i & 63) << 6) as usize
+    } else {
+        0
+    }
+}
+
+fn bench_run(data: &[u8], size: usize, iterations: u64) -> u64 {
+    let mut checksum: u64 = 0;
+    for i in 0..iterations {
+        let off = bench_offset(i, size);
+        checksum = checksum.wrapping_add(farmhash64(black_box(&data[off..off + size])));
+    }
+    checksum
+}
+
+fn main() {
+    let data = data_setup();
+    let mut rows = Vec::with_capacity(SIZES.len());
+    for size in SIZES {
+        let iterations = bench_iterations(size);
+        black_box(bench_run(&data, size, iterations / 8));
+        let allocs = ALLOCS.load(Ordering::Relaxed);
+        let alloc_bytes = ALLOC_BYTES.load(Ordering::Relaxed);
+        let start = Instant::now();
+        let checksum = bench_run(&data, size, iterations);
+        let elapsed = start.elapsed().as_nanos() as f64;
+        let allocs = ALLOCS.load(Ordering::Relaxed) - allocs;
+        let alloc_bytes = ALLOC_BYTES.load(Ordering::Relaxed) - alloc_bytes;
+        let ns = elapsed / iterations as f64;
+        rows.push(format!(
+            "{{\"size\":{},\"iterations\":{},\"ns_per_hash\":{:.3},\"gb_per_s\":{:.3},\"allocs_per_hash\":{},\"alloc_bytes_per_hash\":{},\"checksum\":\"{:016x}\"}}",
+            size,
+            iterations,
+            ns,
+            size as f64 / ns,
+            allocs as f64 / iterations as f64,
+            alloc_bytes as f64 / iterations as f64,
+            checksum
+        ));
+    }
+    println!("{{\"schema\":\"farmhash64-bench/1\",\"lang\":\"rust\",\"impl\":\"farmhash64\",\"results\":[");
+    println!("{}", rows.join(",\n"));
+    println!("]}}");
+}
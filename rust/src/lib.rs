@@ -14,6 +14,10 @@ This is a Rust port of the Fingerprint64 (farmhashna::Hash64) code from Google's
 This code has been ported/translated by Nicola Asuni (Tecnick.com) to Rust code.
 */
 
+#![no_std]
+
+use core::hash::{BuildHasher, Hasher};
+
 // BASICS
 
 // Some primes between 2^63 and 2^64 for various uses.
@@ -25,11 +29,6 @@ const K2: u64 = 0x9ae16a3b2f90404f;
 const C1: u32 = 0xcc9e2d51;
 const C2: u32 = 0x1b873593;
 
-struct Uint128 {
-    hi: u64,
-    lo: u64,
-}
-
 // PLATFORM
 
 #[inline]
@@ -42,24 +41,18 @@ fn rotate64(val: u64, shift: u32) -> u64 {
     val.rotate_right(shift)
 }
 
-#[inline]
+// Single unaligned little-endian loads. The callers either pass fixed-size
+// blocks or have already checked the length, so the bounds checks fold away.
+#[inline(always)]
 fn fetch32(s: &[u8], idx: usize) -> u64 {
-    u64::from(s[idx + 0])
-        | (u64::from(s[idx + 1]) << 8)
-        | (u64::from(s[idx + 2]) << 16)
-        | (u64::from(s[idx + 3]) << 24)
+    let (word, _) = s[idx..].split_first_chunk::<4>().unwrap();
+    u64::from(u32::from_le_bytes(*word))
 }
 
-#[inline]
+#[inline(always)]
 fn fetch64(s: &[u8], idx: usize) -> u64 {
-    u64::from(s[idx + 0])
-        | (u64::from(s[idx + 1]) << 8)
-        | (u64::from(s[idx + 2]) << 16)
-        | (u64::from(s[idx + 3]) << 24)
-        | (u64::from(s[idx + 4]) << 32)
-        | (u64::from(s[idx + 5]) << 40)
-        | (u64::from(s[idx + 6]) << 48)
-        | (u64::from(s[idx + 7]) << 56)
+    let (word, _) = s[idx..].split_first_chunk::<8>().unwrap();
+    u64::from_le_bytes(*word)
 }
 
 // FARMHASH NA
@@ -191,8 +184,9 @@ fn hash_len_33_to_64(s: &[u8]) -> u64 {
 
 // Return a 16-byte hash for 48 bytes.  Quick and dirty.
 // Callers do best to use "random-looking" values for a and b.
-#[inline]
-fn weak_hash_len_32_with_seeds_words(w: u64, x: u64, y: u64, z: u64, a: u64, b: u64) -> Uint128 {
+// The result is returned as (lo, hi).
+#[inline(always)]
+fn weak_hash_len_32_with_seeds_words(w: u64, x: u64, y: u64, z: u64, a: u64, b: u64) -> (u64, u64) {
     let a = a.wrapping_add(w);
     let b = rotate64(b.wrapping_add(a).wrapping_add(z), 21);
     let c = a;
@@ -200,15 +194,12 @@ fn weak_hash_len_32_with_seeds_words(w: u64, x: u64, y: u64, z: u64, a: u64, b:
     let a = a.wrapping_add(y);
     let b = b.wrapping_add(rotate64(a, 44));
 
-    Uint128 {
-        hi: b.wrapping_add(c),
-        lo: a.wrapping_add(z),
-    }
+    (a.wrapping_add(z), b.wrapping_add(c))
 }
 
 // Return a 16-byte hash for s[0] ... s[31], a, and b.  Quick and dirty.
-#[inline]
-fn weak_hash_len_32_with_seeds(s: &[u8], a: u64, b: u64) -> Uint128 {
+#[inline(always)]
+fn weak_hash_len_32_with_seeds(s: &[u8; 32], a: u64, b: u64) -> (u64, u64) {
     weak_hash_len_32_with_seeds_words(
         fetch64(s, 0),
         fetch64(s, 8),
@@ -219,9 +210,120 @@ fn weak_hash_len_32_with_seeds(s: &[u8], a: u64, b: u64) -> Uint128 {
     )
 }
 
+#[inline(always)]
+fn split_block(s: &[u8; 64]) -> (&[u8; 32], &[u8; 32]) {
+    let (lo, hi) = s.split_at(32);
+    (lo.try_into().unwrap(), hi.try_into().unwrap())
+}
+
+// Internal state of the loop over strings longer than 64 bytes: v, w, x, y and z.
+// It is shared by the one-shot function and the streaming Hasher.
+#[derive(Clone, Copy, Debug)]
+struct NaState {
+    v: (u64, u64),
+    w: (u64, u64),
+    x: u64,
+    y: u64,
+    z: u64,
+}
+
+impl NaState {
+    #[inline(always)]
+    fn new(first64: u64) -> Self {
+        let seed: u64 = 81;
+        let y = (seed.wrapping_mul(K1)).wrapping_add(113);
+
+        NaState {
+            v: (0, 0),
+            w: (0, 0),
+            x: (seed.wrapping_mul(K2)).wrapping_add(first64),
+            y,
+            z: (shift_mix((y.wrapping_mul(K2)).wrapping_add(113))).wrapping_mul(K2),
+        }
+    }
+
+    // Mix one 64-byte block that is not the last one.
+    #[inline(always)]
+    fn block(&mut self, s: &[u8; 64]) {
+        let (s0, s32) = split_block(s);
+        let NaState {
+            mut v,
+            mut w,
+            mut x,
+            mut y,
+            mut z,
+        } = *self;
+
+        x = (rotate64(
+            x.wrapping_add(y)
+                .wrapping_add(v.0)
+                .wrapping_add(fetch64(s, 8)),
+            37,
+        ))
+        .wrapping_mul(K1);
+        y = (rotate64(y.wrapping_add(v.1).wrapping_add(fetch64(s, 48)), 42)).wrapping_mul(K1);
+        x ^= w.1;
+        y = y.wrapping_add(v.0).wrapping_add(fetch64(s, 40));
+        z = (rotate64(z.wrapping_add(w.0), 33)).wrapping_mul(K1);
+        v = weak_hash_len_32_with_seeds(s0, v.1.wrapping_mul(K1), x.wrapping_add(w.0));
+        w = weak_hash_len_32_with_seeds(s32, z.wrapping_add(w.1), y.wrapping_add(fetch64(s, 16)));
+
+        // x and z are swapped
+        *self = NaState {
+            v,
+            w,
+            x: z,
+            y,
+            z: x,
+        };
+    }
+
+    // Mix the last 64 bytes of the input (which may overlap the last block) and return the hash.
+    #[inline(always)]
+    fn finish(self, s: &[u8; 64], slen: u64) -> u64 {
+        let (s0, s32) = split_block(s);
+        let NaState {
+            mut v,
+            mut w,
+            mut x,
+            mut y,
+            mut z,
+        } = self;
+
+        let mul = K1.wrapping_add((z & 0xff) << 1);
+        w.0 = w.0.wrapping_add(slen.wrapping_sub(1) & 63);
+        v.0 = v.0.wrapping_add(w.0);
+        w.0 = w.0.wrapping_add(v.0);
+        x = (rotate64(
+            x.wrapping_add(y)
+                .wrapping_add(v.0)
+                .wrapping_add(fetch64(s, 8)),
+            37,
+        ))
+        .wrapping_mul(mul);
+        y = (rotate64(y.wrapping_add(v.1).wrapping_add(fetch64(s, 48)), 42)).wrapping_mul(mul);
+        x ^= w.1.wrapping_mul(9);
+        y = y
+            .wrapping_add(v.0.wrapping_mul(9))
+            .wrapping_add(fetch64(s, 40));
+        z = (rotate64(z.wrapping_add(w.0), 33)).wrapping_mul(mul);
+        v = weak_hash_len_32_with_seeds(s0, v.1.wrapping_mul(mul), x.wrapping_add(w.0));
+        w = weak_hash_len_32_with_seeds(s32, z.wrapping_add(w.1), y.wrapping_add(fetch64(s, 16)));
+
+        // x and z are swapped
+        hash_len_16_mul(
+            hash_len_16_mul(v.0, w.0, mul)
+                .wrapping_add(shift_mix(y).wrapping_mul(K0))
+                .wrapping_add(x),
+            hash_len_16_mul(v.1, w.1, mul).wrapping_add(z),
+            mul,
+        )
+    }
+}
+
 // FarmHash64 returns a 64-bit fingerprint hash for a string.
 #[inline]
-pub fn farmhash64(mut s: &[u8]) -> u64 {
+pub fn farmhash64(s: &[u8]) -> u64 {
     let slen = s.len();
 
     if slen <= 32 {
@@ -236,77 +338,19 @@ pub fn farmhash64(mut s: &[u8]) -> u64 {
         return hash_len_33_to_64(s);
     }
 
-    let seed: u64 = 81;
-
     // For strings over 64 bytes we loop.
-    // Internal state consists of 56 bytes: v, w, x, y, and z.
-    let mut v = Uint128 { hi: 0, lo: 0 };
-    let mut w = Uint128 { hi: 0, lo: 0 };
-    let mut x = (seed.wrapping_mul(K2)).wrapping_add(fetch64(s, 0));
-    let mut y = (seed.wrapping_mul(K1)).wrapping_add(113);
-    let mut z = (shift_mix((y.wrapping_mul(K2)).wrapping_add(113))).wrapping_mul(K2);
-
     // Set end so that after the loop we have 1 to 64 bytes left to process.
+    let mut state = NaState::new(fetch64(s, 0));
     let end_idx = ((slen - 1) >> 6) << 6;
-    let last64_idx = end_idx + ((slen - 1) & 63) - 63;
-    let last64 = &s[last64_idx..];
 
-    while s.len() > 64 {
-        x = (rotate64(
-            x.wrapping_add(y)
-                .wrapping_add(v.lo)
-                .wrapping_add(fetch64(s, 8)),
-            37,
-        ))
-        .wrapping_mul(K1);
-        y = (rotate64(y.wrapping_add(v.hi).wrapping_add(fetch64(s, 48)), 42)).wrapping_mul(K1);
-        x ^= w.hi;
-        y = y.wrapping_add(v.lo).wrapping_add(fetch64(s, 40));
-        z = (rotate64(z.wrapping_add(w.lo), 33)).wrapping_mul(K1);
-        v = weak_hash_len_32_with_seeds(s, v.hi.wrapping_mul(K1), x.wrapping_add(w.lo));
-        w = weak_hash_len_32_with_seeds(
-            &s[32..],
-            z.wrapping_add(w.hi),
-            y.wrapping_add(fetch64(s, 16)),
-        );
-        std::mem::swap(&mut x, &mut z);
-        s = &s[64..];
+    for block in s[..end_idx].chunks_exact(64) {
+        state.block(block.try_into().unwrap());
     }
 
-    let mul = K1.wrapping_add((z & 0xff) << 1);
-    // Make s point to the last 64 bytes of input.
-    s = last64;
-    w.lo = w.lo.wrapping_add((slen - 1) as u64 & 63);
-    v.lo = v.lo.wrapping_add(w.lo);
-    w.lo = w.lo.wrapping_add(v.lo);
-    x = (rotate64(
-        x.wrapping_add(y)
-            .wrapping_add(v.lo)
-            .wrapping_add(fetch64(s, 8)),
-        37,
-    ))
-    .wrapping_mul(mul);
-    y = (rotate64(y.wrapping_add(v.hi).wrapping_add(fetch64(s, 48)), 42)).wrapping_mul(mul);
-    x ^= w.hi.wrapping_mul(9);
-    y = y
-        .wrapping_add(v.lo.wrapping_mul(9))
-        .wrapping_add(fetch64(s, 40));
-    z = (rotate64(z.wrapping_add(w.lo), 33)).wrapping_mul(mul);
-    v = weak_hash_len_32_with_seeds(s, v.hi.wrapping_mul(mul), x.wrapping_add(w.lo));
-    w = weak_hash_len_32_with_seeds(
-        &s[32..],
-        z.wrapping_add(w.hi),
-        y.wrapping_add(fetch64(s, 16)),
-    );
-    std::mem::swap(&mut x, &mut z);
+    // The last 64 bytes of input.
+    let (_, last64) = s.split_last_chunk::<64>().unwrap();
 
-    return hash_len_16_mul(
-        hash_len_16_mul(v.lo, w.lo, mul)
-            .wrapping_add(shift_mix(y).wrapping_mul(K0))
-            .wrapping_add(z),
-        hash_len_16_mul(v.hi, w.hi, mul).wrapping_add(x),
-        mul,
-    );
+    state.finish(last64, slen as u64)
 }
 
 // FarmHash32 returns a 32-bit fingerprint hash for a string.
@@ -315,3 +359,128 @@ pub fn farmhash64(mut s: &[u8]) -> u64 {
 pub fn farmhash32(s: &[u8]) -> u32 {
     mix_64_to_32(farmhash64(s))
 }
+
+// farmhash64_batch stores the 64-bit fingerprint hash of keys[i] in out[i].
+// Panics if out is shorter than keys.
+#[inline]
+pub fn farmhash64_batch<K: AsRef<[u8]>>(keys: &[K], out: &mut [u64]) {
+    let out = &mut out[..keys.len()];
+
+    for (h, k) in out.iter_mut().zip(keys) {
+        *h = farmhash64(k.as_ref());
+    }
+}
+
+/// Streaming FarmHash64.
+///
+/// The result of `finish` is equal to `farmhash64` of the concatenation of
+/// all the bytes written so far, regardless of how they were split across
+/// `write` calls. The state keeps the last mixed 64-byte block, because the
+/// final step rereads the last 64 bytes of the input, plus up to 64 pending
+/// bytes that are only mixed once more input arrives.
+///
+/// Note that `Hash` implementations write extra bytes (e.g. a `0xff`
+/// terminator for `str`), so `HashMap` keys do not hash to `farmhash64` of
+/// their raw bytes.
+#[derive(Clone, Debug)]
+pub struct FarmHasher {
+    buf: [u8; 128], // [..64]: last mixed block, [64..64 + pending]: pending bytes
+    pending: usize,
+    len: u64,
+    state: Option<NaState>, // set when the first block is mixed
+}
+
+impl Default for FarmHasher {
+    #[inline]
+    fn default() -> Self {
+        FarmHasher::new()
+    }
+}
+
+impl FarmHasher {
+    #[inline]
+    pub fn new() -> Self {
+        FarmHasher {
+            buf: [0; 128],
+            pending: 0,
+            len: 0,
+            state: None,
+        }
+    }
+
+    #[inline(always)]
+    fn mix(state: &mut Option<NaState>, block: &[u8; 64]) {
+        state
+            .get_or_insert_with(|| NaState::new(fetch64(block, 0)))
+            .block(block);
+    }
+
+    #[inline]
+    fn write_bytes(&mut self, mut bytes: &[u8]) {
+        self.len = self.len.wrapping_add(bytes.len() as u64);
+
+        loop {
+            let room = 64 - self.pending;
+
+            if bytes.len() <= room {
+                self.buf[64 + self.pending..64 + self.pending + bytes.len()].copy_from_slice(bytes);
+                self.pending += bytes.len();
+                return;
+            }
+
+            // The pending block is completed and more input follows, so it can be mixed.
+            let (head, tail) = bytes.split_at(room);
+            self.buf[64 + self.pending..].copy_from_slice(head);
+            bytes = tail;
+            let (_, block) = self.buf.split_last_chunk::<64>().unwrap();
+            Self::mix(&mut self.state, block);
+            self.buf.copy_within(64.., 0);
+            self.pending = 0;
+
+            // Mix whole blocks in place, keeping 1 to 64 bytes for the pending block.
+            if bytes.len() > 64 {
+                let end = ((bytes.len() - 1) >> 6) << 6;
+                let (blocks, rest) = bytes.split_at(end);
+                for block in blocks.chunks_exact(64) {
+                    Self::mix(&mut self.state, block.try_into().unwrap());
+                }
+                self.buf[..64].copy_from_slice(&blocks[end - 64..]);
+                bytes = rest;
+            }
+        }
+    }
+}
+
+impl Hasher for FarmHasher {
+    #[inline]
+    fn write(&mut self, bytes: &[u8]) {
+        self.write_bytes(bytes);
+    }
+
+    #[inline]
+    fn finish(&self) -> u64 {
+        if self.len <= 64 {
+            return farmhash64(&self.buf[64..64 + self.pending]);
+        }
+
+        // More than 64 bytes were written, so at least one block has been mixed.
+        let last64: &[u8; 64] = self.buf[self.pending..self.pending + 64]
+            .try_into()
+            .unwrap();
+        self.state.unwrap().finish(last64, self.len)
+    }
+}
+
+/// `BuildHasher` producing `FarmHasher` instances, e.g. for
+/// `HashMap::with_hasher(FarmHashBuilder)`.
+#[derive(Clone, Copy, Debug, Default)]
+pub struct FarmHashBuilder;
+
+impl BuildHasher for FarmHashBuilder {
+    type Hasher = FarmHasher;
+
+    #[inline]
+    fn build_hasher(&self) -> FarmHasher {
+        FarmHasher::new()
+    }
+}
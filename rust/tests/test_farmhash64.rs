@@ -1,6 +1,8 @@
 #[cfg(test)]
 mod tests {
     use farmhash64::*;
+    use std::collections::HashMap;
+    use std::hash::{BuildHasher, Hasher};
 
     const TEST_SIZE: usize = 300;
     const DATA_SIZE: usize = 1048576; // 1 << 20
@@ -262,4 +264,86 @@ mod tests {
             );
         }
     }
+
+    #[test]
+    fn test_farmhasher_strings() {
+        let htd = hash_test_data();
+
+        for tt in htd {
+            let mut hasher = FarmHashBuilder.build_hasher();
+            hasher.write(tt.in_.as_bytes());
+
+            assert_eq!(hasher.finish(), tt.oh64, "FarmHasher({:?})", tt.in_);
+        }
+    }
+
+    #[test]
+    fn test_farmhasher_splits() {
+        let data = data_setup();
+        let mut x: u64 = 0x9e3779b97f4a7c15;
+
+        for slen in (0..600).chain([1000, 4095, 4096, 4097, 100000]) {
+            let s = &data[..slen];
+            let exp = farmhash64(s);
+
+            // one byte at a time
+            let mut hasher = FarmHasher::new();
+            for b in s {
+                hasher.write_u8(*b);
+            }
+            assert_eq!(hasher.finish(), exp, "byte writes, len={}", slen);
+
+            // random chunks, checking finish after every write
+            let mut hasher = FarmHasher::new();
+            let mut pos = 0;
+            while pos < slen {
+                x ^= x << 13;
+                x ^= x >> 7;
+                x ^= x << 17;
+                let n = ((x % 200) as usize).min(slen - pos);
+                hasher.write(&s[pos..pos + n]);
+                pos += n;
+                assert_eq!(
+                    hasher.finish(),
+                    farmhash64(&s[..pos]),
+                    "chunked writes, len={}",
+                    pos
+                );
+            }
+            assert_eq!(hasher.finish(), exp, "chunked writes, len={}", slen);
+        }
+    }
+
+    #[test]
+    fn test_farmhash_builder_hashmap() {
+        let mut map: HashMap<&str, usize, FarmHashBuilder> = HashMap::with_hasher(FarmHashBuilder);
+        let htd = hash_test_data();
+
+        for (i, tt) in htd.iter().enumerate() {
+            map.insert(tt.in_, i);
+        }
+
+        for (i, tt) in htd.iter().enumerate() {
+            assert_eq!(map.get(tt.in_), Some(&i));
+        }
+
+        assert_eq!(
+            FarmHashBuilder.hash_one(42u64),
+            FarmHashBuilder.hash_one(42u64)
+        );
+    }
+
+    #[test]
+    fn test_farmhash64_batch() {
+        let htd = hash_test_data();
+        let keys: Vec<&str> = htd.iter().map(|tt| tt.in_).collect();
+        let mut out = vec![0u64; keys.len() + 1];
+
+        farmhash64_batch(&keys, &mut out);
+
+        for (i, tt) in htd.iter().enumerate() {
+            assert_eq!(out[i], tt.oh64, "farmhash64_batch({:?})", tt.in_);
+        }
+        assert_eq!(out[keys.len()], 0);
+    }
 }
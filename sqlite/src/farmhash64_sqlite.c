@@ -0,0 +1,198 @@
+// SQLite farmhash64 Extension
+//
+// Loadable extension with the farmhash64 SQL functions, built on the header-only C implementation:
+//
+//   farmhash64(X)      64-bit hash of X, as a signed 64-bit integer (the same bits as the unsigned C result);
+//   farmhash64(X, S)   64-bit hash of X with the seed S (farmhash64_with_seed);
+//   farmhash32(X)      32-bit hash of X, as a non-negative integer;
+//   farmhash64_agg(X)  order-independent fingerprint of the X values of a group (NULLs are skipped),
+//                      also usable as a window function.
+//
+// BLOB values are hashed in place, without copying. TEXT values are hashed as UTF-8 (in place unless the
+// database uses a UTF-16 encoding), and numbers as their text representation, like CAST(X AS TEXT).
+// A NULL argument returns NULL. The scalar functions are deterministic, so they can be used in indexes,
+// generated columns and CHECK constraints. printf('%016x', farmhash64(X)) gives the usual hexadecimal form.
+//
+// Build with "make build", then load the extension:
+//   sqlite> .load ./target/farmhash64
+//   sqlite> SELECT farmhash64(key) % 16 AS shard, count(*) FROM t GROUP BY shard;
+//
+// @category   Libraries
+// @author     Nicola Asuni <nicola.asuni@tecnick.com>
+// @license    MIT (see LICENSE)
+// @link       https://github.com/tecnickcom/farmhash64
+
+#include <sqlite3ext.h>
+#include "../../c/src/farmhash64.h"
+
+SQLITE_EXTENSION_INIT1
+
+#ifndef SQLITE_INNOCUOUS
+#define SQLITE_INNOCUOUS 0
+#endif
+
+// flags of all the functions
+#define FH_FLAGS (SQLITE_UTF8 | SQLITE_DETERMINISTIC | SQLITE_INNOCUOUS)
+
+// seed of the mix of the second sum of farmhash64_agg
+#define FH_AGG_MUL 0x9ae16a3b2f90404fULL
+
+// State of farmhash64_agg: the number of values and two wrapping sums over their hashes.
+// Sums do not depend on the order of the rows, and a row can be removed again (window frames).
+typedef struct fh_agg_t
+{
+    sqlite3_int64 count; // number of non-NULL values
+    uint64_t sum;        // sum of the hashes
+    uint64_t mixsum;     // sum of a non-linear mix of the hashes
+} fh_agg_t;
+
+// Sets s/len to the bytes of a value.
+// Returns 0 for NULL, 1 for a value, -1 when the conversion to text ran out of memory.
+static int fh_value_bytes(sqlite3_value *v, const char **s, size_t *len)
+{
+    int type = sqlite3_value_type(v);
+    if (type == SQLITE_NULL)
+    {
+        return 0;
+    }
+    // the pointer must be taken before the size, which can change with the conversion to text
+    *s = (type == SQLITE_BLOB) ? (const char *)sqlite3_value_blob(v) : (const char *)sqlite3_value_text(v);
+    *len = (size_t)sqlite3_value_bytes(v);
+    if (*s == NULL)
+    {
+        if ((type != SQLITE_BLOB) || (*len > 0))
+        {
+            return -1;
+        }
+        *s = ""; // empty BLOB
+    }
+    return 1;
+}
+
+// farmhash64(X) and farmhash64(X, S)
+static void fh_farmhash64(sqlite3_context *ctx, int argc, sqlite3_value **argv)
+{
+    const char *s = NULL;
+    size_t len = 0;
+    int ret = fh_value_bytes(argv[0], &s, &len);
+    if ((ret == 0) || ((argc > 1) && (sqlite3_value_type(argv[1]) == SQLITE_NULL)))
+    {
+        return; // NULL
+    }
+    if (ret < 0)
+    {
+        sqlite3_result_error_nomem(ctx);
+        return;
+    }
+    uint64_t h = (argc > 1) ? farmhash64_with_seed(s, len, (uint64_t)sqlite3_value_int64(argv[1])) : farmhash64(s, len);
+    sqlite3_result_int64(ctx, (sqlite3_int64)h);
+}
+
+// farmhash32(X)
+static void fh_farmhash32(sqlite3_context *ctx, int argc, sqlite3_value **argv)
+{
+    const char *s = NULL;
+    size_t len = 0;
+    (void)argc;
+    int ret = fh_value_bytes(argv[0], &s, &len);
+    if (ret == 0)
+    {
+        return;
+    }
+    if (ret < 0)
+    {
+        sqlite3_result_error_nomem(ctx);
+        return;
+    }
+    sqlite3_result_int64(ctx, (sqlite3_int64)farmhash32(s, len));
+}
+
+// Adds (sign 1) or removes (sign -1) a value from the farmhash64_agg state.
+static void fh_agg_update(sqlite3_context *ctx, sqlite3_value *v, int sign)
+{
+    const char *s = NULL;
+    size_t len = 0;
+    int ret = fh_value_bytes(v, &s, &len);
+    if (ret == 0)
+    {
+        return;
+    }
+    fh_agg_t *a = (fh_agg_t *)sqlite3_aggregate_context(ctx, sizeof(fh_agg_t));
+    if ((ret < 0) || (a == NULL))
+    {
+        sqlite3_result_error_nomem(ctx);
+        return;
+    }
+    uint64_t h = farmhash64(s, len);
+    uint64_t m = farmhash64_reseed(h, 0, FH_AGG_MUL);
+    if (sign > 0)
+    {
+        a->count++;
+        a->sum += h;
+        a->mixsum += m;
+    }
+    else
+    {
+        a->count--;
+        a->sum -= h;
+        a->mixsum -= m;
+    }
+}
+
+static void fh_agg_step(sqlite3_context *ctx, int argc, sqlite3_value **argv)
+{
+    (void)argc;
+    fh_agg_update(ctx, argv[0], 1);
+}
+
+static void fh_agg_inverse(sqlite3_context *ctx, int argc, sqlite3_value **argv)
+{
+    (void)argc;
+    fh_agg_update(ctx, argv[0], -1);
+}
+
+// Returns the fingerprint of the current state (0 for a group without non-NULL values).
+static void fh_agg_value(sqlite3_context *ctx)
+{
+    const fh_agg_t *a = (const fh_agg_t *)sqlite3_aggregate_context(ctx, 0);
+    fh_agg_t empty = {0, 0, 0};
+    if (a == NULL)
+    {
+        a = &empty;
+    }
+    uint64_t h = farmhash64_reseed(farmhash64_reseed((uint64_t)a->count, 0, a->sum), 0, a->mixsum);
+    sqlite3_result_int64(ctx, (sqlite3_int64)h);
+}
+
+/**
+ * Extension entry point, called by sqlite3_load_extension.
+ * SQLite derives its name from the letters of the file name: farmhash64.so -> sqlite3_farmhash_init.
+ *
+ * @param db       Database connection.
+ * @param pzErrMsg Error message output (unused).
+ * @param pApi     SQLite API routines.
+ *
+ * @return SQLITE_OK on success, or an SQLite error code.
+ */
+#ifdef _WIN32
+__declspec(dllexport)
+#endif
+int sqlite3_farmhash_init(sqlite3 *db, char **pzErrMsg, const sqlite3_api_routines *pApi)
+{
+    (void)pzErrMsg;
+    SQLITE_EXTENSION_INIT2(pApi);
+    int rc = sqlite3_create_function(db, "farmhash64", 1, FH_FLAGS, NULL, fh_farmhash64, NULL, NULL);
+    if (rc == SQLITE_OK)
+    {
+        rc = sqlite3_create_function(db, "farmhash64", 2, FH_FLAGS, NULL, fh_farmhash64, NULL, NULL);
+    }
+    if (rc == SQLITE_OK)
+    {
+        rc = sqlite3_create_function(db, "farmhash32", 1, FH_FLAGS, NULL, fh_farmhash32, NULL, NULL);
+    }
+    if (rc == SQLITE_OK)
+    {
+        rc = sqlite3_create_window_function(db, "farmhash64_agg", 1, FH_FLAGS, NULL, fh_agg_step, fh_agg_value, fh_agg_value, fh_agg_inverse, NULL);
+    }
+    return rc;
+}
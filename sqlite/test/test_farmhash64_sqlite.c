@@ -0,0 +1,240 @@
+// Nicola Asuni
+
+#if __STDC_VERSION__ >= 199901L
+#define _XOPEN_SOURCE 600
+#else
+#define _XOPEN_SOURCE 500
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sqlite3.h>
+#include "../../c/src/farmhash64.h"
+
+#define k_data_size (1 << 16)
+
+static const int k_bench_rows = 1 << 20;
+static const int k_bench_key = 32;
+
+static char data[k_data_size];
+
+// returns current time in nanoseconds
+uint64_t get_time()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (((uint64_t)t.tv_sec * 1000000000) + (uint64_t)t.tv_nsec);
+}
+
+// same pseudorandom data as the C tests
+void data_setup()
+{
+    static const uint64_t kt = 0xc3a5c85c97cb3127ULL;
+    uint64_t a = 9;
+    uint64_t b = 777;
+    uint8_t u = 0;
+    for (int i = 0; i < k_data_size; i++)
+    {
+        a += b;
+        b += a;
+        a = (a ^ (a >> 41)) * kt;
+        b = (b ^ (b >> 41)) * kt + i;
+        u = b >> 37;
+        memcpy(data + i, &u, 1);  // uint8_t -> char
+    }
+}
+
+// runs a statement and returns the first column of its single row (or -1 on error); sets *isnull for NULL
+static sqlite3_int64 query_int(sqlite3 *db, const char *sql, int *isnull)
+{
+    sqlite3_stmt *st = NULL;
+    sqlite3_int64 v = -1;
+    if (sqlite3_prepare_v2(db, sql, -1, &st, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "%s : %s\n", sql, sqlite3_errmsg(db));
+        return -1;
+    }
+    if (sqlite3_step(st) == SQLITE_ROW)
+    {
+        *isnull = (sqlite3_column_type(st, 0) == SQLITE_NULL);
+        v = sqlite3_column_int64(st, 0);
+    }
+    sqlite3_finalize(st);
+    return v;
+}
+
+static int exec(sqlite3 *db, const char *sql)
+{
+    char *err = NULL;
+    if (sqlite3_exec(db, sql, NULL, NULL, &err) != SQLITE_OK)
+    {
+        fprintf(stderr, "%s : %s\n", sql, err);
+        sqlite3_free(err);
+        return 1;
+    }
+    return 0;
+}
+
+int test_farmhash64_sqlite_scalar(sqlite3 *db)
+{
+    int errors = 0;
+    sqlite3_stmt *st = NULL;
+    if (sqlite3_prepare_v2(db, "SELECT farmhash64(?1), farmhash64(CAST(?1 AS TEXT)), farmhash32(?1), farmhash64(?1, ?2)", -1, &st, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "%s : %s\n", __func__, sqlite3_errmsg(db));
+        return 1;
+    }
+    int len;
+    for (len = 0; len < 4096; len = (len < 130) ? len + 1 : len + 97)
+    {
+        const char *s = data + (len % 7);
+        uint64_t seed = (uint64_t)len * 0x9e3779b97f4a7c15ULL;
+        sqlite3_bind_blob(st, 1, s, len, SQLITE_STATIC);
+        sqlite3_bind_int64(st, 2, (sqlite3_int64)seed);
+        if ((sqlite3_step(st) != SQLITE_ROW) ||
+                ((uint64_t)sqlite3_column_int64(st, 0) != farmhash64(s, (size_t)len)) ||
+                ((uint64_t)sqlite3_column_int64(st, 1) != farmhash64(s, (size_t)len)) ||
+                (sqlite3_column_int64(st, 2) != (sqlite3_int64)farmhash32(s, (size_t)len)) ||
+                ((uint64_t)sqlite3_column_int64(st, 3) != farmhash64_with_seed(s, (size_t)len, seed)))
+        {
+            fprintf(stderr, "%s : mismatch for a BLOB of %d bytes\n", __func__, len);
+            ++errors;
+        }
+        sqlite3_reset(st);
+    }
+    sqlite3_finalize(st);
+    int isnull = 0;
+    // text as UTF-8, numbers as text, NULL
+    static const char *const text = "hello 中文";
+    errors += ((uint64_t)query_int(db, "SELECT farmhash64('hello 中文')", &isnull) != farmhash64(text, strlen(text))) || isnull;
+    errors += ((uint64_t)query_int(db, "SELECT farmhash64(12345)", &isnull) != farmhash64("12345", 5)) || isnull;
+    errors += ((uint64_t)query_int(db, "SELECT farmhash64(x'')", &isnull) != farmhash64("", 0)) || isnull;
+    errors += ((uint64_t)query_int(db, "SELECT farmhash32('')", &isnull) != farmhash32("", 0)) || isnull;
+    query_int(db, "SELECT farmhash64(NULL)", &isnull);
+    errors += !isnull;
+    query_int(db, "SELECT farmhash64('a', NULL)", &isnull);
+    errors += !isnull;
+    query_int(db, "SELECT farmhash32(NULL)", &isnull);
+    errors += !isnull;
+    // deterministic: allowed in expression indexes
+    errors += exec(db, "CREATE TABLE t_idx (k TEXT); CREATE INDEX t_idx_h ON t_idx (farmhash64(k) % 16); DROP TABLE t_idx;");
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors\n", __func__, errors);
+    }
+    return errors;
+}
+
+int test_farmhash64_sqlite_agg(sqlite3 *db)
+{
+    int errors = 0;
+    int isnull = 0;
+    errors += exec(db, "CREATE TABLE t1 (id INTEGER PRIMARY KEY, k); CREATE TABLE t2 (id INTEGER PRIMARY KEY, k);"
+                   "WITH RECURSIVE c(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM c WHERE i < 1000) "
+                   "INSERT INTO t1 (k) SELECT CASE WHEN i % 10 = 0 THEN NULL ELSE 'key' || (i % 700) END FROM c;"
+                   "INSERT INTO t2 (k) SELECT k FROM t1 ORDER BY farmhash64(id);");
+    sqlite3_int64 h1 = query_int(db, "SELECT farmhash64_agg(k) FROM t1", &isnull);
+    sqlite3_int64 h2 = query_int(db, "SELECT farmhash64_agg(k) FROM t2", &isnull);
+    if (h1 != h2)
+    {
+        fprintf(stderr, "%s : the fingerprint depends on the row order\n", __func__);
+        ++errors;
+    }
+    // one changed, one duplicated and one removed row
+    errors += exec(db, "UPDATE t2 SET k = k || 'x' WHERE id = (SELECT min(id) FROM t2 WHERE k IS NOT NULL)");
+    errors += (query_int(db, "SELECT farmhash64_agg(k) FROM t2", &isnull) == h1);
+    errors += exec(db, "UPDATE t2 SET k = substr(k, 1, length(k) - 1) WHERE id = (SELECT min(id) FROM t2 WHERE k IS NOT NULL);"
+                   "INSERT INTO t2 (k) VALUES ('key1');");
+    errors += (query_int(db, "SELECT farmhash64_agg(k) FROM t2", &isnull) == h1);
+    errors += exec(db, "DELETE FROM t2 WHERE id = (SELECT max(id) FROM t2)");
+    errors += (query_int(db, "SELECT farmhash64_agg(k) FROM t2", &isnull) != h1);
+    errors += exec(db, "DELETE FROM t2 WHERE id = (SELECT min(id) FROM t2 WHERE k IS NOT NULL)");
+    errors += (query_int(db, "SELECT farmhash64_agg(k) FROM t2", &isnull) == h1);
+    // empty and all-NULL groups have the same fixed fingerprint
+    sqlite3_int64 e1 = query_int(db, "SELECT farmhash64_agg(k) FROM t1 WHERE id < 0", &isnull);
+    errors += isnull;
+    errors += (query_int(db, "SELECT farmhash64_agg(k) FROM t1 WHERE k IS NULL", &isnull) != e1);
+    // window frames (with inverse steps) match the plain aggregate of the same rows
+    errors += (query_int(db, "SELECT count(*) FROM (SELECT id, farmhash64_agg(k) OVER (ORDER BY id ROWS BETWEEN 3 PRECEDING AND 1 FOLLOWING) AS w FROM t1) AS a "
+                         "WHERE w != (SELECT farmhash64_agg(k) FROM t1 AS b WHERE b.id BETWEEN a.id - 3 AND a.id + 1)", &isnull) != 0);
+    errors += exec(db, "DROP TABLE t1; DROP TABLE t2;");
+    if (errors > 0)
+    {
+        fprintf(stderr, "%s : %d errors\n", __func__, errors);
+    }
+    return errors;
+}
+
+// hashes every row in the query engine, then pulls every row into the application to hash it
+int benchmark_farmhash64_sqlite(sqlite3 *db)
+{
+    int errors = 0;
+    sqlite3_stmt *st = NULL;
+    errors += exec(db, "CREATE TABLE b (k BLOB)");
+    errors += exec(db, "BEGIN");
+    sqlite3_prepare_v2(db, "INSERT INTO b (k) VALUES (?1)", -1, &st, NULL);
+    int i;
+    for (i = 0; i < k_bench_rows; i++)
+    {
+        sqlite3_bind_blob(st, 1, data + (i % (k_data_size - k_bench_key)), k_bench_key, SQLITE_STATIC);
+        sqlite3_step(st);
+        sqlite3_reset(st);
+    }
+    sqlite3_finalize(st);
+    errors += exec(db, "COMMIT");
+    int isnull = 0;
+    uint64_t tstart = get_time();
+    query_int(db, "SELECT count(k) FROM b", &isnull);
+    uint64_t tscan = get_time() - tstart;
+    tstart = get_time();
+    uint64_t sql = (uint64_t)query_int(db, "SELECT sum(farmhash64(k) & 0xFFFF) FROM b", &isnull);
+    uint64_t tsql = get_time() - tstart;
+    tstart = get_time();
+    uint64_t app = 0;
+    sqlite3_prepare_v2(db, "SELECT k FROM b", -1, &st, NULL);
+    while (sqlite3_step(st) == SQLITE_ROW)
+    {
+        app += farmhash64((const char *)sqlite3_column_blob(st, 0), (size_t)sqlite3_column_bytes(st, 0)) & 0xFFFF;
+    }
+    sqlite3_finalize(st);
+    uint64_t tapp = get_time() - tstart;
+    errors += (sql != app);
+    tstart = get_time();
+    query_int(db, "SELECT farmhash64_agg(k) FROM b", &isnull);
+    uint64_t tagg = get_time() - tstart;
+    fprintf(stdout, " * %s : %d rows of %d bytes : scan %6.1f ns/row : farmhash64 in SQL %6.1f ns/row : rows hashed by the application %6.1f ns/row : farmhash64_agg %6.1f ns/row\n",
+            __func__, k_bench_rows, k_bench_key, (double)tscan / k_bench_rows, (double)tsql / k_bench_rows, (double)tapp / k_bench_rows, (double)tagg / k_bench_rows);
+    errors += exec(db, "DROP TABLE b");
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+    int errors = 0;
+    sqlite3 *db = NULL;
+    char *err = NULL;
+
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <extension>\n", argv[0]);
+        return 1;
+    }
+    data_setup();
+    if ((sqlite3_open(":memory:", &db) != SQLITE_OK) ||
+            (sqlite3_enable_load_extension(db, 1) != SQLITE_OK) ||
+            (sqlite3_load_extension(db, argv[1], NULL, &err) != SQLITE_OK))
+    {
+        fprintf(stderr, "unable to load %s: %s\n", argv[1], (err != NULL) ? err : sqlite3_errmsg(db));
+        sqlite3_free(err);
+        sqlite3_close(db);
+        return 1;
+    }
+
+    errors += test_farmhash64_sqlite_scalar(db);
+    errors += test_farmhash64_sqlite_agg(db);
+    errors += benchmark_farmhash64_sqlite(db);
+
+    sqlite3_close(db);
+    return errors;
+}
@@ -44,4 +44,18 @@ pub fn build(b: *std.Build) void {
     // This will evaluate the `test` step rather than the default, which is "install".
     const test_step = b.step("test", "Run library tests");
     test_step.dependOn(&run_main_tests.step);
+
+    // Creates a benchmark executable, always optimized for speed.
+    // Run it with `zig build bench`.
+    const bench = b.addExecutable(.{
+        .name = "bench_farmhash64",
+        .root_source_file = .{ .path = "src/bench_farmhash64.zig" },
+        .target = target,
+        .optimize = .ReleaseFast,
+    });
+
+    const run_bench = b.addRunArtifact(bench);
+
+    const bench_step = b.step("bench", "Run the throughput benchmarks");
+    bench_step.dependOn(&run_bench.step);
 }
@@ -0,0 +1,66 @@
+//! Throughput benchmark for the farmhash64 functions: run with `zig build bench`.
+
+const std = @import("std");
+const farmhash64 = @import("farmhash64.zig").farmhash64;
+const farmhash64Lanes = @import("farmhash64.zig").farmhash64Lanes;
+
+const DATA_SIZE: usize = 1 << 20;
+const TOTAL_BYTES: usize = 1 << 28; // bytes hashed for each length
+
+var data: [DATA_SIZE]u8 = undefined;
+
+fn bench_farmhash64(writer: anytype, len: usize) !void {
+    const iter: usize = @max(TOTAL_BYTES / @max(len, 1) / 16, 1);
+    var h: u64 = 0;
+    var timer = try std.time.Timer.start();
+    for (0..iter) |i| {
+        const off: usize = i & 1023;
+        h +%= farmhash64(data[off..(off + len)]);
+    }
+    const ns: u64 = @max(timer.read(), 1);
+    std.mem.doNotOptimizeAway(h);
+    const per_hash: f64 = @as(f64, @floatFromInt(ns)) / @as(f64, @floatFromInt(iter));
+    const mbs: f64 = @as(f64, @floatFromInt(iter * len)) * 1000.0 / @as(f64, @floatFromInt(ns));
+    try writer.print("farmhash64          len {d:>7} : {d:>10.2} ns/hash {d:>10.2} MB/s\n", .{ len, per_hash, mbs });
+}
+
+fn bench_farmhash64_lanes(writer: anytype, comptime N: usize, comptime len: usize) !void {
+    const iter: usize = @max(TOTAL_BYTES / (N * len) / 16, 1);
+    var keys: [N][len]u8 = undefined;
+    for (0..N) |l| {
+        @memcpy(&keys[l], data[(l * 64)..((l * 64) + len)]);
+    }
+    var h: u64 = 0;
+    var timer = try std.time.Timer.start();
+    for (0..iter) |i| {
+        // change and use every lane, so that none of them can be hoisted out of the loop
+        for (0..N) |l| {
+            keys[l][0] = @as(u8, @truncate(i +% l));
+        }
+        const r = farmhash64Lanes(N, len, &keys);
+        for (r) |x| {
+            h +%= x;
+        }
+    }
+    const ns: u64 = @max(timer.read(), 1);
+    std.mem.doNotOptimizeAway(h);
+    const per_hash: f64 = @as(f64, @floatFromInt(ns)) / @as(f64, @floatFromInt(iter * N));
+    const mbs: f64 = @as(f64, @floatFromInt(iter * N * len)) * 1000.0 / @as(f64, @floatFromInt(ns));
+    try writer.print("farmhash64Lanes({d:>2}) len {d:>7} : {d:>10.2} ns/hash {d:>10.2} MB/s\n", .{ N, len, per_hash, mbs });
+}
+
+pub fn main() !void {
+    const stdout = std.io.getStdOut().writer();
+
+    for (0..DATA_SIZE) |i| {
+        data[i] = @as(u8, @truncate((i * 31) ^ (i >> 7)));
+    }
+
+    for ([_]usize{ 8, 16, 32, 64, 128, 256, 1024, 4096, 65536 }) |len| {
+        try bench_farmhash64(stdout, len);
+    }
+    inline for (.{ 8, 16, 32, 64 }) |len| {
+        try bench_farmhash64_lanes(stdout, 4, len);
+        try bench_farmhash64_lanes(stdout, 8, len);
+    }
+}
@@ -11,6 +11,12 @@
 //! This is a Zig port of the Fingerprint64 (farmhashna::Hash64) code from Google's FarmHash (https://github.com/google/farmhash).
 //!
 //! This code has been ported/translated by Nicola Asuni (Tecnick.com) to Zig code.
+//!
+//! All the functions can also be evaluated at comptime (see farmhash64Comptime),
+//! farmhash64Lanes hashes several fixed-length keys in parallel using @Vector lanes,
+//! and FarmHashContext / FarmHashArrayContext plug farmhash into std.HashMap / std.ArrayHashMap.
+
+const std = @import("std");
 
 // BASICS
 
@@ -267,3 +273,246 @@ pub fn farmhash64(s: []const u8) u64 {
 pub fn farmhash32(s: []const u8) u32 {
     return mix_64_to_32(farmhash64(s));
 }
+
+// COMPTIME
+
+/// Returns the farmhash64 of a comptime-known string, computed during compilation.
+/// This can be used to build switch tables and static maps keyed by hash, e.g.:
+/// `switch (farmhash64(s)) { farmhash64Comptime("GET") => ..., else => ... }`.
+pub fn farmhash64Comptime(comptime s: []const u8) u64 {
+    return comptime blk: {
+        @setEvalBranchQuota(1000 + 10 * s.len);
+        break :blk farmhash64(s);
+    };
+}
+
+/// Returns the farmhash32 of a comptime-known string, computed during compilation.
+pub fn farmhash32Comptime(comptime s: []const u8) u32 {
+    return comptime mix_64_to_32(farmhash64Comptime(s));
+}
+
+// HASH MAP CONTEXTS
+
+/// std.HashMap context for string keys, e.g.:
+/// `std.HashMap([]const u8, V, FarmHashContext, std.hash_map.default_max_load_percentage)`.
+pub const FarmHashContext = struct {
+    pub fn hash(self: @This(), s: []const u8) u64 {
+        _ = self;
+        return farmhash64(s);
+    }
+
+    pub fn eql(self: @This(), a: []const u8, b: []const u8) bool {
+        _ = self;
+        return std.mem.eql(u8, a, b);
+    }
+};
+
+/// std.ArrayHashMap context for string keys, e.g.:
+/// `std.ArrayHashMap([]const u8, V, FarmHashArrayContext, true)`.
+pub const FarmHashArrayContext = struct {
+    pub fn hash(self: @This(), s: []const u8) u32 {
+        _ = self;
+        return farmhash32(s);
+    }
+
+    pub fn eql(self: @This(), a: []const u8, b: []const u8, b_index: usize) bool {
+        _ = self;
+        _ = b_index;
+        return std.mem.eql(u8, a, b);
+    }
+};
+
+// MULTI-LANE KERNEL
+
+/// Hashes N keys of the same comptime-known length in parallel, one key per @Vector lane.
+/// The length class is selected at compile time, so all the lanes run the same instructions.
+/// Returns the same values as calling farmhash64 on each key.
+pub fn farmhash64Lanes(comptime N: usize, comptime len: usize, keys: *const [N][len]u8) [N]u64 {
+    return Lanes(N, len).hash(keys);
+}
+
+fn Lanes(comptime N: usize, comptime len: usize) type {
+    return struct {
+        const V = @Vector(N, u64);
+        const Keys = *const [N][len]u8;
+
+        fn splat(x: u64) V {
+            return @splat(x);
+        }
+
+        fn rot(v: V, comptime shift: u6) V {
+            const r: @Vector(N, u6) = @splat(shift);
+            const l: @Vector(N, u6) = @splat(@as(u6, @intCast(64 - @as(u7, shift))));
+            return (v >> r) | (v << l);
+        }
+
+        fn shr(v: V, comptime shift: u6) V {
+            const r: @Vector(N, u6) = @splat(shift);
+            return v >> r;
+        }
+
+        fn shl(v: V, comptime shift: u6) V {
+            const l: @Vector(N, u6) = @splat(shift);
+            return v << l;
+        }
+
+        fn load64(keys: Keys, idx: usize) V {
+            var r: [N]u64 = undefined;
+            inline for (0..N) |l| {
+                r[l] = fetch64(&keys[l], idx);
+            }
+            return r;
+        }
+
+        fn load32(keys: Keys, idx: usize) V {
+            var r: [N]u64 = undefined;
+            inline for (0..N) |l| {
+                r[l] = fetch32(&keys[l], idx);
+            }
+            return r;
+        }
+
+        fn load8(keys: Keys, idx: usize) V {
+            var r: [N]u64 = undefined;
+            inline for (0..N) |l| {
+                r[l] = keys[l][idx];
+            }
+            return r;
+        }
+
+        fn lanes_hash_len_16_mul(u: V, v: V, mul: V) V {
+            var a: V = (u ^ v) *% mul;
+            a = a ^ shr(a, 47);
+            var b: V = (v ^ a) *% mul;
+            b = b ^ shr(b, 47);
+            return b *% mul;
+        }
+
+        fn lanes_hash_len_0_to_16(keys: Keys) V {
+            const mul = splat(K2 +% (@as(u64, len) *% 2));
+            if (len >= 8) {
+                const a: V = load64(keys, 0) +% splat(K2);
+                const b: V = load64(keys, len - 8);
+                const c: V = rot(b, 37) *% mul +% a;
+                const d: V = (rot(a, 25) +% b) *% mul;
+                return lanes_hash_len_16_mul(c, d, mul);
+            }
+            if (len >= 4) {
+                const a: V = load32(keys, 0);
+                return lanes_hash_len_16_mul(splat(len) +% shl(a, 3), load32(keys, len - 4), mul);
+            }
+            if (len > 0) {
+                const y: V = load8(keys, 0) +% shl(load8(keys, len >> 1), 8);
+                const z: V = splat(len) +% shl(load8(keys, len - 1), 2);
+                const m: V = (y *% splat(K2)) ^ (z *% splat(K0));
+                return (m ^ shr(m, 47)) *% splat(K2);
+            }
+            return splat(K2);
+        }
+
+        fn lanes_hash_len_17_to_32(keys: Keys) V {
+            const mul = splat(K2 +% (@as(u64, len) *% 2));
+            const a: V = load64(keys, 0) *% splat(K1);
+            const b: V = load64(keys, 8);
+            const c: V = load64(keys, len - 8) *% mul;
+            const d: V = load64(keys, len - 16) *% splat(K2);
+            return lanes_hash_len_16_mul(
+                rot(a +% b, 43) +% rot(c, 30) +% d,
+                a +% rot(b +% splat(K2), 18) +% c,
+                mul,
+            );
+        }
+
+        fn lanes_hash_len_33_to_64(keys: Keys) V {
+            const mul = splat(K2 +% (@as(u64, len) *% 2));
+            const a: V = load64(keys, 0) *% splat(K2);
+            const b: V = load64(keys, 8);
+            const c: V = load64(keys, len - 8) *% mul;
+            const d: V = load64(keys, len - 16) *% splat(K2);
+            const y: V = rot(a +% b, 43) +% rot(c, 30) +% d;
+            const z: V = lanes_hash_len_16_mul(y, a +% rot(b +% splat(K2), 18) +% c, mul);
+            const e: V = load64(keys, 16) *% mul;
+            const f: V = load64(keys, 24);
+            const g: V = (y +% load64(keys, len - 32)) *% mul;
+            const h: V = (z +% load64(keys, len - 24)) *% mul;
+            return lanes_hash_len_16_mul(
+                rot(e +% f, 43) +% rot(g, 30) +% h,
+                e +% rot(f +% a, 18) +% g,
+                mul,
+            );
+        }
+
+        // Vector version of weak_hash_len_32_with_seeds: returns {hi, lo}.
+        fn lanes_weak_hash_len_32_with_seeds(keys: Keys, idx: usize, pa: V, pb: V) [2]V {
+            const z: V = load64(keys, idx + 24);
+            var a: V = pa +% load64(keys, idx);
+            var b: V = rot(pb +% a +% z, 21);
+            const c: V = a;
+            a = a +% load64(keys, idx + 8);
+            a = a +% load64(keys, idx + 16);
+            b = b +% rot(a, 44);
+            return .{ b +% c, a +% z };
+        }
+
+        fn lanes_hash_len_65_plus(keys: Keys) V {
+            var v = [2]V{ splat(0), splat(0) };
+            var w = [2]V{ splat(0), splat(0) };
+            var x: V = splat(81 *% K2) +% load64(keys, 0);
+            var y: V = splat((81 *% K1) +% 113);
+            var z: V = splat(shift_mix(((81 *% K1 +% 113) *% K2) +% 113) *% K2);
+            const k1 = splat(K1);
+
+            const end_idx: usize = ((len - 1) >> 6) << 6;
+            const last64_idx: usize = end_idx + ((len - 1) & 63) - 63;
+            var idx: usize = 0;
+
+            while (idx < end_idx) : (idx += 64) {
+                x = rot(x +% y +% v[1] +% load64(keys, idx + 8), 37) *% k1;
+                y = rot(y +% v[0] +% load64(keys, idx + 48), 42) *% k1;
+                x ^= w[0];
+                y = y +% v[1] +% load64(keys, idx + 40);
+                z = rot(z +% w[1], 33) *% k1;
+                v = lanes_weak_hash_len_32_with_seeds(keys, idx, v[0] *% k1, x +% w[1]);
+                w = lanes_weak_hash_len_32_with_seeds(keys, idx + 32, z +% w[0], y +% load64(keys, idx + 16));
+                const tmp = x;
+                x = z;
+                z = tmp;
+            }
+
+            // The multiplier of the last block depends on the lane.
+            const mul: V = k1 +% shl(z & splat(0xff), 1);
+            idx = last64_idx;
+            w[1] +%= splat((len - 1) & 63);
+            v[1] +%= w[1];
+            w[1] +%= v[1];
+            x = rot(x +% y +% v[1] +% load64(keys, idx + 8), 37) *% mul;
+            y = rot(y +% v[0] +% load64(keys, idx + 48), 42) *% mul;
+            x ^= w[0] *% splat(9);
+            y = y +% (v[1] *% splat(9)) +% load64(keys, idx + 40);
+            z = rot(z +% w[1], 33) *% mul;
+            v = lanes_weak_hash_len_32_with_seeds(keys, idx, v[0] *% mul, x +% w[1]);
+            w = lanes_weak_hash_len_32_with_seeds(keys, idx + 32, z +% w[0], y +% load64(keys, idx + 16));
+            const tmp = x;
+            x = z;
+            z = tmp;
+
+            return lanes_hash_len_16_mul(
+                lanes_hash_len_16_mul(v[1], w[1], mul) +% ((y ^ shr(y, 47)) *% splat(K0)) +% z,
+                lanes_hash_len_16_mul(v[0], w[0], mul) +% x,
+                mul,
+            );
+        }
+
+        fn hash(keys: Keys) [N]u64 {
+            const h: V = if (len <= 16)
+                lanes_hash_len_0_to_16(keys)
+            else if (len <= 32)
+                lanes_hash_len_17_to_32(keys)
+            else if (len <= 64)
+                lanes_hash_len_33_to_64(keys)
+            else
+                lanes_hash_len_65_plus(keys);
+            return h;
+        }
+    };
+}
@@ -1,5 +1,10 @@
 const farmhash64 = @import("farmhash64.zig").farmhash64;
 const farmhash32 = @import("farmhash64.zig").farmhash32;
+const farmhash64Comptime = @import("farmhash64.zig").farmhash64Comptime;
+const farmhash32Comptime = @import("farmhash64.zig").farmhash32Comptime;
+const farmhash64Lanes = @import("farmhash64.zig").farmhash64Lanes;
+const FarmHashContext = @import("farmhash64.zig").FarmHashContext;
+const FarmHashArrayContext = @import("farmhash64.zig").FarmHashArrayContext;
 
 const std = @import("std");
 const expectEqual = std.testing.expectEqual;
@@ -233,3 +238,71 @@ test "test_farmhash64" {
 
     try test_data_item_farmhash64(&data, 0, DATA_SIZE, index);
 }
+
+test "test_farmhash64_comptime" {
+    inline for (hash_test_data) |tt| {
+        const h64 = comptime farmhash64Comptime(tt.in);
+        const h32 = comptime farmhash32Comptime(tt.in);
+        try expectEqual(tt.oh64, h64);
+        try expectEqual(tt.oh32, h32);
+    }
+}
+
+fn method_id(s: []const u8) u8 {
+    return switch (farmhash64(s)) {
+        farmhash64Comptime("GET") => 1,
+        farmhash64Comptime("POST") => 2,
+        farmhash64Comptime("DELETE") => 3,
+        else => 0,
+    };
+}
+
+test "test_farmhash64_switch" {
+    try expectEqual(@as(u8, 1), method_id("GET"));
+    try expectEqual(@as(u8, 2), method_id("POST"));
+    try expectEqual(@as(u8, 3), method_id("DELETE"));
+    try expectEqual(@as(u8, 0), method_id("PUT"));
+}
+
+fn test_lanes(comptime N: usize, comptime len: usize, data: []const u8) !void {
+    var keys: [N][len]u8 = undefined;
+    for (0..N) |l| {
+        @memcpy(&keys[l], data[(l * 131)..((l * 131) + len)]);
+    }
+    const h = farmhash64Lanes(N, len, &keys);
+    for (0..N) |l| {
+        try expectEqual(farmhash64(&keys[l]), h[l]);
+    }
+}
+
+test "test_farmhash64_lanes" {
+    var data: [4096]u8 = undefined;
+    for (0..data.len) |i| {
+        data[i] = @as(u8, @truncate((i * 31) ^ (i >> 5)));
+    }
+    inline for (.{ 0, 1, 3, 4, 7, 8, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 128, 129, 200, 1000 }) |len| {
+        try test_lanes(4, len, &data);
+        try test_lanes(8, len, &data);
+    }
+}
+
+test "test_farmhash64_hash_map" {
+    const allocator = std.testing.allocator;
+
+    var map = std.HashMap([]const u8, u32, FarmHashContext, std.hash_map.default_max_load_percentage).init(allocator);
+    defer map.deinit();
+    var amap = std.ArrayHashMap([]const u8, u32, FarmHashArrayContext, true).init(allocator);
+    defer amap.deinit();
+
+    for (hash_test_data, 0..) |tt, i| {
+        try map.put(tt.in, @as(u32, @intCast(i)));
+        try amap.put(tt.in, @as(u32, @intCast(i)));
+    }
+    try expectEqual(hash_test_data.len, map.count());
+    for (hash_test_data, 0..) |tt, i| {
+        const v: u32 = @intCast(i);
+        try expectEqual(@as(?u32, v), map.get(tt.in));
+        try expectEqual(@as(?u32, v), amap.get(tt.in));
+    }
+    try expectEqual(@as(?u32, null), map.get("not a key"));
+}